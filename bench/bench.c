@@ -0,0 +1,848 @@
+/*
+    bench.c    version 1.0
+
+    Benchmark harness for the matrix library.
+    --------------------------
+
+    Every benchmark is run for a sweep of square sizes. Each run starts
+    with warm-up repetitions, then the measured repetitions are reduced
+    to minimum, median and 99th percentile. Throughput is reported in
+    GFLOP/s for arithmetic and GB/s for memory and file traffic.
+
+    Usage: matrix_bench [--sizes 256,512,1024] [--reps 10] [--warmup 2]
+                        [--filter name] [--json file]
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "matrix.h"
+#include "matrix_f32.h"
+#include "matrix_types.h"
+#include "gemm.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "binary.h"
+#include "sparse.h"
+#include "mtx.h"
+#include "linalg.h"
+#include "eigen.h"
+#include "svd.h"
+#include "krylov.h"
+#include "batch.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define MAX_SIZES 32
+#define TEXT_FILE "bench_matrix.txt"
+#define BINARY_FILE "bench_matrix.bin"
+#define MTX_FILE "bench_matrix.mtx"
+#define SVD_RANK 20
+#define CG_ITERATIONS 100
+
+// Matrices and files shared by the setup, run and teardown of one benchmark
+typedef struct
+{
+    int n;
+    matrix* a;
+    matrix* b;
+    matrix* c;
+    matrix_f32* fa;
+    matrix_f32* fb;
+    matrix_f32* fc;
+    matrix_i32* ia;
+    matrix_i32* ib;
+    matrix_i32* ic;
+    sparse_matrix* s;
+    double file_bytes;
+    double checksum;
+} bench_state;
+
+typedef struct
+{
+    const char* name;
+    void (*setup)(bench_state* state);
+    void (*run)(bench_state* state);
+    double (*flops)(bench_state* state);    // floating point operations per run, or NULL
+    double (*bytes)(bench_state* state);    // bytes moved per run, or NULL
+} benchmark;
+
+typedef struct
+{
+    double min;
+    double median;
+    double p99;
+    double mean;
+} bench_stats;
+
+
+static double now(void) {
+    /* Returns a monotonic time in seconds. */
+
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+
+static matrix* random_matrix(int rows, int cols) {
+    /* Creates a matrix of uniform values in [-0.5, 0.5]. */
+    matrix* mat = initialize_matrix(rows, cols);
+    int i, j;
+
+    if (mat == NULL)
+    {
+        fprintf(stderr, "bench: %s\n", matrix_error_str(error));
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < rows; i++)
+    {
+        for (j = 0; j < cols; j++)
+        {
+            MATRIX_AT(mat, i, j) = (double)rand() / RAND_MAX - 0.5;
+        }
+    }
+
+    return mat;
+}
+
+
+static double file_size(const char* filename) {
+    /* Returns the size of a file in bytes. */
+    FILE* f = fopen(filename, "rb");
+    double size = 0;
+
+    if (f != NULL)
+    {
+        fseek(f, 0, SEEK_END);
+        size = (double)ftell(f);
+        fclose(f);
+    }
+
+    return size;
+}
+
+
+/* ---------------- setups ---------------- */
+
+static void setup_one(bench_state* state) {
+    state->a = random_matrix(state->n, state->n);
+}
+
+
+static void setup_two(bench_state* state) {
+    state->a = random_matrix(state->n, state->n);
+    state->b = random_matrix(state->n, state->n);
+    state->c = initialize_matrix(state->n, state->n);
+}
+
+
+static void setup_spd(bench_state* state) {
+    // a = b * b^T + n * I is symmetric positive definite
+    int i;
+
+    setup_two(state);
+    gemm(1.0, state->b, MATRIX_NO_TRANS, state->b, MATRIX_TRANS, 0.0, state->a);
+    for (i = 0; i < state->n; i++)
+    {
+        MATRIX_AT(state->a, i, i) += state->n;
+    }
+}
+
+
+static void setup_two_f32(bench_state* state) {
+    matrix* a = random_matrix(state->n, state->n);
+    matrix* b = random_matrix(state->n, state->n);
+
+    state->fa = matrix_to_f32(a);
+    state->fb = matrix_to_f32(b);
+    state->fc = initialize_matrix_f32(state->n, state->n);
+    destroy_matrix(a);
+    destroy_matrix(b);
+}
+
+
+static void setup_two_i32(bench_state* state) {
+    int i, j;
+
+    state->ia = initialize_matrix_i32(state->n, state->n);
+    state->ib = initialize_matrix_i32(state->n, state->n);
+    state->ic = initialize_matrix_i32(state->n, state->n);
+    for (i = 0; i < state->n; i++)
+    {
+        for (j = 0; j < state->n; j++)
+        {
+            MATRIX_AT(state->ia, i, j) = rand() % 100;
+            MATRIX_AT(state->ib, i, j) = rand() % 100;
+        }
+    }
+}
+
+
+static void setup_sparse(bench_state* state) {
+    // 1% of the elements are nonzero, b and c are dense n * n or n * 1 operands
+    matrix* a = create_zero_matrix(state->n, state->n);
+    int i, j;
+
+    for (i = 0; i < state->n; i++)
+    {
+        for (j = 0; j < state->n; j++)
+        {
+            if (rand() % 100 == 0)
+            {
+                MATRIX_AT(a, i, j) = (double)rand() / RAND_MAX;
+            }
+        }
+    }
+    state->s = dense_to_sparse(a, SPARSE_CSR);
+    destroy_matrix(a);
+}
+
+
+static void setup_sparse_vector(bench_state* state) {
+    setup_sparse(state);
+    state->b = random_matrix(state->n, 1);
+    state->c = initialize_matrix(state->n, 1);
+}
+
+
+static void setup_sparse_dense(bench_state* state) {
+    setup_sparse(state);
+    state->b = random_matrix(state->n, state->n);
+    state->c = initialize_matrix(state->n, state->n);
+}
+
+
+static void setup_poisson(bench_state* state) {
+    // 5-point Laplacian on an n * n grid, b and c are vectors of its n^2 unknowns
+    int unknowns = state->n * state->n, i, j, d;
+    int* rows = malloc(5 * (size_t)unknowns * sizeof(int));
+    int* cols = malloc(5 * (size_t)unknowns * sizeof(int));
+    double* values = malloc(5 * (size_t)unknowns * sizeof(double));
+    size_t nnz = 0;
+
+    for (i = 0; i < state->n; i++)
+    {
+        for (j = 0; j < state->n; j++)
+        {
+            int neighbors[4][2] = { { i - 1, j }, { i + 1, j }, { i, j - 1 }, { i, j + 1 } };
+
+            rows[nnz] = cols[nnz] = i * state->n + j;
+            values[nnz++] = 4.0;
+            for (d = 0; d < 4; d++)
+            {
+                if (neighbors[d][0] >= 0 && neighbors[d][0] < state->n && neighbors[d][1] >= 0 && neighbors[d][1] < state->n)
+                {
+                    rows[nnz] = i * state->n + j;
+                    cols[nnz] = neighbors[d][0] * state->n + neighbors[d][1];
+                    values[nnz++] = -1.0;
+                }
+            }
+        }
+    }
+    state->s = sparse_from_triplets(unknowns, unknowns, nnz, rows, cols, values, SPARSE_CSR);
+    state->b = random_matrix(unknowns, 1);
+    state->c = initialize_matrix(unknowns, 1);
+
+    free(rows);
+    free(cols);
+    free(values);
+}
+
+
+static void setup_text_file(bench_state* state) {
+    state->a = random_matrix(state->n, state->n);
+    save_to_file(state->a, TEXT_FILE, ';');
+    state->file_bytes = file_size(TEXT_FILE);
+}
+
+
+static void setup_mtx_file(bench_state* state) {
+    setup_sparse(state);
+    save_sparse_to_mtx(state->s, MTX_FILE);
+    state->file_bytes = file_size(MTX_FILE);
+}
+
+
+static void setup_binary_file(bench_state* state) {
+    state->a = random_matrix(state->n, state->n);
+    save_to_binary(state->a, BINARY_FILE);
+    state->file_bytes = file_size(BINARY_FILE);
+}
+
+
+/* ---------------- runs ---------------- */
+
+static void run_multiply_by_matrix(bench_state* state) {
+    destroy_matrix(multiply_by_matrix(state->a, state->b));
+}
+
+
+static void run_multiply_by_matrix_into(bench_state* state) {
+    multiply_by_matrix_into(state->c, state->a, state->b);
+}
+
+
+static void run_multiply_transpose_view(bench_state* state) {
+    // A^T * B read through a view, without a transposed copy of A
+    matrix* at = transpose_view(state->a);
+    multiply_by_matrix_into(state->c, at, state->b);
+    destroy_matrix(at);
+}
+
+
+static void run_multiply_by_matrix_f32(bench_state* state) {
+    multiply_by_matrix_into_f32(state->fc, state->fa, state->fb);
+}
+
+
+static void run_multiply_by_matrix_i32(bench_state* state) {
+    multiply_by_matrix_into_i32(state->ic, state->ia, state->ib);
+}
+
+
+static void run_sparse_multiply_vector(bench_state* state) {
+    sparse_multiply_vector(1.0, state->s, state->b->buffer, 0.0, state->c->buffer);
+}
+
+
+static void run_sparse_multiply_dense(bench_state* state) {
+    sparse_multiply_dense(1.0, state->s, state->b, 0.0, state->c);
+}
+
+
+static void run_sparse_multiply_sparse(bench_state* state) {
+    // A^2, as in powers of an adjacency matrix
+    destroy_sparse_matrix(sparse_multiply_sparse(state->s, state->s));
+}
+
+
+static void run_lu_factor(bench_state* state) {
+    // The copy keeps every repetition factoring the same matrix
+    int* pivots = malloc(state->n * sizeof(int));
+
+    copy_into(state->c, state->a);
+    lu_factor(state->c, pivots);
+    free(pivots);
+}
+
+
+static void run_cholesky_factor(bench_state* state) {
+    copy_into(state->c, state->a);
+    cholesky_factor(state->c, MATRIX_LOWER);
+}
+
+
+static void run_cholesky_factor_tiled(bench_state* state) {
+    copy_into(state->c, state->a);
+    cholesky_factor_tiled(state->c, MATRIX_LOWER);
+}
+
+
+static void run_qr_factor(bench_state* state) {
+    double* tau = malloc(state->n * sizeof(double));
+
+    copy_into(state->c, state->a);
+    qr_factor(state->c, tau);
+    free(tau);
+}
+
+
+static void run_eigen_symmetric(bench_state* state) {
+    double* values = malloc(state->n * sizeof(double));
+
+    eigen_symmetric(state->a, values, state->c);
+    free(values);
+}
+
+
+static void run_eigen_values(bench_state* state) {
+    double* values = malloc(state->n * sizeof(double));
+
+    eigen_symmetric(state->a, values, NULL);
+    free(values);
+}
+
+
+static void run_svd(bench_state* state) {
+    double* s = malloc(state->n * sizeof(double));
+
+    svd(state->a, s, state->b, state->c);
+    free(s);
+}
+
+
+static void run_svd_randomized(bench_state* state) {
+    double* s = malloc(SVD_RANK * sizeof(double));
+    matrix* u = matrix_view_block(state->b, 0, 0, state->n, SVD_RANK);
+    matrix* v = matrix_view_block(state->c, 0, 0, state->n, SVD_RANK);
+
+    svd_randomized(state->a, SVD_RANK, -1, 2, s, u, v);
+    destroy_matrix(u);
+    destroy_matrix(v);
+    free(s);
+}
+
+
+static void run_cg_poisson(bench_state* state) {
+    // Tolerance 0 runs all CG_ITERATIONS, the iteration rate is measured
+    linear_operator* op = sparse_operator(state->s);
+
+    memset(state->c->buffer, 0, (size_t)state->n * state->n * sizeof(double));
+    solve_cg(op, NULL, state->b->buffer, state->c->buffer, 0.0, CG_ITERATIONS);
+    destroy_operator(op);
+}
+
+
+static void run_gemm_batch(bench_state* state, int size) {
+    // n * n / size^2 products of size x size matrices packed into the buffers of a, b and c
+    int count = state->n * state->n / (size * size);
+
+    gemm_batch_strided(count, size, size, size, 1.0, state->a->buffer, size * size, state->b->buffer, size * size,
+                       0.0, state->c->buffer, size * size);
+}
+
+
+static void run_gemm_batch_4(bench_state* state) {
+    run_gemm_batch(state, 4);
+}
+
+
+static void run_gemm_batch_16(bench_state* state) {
+    run_gemm_batch(state, 16);
+}
+
+
+static void run_gemm_batch_interleaved_4(bench_state* state) {
+    gemm_batch_interleaved(state->n * state->n / 16, 4, 4, 4, 1.0, state->a->buffer, state->b->buffer, 0.0, state->c->buffer);
+}
+
+
+static void run_inverse(bench_state* state) {
+    destroy_matrix(inverse(state->a));
+}
+
+
+static void run_add_into(bench_state* state) {
+    add_into(state->c, state->a, state->b);
+}
+
+
+static void run_add_into_f32(bench_state* state) {
+    add_into_f32(state->fc, state->fa, state->fb);
+}
+
+
+static void run_transpose(bench_state* state) {
+    destroy_matrix(transpose(state->a));
+}
+
+
+static void run_transpose_into_f32(bench_state* state) {
+    transpose_into_f32(state->fc, state->fa);
+}
+
+
+static void run_transpose_inplace(bench_state* state) {
+    transpose_inplace(state->a);
+}
+
+
+static void run_save_to_file(bench_state* state) {
+    save_to_file(state->a, TEXT_FILE, ';');
+    state->file_bytes = file_size(TEXT_FILE);
+}
+
+
+static void run_read_from_file(bench_state* state) {
+    (void)state;
+    destroy_matrix(read_from_file(TEXT_FILE, ';'));
+}
+
+
+static void run_read_sparse_from_mtx(bench_state* state) {
+    (void)state;
+    destroy_sparse_matrix(read_sparse_from_mtx(MTX_FILE, SPARSE_CSR));
+}
+
+
+static void run_read_from_binary(bench_state* state) {
+    (void)state;
+    destroy_matrix(read_from_binary(BINARY_FILE));
+}
+
+
+static void run_mmap_matrix(bench_state* state) {
+    // Touches one element per page so the mapping is really populated
+    matrix* mat = mmap_matrix(BINARY_FILE, MATRIX_MAP_READ);
+    size_t count = (size_t)state->n * state->n, k;
+
+    for (k = 0; mat != NULL && k < count; k += 512)
+    {
+        state->checksum += mat->buffer[k];
+    }
+    destroy_matrix(mat);
+}
+
+
+/* ---------------- work per run ---------------- */
+
+static double gemm_flops(bench_state* state) {
+    return 2.0 * state->n * state->n * state->n;
+}
+
+
+static double batch_4_flops(bench_state* state) {
+    // n^2 / 16 products of 4 x 4 matrices
+    return 8.0 * state->n * state->n;
+}
+
+
+static double batch_16_flops(bench_state* state) {
+    return 32.0 * state->n * state->n;
+}
+
+
+static double lu_flops(bench_state* state) {
+    return 2.0 / 3.0 * state->n * state->n * state->n;
+}
+
+
+static double cholesky_flops(bench_state* state) {
+    return 1.0 / 3.0 * state->n * state->n * state->n;
+}
+
+
+static double qr_flops(bench_state* state) {
+    return 4.0 / 3.0 * state->n * state->n * state->n;
+}
+
+
+static double tridiagonal_flops(bench_state* state) {
+    // reduction to tridiagonal form, the tridiagonal eigenvalues cost O(n^2)
+    return 4.0 / 3.0 * state->n * state->n * state->n;
+}
+
+
+static double eigen_flops(bench_state* state) {
+    // reduction and multiplication by its Q, divide and conquer is not counted
+    return 10.0 / 3.0 * state->n * state->n * state->n;
+}
+
+
+static double randomized_flops(bench_state* state) {
+    // sketch and power iterations multiply A by n x (rank + 10) blocks six times
+    return 12.0 * (SVD_RANK + 10) * state->n * state->n;
+}
+
+
+static double cg_flops(bench_state* state) {
+    // one sparse product and five vector operations per iteration
+    return CG_ITERATIONS * (2.0 * state->s->nnz + 10.0 * state->n * state->n);
+}
+
+
+static double inverse_flops(bench_state* state) {
+    // factorization and two triangular solves with n right-hand sides
+    return 8.0 / 3.0 * state->n * state->n * state->n;
+}
+
+
+static double sparse_vector_flops(bench_state* state) {
+    return 2.0 * state->s->nnz;
+}
+
+
+static double sparse_dense_flops(bench_state* state) {
+    return 2.0 * state->s->nnz * state->n;
+}
+
+
+static double sparse_sparse_flops(bench_state* state) {
+    // every stored element meets a row of about nnz / n elements
+    return 2.0 * state->s->nnz * ((double)state->s->nnz / state->n);
+}
+
+
+static double sparse_bytes(bench_state* state) {
+    // stored elements with their indices and the dense operands
+    return (double)state->s->nnz * (sizeof(double) + sizeof(int)) +
+           (double)sizeof(double) * (state->b->rows * state->b->cols + state->c->rows * state->c->cols);
+}
+
+
+static double cg_bytes(bench_state* state) {
+    // the matrix and about 14 vector sweeps of the product, dot products and updates per iteration
+    return CG_ITERATIONS * ((double)state->s->nnz * (sizeof(double) + sizeof(int)) +
+                            14.0 * sizeof(double) * state->n * state->n);
+}
+
+
+static double sparse_sparse_bytes(bench_state* state) {
+    // both operands once, the result is not counted
+    return 2.0 * state->s->nnz * (sizeof(double) + sizeof(int));
+}
+
+
+static double elementwise_flops(bench_state* state) {
+    return (double)state->n * state->n;
+}
+
+
+static double three_matrices_bytes(bench_state* state) {
+    return 3.0 * sizeof(double) * state->n * state->n;
+}
+
+
+static double three_matrices_bytes_f32(bench_state* state) {
+    return 3.0 * sizeof(float) * state->n * state->n;
+}
+
+
+static double three_matrices_bytes_i32(bench_state* state) {
+    return 3.0 * sizeof(int32_t) * state->n * state->n;
+}
+
+
+static double two_matrices_bytes(bench_state* state) {
+    return 2.0 * sizeof(double) * state->n * state->n;
+}
+
+
+static double two_matrices_bytes_f32(bench_state* state) {
+    return 2.0 * sizeof(float) * state->n * state->n;
+}
+
+
+static double file_bytes(bench_state* state) {
+    return state->file_bytes;
+}
+
+
+static const benchmark BENCHMARKS[] =
+{
+    { "multiply_by_matrix", setup_two, run_multiply_by_matrix, gemm_flops, three_matrices_bytes },
+    { "multiply_by_matrix_into", setup_two, run_multiply_by_matrix_into, gemm_flops, three_matrices_bytes },
+    { "multiply_transpose_view", setup_two, run_multiply_transpose_view, gemm_flops, three_matrices_bytes },
+    { "multiply_by_matrix_f32", setup_two_f32, run_multiply_by_matrix_f32, gemm_flops, three_matrices_bytes_f32 },
+    { "multiply_by_matrix_i32", setup_two_i32, run_multiply_by_matrix_i32, gemm_flops, three_matrices_bytes_i32 },
+    { "gemm_batch_4", setup_two, run_gemm_batch_4, batch_4_flops, three_matrices_bytes },
+    { "gemm_batch_16", setup_two, run_gemm_batch_16, batch_16_flops, three_matrices_bytes },
+    { "gemm_batch_interleaved_4", setup_two, run_gemm_batch_interleaved_4, batch_4_flops, three_matrices_bytes },
+    { "sparse_multiply_vector", setup_sparse_vector, run_sparse_multiply_vector, sparse_vector_flops, sparse_bytes },
+    { "sparse_multiply_dense", setup_sparse_dense, run_sparse_multiply_dense, sparse_dense_flops, sparse_bytes },
+    { "sparse_multiply_sparse", setup_sparse, run_sparse_multiply_sparse, sparse_sparse_flops, sparse_sparse_bytes },
+    { "lu_factor", setup_two, run_lu_factor, lu_flops, two_matrices_bytes },
+    { "cholesky_factor", setup_spd, run_cholesky_factor, cholesky_flops, two_matrices_bytes },
+    { "cholesky_factor_tiled", setup_spd, run_cholesky_factor_tiled, cholesky_flops, two_matrices_bytes },
+    { "qr_factor", setup_two, run_qr_factor, qr_flops, two_matrices_bytes },
+    { "eigen_symmetric", setup_two, run_eigen_symmetric, eigen_flops, two_matrices_bytes },
+    { "eigen_values", setup_two, run_eigen_values, tridiagonal_flops, two_matrices_bytes },
+    { "svd", setup_two, run_svd, NULL, two_matrices_bytes },
+    { "svd_randomized", setup_two, run_svd_randomized, randomized_flops, two_matrices_bytes },
+    { "cg_poisson", setup_poisson, run_cg_poisson, cg_flops, cg_bytes },
+    { "inverse", setup_one, run_inverse, inverse_flops, two_matrices_bytes },
+    { "add_into", setup_two, run_add_into, elementwise_flops, three_matrices_bytes },
+    { "add_into_f32", setup_two_f32, run_add_into_f32, elementwise_flops, three_matrices_bytes_f32 },
+    { "transpose", setup_one, run_transpose, NULL, two_matrices_bytes },
+    { "transpose_inplace", setup_one, run_transpose_inplace, NULL, two_matrices_bytes },
+    { "transpose_into_f32", setup_two_f32, run_transpose_into_f32, NULL, two_matrices_bytes_f32 },
+    { "save_to_file", setup_one, run_save_to_file, NULL, file_bytes },
+    { "read_from_file", setup_text_file, run_read_from_file, NULL, file_bytes },
+    { "read_sparse_from_mtx", setup_mtx_file, run_read_sparse_from_mtx, NULL, file_bytes },
+    { "read_from_binary", setup_binary_file, run_read_from_binary, NULL, file_bytes },
+    { "mmap_matrix", setup_binary_file, run_mmap_matrix, NULL, file_bytes },
+};
+
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+
+static bench_stats measure(const benchmark* bench, bench_state* state, int warmup, int reps) {
+    /* Runs warm-up and measured repetitions and summarizes the timings. */
+    double* times = malloc(reps * sizeof(double));
+    bench_stats stats = { 0, 0, 0, 0 };
+    int i;
+
+    if (times == NULL)
+    {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < warmup; i++)
+    {
+        bench->run(state);
+    }
+
+    for (i = 0; i < reps; i++)
+    {
+        double start = now();
+        bench->run(state);
+        times[i] = now() - start;
+        stats.mean += times[i] / reps;
+    }
+
+    qsort(times, reps, sizeof(double), compare_doubles);
+    stats.min = times[0];
+    stats.median = reps % 2 ? times[reps / 2] : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+    stats.p99 = times[(int)(0.99 * (reps - 1) + 0.5)];
+
+    free(times);
+    return stats;
+}
+
+
+static int parse_sizes(const char* arg, int* sizes) {
+    /* Parses a comma separated list of sizes, returns their count. */
+    int count = 0;
+    char* end;
+
+    while (*arg && count < MAX_SIZES)
+    {
+        long n = strtol(arg, &end, 10);
+        if (end == arg || n <= 0)
+        {
+            return 0;
+        }
+        sizes[count++] = (int)n;
+        arg = *end == ',' ? end + 1 : end;
+    }
+
+    return count;
+}
+
+
+static void usage(void) {
+    fprintf(stderr, "usage: matrix_bench [--sizes 256,512,1024] [--reps 10] [--warmup 2] [--filter name] [--json file]\n");
+}
+
+
+int main(int argc, char** argv) {
+    int sizes[MAX_SIZES] = { 256, 512, 1024 };
+    int size_count = 3, reps = 10, warmup = 2, first = 1;
+    const char* filter = NULL;
+    const char* json_file = NULL;
+    FILE* json = NULL;
+    size_t b;
+    int i, s;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+        {
+            size_count = parse_sizes(argv[++i], sizes);
+        }else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc){
+            reps = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc){
+            warmup = atoi(argv[++i]);
+        }else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc){
+            filter = argv[++i];
+        }else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc){
+            json_file = argv[++i];
+        }else{
+            usage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (size_count == 0 || reps <= 0 || warmup < 0)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (json_file != NULL && (json = fopen(json_file, "w")) == NULL)
+    {
+        fprintf(stderr, "bench: cannot open %s\n", json_file);
+        return EXIT_FAILURE;
+    }
+
+    srand(42);
+    printf("isa %s, threads %d, %d warm-up + %d measured repetitions\n",
+           matrix_isa_str(matrix_get_isa()), matrix_get_num_threads(), warmup, reps);
+    printf("%-24s %6s %12s %12s %12s %10s %10s\n", "benchmark", "n", "min [s]", "median [s]", "p99 [s]", "GFLOP/s", "GB/s");
+
+    if (json != NULL)
+    {
+        fprintf(json, "{\n  \"isa\": \"%s\",\n  \"threads\": %d,\n  \"warmup\": %d,\n  \"reps\": %d,\n  \"results\": [",
+                matrix_isa_str(matrix_get_isa()), matrix_get_num_threads(), warmup, reps);
+    }
+
+    for (b = 0; b < ARRAY_LEN(BENCHMARKS); b++)
+    {
+        const benchmark* bench = &BENCHMARKS[b];
+
+        if (filter != NULL && strstr(bench->name, filter) == NULL)
+        {
+            continue;
+        }
+
+        for (s = 0; s < size_count; s++)
+        {
+            bench_state state;
+            bench_stats stats;
+            double gflops, gbps;
+
+            memset(&state, 0, sizeof(state));
+            state.n = sizes[s];
+            bench->setup(&state);
+            stats = measure(bench, &state, warmup, reps);
+
+            gflops = bench->flops ? bench->flops(&state) / stats.median * 1e-9 : 0.0;
+            gbps = bench->bytes ? bench->bytes(&state) / stats.median * 1e-9 : 0.0;
+
+            printf("%-24s %6d %12.6f %12.6f %12.6f %10.2f %10.2f\n",
+                   bench->name, state.n, stats.min, stats.median, stats.p99, gflops, gbps);
+
+            if (json != NULL)
+            {
+                fprintf(json, "%s\n    { \"name\": \"%s\", \"n\": %d, \"min_s\": %.9f, \"median_s\": %.9f, "
+                              "\"p99_s\": %.9f, \"mean_s\": %.9f, \"gflops\": %.4f, \"gbps\": %.4f }",
+                        first ? "" : ",", bench->name, state.n, stats.min, stats.median,
+                        stats.p99, stats.mean, gflops, gbps);
+                first = 0;
+            }
+
+            destroy_matrix(state.a);
+            destroy_matrix(state.b);
+            destroy_matrix(state.c);
+            destroy_matrix_f32(state.fa);
+            destroy_matrix_f32(state.fb);
+            destroy_matrix_f32(state.fc);
+            destroy_matrix_i32(state.ia);
+            destroy_matrix_i32(state.ib);
+            destroy_matrix_i32(state.ic);
+            destroy_sparse_matrix(state.s);
+        }
+    }
+
+    if (json != NULL)
+    {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+
+    remove(TEXT_FILE);
+    remove(BINARY_FILE);
+    remove(MTX_FILE);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,409 @@
+/*
+    batch.c    version 1.0
+
+    Module for batches of small matrix products.
+    --------------------------
+
+    A batch is an array of same-shape matrices stored in one buffer,
+    either one after another (strided) or element by element
+    (interleaved, element (i, j) of all matrices next to each other).
+    Strided products run a kernel per shape, the common square sizes
+    have their loops fixed at compile time so that rows of C stay in
+    vector registers. Interleaved products vectorize across the batch
+    instead, every lane being another matrix. Both split the batch
+    across the thread pool, and each kernel is compiled for SSE2, AVX2
+    and AVX-512, selected by the ISA level of simd.h.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include "batch.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86 1
+#define TARGET_DEFAULT
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define BATCH_X86 0
+#define TARGET_DEFAULT
+#endif
+
+// Batches with fewer multiply-adds than this stay in the calling thread
+#define BATCH_PARALLEL (1 << 16)
+
+// Tasks per worker, more tasks even out the workers
+#define BATCH_TASKS_PER_WORKER 4
+
+// Columns and rows of C accumulated in registers at once by the kernel of any shape
+#define BATCH_COLS 8
+#define BATCH_ROWS 4
+
+// Columns of C of an interleaved batch computed at once
+#define BATCH_COLUMNS 4
+
+// Matrices of an interleaved batch computed by one fixed length loop the compiler vectorizes
+#define BATCH_LANES 8
+
+// Most matrices of an interleaved batch per chunk, fewer when the chunk would not fit BATCH_CACHE bytes
+#define BATCH_CHUNK 256
+#define BATCH_CACHE (256 * 1024)
+
+// Computes count products of a strided batch
+typedef void (*strided_kernel)(int count, int m, int n, int k, double alpha, const double* restrict A, ptrdiff_t stride_a,
+                               const double* restrict B, ptrdiff_t stride_b, double beta, double* restrict C, ptrdiff_t stride_c);
+
+// Computes the products of lanes matrices of an interleaved batch whose elements are count apart
+typedef void (*interleaved_kernel)(int lanes, int count, int m, int n, int k, double alpha, const double* restrict A,
+                                   const double* restrict B, double beta, double* restrict C);
+
+// Batch product split into tasks of consecutive matrices
+typedef struct
+{
+    int count;
+    int m;
+    int n;
+    int k;
+    int tasks;
+    double alpha;
+    double beta;
+    const double* a;
+    const double* b;
+    double* c;
+    ptrdiff_t stride_a;
+    ptrdiff_t stride_b;
+    ptrdiff_t stride_c;
+    strided_kernel strided;
+    interleaved_kernel interleaved;
+    interleaved_kernel interleaved_tail;
+    int chunk;          // matrices of an interleaved batch computed together
+} batch_job;
+
+
+/*  Rows i to i + R - 1 of C = alpha * A * B + beta * C, W columns at a
+    time. Every element of B loaded is used for R rows, the R * W sums
+    stay in acc. Columns left over from the last W are dot products. */
+#define BATCH_ROW_BLOCK(R, N, K, W) \
+    for (jb = 0; jb + (W) <= (N); jb += (W)) \
+    { \
+        double acc[R][W]; \
+        for (r = 0; r < (R); r++) \
+        { \
+            for (j = 0; j < (W); j++) \
+            { \
+                acc[r][j] = 0.0; \
+            } \
+        } \
+        for (p = 0; p < (K); p++) \
+        { \
+            for (r = 0; r < (R); r++) \
+            { \
+                double s = a[(i + r) * (K) + p]; \
+                for (j = 0; j < (W); j++) \
+                { \
+                    acc[r][j] += s * x[p * (N) + jb + j]; \
+                } \
+            } \
+        } \
+        for (r = 0; r < (R); r++) \
+        { \
+            double* row = c + (i + r) * (N) + jb; \
+            for (j = 0; j < (W); j++) \
+            { \
+                row[j] = alpha * acc[r][j] + (beta == 0.0 ? 0.0 : beta * row[j]); \
+            } \
+        } \
+    } \
+    for (r = 0; r < (R); r++) \
+    { \
+        for (j = jb; j < (N); j++) \
+        { \
+            double sum = 0.0; \
+            for (p = 0; p < (K); p++) \
+            { \
+                sum += a[(i + r) * (K) + p] * x[p * (N) + j]; \
+            } \
+            c[(i + r) * (N) + j] = alpha * sum + (beta == 0.0 ? 0.0 : beta * c[(i + r) * (N) + j]); \
+        } \
+    }
+
+/*  C = alpha * A * B + beta * C for count matrices stored by rows, R rows
+    at a time and the remaining rows one by one. With M, N, K, W and R
+    constant the loops are unrolled and the sums kept in registers. */
+#define BATCH_STRIDED_BODY(M, N, K, W, R) \
+    int b, i, j, jb, p, r; \
+    for (b = 0; b < count; b++) \
+    { \
+        const double* a = A + b * stride_a; \
+        const double* x = B + b * stride_b; \
+        double* c = C + b * stride_c; \
+        for (i = 0; i + (R) <= (M); i += (R)) \
+        { \
+            BATCH_ROW_BLOCK(R, N, K, W) \
+        } \
+        for (; i < (M); i++) \
+        { \
+            BATCH_ROW_BLOCK(1, N, K, W) \
+        } \
+    }
+
+/*  The same for lanes interleaved matrices, element (i, j) of lane w at
+    (i * cols + j) * count + w. Every lane accumulates its own sums, LANES
+    lanes and BATCH_COLUMNS columns of C at a time so that each loaded
+    element of A serves several columns. */
+#define BATCH_INTERLEAVED_COLUMNS(J, LANES) \
+    for (l = 0; l + (LANES) <= lanes; l += (LANES)) \
+    { \
+        double acc[J][LANES]; \
+        for (q = 0; q < (J); q++) \
+        { \
+            for (w = 0; w < (LANES); w++) \
+            { \
+                acc[q][w] = 0.0; \
+            } \
+        } \
+        for (p = 0; p < k; p++) \
+        { \
+            const double* a = A + ((ptrdiff_t)i * k + p) * count + l; \
+            for (q = 0; q < (J); q++) \
+            { \
+                const double* x = B + ((ptrdiff_t)p * n + j + q) * count + l; \
+                for (w = 0; w < (LANES); w++) \
+                { \
+                    acc[q][w] += a[w] * x[w]; \
+                } \
+            } \
+        } \
+        for (q = 0; q < (J); q++) \
+        { \
+            double* c = C + ((ptrdiff_t)i * n + j + q) * count + l; \
+            for (w = 0; w < (LANES); w++) \
+            { \
+                c[w] = alpha * acc[q][w] + (beta == 0.0 ? 0.0 : beta * c[w]); \
+            } \
+        } \
+    }
+
+#define BATCH_INTERLEAVED_BODY(LANES) \
+    int i, j, p, q, w, l; \
+    for (i = 0; i < m; i++) \
+    { \
+        for (j = 0; j + BATCH_COLUMNS <= n; j += BATCH_COLUMNS) \
+        { \
+            BATCH_INTERLEAVED_COLUMNS(BATCH_COLUMNS, LANES) \
+        } \
+        for (; j < n; j++) \
+        { \
+            BATCH_INTERLEAVED_COLUMNS(1, LANES) \
+        } \
+    }
+
+#define BATCH_STRIDED_KERNEL(NAME, TARGET, M, N, K, W, R) \
+TARGET \
+static void NAME(int count, int m, int n, int k, double alpha, const double* restrict A, ptrdiff_t stride_a, \
+                 const double* restrict B, ptrdiff_t stride_b, double beta, double* restrict C, ptrdiff_t stride_c) { \
+    (void)m; \
+    (void)n; \
+    (void)k; \
+    BATCH_STRIDED_BODY(M, N, K, W, R) \
+}
+
+// Kernels of one ISA level: any shape, square sizes 3, 4, 6, 8 and 16, interleaved full and partial chunks
+#define BATCH_KERNELS(ISA, TARGET) \
+BATCH_STRIDED_KERNEL(strided_any_##ISA, TARGET, m, n, k, BATCH_COLS, BATCH_ROWS) \
+BATCH_STRIDED_KERNEL(strided_3_##ISA, TARGET, 3, 3, 3, 3, 3) \
+BATCH_STRIDED_KERNEL(strided_4_##ISA, TARGET, 4, 4, 4, 4, 4) \
+BATCH_STRIDED_KERNEL(strided_6_##ISA, TARGET, 6, 6, 6, 6, 3) \
+BATCH_STRIDED_KERNEL(strided_8_##ISA, TARGET, 8, 8, 8, 8, 4) \
+BATCH_STRIDED_KERNEL(strided_16_##ISA, TARGET, 16, 16, 16, 16, 4) \
+TARGET \
+static void interleaved_##ISA(int lanes, int count, int m, int n, int k, double alpha, const double* restrict A, \
+                              const double* restrict B, double beta, double* restrict C) { \
+    BATCH_INTERLEAVED_BODY(BATCH_LANES) \
+} \
+TARGET \
+static void interleaved_tail_##ISA(int lanes, int count, int m, int n, int k, double alpha, const double* restrict A, \
+                                   const double* restrict B, double beta, double* restrict C) { \
+    BATCH_INTERLEAVED_BODY(1) \
+} \
+static strided_kernel strided_##ISA(int m, int n, int k) { \
+    if (m == n && n == k) \
+    { \
+        switch (m) \
+        { \
+            case 3: return strided_3_##ISA; \
+            case 4: return strided_4_##ISA; \
+            case 6: return strided_6_##ISA; \
+            case 8: return strided_8_##ISA; \
+            case 16: return strided_16_##ISA; \
+        } \
+    } \
+    return strided_any_##ISA; \
+}
+
+BATCH_KERNELS(default, TARGET_DEFAULT)
+#if BATCH_X86
+BATCH_KERNELS(avx2, TARGET_AVX2)
+BATCH_KERNELS(avx512, TARGET_AVX512)
+#endif
+
+
+static void select_kernels(batch_job* job) {
+    /* Chooses the kernels for the shape of the job and the active ISA level. */
+
+    job->strided = strided_default(job->m, job->n, job->k);
+    job->interleaved = interleaved_default;
+    job->interleaved_tail = interleaved_tail_default;
+#if BATCH_X86
+    if (matrix_get_isa() >= MATRIX_ISA_AVX512)
+    {
+        job->strided = strided_avx512(job->m, job->n, job->k);
+        job->interleaved = interleaved_avx512;
+        job->interleaved_tail = interleaved_tail_avx512;
+    }else if (matrix_get_isa() >= MATRIX_ISA_AVX2){
+        job->strided = strided_avx2(job->m, job->n, job->k);
+        job->interleaved = interleaved_avx2;
+        job->interleaved_tail = interleaved_tail_avx2;
+    }
+#endif
+}
+
+
+static int batch_workers(const batch_job* job) {
+    /* Number of workers for a batch of the job's size. */
+
+    return (double)job->count * job->m * job->n * job->k < BATCH_PARALLEL ? 1 : thread_pool_size();
+}
+
+
+static void strided_task(void* ctx, int task, int worker) {
+    /* Computes the products of the matrices of a task. */
+    const batch_job* job = ctx;
+    int first = (int)((long long)job->count * task / job->tasks);
+    int end = (int)((long long)job->count * (task + 1) / job->tasks);
+    (void)worker;
+
+    job->strided(end - first, job->m, job->n, job->k, job->alpha, job->a + first * job->stride_a, job->stride_a,
+                 job->b + first * job->stride_b, job->stride_b, job->beta, job->c + first * job->stride_c, job->stride_c);
+}
+
+
+static void interleaved_task(void* ctx, int task, int worker) {
+    /*  Computes the products of the chunks of a task, full groups of
+        BATCH_LANES matrices first, then the remaining ones one by one. */
+    const batch_job* job = ctx;
+    int chunks = (job->count + job->chunk - 1) / job->chunk;
+    int chunk = (int)((long long)chunks * task / job->tasks);
+    int end = (int)((long long)chunks * (task + 1) / job->tasks);
+    (void)worker;
+
+    for (; chunk < end; chunk++)
+    {
+        int first = chunk * job->chunk;
+        int lanes = job->count - first < job->chunk ? job->count - first : job->chunk;
+        int full = lanes - lanes % BATCH_LANES;
+
+        job->interleaved(full, job->count, job->m, job->n, job->k, job->alpha, job->a + first, job->b + first,
+                         job->beta, job->c + first);
+        job->interleaved_tail(lanes - full, job->count, job->m, job->n, job->k, job->alpha, job->a + first + full,
+                              job->b + first + full, job->beta, job->c + first + full);
+    }
+}
+
+
+void gemm_batch_strided(int count, int m, int n, int k, double alpha,
+                        const double* A, ptrdiff_t stride_a, const double* B, ptrdiff_t stride_b,
+                        double beta, double* C, ptrdiff_t stride_c){
+    /*  Computes C_i = alpha * A_i * B_i + beta * C_i for count matrices
+        A_i (m x k), B_i (k x n) and C_i (m x n) stored by rows without
+        padding. Matrix i of a batch starts at element i * stride, a
+        stride of 0 uses one A or B for the whole batch. C must not
+        overlap A or B. With beta 0 C is only written. */
+
+    batch_job job;
+    int workers;
+
+    if (!A || !B || !C || count < 0 || m < 1 || n < 1 || k < 1 ||
+        (stride_a != 0 && stride_a < (ptrdiff_t)m * k) || (stride_b != 0 && stride_b < (ptrdiff_t)k * n) ||
+        (count > 1 && stride_c < (ptrdiff_t)m * n)) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    job.count = count;
+    job.m = m;
+    job.n = n;
+    job.k = k;
+    job.alpha = alpha;
+    job.beta = beta;
+    job.a = A;
+    job.b = B;
+    job.c = C;
+    job.stride_a = stride_a;
+    job.stride_b = stride_b;
+    job.stride_c = stride_c;
+    select_kernels(&job);
+
+    workers = batch_workers(&job);
+    job.tasks = workers > 1 ? workers * BATCH_TASKS_PER_WORKER : 1;
+    job.tasks = job.tasks < count ? job.tasks : count;
+    thread_pool_run(job.tasks, workers, strided_task, &job);
+
+    error = MATRIX_OK;
+}
+
+
+void gemm_batch_interleaved(int count, int m, int n, int k, double alpha,
+                            const double* A, const double* B, double beta, double* C){
+    /*  Computes C_i = alpha * A_i * B_i + beta * C_i for count interleaved
+        matrices A_i (m x k), B_i (k x n) and C_i (m x n): element (r, s)
+        of matrix i is stored at (r * cols + s) * count + i, so the same
+        element of all matrices is contiguous and one vector instruction
+        works on several matrices. C must not overlap A or B. With beta 0
+        C is only written. */
+
+    batch_job job;
+    int workers, chunks;
+
+    if (!A || !B || !C || count < 0 || m < 1 || n < 1 || k < 1) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    job.count = count;
+    job.m = m;
+    job.n = n;
+    job.k = k;
+    job.alpha = alpha;
+    job.beta = beta;
+    job.a = A;
+    job.b = B;
+    job.c = C;
+    select_kernels(&job);
+
+    // A chunk of all elements of A, B and C is reused from cache
+    job.chunk = (int)(BATCH_CACHE / (sizeof(double) * ((double)m * k + (double)k * n + (double)m * n)));
+    job.chunk = job.chunk < BATCH_CHUNK ? job.chunk - job.chunk % BATCH_LANES : BATCH_CHUNK;
+    job.chunk = job.chunk > BATCH_LANES ? job.chunk : BATCH_LANES;
+    chunks = (count + job.chunk - 1) / job.chunk;
+    workers = batch_workers(&job);
+    job.tasks = workers > 1 ? workers * BATCH_TASKS_PER_WORKER : 1;
+    job.tasks = job.tasks < chunks ? job.tasks : chunks;
+    thread_pool_run(job.tasks, workers, interleaved_task, &job);
+
+    error = MATRIX_OK;
+}
@@ -0,0 +1,32 @@
+/*
+    batch.h    version 1.0
+
+    Header file for batch.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_BATCH
+#define MAT_BATCH
+
+#include <stddef.h>
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void gemm_batch_strided(int count, int m, int n, int k, double alpha,
+                               const double* A, ptrdiff_t stride_a, const double* B, ptrdiff_t stride_b,
+                               double beta, double* C, ptrdiff_t stride_c);
+extern void gemm_batch_interleaved(int count, int m, int n, int k, double alpha,
+                                   const double* A, const double* B, double beta, double* C);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,478 @@
+/*
+    binary.c    version 1.0
+
+    Module for the native binary matrix format.
+    --------------------------
+
+    A file is a 64 byte matrix_bin_header followed by the raw elements
+    starting at an aligned data_offset. The elements are stored exactly
+    as in memory, so a file can be mapped and used as matrix storage
+    without parsing or copying. The dtype field tells double matrices
+    from the element types of matrix_f32.h and matrix_types.h.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "binary.h"
+#include "matrix_types.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#define file_seek _fseeki64
+#define file_tell _ftelli64
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define file_seek fseeko
+#define file_tell ftello
+#endif
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+// Mapped region holding the header and the elements of a matrix
+struct matrix_mapping
+{
+    void* base;
+    size_t length;
+};
+
+
+static matrix_error check_header(const matrix_bin_header* header, uint64_t file_size, uint32_t dtype, size_t size) {
+    /* Checks that a header describes a matrix of elements of dtype this build can use in place. */
+    uint64_t count;
+
+    if (memcmp(header->magic, MATRIX_BIN_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MATRIX_BIN_VERSION ||
+        header->byte_order != MATRIX_BIN_BYTE_ORDER ||
+        header->dtype != dtype ||
+        header->layout != MATRIX_LAYOUT_ROW_MAJOR)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    if (header->rows == 0 || header->cols == 0 || header->rows > INT_MAX || header->cols > INT_MAX ||
+        header->data_offset < sizeof(matrix_bin_header) || header->data_offset % MATRIX_ALIGNMENT != 0)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    count = header->rows * header->cols;
+    if (count > (SIZE_MAX - header->data_offset) / size ||
+        file_size < header->data_offset + count * size)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    return MATRIX_OK;
+}
+
+
+static void write_binary(const char* filename, uint32_t dtype, size_t size, const char* buffer,
+                         int rows, int cols, int row_stride, int col_stride) {
+    /* Saves elements of the given size and strides in elements to a binary file. */
+    matrix_bin_header header;
+    char padding[MATRIX_ALIGNMENT] = {0};
+    ptrdiff_t rs = (ptrdiff_t)row_stride * size, cs = (ptrdiff_t)col_stride * size;
+    FILE *f;
+    int i, j, ok;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MATRIX_BIN_MAGIC, sizeof(header.magic));
+    header.version = MATRIX_BIN_VERSION;
+    header.byte_order = MATRIX_BIN_BYTE_ORDER;
+    header.dtype = dtype;
+    header.layout = MATRIX_LAYOUT_ROW_MAJOR;
+    header.rows = rows;
+    header.cols = cols;
+    header.alignment = MATRIX_ALIGNMENT;
+    header.data_offset = (sizeof(header) + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT * MATRIX_ALIGNMENT;
+
+    if ((f = fopen(filename, "wb")) == NULL)
+    {
+        error = MATRIX_OPENING_ERROR;
+        LOG_ERROR("Failed opening file");
+        return;
+    }
+
+    ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(padding, 1, header.data_offset - sizeof(header), f) == header.data_offset - sizeof(header);
+
+    if (row_stride == cols && col_stride == 1)
+    {
+        size_t count = (size_t)rows * cols;
+        ok = ok && fwrite(buffer, size, count, f) == count;
+    }else if (col_stride == 1){
+        for (i = 0; i < rows && ok; i++)
+        {
+            ok = fwrite(buffer + i * rs, size, cols, f) == (size_t)cols;
+        }
+    }else{
+        // Views stored in another order are written element by element through the stdio buffer
+        for (i = 0; i < rows && ok; i++)
+        {
+            for (j = 0; j < cols && ok; j++)
+            {
+                ok = fwrite(buffer + i * rs + j * cs, size, 1, f) == 1;
+            }
+        }
+    }
+
+    if (fclose(f) == EOF)
+    {
+        error = MATRIX_CLOSING_ERROR;
+        LOG_ERROR("Failed closing file");
+        return;
+    }
+
+    if (!ok)
+    {
+        error = MATRIX_OTHER_ERROR;
+        LOG_ERROR("Failed writing to file");
+        return;
+    }
+
+    error = MATRIX_OK;
+}
+
+
+void save_to_binary(matrix* mat, const char* filename){
+    /* Saves matrix to a binary file. */
+
+    if (mat == NULL || filename == NULL){
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    write_binary(filename, MATRIX_DTYPE_F64, sizeof(double), (const char*)mat->buffer,
+                 mat->rows, mat->cols, mat->row_stride, mat->col_stride);
+}
+
+
+static FILE* open_binary(const char* filename, uint32_t dtype, size_t size, matrix_bin_header* header) {
+    /* Opens a binary file of dtype elements positioned at its data, returns NULL and sets error on failure. */
+    FILE *f;
+    long long file_size;
+
+    if (filename == NULL){
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if ((f = fopen(filename, "rb")) == NULL)
+    {
+        error = MATRIX_OPENING_ERROR;
+        LOG_ERROR("Failed opening file");
+        return NULL;
+    }
+
+    // 64-bit offsets, binary matrices are often larger than 2 GB
+    if (file_seek(f, 0, SEEK_END) != 0 || (file_size = file_tell(f)) < 0 || file_seek(f, 0, SEEK_SET) != 0 ||
+        fread(header, sizeof(*header), 1, f) != 1 ||
+        check_header(header, (uint64_t)file_size, dtype, size) != MATRIX_OK ||
+        file_seek(f, header->data_offset, SEEK_SET) != 0)
+    {
+        fclose(f);
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("File does not represent a matrix");
+        return NULL;
+    }
+
+    return f;
+}
+
+
+static int read_elements(FILE* f, void* buffer, size_t size, size_t count) {
+    /* Reads the elements and closes the file, returns 0 and sets error on failure. */
+
+    if (fread(buffer, size, count, f) != count)
+    {
+        fclose(f);
+        error = MATRIX_OTHER_ERROR;
+        LOG_ERROR("Failed reading from file");
+        return 0;
+    }
+
+    if (fclose(f) == EOF)
+    {
+        error = MATRIX_CLOSING_ERROR;
+        LOG_ERROR("Failed closing file");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+matrix* read_from_binary(const char* filename){
+    /* Creates a new matrix by reading a binary file into memory. */
+
+    matrix_bin_header header;
+    matrix* mat;
+    FILE *f;
+
+    if ((f = open_binary(filename, MATRIX_DTYPE_F64, sizeof(double), &header)) == NULL)
+    {
+        return NULL;
+    }
+
+    mat = initialize_matrix((int)header.rows, (int)header.cols);
+    if (mat == NULL)
+    {
+        fclose(f);
+        return NULL;
+    }
+
+    if (!read_elements(f, mat->buffer, sizeof(double), (size_t)mat->rows * mat->cols))
+    {
+        destroy_matrix(mat);
+        return NULL;
+    }
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+static void* map_file(const char* filename, matrix_map_mode mode, size_t* length) {
+    /* Maps a whole file into memory, returns NULL and sets error on failure. */
+    void* base;
+
+#ifdef _WIN32
+    HANDLE file, mapping;
+    LARGE_INTEGER size;
+    DWORD access = mode == MATRIX_MAP_WRITE ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+    DWORD protect = mode == MATRIX_MAP_READ ? PAGE_READONLY : mode == MATRIX_MAP_WRITE ? PAGE_READWRITE : PAGE_WRITECOPY;
+    DWORD view = mode == MATRIX_MAP_READ ? FILE_MAP_READ : mode == MATRIX_MAP_WRITE ? FILE_MAP_WRITE : FILE_MAP_COPY;
+
+    file = CreateFileA(filename, access, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        error = MATRIX_OPENING_ERROR;
+        return NULL;
+    }
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(matrix_bin_header) ||
+        (unsigned long long)size.QuadPart > SIZE_MAX)
+    {
+        CloseHandle(file);
+        error = MATRIX_TYPE_ERROR;
+        return NULL;
+    }
+
+    mapping = CreateFileMappingA(file, NULL, protect, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+    {
+        error = MATRIX_OTHER_ERROR;
+        return NULL;
+    }
+
+    // The view keeps the mapping object alive
+    base = MapViewOfFile(mapping, view, 0, 0, 0);
+    CloseHandle(mapping);
+    if (base == NULL)
+    {
+        error = MATRIX_OTHER_ERROR;
+        return NULL;
+    }
+    *length = (size_t)size.QuadPart;
+#else
+    struct stat st;
+    int fd = open(filename, mode == MATRIX_MAP_WRITE ? O_RDWR : O_RDONLY);
+    int prot = mode == MATRIX_MAP_READ ? PROT_READ : PROT_READ | PROT_WRITE;
+    int flags = mode == MATRIX_MAP_COPY ? MAP_PRIVATE : MAP_SHARED;
+
+    if (fd < 0)
+    {
+        error = MATRIX_OPENING_ERROR;
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(matrix_bin_header) ||
+        (unsigned long long)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        error = MATRIX_TYPE_ERROR;
+        return NULL;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    base = mmap(NULL, (size_t)st.st_size, prot, flags, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        error = MATRIX_OTHER_ERROR;
+        return NULL;
+    }
+    *length = (size_t)st.st_size;
+#endif
+
+    return base;
+}
+
+
+static void unmap_file(void* base, size_t length) {
+    /* Releases a region mapped by map_file. */
+
+#ifdef _WIN32
+    (void)length;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, length);
+#endif
+}
+
+
+static void* map_binary(const char* filename, matrix_map_mode mode, uint32_t dtype, size_t size,
+                        struct matrix_mapping** mapping, int* rows, int* cols) {
+    /* Maps a binary file of dtype elements, returns a pointer to its data or NULL and sets error. */
+    const matrix_bin_header* header;
+    size_t length;
+    void* base;
+
+    if (filename == NULL || (mode != MATRIX_MAP_READ && mode != MATRIX_MAP_WRITE && mode != MATRIX_MAP_COPY)){
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if ((base = map_file(filename, mode, &length)) == NULL)
+    {
+        LOG_ERROR("Failed mapping file");
+        return NULL;
+    }
+
+    header = base;
+    if (check_header(header, length, dtype, size) != MATRIX_OK)
+    {
+        unmap_file(base, length);
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("File does not represent a matrix");
+        return NULL;
+    }
+
+    if ((*mapping = malloc(sizeof(struct matrix_mapping))) == NULL)
+    {
+        unmap_file(base, length);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+    (*mapping)->base = base;
+    (*mapping)->length = length;
+    *rows = (int)header->rows;
+    *cols = (int)header->cols;
+
+    return (char*)base + header->data_offset;
+}
+
+
+matrix* mmap_matrix(const char* filename, matrix_map_mode mode){
+    /*  Creates a matrix whose storage is a mapped binary file.
+        Nothing is read or copied until elements are accessed, and the
+        pages are shared with other processes mapping the same file. */
+
+    struct matrix_mapping* mapping;
+    matrix* mat;
+    void* data;
+    int rows, cols;
+
+    if ((data = map_binary(filename, mode, MATRIX_DTYPE_F64, sizeof(double), &mapping, &rows, &cols)) == NULL)
+    {
+        return NULL;
+    }
+
+    mat = matrix_from_buffer(data, rows, cols);
+    if (mat == NULL)
+    {
+        matrix_unmap(mapping);
+        return NULL;
+    }
+    mat->mapping = mapping;
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+void matrix_unmap(struct matrix_mapping* mapping){
+    /* Unmaps the file of a mapped matrix, called by destroy_matrix of every element type. */
+
+    if (!mapping) {
+        return;
+    }
+
+    unmap_file(mapping->base, mapping->length);
+    free(mapping);
+}
+
+
+// Defines save_to_binary, read_from_binary and mmap_matrix with suffix S for MATRIX of T elements
+#define BINARY_TYPE_FUNCTIONS(T, MATRIX, S, DTYPE) \
+    void save_to_binary##S(MATRIX* mat, const char* filename){ \
+        if (mat == NULL || filename == NULL){ \
+            error = MATRIX_INVARGS; \
+            LOG_ERROR("Invalid arguments"); \
+            return; \
+        } \
+        write_binary(filename, DTYPE, sizeof(T), (const char*)mat->buffer, \
+                     mat->rows, mat->cols, mat->row_stride, mat->col_stride); \
+    } \
+    \
+    MATRIX* read_from_binary##S(const char* filename){ \
+        matrix_bin_header header; \
+        MATRIX* mat; \
+        FILE *f; \
+        if ((f = open_binary(filename, DTYPE, sizeof(T), &header)) == NULL) \
+        { \
+            return NULL; \
+        } \
+        if ((mat = initialize_matrix##S((int)header.rows, (int)header.cols)) == NULL) \
+        { \
+            fclose(f); \
+            return NULL; \
+        } \
+        if (!read_elements(f, mat->buffer, sizeof(T), (size_t)mat->rows * mat->cols)) \
+        { \
+            destroy_matrix##S(mat); \
+            return NULL; \
+        } \
+        error = MATRIX_OK; \
+        return mat; \
+    } \
+    \
+    MATRIX* mmap_matrix##S(const char* filename, matrix_map_mode mode){ \
+        struct matrix_mapping* mapping; \
+        MATRIX* mat; \
+        void* data; \
+        int rows, cols; \
+        if ((data = map_binary(filename, mode, DTYPE, sizeof(T), &mapping, &rows, &cols)) == NULL) \
+        { \
+            return NULL; \
+        } \
+        if ((mat = matrix##S##_from_buffer(data, rows, cols)) == NULL) \
+        { \
+            matrix_unmap(mapping); \
+            return NULL; \
+        } \
+        mat->mapping = mapping; \
+        error = MATRIX_OK; \
+        return mat; \
+    }
+
+BINARY_TYPE_FUNCTIONS(float, matrix_f32, _f32, MATRIX_DTYPE_F32)
+BINARY_TYPE_FUNCTIONS(int32_t, matrix_i32, _i32, MATRIX_DTYPE_I32)
+BINARY_TYPE_FUNCTIONS(int64_t, matrix_i64, _i64, MATRIX_DTYPE_I64)
+BINARY_TYPE_FUNCTIONS(matrix_complex, matrix_c64, _c64, MATRIX_DTYPE_C64)
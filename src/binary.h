@@ -0,0 +1,80 @@
+/*
+    binary.h    version 1.0
+
+    Header file for binary.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_BINARY
+#define MAT_BINARY
+
+#include <stdint.h>
+#include "matrix.h"
+#include "matrix_f32.h"
+#include "matrix_types.h"
+
+// "MATRIXB" followed by a zero byte
+#define MATRIX_BIN_MAGIC "MATRIXB"
+#define MATRIX_BIN_VERSION 1
+// written as a native integer to detect files from machines of other byte order
+#define MATRIX_BIN_BYTE_ORDER 0x01020304u
+
+typedef enum
+{
+    MATRIX_DTYPE_F64,
+    MATRIX_DTYPE_F32,
+    MATRIX_DTYPE_I32,
+    MATRIX_DTYPE_I64,
+    MATRIX_DTYPE_C64,     // pairs of double, real part first
+    MATRIX_DTYPE_COUNT
+} matrix_dtype;
+
+typedef enum
+{
+    MATRIX_LAYOUT_ROW_MAJOR,
+    MATRIX_LAYOUT_COUNT
+} matrix_layout;
+
+typedef enum
+{
+    MATRIX_MAP_READ,        // read-only, writing to the matrix crashes
+    MATRIX_MAP_WRITE,       // changes of the matrix are written to the file
+    MATRIX_MAP_COPY         // changes stay private to the process
+} matrix_map_mode;
+
+// Header at the start of a binary matrix file, data starts at data_offset
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t dtype;
+    uint32_t layout;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t alignment;
+    uint64_t data_offset;
+    uint8_t reserved[8];
+} matrix_bin_header;
+
+extern void save_to_binary(matrix* mat, const char* file);
+extern matrix* read_from_binary(const char* file);
+extern matrix* mmap_matrix(const char* file, matrix_map_mode mode);
+extern void matrix_unmap(struct matrix_mapping* mapping);
+
+// save_to_binary, read_from_binary and mmap_matrix for the other element types
+#define BINARY_TYPE_DECLARE(MATRIX, S) \
+    extern void save_to_binary##S(MATRIX* mat, const char* file); \
+    extern MATRIX* read_from_binary##S(const char* file); \
+    extern MATRIX* mmap_matrix##S(const char* file, matrix_map_mode mode);
+
+BINARY_TYPE_DECLARE(matrix_f32, _f32)
+BINARY_TYPE_DECLARE(matrix_i32, _i32)
+BINARY_TYPE_DECLARE(matrix_i64, _i64)
+BINARY_TYPE_DECLARE(matrix_c64, _c64)
+
+#endif
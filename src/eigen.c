@@ -0,0 +1,1098 @@
+/*
+    eigen.c    version 1.0
+
+    Module for eigenvalue decompositions.
+    --------------------------
+
+    A symmetric matrix is first reduced to a tridiagonal matrix
+    T = Q^T * A * Q by blocked Householder reflectors, most of the work
+    being rank-2k updates through gemm. All eigenvalues of T come from
+    the implicit QL algorithm, all eigenvectors from divide and conquer,
+    which splits T in halves and merges their decompositions by solving
+    the secular equation of a rank-one modification. A range of
+    eigenvalues is found by bisection on Sturm counts, its eigenvectors
+    by inverse iteration. Eigenvectors of T are finally multiplied by Q.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "eigen.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "matrix_view.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+// Columns reduced by one panel of the tridiagonal reduction before the trailing update
+#define TRD_BLOCK 32
+
+// Tridiagonal matrices this small are solved by the QL algorithm in divide and conquer
+#define DC_LEAF 32
+
+// Iterations of the QL algorithm allowed per eigenvalue
+#define QL_ITERATIONS 60
+
+// Iterations of the secular equation solver and of bisection per eigenvalue
+#define ROOT_ITERATIONS 200
+
+// Inverse iterations per eigenvector
+#define INVERSE_ITERATIONS 3
+
+// Eigenvalue with the column of its eigenvector
+typedef struct
+{
+    double value;
+    int index;
+} eigen_pair;
+
+// Workspace of divide and conquer, sized for the whole tridiagonal matrix
+typedef struct
+{
+    matrix* gathered;   // eigenvectors of the halves not deflated, later the merged eigenvectors
+    matrix* product;    // gathered times the eigenvectors of the rank-one modification
+    matrix* secular;    // differences d(j) - lambda(i), then eigenvectors, by rows
+    double* z;          // rank-one modification vector
+    double* values;     // poles of the secular equation
+    double* weights;    // its weights
+    double* scratch;    // off-diagonal of the leaves
+    int* kept;          // columns not deflated
+    int* deflated;      // deflated columns
+    eigen_pair* order;
+} dc_work;
+
+// Bisection of a range of eigenvalues, one task per eigenvalue
+typedef struct
+{
+    int n;
+    const double* d;
+    const double* e;
+    double* values;
+    int first;
+    double lower;
+    double upper;
+    double pivmin;
+} bisect_job;
+
+// Inverse iteration, one task per cluster of close eigenvalues
+typedef struct
+{
+    int n;
+    const double* d;
+    const double* e;
+    const double* values;
+    const int* clusters;
+    matrix* z;
+    double* work;       // 5 * n doubles per worker
+    int* pivots;        // n pivots per worker
+    double norm;
+} inverse_job;
+
+
+static int compare_pairs(const void* a, const void* b) {
+    double x = ((const eigen_pair*)a)->value, y = ((const eigen_pair*)b)->value;
+
+    return (x > y) - (x < y);
+}
+
+
+static void householder(matrix* x, double* tau) {
+    /*  Generates the reflector H = I - tau * v * v^T that maps the column
+        vector x to (beta, 0, ..., 0). beta overwrites x(0), v the rest of x,
+        the leading 1 of v is not stored. */
+    double alpha = MATRIX_AT(x, 0, 0), norm = 0.0, beta, scale;
+    int r;
+
+    for (r = 1; r < x->rows; r++)
+    {
+        norm += MATRIX_AT(x, r, 0) * MATRIX_AT(x, r, 0);
+    }
+
+    if (norm == 0.0)
+    {
+        *tau = 0.0;
+        return;
+    }
+
+    beta = -copysign(sqrt(alpha * alpha + norm), alpha);
+    *tau = (beta - alpha) / beta;
+    scale = 1.0 / (alpha - beta);
+    for (r = 1; r < x->rows; r++)
+    {
+        MATRIX_AT(x, r, 0) *= scale;
+    }
+    MATRIX_AT(x, 0, 0) = beta;
+}
+
+
+static void reduce_panel(const simd_kernels* k, matrix* a, int nb, matrix* v, matrix* w, matrix* t, double* x, double* y,
+                         double* d, double* e, double* tau) {
+    /*  Reduces the first nb columns of the symmetric matrix a, whose
+        trailing part is not updated. Instead the reflectors are collected
+        in v and w so that the trailing part is A - V * W^T - W * V^T. x
+        and y hold m elements each. */
+    int m = a->rows, i, r;
+    matrix col, vr, wr, vrow, wrow, column, vi, wi, vp, wp, ti;
+    double dot;
+
+    for (i = 0; i < nb; i++)
+    {
+        // Column i with the updates of the previous columns of the panel
+        if (i > 0)
+        {
+            col = sub_block(a, i, i, m - i, 1);
+            vr = sub_block(v, i, 0, m - i, i);
+            wr = sub_block(w, i, 0, m - i, i);
+            vrow = sub_block(v, i, 0, 1, i);
+            wrow = sub_block(w, i, 0, 1, i);
+            gemm(-1.0, &vr, MATRIX_NO_TRANS, &wrow, MATRIX_TRANS, 1.0, &col);
+            gemm(-1.0, &wr, MATRIX_NO_TRANS, &vrow, MATRIX_TRANS, 1.0, &col);
+        }
+        d[i] = MATRIX_AT(a, i, i);
+
+        column = sub_block(a, i + 1, i, m - i - 1, 1);
+        householder(&column, &tau[i]);
+        e[i] = MATRIX_AT(a, i + 1, i);
+
+        for (r = 0; r < m; r++)
+        {
+            MATRIX_AT(v, r, i) = r > i + 1 ? MATRIX_AT(a, r, i) : (r == i + 1 ? 1.0 : 0.0);
+            MATRIX_AT(w, r, i) = 0.0;
+        }
+
+        // w = tau * (A22 - V * W^T - W * V^T) * v, A22 * v summed over the contiguous rows of A22
+        vi = sub_block(v, i + 1, i, m - i - 1, 1);
+        wi = sub_block(w, i + 1, i, m - i - 1, 1);
+        for (r = 0; r < vi.rows; r++)
+        {
+            x[r] = MATRIX_AT(&vi, r, 0);
+            y[r] = 0.0;
+        }
+        for (r = 0; r < vi.rows; r++)
+        {
+            k->axpy(vi.rows, x[r], &MATRIX_AT(a, i + 1 + r, i + 1), y);
+        }
+        for (r = 0; r < vi.rows; r++)
+        {
+            MATRIX_AT(&wi, r, 0) = y[r];
+        }
+        if (i > 0)
+        {
+            vp = sub_block(v, i + 1, 0, m - i - 1, i);
+            wp = sub_block(w, i + 1, 0, m - i - 1, i);
+            ti = sub_block(t, 0, 0, i, 1);
+            gemm(1.0, &wp, MATRIX_TRANS, &vi, MATRIX_NO_TRANS, 0.0, &ti);
+            gemm(-1.0, &vp, MATRIX_NO_TRANS, &ti, MATRIX_NO_TRANS, 1.0, &wi);
+            gemm(1.0, &vp, MATRIX_TRANS, &vi, MATRIX_NO_TRANS, 0.0, &ti);
+            gemm(-1.0, &wp, MATRIX_NO_TRANS, &ti, MATRIX_NO_TRANS, 1.0, &wi);
+        }
+
+        // w = w - tau / 2 * (w^T * v) * v makes the update symmetric
+        dot = 0.0;
+        for (r = 0; r < wi.rows; r++)
+        {
+            MATRIX_AT(&wi, r, 0) *= tau[i];
+            dot += MATRIX_AT(&wi, r, 0) * MATRIX_AT(&vi, r, 0);
+        }
+        for (r = 0; r < wi.rows; r++)
+        {
+            MATRIX_AT(&wi, r, 0) -= 0.5 * tau[i] * dot * MATRIX_AT(&vi, r, 0);
+        }
+    }
+}
+
+
+static int tridiagonalize(matrix* a, double* d, double* e, double* tau) {
+    /*  Reduces the symmetric matrix a, both of its triangles stored, to
+        the tridiagonal matrix with diagonal d and off-diagonal e. Reflector
+        i is stored below the subdiagonal of column i, Q = H(0) * ... * H(n - 2).
+        Returns 0 if the workspace can not be allocated. */
+    const simd_kernels* k = simd_get_kernels();
+    int n = a->rows, kb, nb, m;
+    matrix *v = initialize_matrix(n, TRD_BLOCK), *w = initialize_matrix(n, TRD_BLOCK), *t = initialize_matrix(TRD_BLOCK, 1);
+    double* scratch = malloc(2 * n * sizeof(double));
+    matrix sub, vb, wb, trailing, v2, w2;
+
+    if (!v || !w || !t || !scratch)
+    {
+        destroy_matrix(v);
+        destroy_matrix(w);
+        destroy_matrix(t);
+        free(scratch);
+        return 0;
+    }
+
+    for (kb = 0; kb < n - 1; kb += TRD_BLOCK)
+    {
+        nb = n - 1 - kb < TRD_BLOCK ? n - 1 - kb : TRD_BLOCK;
+        m = n - kb;
+        sub = sub_block(a, kb, kb, m, m);
+        vb = sub_block(v, 0, 0, m, nb);
+        wb = sub_block(w, 0, 0, m, nb);
+        reduce_panel(k, &sub, nb, &vb, &wb, t, scratch, scratch + n, d + kb, e + kb, tau + kb);
+
+        // Rank-2nb update of both triangles of the trailing matrix
+        trailing = sub_block(&sub, nb, nb, m - nb, m - nb);
+        v2 = sub_block(&vb, nb, 0, m - nb, nb);
+        w2 = sub_block(&wb, nb, 0, m - nb, nb);
+        gemm(-1.0, &v2, MATRIX_NO_TRANS, &w2, MATRIX_TRANS, 1.0, &trailing);
+        gemm(-1.0, &w2, MATRIX_NO_TRANS, &v2, MATRIX_TRANS, 1.0, &trailing);
+    }
+    d[n - 1] = MATRIX_AT(a, n - 1, n - 1);
+    e[n - 1] = 0.0;
+
+    destroy_matrix(v);
+    destroy_matrix(w);
+    destroy_matrix(t);
+    free(scratch);
+    return 1;
+}
+
+
+static void sort_eigenpairs(int n, double* d, matrix* z) {
+    /* Sorts the eigenvalues d in ascending order together with the columns of z, if z is given. */
+    int i, j, p, r;
+    double tmp;
+
+    for (i = 0; i < n - 1; i++)
+    {
+        p = i;
+        for (j = i + 1; j < n; j++)
+        {
+            p = d[j] < d[p] ? j : p;
+        }
+        if (p == i)
+        {
+            continue;
+        }
+
+        tmp = d[i];
+        d[i] = d[p];
+        d[p] = tmp;
+        for (r = 0; z && r < z->rows; r++)
+        {
+            tmp = MATRIX_AT(z, r, i);
+            MATRIX_AT(z, r, i) = MATRIX_AT(z, r, p);
+            MATRIX_AT(z, r, p) = tmp;
+        }
+    }
+}
+
+
+static int tridiagonal_ql(int n, double* d, double* e, matrix* z) {
+    /*  Computes the eigenvalues d of the tridiagonal matrix with diagonal d
+        and off-diagonal e(0 : n - 1) by the implicit QL algorithm with
+        Wilkinson shifts, e(n - 1) must be 0 and e is destroyed. The
+        rotations are applied to the columns of z if it is given. Returns 1
+        if an eigenvalue does not converge. */
+    int l, m, i, r, iterations;
+    double g, p, rr, s, c, f, b, x;
+
+    for (l = 0; l < n; l++)
+    {
+        iterations = 0;
+        do
+        {
+            // Look for a negligible off-diagonal element to split the matrix at
+            for (m = l; m < n - 1; m++)
+            {
+                if (fabs(e[m]) <= DBL_EPSILON * (fabs(d[m]) + fabs(d[m + 1])))
+                {
+                    break;
+                }
+            }
+            if (m == l)
+            {
+                break;
+            }
+            if (iterations++ == QL_ITERATIONS)
+            {
+                return 1;
+            }
+
+            g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+            rr = hypot(g, 1.0);
+            g = d[m] - d[l] + e[l] / (g + copysign(rr, g));
+            s = c = 1.0;
+            p = 0.0;
+
+            for (i = m - 1; i >= l; i--)
+            {
+                f = s * e[i];
+                b = c * e[i];
+                e[i + 1] = rr = hypot(f, g);
+
+                // Underflow, the matrix splits and the sweep is restarted
+                if (rr == 0.0)
+                {
+                    d[i + 1] -= p;
+                    e[m] = 0.0;
+                    break;
+                }
+                s = f / rr;
+                c = g / rr;
+                g = d[i + 1] - p;
+                rr = (d[i] - g) * s + 2.0 * c * b;
+                p = s * rr;
+                d[i + 1] = g + p;
+                g = c * rr - b;
+
+                for (r = 0; z && r < z->rows; r++)
+                {
+                    x = MATRIX_AT(z, r, i + 1);
+                    MATRIX_AT(z, r, i + 1) = s * MATRIX_AT(z, r, i) + c * x;
+                    MATRIX_AT(z, r, i) = c * MATRIX_AT(z, r, i) - s * x;
+                }
+            }
+            if (rr == 0.0 && i >= l)
+            {
+                continue;
+            }
+            d[l] -= p;
+            e[l] = g;
+            e[m] = 0.0;
+        } while (m != l);
+    }
+
+    sort_eigenpairs(n, d, z);
+    return 0;
+}
+
+
+static double secular_root(int k, const double* d, const double* z, double rho, int i, double* delta) {
+    /*  Returns root i of the secular equation 1 + rho * sum z(j)^2 / (d(j) - x) = 0
+        for ascending d and rho > 0, which lies between d(i) and d(i + 1), or
+        above d(k - 1) for the last one. The root is found relative to its
+        closer pole so that delta(j) = d(j) - root is accurate. A model with
+        the two neighbouring poles gives the steps, bisection guards them. */
+    double origin, lower, upper, mu, f, psi, dpsi, phi, dphi, a, b, c, s, big, q, disc, step, candidate;
+    int j, origin_index, iteration;
+
+    if (i < k - 1)
+    {
+        // The sign of f at the midpoint tells the closer pole
+        mu = (d[i + 1] - d[i]) / 2.0;
+        f = 1.0;
+        for (j = 0; j < k; j++)
+        {
+            f += rho * z[j] * z[j] / ((d[j] - d[i]) - mu);
+        }
+        origin_index = f >= 0.0 ? i : i + 1;
+        lower = f >= 0.0 ? 0.0 : -mu;
+        upper = f >= 0.0 ? mu : 0.0;
+    }else{
+        origin_index = k - 1;
+        lower = 0.0;
+        upper = 0.0;
+        for (j = 0; j < k; j++)
+        {
+            upper += rho * z[j] * z[j];
+        }
+    }
+    origin = d[origin_index];
+    mu = (lower + upper) / 2.0;
+
+    for (iteration = 0; iteration < ROOT_ITERATIONS; iteration++)
+    {
+        psi = dpsi = phi = dphi = 0.0;
+        for (j = 0; j < k; j++)
+        {
+            delta[j] = (d[j] - origin) - mu;
+            if (j <= i)
+            {
+                psi += rho * z[j] * z[j] / delta[j];
+                dpsi += rho * z[j] * z[j] / (delta[j] * delta[j]);
+            }else{
+                phi += rho * z[j] * z[j] / delta[j];
+                dphi += rho * z[j] * z[j] / (delta[j] * delta[j]);
+            }
+        }
+        f = 1.0 + psi + phi;
+
+        // f increases between the poles
+        if (f < 0.0)
+        {
+            lower = mu;
+        }else{
+            upper = mu;
+        }
+        if (fabs(f) <= 8.0 * DBL_EPSILON * (1.0 + fabs(psi) + fabs(phi)) ||
+            upper - lower <= 2.0 * DBL_EPSILON * fmin(fabs(lower), fabs(upper)))
+        {
+            break;
+        }
+
+        // psi and phi modeled as constants plus s / delta(i) and big / delta(i + 1)
+        a = delta[i];
+        s = dpsi * a * a;
+        c = f - dpsi * a;
+        if (i < k - 1)
+        {
+            b = delta[i + 1];
+            big = dphi * b * b;
+            c -= dphi * b;
+            q = -(c * (a + b) + s + big);
+            disc = q * q - 4.0 * c * (c * a * b + s * b + big * a);
+            q = -0.5 * (q + copysign(sqrt(fabs(disc)), q));
+            step = q != 0.0 ? (c * a * b + s * b + big * a) / q : 0.0;
+            step = disc < 0.0 ? NAN : step;
+        }else{
+            step = c != 0.0 ? a + s / c : NAN;
+        }
+
+        candidate = mu + step;
+        mu = candidate > lower && candidate < upper && iteration % 8 != 7 ? candidate : (lower + upper) / 2.0;
+    }
+
+    for (j = 0; j < k; j++)
+    {
+        delta[j] = (d[j] - origin) - mu;
+    }
+    return origin + mu;
+}
+
+
+static void rotate_columns(matrix* q, int x, int y, double c, double s) {
+    /* Replaces columns x and y of q by c * x + s * y and c * y - s * x. */
+    int r;
+    double tmp;
+
+    for (r = 0; r < q->rows; r++)
+    {
+        tmp = MATRIX_AT(q, r, x);
+        MATRIX_AT(q, r, x) = c * tmp + s * MATRIX_AT(q, r, y);
+        MATRIX_AT(q, r, y) = c * MATRIX_AT(q, r, y) - s * tmp;
+    }
+}
+
+
+static void merge_halves(matrix* q, double* d, int m, double beta, dc_work* w) {
+    /*  Merges the eigendecompositions Q1, Q2 of the halves (first m rows)
+        into that of T = diag(Q1, Q2) * (D + rho * z * z^T) * diag(Q1, Q2)^T.
+        Eigenvalues with a negligible component of z, or close to another
+        one, are deflated and kept. The others solve the secular equation,
+        their eigenvectors (Gu and Eisenstat) are multiplied by the
+        eigenvectors of the halves through gemm. */
+    int n = q->rows, i, j, t, pj = -1, k = 0, deflated = 0;
+    double rho = 2.0 * fabs(beta), largest = 0.0, tol, c, s, r, gap, value, norm;
+    matrix gathered, product, secular, sorted;
+
+    // z = diag(Q1, Q2)^T * (e(m - 1) + sign(beta) * e(m)) / sqrt(2)
+    for (j = 0; j < n; j++)
+    {
+        w->z[j] = (j < m ? MATRIX_AT(q, m - 1, j) : copysign(1.0, beta) * MATRIX_AT(q, m, j)) / sqrt(2.0);
+        w->order[j].value = d[j];
+        w->order[j].index = j;
+        largest = fabs(d[j]) > largest ? fabs(d[j]) : largest;
+    }
+    qsort(w->order, n, sizeof(eigen_pair), compare_pairs);
+    tol = 8.0 * DBL_EPSILON * (largest > rho ? largest : rho);
+
+    for (t = 0; t < n; t++)
+    {
+        j = w->order[t].index;
+        if (rho * fabs(w->z[j]) <= tol)
+        {
+            w->deflated[deflated++] = j;
+            continue;
+        }
+
+        if (pj >= 0)
+        {
+            // A rotation of two close eigenvalues zeroes one component of z
+            r = hypot(w->z[pj], w->z[j]);
+            c = w->z[j] / r;
+            s = -w->z[pj] / r;
+            gap = d[j] - d[pj];
+            if (fabs(gap * c * s) <= tol)
+            {
+                w->z[j] = r;
+                w->z[pj] = 0.0;
+                rotate_columns(q, pj, j, c, s);
+                value = d[pj] * c * c + d[j] * s * s;
+                d[j] = d[pj] * s * s + d[j] * c * c;
+                d[pj] = value;
+                w->deflated[deflated++] = pj;
+                pj = j;
+                continue;
+            }
+            w->kept[k++] = pj;
+        }
+        pj = j;
+    }
+    if (pj >= 0)
+    {
+        w->kept[k++] = pj;
+    }
+
+    gathered = sub_block(w->gathered, 0, 0, n, k);
+    product = sub_block(w->product, 0, 0, n, k);
+    secular = sub_block(w->secular, 0, 0, k, k);
+    for (t = 0; t < k; t++)
+    {
+        w->values[t] = d[w->kept[t]];
+        w->weights[t] = w->z[w->kept[t]];
+        for (i = 0; i < n; i++)
+        {
+            MATRIX_AT(&gathered, i, t) = MATRIX_AT(q, i, w->kept[t]);
+        }
+    }
+
+    // Row t of secular holds d(j) - lambda(t) for root t
+    for (t = 0; t < k; t++)
+    {
+        w->order[t].value = secular_root(k, w->values, w->weights, rho, t, &MATRIX_AT(&secular, t, 0));
+        w->order[t].index = -1 - t;
+    }
+
+    // z recomputed from the roots keeps the eigenvectors orthogonal
+    for (j = 0; j < k; j++)
+    {
+        value = MATRIX_AT(&secular, j, j);
+        for (t = 0; t < k; t++)
+        {
+            value *= t != j ? MATRIX_AT(&secular, t, j) / (w->values[j] - w->values[t]) : 1.0;
+        }
+        w->z[j] = copysign(sqrt(fabs(value)), w->weights[j]);
+    }
+    for (t = 0; t < k; t++)
+    {
+        norm = 0.0;
+        for (j = 0; j < k; j++)
+        {
+            MATRIX_AT(&secular, t, j) = w->z[j] / MATRIX_AT(&secular, t, j);
+            norm += MATRIX_AT(&secular, t, j) * MATRIX_AT(&secular, t, j);
+        }
+        norm = 1.0 / sqrt(norm);
+        for (j = 0; j < k; j++)
+        {
+            MATRIX_AT(&secular, t, j) *= norm;
+        }
+    }
+    if (k > 0)
+    {
+        gemm(1.0, &gathered, MATRIX_NO_TRANS, &secular, MATRIX_TRANS, 0.0, &product);
+    }
+
+    // Eigenvectors of T in ascending order of their eigenvalues
+    for (t = 0; t < deflated; t++)
+    {
+        w->order[k + t].value = d[w->deflated[t]];
+        w->order[k + t].index = w->deflated[t];
+    }
+    qsort(w->order, n, sizeof(eigen_pair), compare_pairs);
+
+    sorted = sub_block(w->gathered, 0, 0, n, n);
+    for (t = 0; t < n; t++)
+    {
+        j = w->order[t].index;
+        for (i = 0; i < n; i++)
+        {
+            MATRIX_AT(&sorted, i, t) = j < 0 ? MATRIX_AT(&product, i, -1 - j) : MATRIX_AT(q, i, j);
+        }
+        d[t] = w->order[t].value;
+    }
+    copy_into(q, &sorted);
+}
+
+
+static int divide_and_conquer(matrix* q, double* d, double* e, dc_work* w) {
+    /*  Computes the eigenvalues d in ascending order and the eigenvectors q
+        of the tridiagonal matrix with diagonal d and off-diagonal e, whose
+        last element is not read. Returns 1 if the QL algorithm fails. */
+    int n = q->rows, m = n / 2, i, j;
+    double beta;
+    matrix q1, q2;
+
+    if (n <= DC_LEAF)
+    {
+        for (i = 0; i < n; i++)
+        {
+            for (j = 0; j < n; j++)
+            {
+                MATRIX_AT(q, i, j) = i == j;
+            }
+            w->scratch[i] = i < n - 1 ? e[i] : 0.0;
+        }
+        return tridiagonal_ql(n, d, w->scratch, q);
+    }
+
+    // T = diag(T1 - |beta| * e(m - 1) * e(m - 1)^T, T2 - |beta| * e(0) * e(0)^T) + rank-one
+    beta = e[m - 1];
+    d[m - 1] -= fabs(beta);
+    d[m] -= fabs(beta);
+
+    for (i = 0; i < n; i++)
+    {
+        for (j = i < m ? m : 0; j < (i < m ? n : m); j++)
+        {
+            MATRIX_AT(q, i, j) = 0.0;
+        }
+    }
+
+    q1 = sub_block(q, 0, 0, m, m);
+    q2 = sub_block(q, m, m, n - m, n - m);
+    if (divide_and_conquer(&q1, d, e, w) || divide_and_conquer(&q2, d + m, e + m, w))
+    {
+        return 1;
+    }
+
+    merge_halves(q, d, m, beta, w);
+    return 0;
+}
+
+
+static void destroy_dc_work(dc_work* w) {
+    destroy_matrix(w->gathered);
+    destroy_matrix(w->product);
+    destroy_matrix(w->secular);
+    free(w->z);
+    free(w->values);
+    free(w->weights);
+    free(w->scratch);
+    free(w->kept);
+    free(w->deflated);
+    free(w->order);
+}
+
+
+static int init_dc_work(dc_work* w, int n) {
+    /* Allocates the workspace of divide and conquer for n x n tridiagonal matrices, returns 0 on failure. */
+    w->gathered = initialize_matrix(n, n);
+    w->product = initialize_matrix(n, n);
+    w->secular = initialize_matrix(n, n);
+    w->z = malloc(n * sizeof(double));
+    w->values = malloc(n * sizeof(double));
+    w->weights = malloc(n * sizeof(double));
+    w->scratch = malloc(n * sizeof(double));
+    w->kept = malloc(n * sizeof(int));
+    w->deflated = malloc(n * sizeof(int));
+    w->order = malloc(n * sizeof(eigen_pair));
+
+    if (!w->gathered || !w->product || !w->secular || !w->z || !w->values || !w->weights ||
+        !w->scratch || !w->kept || !w->deflated || !w->order)
+    {
+        destroy_dc_work(w);
+        return 0;
+    }
+    return 1;
+}
+
+
+static int sturm_count(int n, const double* d, const double* e, double x, double pivmin) {
+    /* Returns the number of eigenvalues of the tridiagonal matrix below x. */
+    double q = d[0] - x;
+    int count, i;
+
+    q = fabs(q) < pivmin ? -pivmin : q;
+    count = q < 0.0;
+    for (i = 1; i < n; i++)
+    {
+        q = d[i] - x - e[i - 1] * e[i - 1] / q;
+        q = fabs(q) < pivmin ? -pivmin : q;
+        count += q < 0.0;
+    }
+    return count;
+}
+
+
+static void bisect_task(void* ctx, int task, int worker) {
+    /* Bisects the Gershgorin interval down to eigenvalue first + task. */
+    const bisect_job* job = ctx;
+    double lower = job->lower, upper = job->upper, middle;
+    int iteration;
+    (void)worker;
+
+    for (iteration = 0; iteration < ROOT_ITERATIONS &&
+         upper - lower > 2.0 * DBL_EPSILON * fmax(fabs(lower), fabs(upper)) + job->pivmin; iteration++)
+    {
+        middle = lower + (upper - lower) / 2.0;
+        if (sturm_count(job->n, job->d, job->e, middle, job->pivmin) <= job->first + task)
+        {
+            lower = middle;
+        }else{
+            upper = middle;
+        }
+    }
+    job->values[task] = lower + (upper - lower) / 2.0;
+}
+
+
+static void inverse_task(void* ctx, int task, int worker) {
+    /*  Computes the eigenvectors of one cluster by inverse iteration with
+        T - lambda * I factored by Gaussian elimination with partial
+        pivoting. Vectors of the cluster are orthogonalized against each
+        other, equal eigenvalues are separated slightly. */
+    const inverse_job* job = ctx;
+    int n = job->n, i, j, p, iteration;
+    double *diag = job->work + (size_t)5 * n * worker, *super1 = diag + n, *super2 = super1 + n, *lower = super2 + n, *x = lower + n;
+    int* swapped = job->pivots + (size_t)n * worker;
+    double lambda = 0.0, tiny = DBL_EPSILON * job->norm, m, r0, r1, tmp, dot, norm;
+    unsigned int seed;
+
+    tiny = tiny > 0.0 ? tiny : DBL_MIN;
+    for (j = job->clusters[task]; j < job->clusters[task + 1]; j++)
+    {
+        lambda = j > job->clusters[task] && job->values[j] - lambda < 10.0 * tiny ? lambda + 10.0 * tiny : job->values[j];
+
+        // (T - lambda * I) = P * L * U with U upper triangular with two superdiagonals
+        for (i = 0; i < n; i++)
+        {
+            diag[i] = job->d[i] - lambda;
+            super1[i] = i < n - 1 ? job->e[i] : 0.0;
+            super2[i] = 0.0;
+        }
+        for (i = 0; i < n - 1; i++)
+        {
+            if (fabs(diag[i]) >= fabs(job->e[i]))
+            {
+                diag[i] = diag[i] == 0.0 ? tiny : diag[i];
+                m = job->e[i] / diag[i];
+                diag[i + 1] -= m * super1[i];
+                swapped[i] = 0;
+            }else{
+                m = diag[i] / job->e[i];
+                r0 = diag[i + 1];
+                r1 = super1[i + 1];
+                diag[i] = job->e[i];
+                tmp = super1[i];
+                super1[i] = r0;
+                super2[i] = r1;
+                diag[i + 1] = tmp - m * r0;
+                super1[i + 1] = -m * r1;
+                swapped[i] = 1;
+            }
+            lower[i] = m;
+        }
+        diag[n - 1] = diag[n - 1] == 0.0 ? tiny : diag[n - 1];
+
+        // Pseudorandom start, the same for every run
+        seed = 2654435761u * (unsigned int)(j + 1);
+        for (i = 0; i < n; i++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            x[i] = (double)(seed >> 16) / 65536.0 - 0.5;
+        }
+
+        for (iteration = 0; iteration < INVERSE_ITERATIONS; iteration++)
+        {
+            for (i = 0; i < n - 1; i++)
+            {
+                if (swapped[i])
+                {
+                    tmp = x[i];
+                    x[i] = x[i + 1];
+                    x[i + 1] = tmp;
+                }
+                x[i + 1] -= lower[i] * x[i];
+            }
+            for (i = n - 1; i >= 0; i--)
+            {
+                x[i] -= (i < n - 1 ? super1[i] * x[i + 1] : 0.0) + (i < n - 2 ? super2[i] * x[i + 2] : 0.0);
+                x[i] /= diag[i];
+            }
+
+            for (p = job->clusters[task]; p < j; p++)
+            {
+                dot = 0.0;
+                for (i = 0; i < n; i++)
+                {
+                    dot += MATRIX_AT(job->z, i, p) * x[i];
+                }
+                for (i = 0; i < n; i++)
+                {
+                    x[i] -= dot * MATRIX_AT(job->z, i, p);
+                }
+            }
+
+            norm = 0.0;
+            for (i = 0; i < n; i++)
+            {
+                norm += x[i] * x[i];
+            }
+            norm = 1.0 / sqrt(norm);
+            for (i = 0; i < n; i++)
+            {
+                x[i] *= norm;
+            }
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            MATRIX_AT(job->z, i, j) = x[i];
+        }
+    }
+}
+
+
+static int tridiagonal_range(int n, const double* d, const double* e, int first, int count, double* values, matrix* z) {
+    /*  Computes eigenvalues first to first + count - 1 of the tridiagonal
+        matrix by bisection and, if z is given, their eigenvectors by
+        inverse iteration. Returns 0 if the workspace can not be allocated. */
+    bisect_job bisect;
+    inverse_job inverse;
+    int i, clusters, workers = thread_pool_size();
+    double radius, largest = 0.0;
+    int* starts;
+
+    bisect.n = n;
+    bisect.d = d;
+    bisect.e = e;
+    bisect.values = values;
+    bisect.first = first;
+    bisect.lower = d[0];
+    bisect.upper = d[0];
+    for (i = 0; i < n; i++)
+    {
+        radius = (i > 0 ? fabs(e[i - 1]) : 0.0) + (i < n - 1 ? fabs(e[i]) : 0.0);
+        bisect.lower = fmin(bisect.lower, d[i] - radius);
+        bisect.upper = fmax(bisect.upper, d[i] + radius);
+        largest = i < n - 1 ? fmax(largest, e[i] * e[i]) : largest;
+    }
+    inverse.norm = fmax(fabs(bisect.lower), fabs(bisect.upper));
+    bisect.lower -= 2.0 * n * DBL_EPSILON * inverse.norm;
+    bisect.upper += 2.0 * n * DBL_EPSILON * inverse.norm;
+    bisect.pivmin = DBL_MIN * fmax(1.0, largest);
+    thread_pool_run(count, workers, bisect_task, &bisect);
+
+    if (!z)
+    {
+        return 1;
+    }
+
+    // Clusters of eigenvalues closer than 1e-3 * norm(T) are orthogonalized together
+    if ((starts = malloc((count + 1) * sizeof(int))) == NULL)
+    {
+        return 0;
+    }
+    clusters = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (i == 0 || values[i] - values[i - 1] > 1e-3 * inverse.norm)
+        {
+            starts[clusters++] = i;
+        }
+    }
+    starts[clusters] = count;
+
+    workers = workers < clusters ? workers : clusters;
+    inverse.n = n;
+    inverse.d = d;
+    inverse.e = e;
+    inverse.values = values;
+    inverse.clusters = starts;
+    inverse.z = z;
+    inverse.work = malloc((size_t)5 * n * workers * sizeof(double));
+    inverse.pivots = malloc((size_t)n * workers * sizeof(int));
+    if (!inverse.work || !inverse.pivots)
+    {
+        free(inverse.work);
+        free(inverse.pivots);
+        free(starts);
+        return 0;
+    }
+
+    thread_pool_run(clusters, workers, inverse_task, &inverse);
+
+    free(inverse.work);
+    free(inverse.pivots);
+    free(starts);
+    return 1;
+}
+
+
+static matrix* reduce_copy(matrix* A, double** d, double** e, double** tau) {
+    /*  Returns a copy of A with its lower triangle mirrored, reduced to
+        tridiagonal form with d, e and tau allocated, or NULL with error set. */
+    int n = A->rows, i, j;
+    matrix* a;
+
+    if ((a = materialize(A)) == NULL)
+    {
+        return NULL;
+    }
+
+    *d = malloc(n * sizeof(double));
+    *e = malloc(n * sizeof(double));
+    *tau = malloc(n * sizeof(double));
+    if (!*d || !*e || !*tau)
+    {
+        free(*d);
+        free(*e);
+        free(*tau);
+        destroy_matrix(a);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        for (j = i + 1; j < n; j++)
+        {
+            MATRIX_AT(a, i, j) = MATRIX_AT(a, j, i);
+        }
+    }
+
+    if (!tridiagonalize(a, *d, *e, *tau))
+    {
+        free(*d);
+        free(*e);
+        free(*tau);
+        destroy_matrix(a);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+    return a;
+}
+
+
+static void back_transform(matrix* a, double* tau, matrix* z) {
+    /* Multiplies the eigenvectors z of the tridiagonal matrix by Q of the reduction stored in a. */
+    matrix reflectors, rows;
+
+    if (a->rows < 2)
+    {
+        error = MATRIX_OK;
+        return;
+    }
+
+    // Q = diag(1, Q'), the reflectors of Q' lie below the diagonal of a(1 :, 0 : n - 1)
+    reflectors = sub_block(a, 1, 0, a->rows - 1, a->rows - 1);
+    rows = sub_block(z, 1, 0, z->rows - 1, z->cols);
+    qr_apply_q(&reflectors, tau, MATRIX_NO_TRANS, &rows);
+}
+
+
+static int check_eigen(matrix* A, double* values, matrix* vectors, int cols) {
+    /* Checks the arguments of a symmetric eigensolver, sets error and returns 0 if they are invalid. */
+
+    if (!A || !values) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return 0;
+    }
+
+    if (A->rows != A->cols || (vectors && (vectors->rows != A->rows || vectors->cols != cols)))
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+void eigen_symmetric(matrix* A, double* values, matrix* vectors){
+    /*  Computes all eigenvalues of the symmetric matrix A in ascending
+        order into values and, unless vectors is NULL, the corresponding
+        orthonormal eigenvectors into the columns of vectors (n x n). Only
+        the lower triangle of A is read, A is kept. Sets MATRIX_OTHER_ERROR
+        if the QL algorithm does not converge. */
+
+    matrix* a;
+    double *d, *e, *tau;
+    dc_work work;
+    int failed;
+
+    if (!check_eigen(A, values, vectors, A ? A->rows : 0))
+    {
+        return;
+    }
+
+    if ((a = reduce_copy(A, &d, &e, &tau)) == NULL)
+    {
+        return;
+    }
+
+    if (!vectors)
+    {
+        failed = tridiagonal_ql(a->rows, d, e, NULL);
+    }else if (init_dc_work(&work, a->rows))
+    {
+        failed = divide_and_conquer(vectors, d, e, &work);
+        destroy_dc_work(&work);
+    }else{
+        failed = -1;
+    }
+
+    if (failed == 0)
+    {
+        memcpy(values, d, a->rows * sizeof(double));
+        error = MATRIX_OK;
+        if (vectors)
+        {
+            back_transform(a, tau, vectors);
+        }
+    }else if (failed < 0)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+    }else{
+        error = MATRIX_OTHER_ERROR;
+        LOG_ERROR("Eigenvalues did not converge");
+    }
+
+    destroy_matrix(a);
+    free(d);
+    free(e);
+    free(tau);
+}
+
+
+void eigen_symmetric_range(matrix* A, int first, int count, double* values, matrix* vectors){
+    /*  Computes eigenvalues first to first + count - 1 (indexed from 0 in
+        ascending order) of the symmetric matrix A into values and, unless
+        vectors is NULL, their eigenvectors into the columns of vectors
+        (n x count). Only the lower triangle of A is read, A is kept. The
+        eigenvalues are bisected in parallel, eigenvectors of separate
+        clusters are computed in parallel by inverse iteration. */
+
+    matrix* a;
+    double *d, *e, *tau;
+
+    if (!check_eigen(A, values, vectors, count))
+    {
+        return;
+    }
+
+    if (first < 0 || count < 1 || first + count > A->rows)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if ((a = reduce_copy(A, &d, &e, &tau)) == NULL)
+    {
+        return;
+    }
+
+    if (!tridiagonal_range(a->rows, d, e, first, count, values, vectors))
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+    }else if (vectors)
+    {
+        back_transform(a, tau, vectors);
+    }else{
+        error = MATRIX_OK;
+    }
+
+    destroy_matrix(a);
+    free(d);
+    free(e);
+    free(tau);
+}
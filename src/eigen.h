@@ -0,0 +1,29 @@
+/*
+    eigen.h    version 1.0
+
+    Header file for eigen.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_EIGEN
+#define MAT_EIGEN
+
+#include "matrix.h"
+#include "linalg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void eigen_symmetric(matrix* A, double* values, matrix* vectors);
+extern void eigen_symmetric_range(matrix* A, int first, int count, double* values, matrix* vectors);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
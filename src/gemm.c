@@ -0,0 +1,37 @@
+/*
+    gemm.c    version 1.0
+
+    Module for general matrix-matrix multiplication.
+    --------------------------
+
+    Computes C = alpha * op(A) * op(B) + beta * C with cache blocking,
+    panel packing and a register-blocked micro-kernel.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "gemm.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+#define GEMM_T double
+#define GEMM_MATRIX matrix
+#define GEMM_KERNELS simd_kernels
+#define GEMM_GET_KERNELS simd_get_kernels
+#define GEMM_FUNCTION gemm
+#define GEMM_MATERIALIZE materialize
+#define GEMM_COPY_INTO copy_into
+#define GEMM_DESTROY destroy_matrix
+
+#include "gemm_template.h"
@@ -0,0 +1,35 @@
+/*
+    gemm.h    version 1.0
+
+    Header file for gemm.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_GEMM
+#define MAT_GEMM
+
+#include "matrix.h"
+#include "matrix_f32.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    MATRIX_NO_TRANS,
+    MATRIX_TRANS
+} matrix_op;
+
+extern void gemm(double alpha, matrix* A, matrix_op opA, matrix* B, matrix_op opB, double beta, matrix* C);
+extern void gemm_f32(float alpha, matrix_f32* A, matrix_op opA, matrix_f32* B, matrix_op opB, float beta, matrix_f32* C);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+/*
+    gemm_f32.c    version 1.0
+
+    Module for float32 matrix-matrix multiplication.
+    --------------------------
+
+    The blocked gemm of gemm.c instantiated for matrix_f32 with the
+    float32 micro-kernels, which hold twice as many elements per register.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "gemm.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+#define GEMM_T float
+#define GEMM_MATRIX matrix_f32
+#define GEMM_KERNELS simd_kernels_f32
+#define GEMM_GET_KERNELS simd_get_kernels_f32
+#define GEMM_FUNCTION gemm_f32
+#define GEMM_MATERIALIZE materialize_f32
+#define GEMM_COPY_INTO copy_into_f32
+#define GEMM_DESTROY destroy_matrix_f32
+
+#include "gemm_template.h"
@@ -0,0 +1,403 @@
+/*
+    gemm_template.h    version 1.0
+
+    Blocked gemm shared by the element types.
+    --------------------------
+
+    Included by gemm.c and gemm_f32.c after defining:
+        GEMM_T              element type
+        GEMM_MATRIX         matrix type holding GEMM_T elements
+        GEMM_KERNELS        kernel table type from simd.h
+        GEMM_GET_KERNELS    function returning the active kernel table
+        GEMM_FUNCTION       name of the defined gemm function
+        GEMM_MATERIALIZE, GEMM_COPY_INTO, GEMM_DESTROY
+                            materialize, copy_into and destroy_matrix of GEMM_MATRIX
+
+    Jakub Novák     March 2024
+
+*/
+
+// Cache blocking sizes in elements
+#define GEMM_MC 96      // rows of a packed A block, kept in L2
+#define GEMM_KC 256     // depth of packed panels, micro-panels kept in L1
+#define GEMM_NC 4096    // columns of a packed B panel, kept in L3
+
+// Products with fewer multiply-adds than this skip packing
+#define GEMM_SMALL (32 * 32 * 32)
+
+// Products with fewer multiply-adds than this stay in the calling thread
+#define GEMM_PARALLEL (96 * 96 * 96)
+
+// Largest register block of any micro-kernel in simd.c
+#define GEMM_MAX_MR 16
+#define GEMM_MAX_NR 32
+
+// Strided view of op(X): element (i, j) is ptr[i * rs + j * cs]
+typedef struct
+{
+    const GEMM_T* ptr;
+    ptrdiff_t rs;
+    ptrdiff_t cs;
+} gemm_operand;
+
+// State of one product shared by the pack and compute tasks
+typedef struct
+{
+    const GEMM_KERNELS* k;
+    gemm_operand a;
+    gemm_operand b;
+    GEMM_T alpha;
+    GEMM_MATRIX* C;
+    int m;
+    int mc_max;
+    int kc_max;
+    int jc, nc;                 // current panel of B and C columns
+    int pc, kc;                 // current depth block
+    int col_chunks;             // tasks per row block
+    int col_chunk;              // columns per task, multiple of gemm_nr
+    int pack_chunk;             // columns packed per pack task, multiple of gemm_nr
+    GEMM_T* a_packed;           // one A block per worker
+    GEMM_T* b_packed;
+} gemm_job;
+
+static void pack_a(int mc, int kc, gemm_operand a, int mr, GEMM_T* packed) {
+    /* Packs an mc * kc block of op(A) into mr tall row panels, zero padded. */
+    int ir, i, p;
+
+    for (ir = 0; ir < mc; ir += mr)
+    {
+        int rows = mc - ir < mr ? mc - ir : mr;
+        const GEMM_T* src = a.ptr + ir * a.rs;
+
+        for (p = 0; p < kc; p++)
+        {
+            for (i = 0; i < rows; i++)
+            {
+                packed[i] = src[i * a.rs + p * a.cs];
+            }
+            for (; i < mr; i++)
+            {
+                packed[i] = 0.0;
+            }
+            packed += mr;
+        }
+    }
+}
+
+
+static void pack_b(int kc, int nc, gemm_operand b, int nr, GEMM_T* packed) {
+    /* Packs a kc * nc panel of op(B) into nr wide column panels, zero padded. */
+    int jr, j, p;
+
+    for (jr = 0; jr < nc; jr += nr)
+    {
+        int cols = nc - jr < nr ? nc - jr : nr;
+        const GEMM_T* src = b.ptr + jr * b.cs;
+
+        for (p = 0; p < kc; p++)
+        {
+            if (b.cs == 1 && cols == nr)
+            {
+                memcpy(packed, src + p * b.rs, nr * sizeof(GEMM_T));
+            }else{
+                for (j = 0; j < cols; j++)
+                {
+                    packed[j] = src[p * b.rs + j * b.cs];
+                }
+                for (; j < nr; j++)
+                {
+                    packed[j] = 0.0;
+                }
+            }
+            packed += nr;
+        }
+    }
+}
+
+
+static void macro_kernel(const GEMM_KERNELS* k, int mc, int nc, int kc, const GEMM_T* a_packed,
+                         const GEMM_T* b_packed, GEMM_T* c, ptrdiff_t rs_c, GEMM_T alpha) {
+    /* Multiplies a packed A block by a packed B panel, tile by tile. */
+    GEMM_T tile[GEMM_MAX_MR * GEMM_MAX_NR];
+    int ir, jr, i, j;
+
+    for (jr = 0; jr < nc; jr += k->gemm_nr)
+    {
+        int cols = nc - jr < k->gemm_nr ? nc - jr : k->gemm_nr;
+        const GEMM_T* b = b_packed + (size_t)jr * kc;
+
+        for (ir = 0; ir < mc; ir += k->gemm_mr)
+        {
+            int rows = mc - ir < k->gemm_mr ? mc - ir : k->gemm_mr;
+            const GEMM_T* a = a_packed + (size_t)ir * kc;
+            GEMM_T* c_tile = c + ir * rs_c + jr;
+
+            if (rows == k->gemm_mr && cols == k->gemm_nr)
+            {
+                k->gemm(kc, a, b, c_tile, rs_c, alpha);
+                continue;
+            }
+
+            // Edge tile: compute into a scratch tile and add only the valid part
+            memset(tile, 0, sizeof(GEMM_T) * k->gemm_mr * k->gemm_nr);
+            k->gemm(kc, a, b, tile, k->gemm_nr, alpha);
+            for (i = 0; i < rows; i++)
+            {
+                for (j = 0; j < cols; j++)
+                {
+                    c_tile[i * rs_c + j] += tile[i * k->gemm_nr + j];
+                }
+            }
+        }
+    }
+}
+
+
+static void scale_matrix(GEMM_MATRIX* C, GEMM_T beta) {
+    /* Computes C = beta * C, beta == 0 clears C even if it holds NaNs. */
+    int i, j;
+
+    if (beta == 1.0)
+    {
+        return;
+    }
+
+    for (i = 0; i < C->rows; i++)
+    {
+        GEMM_T* c = &MATRIX_AT(C, i, 0);
+
+        if (beta == 0.0)
+        {
+            memset(c, 0, C->cols * sizeof(GEMM_T));
+            continue;
+        }
+        for (j = 0; j < C->cols; j++)
+        {
+            c[j] *= beta;
+        }
+    }
+}
+
+
+static void gemm_small(int m, int n, int k, GEMM_T alpha, gemm_operand a, gemm_operand b, GEMM_MATRIX* C) {
+    /* Unpacked i-p-j loop for products too small to amortize packing. */
+    const GEMM_KERNELS* kernels = GEMM_GET_KERNELS();
+    int i, j, p;
+
+    for (i = 0; i < m; i++)
+    {
+        GEMM_T* c = &MATRIX_AT(C, i, 0);
+
+        for (p = 0; p < k; p++)
+        {
+            GEMM_T a_ip = alpha * a.ptr[i * a.rs + p * a.cs];
+            const GEMM_T* b_row = b.ptr + p * b.rs;
+
+            if (b.cs == 1)
+            {
+                kernels->axpy(n, a_ip, b_row, c);
+                continue;
+            }
+            for (j = 0; j < n; j++)
+            {
+                c[j] += a_ip * b_row[j * b.cs];
+            }
+        }
+    }
+}
+
+
+static gemm_operand make_operand(GEMM_MATRIX* mat, matrix_op op) {
+    /* Describes op(mat) by its base pointer and strides. */
+    gemm_operand operand;
+
+    operand.ptr = mat->buffer;
+    if (op == MATRIX_TRANS)
+    {
+        operand.rs = mat->col_stride;
+        operand.cs = mat->row_stride;
+    }else{
+        operand.rs = mat->row_stride;
+        operand.cs = mat->col_stride;
+    }
+
+    return operand;
+}
+
+
+static void pack_b_task(void* ctx, int task, int worker) {
+    /* Packs one group of B micro-panels of the current panel. */
+    gemm_job* job = ctx;
+    int nr = job->k->gemm_nr;
+    int jr = task * job->pack_chunk;
+    int cols = job->nc - jr < job->pack_chunk ? job->nc - jr : job->pack_chunk;
+    gemm_operand b_panel = { job->b.ptr + job->pc * job->b.rs + (job->jc + jr) * job->b.cs, job->b.rs, job->b.cs };
+
+    (void)worker;
+    pack_b(job->kc, cols, b_panel, nr, job->b_packed + (size_t)jr * job->kc);
+}
+
+
+static void compute_task(void* ctx, int task, int worker) {
+    /* Packs one block of A and multiplies it by a column chunk of the packed B panel. */
+    gemm_job* job = ctx;
+    int ic = task / job->col_chunks * job->mc_max;
+    int jr = task % job->col_chunks * job->col_chunk;
+    int mc = job->m - ic < job->mc_max ? job->m - ic : job->mc_max;
+    int nc = job->nc - jr < job->col_chunk ? job->nc - jr : job->col_chunk;
+    GEMM_T* a_packed = job->a_packed + (size_t)worker * job->mc_max * job->kc_max;
+    gemm_operand a_block = { job->a.ptr + ic * job->a.rs + job->pc * job->a.cs, job->a.rs, job->a.cs };
+
+    if (nc <= 0)
+    {
+        return;
+    }
+
+    pack_a(mc, job->kc, a_block, job->k->gemm_mr, a_packed);
+    macro_kernel(job->k, mc, nc, job->kc, a_packed, job->b_packed + (size_t)jr * job->kc,
+                 &MATRIX_AT(job->C, ic, job->jc + jr), job->C->row_stride, job->alpha);
+}
+
+
+static void gemm_strided_c(GEMM_T alpha, GEMM_MATRIX* A, matrix_op opA, GEMM_MATRIX* B, matrix_op opB, GEMM_T beta, GEMM_MATRIX* C) {
+    /*  Handles C not stored by rows. When C is stored by columns, its
+        transposition op(B)^T * op(A)^T is computed in place, otherwise
+        through a contiguous copy of C. */
+    GEMM_MATRIX Ct = *C;
+    GEMM_MATRIX* tmp;
+
+    Ct.rows = C->cols;
+    Ct.cols = C->rows;
+    Ct.row_stride = C->col_stride;
+    Ct.col_stride = Ct.cols == 1 ? 1 : C->row_stride;
+
+    if (Ct.col_stride == 1)
+    {
+        GEMM_FUNCTION(alpha, B, opB == MATRIX_TRANS ? MATRIX_NO_TRANS : MATRIX_TRANS,
+             A, opA == MATRIX_TRANS ? MATRIX_NO_TRANS : MATRIX_TRANS, beta, &Ct);
+        return;
+    }
+
+    if ((tmp = GEMM_MATERIALIZE(C)) == NULL)
+    {
+        return;
+    }
+    GEMM_FUNCTION(alpha, A, opA, B, opB, beta, tmp);
+    if (error == MATRIX_OK)
+    {
+        GEMM_COPY_INTO(C, tmp);
+    }
+    GEMM_DESTROY(tmp);
+}
+
+
+void GEMM_FUNCTION(GEMM_T alpha, GEMM_MATRIX* A, matrix_op opA, GEMM_MATRIX* B, matrix_op opB, GEMM_T beta, GEMM_MATRIX* C){
+    /*  Computes C = alpha * op(A) * op(B) + beta * C.
+        op(X) is X or its transposition, C must not overlap A or B.
+        Any of them may be a view, operands are read through their strides.
+        Large products are split into tiles of C across the thread pool. */
+
+    const GEMM_KERNELS* k = GEMM_GET_KERNELS();
+    gemm_job job;
+    int n, depth, nc_max, workers, row_blocks, pack_tasks;
+
+    if (!A || !B || !C || C == A || C == B) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    job.m = opA == MATRIX_TRANS ? A->cols : A->rows;
+    depth = opA == MATRIX_TRANS ? A->rows : A->cols;
+    n = opB == MATRIX_TRANS ? B->rows : B->cols;
+
+    if ((opB == MATRIX_TRANS ? B->cols : B->rows) != depth || C->rows != job.m || C->cols != n)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    if (C->col_stride != 1)
+    {
+        gemm_strided_c(alpha, A, opA, B, opB, beta, C);
+        return;
+    }
+
+    job.k = k;
+    job.a = make_operand(A, opA);
+    job.b = make_operand(B, opB);
+    job.alpha = alpha;
+    job.C = C;
+
+    if (alpha == 0.0)
+    {
+        scale_matrix(C, beta);
+        error = MATRIX_OK;
+        return;
+    }
+
+    if ((double)job.m * n * depth < GEMM_SMALL)
+    {
+        scale_matrix(C, beta);
+        gemm_small(job.m, n, depth, alpha, job.a, job.b, C);
+        error = MATRIX_OK;
+        return;
+    }
+
+    workers = (double)job.m * n * depth < GEMM_PARALLEL ? 1 : thread_pool_size();
+
+    // Blocks never exceed the problem, rounded up to whole micro-panels
+    job.mc_max = GEMM_MC / k->gemm_mr * k->gemm_mr;
+    if (job.m < job.mc_max)
+    {
+        job.mc_max = (job.m + k->gemm_mr - 1) / k->gemm_mr * k->gemm_mr;
+    }
+    nc_max = GEMM_NC / k->gemm_nr * k->gemm_nr;
+    if (n < nc_max)
+    {
+        nc_max = (n + k->gemm_nr - 1) / k->gemm_nr * k->gemm_nr;
+    }
+    job.kc_max = depth < GEMM_KC ? depth : GEMM_KC;
+
+    // Split columns of a panel only when there are fewer row blocks than workers
+    row_blocks = (job.m + job.mc_max - 1) / job.mc_max;
+    job.col_chunks = row_blocks >= workers ? 1 : (workers + row_blocks - 1) / row_blocks;
+    // At least one micro-panel per pack task, a panel narrower than the workers has fewer tasks
+    job.pack_chunk = ((nc_max > workers ? nc_max / workers : 1) + k->gemm_nr - 1) / k->gemm_nr * k->gemm_nr;
+
+    job.a_packed = matrix_aligned_alloc((size_t)workers * job.mc_max * job.kc_max * sizeof(GEMM_T));
+    job.b_packed = matrix_aligned_alloc((size_t)job.kc_max * nc_max * sizeof(GEMM_T));
+
+    if (job.a_packed == NULL || job.b_packed == NULL)
+    {
+        matrix_aligned_free(job.a_packed);
+        matrix_aligned_free(job.b_packed);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return;
+    }
+
+    // Scaled only once nothing can fail, so that an error leaves C untouched
+    scale_matrix(C, beta);
+
+    for (job.jc = 0; job.jc < n; job.jc += nc_max)
+    {
+        job.nc = n - job.jc < nc_max ? n - job.jc : nc_max;
+        job.col_chunk = ((job.nc + job.col_chunks - 1) / job.col_chunks + k->gemm_nr - 1) / k->gemm_nr * k->gemm_nr;
+        pack_tasks = (job.nc + job.pack_chunk - 1) / job.pack_chunk;
+
+        for (job.pc = 0; job.pc < depth; job.pc += job.kc_max)
+        {
+            job.kc = depth - job.pc < job.kc_max ? depth - job.pc : job.kc_max;
+
+            thread_pool_run(pack_tasks, workers, pack_b_task, &job);
+            thread_pool_run(row_blocks * job.col_chunks, workers, compute_task, &job);
+        }
+    }
+
+    matrix_aligned_free(job.a_packed);
+    matrix_aligned_free(job.b_packed);
+
+    error = MATRIX_OK;
+}
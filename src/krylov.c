@@ -0,0 +1,888 @@
+/*
+    krylov.c    version 1.0
+
+    Module for iterative solvers of linear systems.
+    --------------------------
+
+    Conjugate gradients, BiCGSTAB and restarted GMRES solve A * x = b
+    touching A only through a linear_operator, so the same solver runs
+    on a dense matrix, a sparse matrix or a user callback. A
+    preconditioner is another linear_operator applying M^-1, this module
+    builds Jacobi and ILU(0) ones. Every solver allocates its vectors
+    once before iterating, the iterations themselves never allocate.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "krylov.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+// Dense products with fewer multiply-adds than this stay in the calling thread
+#define KRYLOV_PARALLEL (1 << 16)
+
+// Basis vectors GMRES builds before restarting when the caller passes a non-positive restart
+#define DEFAULT_RESTART 30
+
+// Dense product y = A * x split into tasks of consecutive rows
+typedef struct
+{
+    const matrix* a;
+    const double* x;
+    double* y;
+    int tasks;
+} dense_job;
+
+// Inverted diagonal of A
+typedef struct
+{
+    int n;
+    double inverse[];
+} jacobi_factors;
+
+// Incomplete LU factors stored in the sparsity pattern of A, L has a unit diagonal
+typedef struct
+{
+    sparse_matrix* lu;
+    size_t* diag;       // position of the diagonal element of every row
+} ilu_factors;
+
+
+static linear_operator* create_operator(int n, void (*apply)(void*, const double*, double*), void* ctx,
+                                        void (*destroy)(void*)) {
+    /* Wraps ctx into an operator, ctx is destroyed if the allocation fails. */
+    linear_operator* op = malloc(sizeof(linear_operator));
+
+    if (!op)
+    {
+        if (destroy)
+        {
+            destroy(ctx);
+        }
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    op->n = n;
+    op->apply = apply;
+    op->ctx = ctx;
+    op->destroy = destroy;
+    error = MATRIX_OK;
+    return op;
+}
+
+
+static void dense_task(void* ctx, int task, int worker) {
+    /* Computes the elements of y of the rows of a task. */
+    const dense_job* job = ctx;
+    const matrix* a = job->a;
+    int first = (int)((long long)a->rows * task / job->tasks);
+    int end = (int)((long long)a->rows * (task + 1) / job->tasks);
+    int i, j;
+    (void)worker;
+
+    for (i = first; i < end; i++)
+    {
+        double sum = 0.0;
+
+        if (a->col_stride == 1)
+        {
+            const double* row = &MATRIX_AT(a, i, 0);
+
+            for (j = 0; j < a->cols; j++)
+            {
+                sum += row[j] * job->x[j];
+            }
+        }else{
+            for (j = 0; j < a->cols; j++)
+            {
+                sum += MATRIX_AT(a, i, j) * job->x[j];
+            }
+        }
+        job->y[i] = sum;
+    }
+}
+
+
+static void dense_apply(void* ctx, const double* x, double* y) {
+    /* Computes y = A * x for a dense matrix A. */
+    const matrix* a = ctx;
+    dense_job job = { a, x, y, 1 };
+
+    if ((long long)a->rows * a->cols >= KRYLOV_PARALLEL)
+    {
+        job.tasks = thread_pool_size();
+    }
+    thread_pool_run(job.tasks, job.tasks, dense_task, &job);
+}
+
+
+static void sparse_apply(void* ctx, const double* x, double* y) {
+    /* Computes y = A * x for a CSR matrix A. */
+
+    sparse_multiply_vector(1.0, ctx, x, 0.0, y);
+}
+
+
+static void destroy_sparse(void* ctx) {
+    /* Frees a CSR copy owned by an operator. */
+
+    destroy_sparse_matrix(ctx);
+}
+
+
+static void jacobi_apply(void* ctx, const double* x, double* y) {
+    /* Computes y = D^-1 * x. */
+    const jacobi_factors* f = ctx;
+    int i;
+
+    for (i = 0; i < f->n; i++)
+    {
+        y[i] = f->inverse[i] * x[i];
+    }
+}
+
+
+static void ilu_apply(void* ctx, const double* x, double* y) {
+    /* Computes y = U^-1 * L^-1 * x by forward and backward substitution. */
+    const ilu_factors* f = ctx;
+    const sparse_matrix* lu = f->lu;
+    size_t p;
+    int i;
+
+    for (i = 0; i < lu->rows; i++)
+    {
+        double sum = x[i];
+
+        for (p = lu->ptr[i]; p < f->diag[i]; p++)
+        {
+            sum -= lu->values[p] * y[lu->idx[p]];
+        }
+        y[i] = sum;
+    }
+
+    for (i = lu->rows - 1; i >= 0; i--)
+    {
+        double sum = y[i];
+
+        for (p = f->diag[i] + 1; p < lu->ptr[i + 1]; p++)
+        {
+            sum -= lu->values[p] * y[lu->idx[p]];
+        }
+        y[i] = sum / lu->values[f->diag[i]];
+    }
+}
+
+
+static void destroy_ilu(void* ctx) {
+    /* Frees incomplete LU factors. */
+    ilu_factors* f = ctx;
+
+    destroy_sparse_matrix(f->lu);
+    free(f->diag);
+    free(f);
+}
+
+
+linear_operator* dense_operator(matrix* A){
+    /*  Returns an operator multiplying by a square matrix A, which may be
+        a view. A is referenced, not copied, and must outlive the
+        operator. */
+
+    if (!A) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->rows != A->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    return create_operator(A->rows, dense_apply, A, NULL);
+}
+
+
+linear_operator* sparse_operator(sparse_matrix* A){
+    /*  Returns an operator multiplying by a square sparse matrix A. A CSR
+        matrix is referenced and must outlive the operator. A CSC matrix
+        is copied to CSR, whose rows are computed in parallel without
+        per-worker buffers. */
+
+    sparse_matrix* csr;
+
+    if (!A) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->rows != A->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if (A->format == SPARSE_CSR)
+    {
+        return create_operator(A->rows, sparse_apply, A, NULL);
+    }
+
+    if ((csr = sparse_convert(A, SPARSE_CSR)) == NULL)
+    {
+        return NULL;
+    }
+    return create_operator(A->rows, sparse_apply, csr, destroy_sparse);
+}
+
+
+static jacobi_factors* create_jacobi(int n) {
+    /* Allocates the inverted diagonal of n elements. */
+    jacobi_factors* f = malloc(sizeof(jacobi_factors) + (size_t)n * sizeof(double));
+
+    if (!f)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+    f->n = n;
+    return f;
+}
+
+
+static linear_operator* finish_jacobi(jacobi_factors* f) {
+    /* Inverts the diagonal stored in f and wraps it into an operator. */
+    int i;
+
+    for (i = 0; i < f->n; i++)
+    {
+        if (f->inverse[i] == 0.0)
+        {
+            free(f);
+            error = MATRIX_SINGULAR;
+            LOG_ERROR("Zero diagonal element");
+            return NULL;
+        }
+        f->inverse[i] = 1.0 / f->inverse[i];
+    }
+    return create_operator(f->n, jacobi_apply, f, free);
+}
+
+
+linear_operator* jacobi_preconditioner(matrix* A){
+    /*  Returns the Jacobi preconditioner of a square matrix A, which
+        divides by the diagonal of A. Sets MATRIX_SINGULAR if a diagonal
+        element is zero. */
+
+    jacobi_factors* f;
+    int i;
+
+    if (!A) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->rows != A->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if ((f = create_jacobi(A->rows)) == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0; i < A->rows; i++)
+    {
+        f->inverse[i] = MATRIX_AT(A, i, i);
+    }
+    return finish_jacobi(f);
+}
+
+
+linear_operator* sparse_jacobi_preconditioner(sparse_matrix* A){
+    /*  Returns the Jacobi preconditioner of a square sparse matrix A.
+        Sets MATRIX_SINGULAR if a diagonal element is zero or not
+        stored. */
+
+    jacobi_factors* f;
+    int i;
+
+    if (!A) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->rows != A->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if ((f = create_jacobi(A->rows)) == NULL)
+    {
+        return NULL;
+    }
+    for (i = 0; i < A->rows; i++)
+    {
+        f->inverse[i] = sparse_get_value(A, i, i);
+    }
+    return finish_jacobi(f);
+}
+
+
+static int factor_ilu(ilu_factors* f, int* position) {
+    /*  Overwrites the copy of A by its incomplete LU factors, dropping
+        every fill-in outside the pattern of A. position maps the columns
+        of the current row to their elements and holds -1 elsewhere.
+        Returns 1 if a diagonal element is missing or a pivot is zero. */
+    sparse_matrix* lu = f->lu;
+    size_t p, q;
+    int i, k;
+
+    for (i = 0; i < lu->rows; i++)
+    {
+        for (p = lu->ptr[i]; p < lu->ptr[i + 1] && lu->idx[p] < i; p++);
+        if (p == lu->ptr[i + 1] || lu->idx[p] != i)
+        {
+            return 1;
+        }
+        f->diag[i] = p;
+    }
+
+    for (i = 0; i < lu->rows; i++)
+    {
+        for (p = lu->ptr[i]; p < lu->ptr[i + 1]; p++)
+        {
+            position[lu->idx[p]] = (int)(p - lu->ptr[i]);
+        }
+
+        // Row i is updated by the rows k < i it has an element in
+        for (p = lu->ptr[i]; p < f->diag[i]; p++)
+        {
+            double l;
+
+            k = lu->idx[p];
+            l = lu->values[p] /= lu->values[f->diag[k]];
+            for (q = f->diag[k] + 1; q < lu->ptr[k + 1]; q++)
+            {
+                if (position[lu->idx[q]] >= 0)
+                {
+                    lu->values[lu->ptr[i] + position[lu->idx[q]]] -= l * lu->values[q];
+                }
+            }
+        }
+
+        for (p = lu->ptr[i]; p < lu->ptr[i + 1]; p++)
+        {
+            position[lu->idx[p]] = -1;
+        }
+
+        if (lu->values[f->diag[i]] == 0.0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+linear_operator* ilu0_preconditioner(sparse_matrix* A){
+    /*  Returns the ILU(0) preconditioner of a square sparse matrix A,
+        incomplete LU factors with the sparsity pattern of A. A is
+        copied. Sets MATRIX_SINGULAR if a diagonal element is not stored
+        or a pivot becomes zero. */
+
+    ilu_factors* f;
+    int* position;
+    int i, failed;
+
+    if (!A) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->rows != A->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if ((f = calloc(1, sizeof(ilu_factors))) == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    f->lu = sparse_convert(A, SPARSE_CSR);
+    f->diag = malloc((size_t)A->rows * sizeof(size_t));
+    position = malloc((size_t)A->rows * sizeof(int));
+    if (!f->lu || !f->diag || !position)
+    {
+        destroy_ilu(f);
+        free(position);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    for (i = 0; i < A->rows; i++)
+    {
+        position[i] = -1;
+    }
+    failed = factor_ilu(f, position);
+    free(position);
+
+    if (failed)
+    {
+        destroy_ilu(f);
+        error = MATRIX_SINGULAR;
+        LOG_ERROR("Zero pivot");
+        return NULL;
+    }
+    return create_operator(A->rows, ilu_apply, f, destroy_ilu);
+}
+
+
+void destroy_operator(linear_operator* op){
+    /* Frees an operator and the data it owns. */
+
+    if (!op)
+    {
+        return;
+    }
+    if (op->destroy)
+    {
+        op->destroy(op->ctx);
+    }
+    free(op);
+}
+
+
+static double dot(int n, const double* x, const double* y) {
+    /* Returns x^T * y, four independent sums keep the additions pipelined. */
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        s0 += x[i] * y[i];
+        s1 += x[i + 1] * y[i + 1];
+        s2 += x[i + 2] * y[i + 2];
+        s3 += x[i + 3] * y[i + 3];
+    }
+    for (; i < n; i++)
+    {
+        s0 += x[i] * y[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+
+static void precondition(const linear_operator* M, int n, const double* r, double* z) {
+    /* Computes z = M^-1 * r, z = r without a preconditioner. */
+
+    if (M)
+    {
+        M->apply(M->ctx, r, z);
+    }else{
+        memcpy(z, r, (size_t)n * sizeof(double));
+    }
+}
+
+
+static double residual(const linear_operator* A, const double* b, const double* x, double* r) {
+    /* Computes r = b - A * x and returns its norm. */
+    int i;
+
+    A->apply(A->ctx, x, r);
+    for (i = 0; i < A->n; i++)
+    {
+        r[i] = b[i] - r[i];
+    }
+    return sqrt(dot(A->n, r, r));
+}
+
+
+static int check_system(const linear_operator* A, const linear_operator* M, const double* b, double* x,
+                        double tolerance, int max_iterations, double* target) {
+    /*  Validates the arguments of a solver and sets target to the residual
+        norm it has to reach. Returns 1 if the solver has nothing left to
+        do, either for invalid arguments or for b = 0, whose solution x = 0
+        is written. */
+
+    if (!A || !A->apply || A->n < 1 || !b || !x || (M && !M->apply) || !(tolerance >= 0.0) || max_iterations < 0) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return 1;
+    }
+
+    if (M && M->n != A->n)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return 1;
+    }
+
+    *target = tolerance * sqrt(dot(A->n, b, b));
+    if (*target == 0.0 && tolerance > 0.0)
+    {
+        memset(x, 0, (size_t)A->n * sizeof(double));
+        error = MATRIX_OK;
+        return 1;
+    }
+    return 0;
+}
+
+
+static void finish_solve(double norm, double target) {
+    /* Reports whether the residual norm reached its target. */
+
+    if (norm <= target)
+    {
+        error = MATRIX_OK;
+    }else{
+        error = MATRIX_OTHER_ERROR;
+        LOG_ERROR("Solver did not converge");
+    }
+}
+
+
+int solve_cg(const linear_operator* A, const linear_operator* M, const double* b, double* x,
+             double tolerance, int max_iterations){
+    /*  Solves A * x = b for a symmetric positive definite A by conjugate
+        gradients, preconditioned by a symmetric positive definite M if it
+        is not NULL. x holds the initial guess and receives the solution.
+        Iterates until ||b - A * x|| <= tolerance * ||b|| and returns the
+        number of iterations. Sets MATRIX_OTHER_ERROR, keeping the last
+        iterate, if max_iterations are not enough or A is found not to be
+        positive definite. */
+
+    const simd_kernels* k = simd_get_kernels();
+    double *work, *r, *z, *p, *q, target, norm, rz, rz_next, pq, alpha;
+    int n, iterations = 0;
+
+    if (check_system(A, M, b, x, tolerance, max_iterations, &target))
+    {
+        return 0;
+    }
+
+    n = A->n;
+    if ((work = malloc(4 * (size_t)n * sizeof(double))) == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return 0;
+    }
+    r = work;
+    z = r + n;
+    p = z + n;
+    q = p + n;
+
+    norm = residual(A, b, x, r);
+    precondition(M, n, r, z);
+    memcpy(p, z, (size_t)n * sizeof(double));
+    rz = dot(n, r, z);
+
+    while (norm > target && iterations < max_iterations)
+    {
+        A->apply(A->ctx, p, q);
+        pq = dot(n, p, q);
+        if (!(pq > 0.0))
+        {
+            break;
+        }
+
+        alpha = rz / pq;
+        k->axpy(n, alpha, p, x);
+        k->axpy(n, -alpha, q, r);
+        norm = sqrt(dot(n, r, r));
+        iterations++;
+
+        // p = z + (r_next^T * z_next) / (r^T * z) * p
+        precondition(M, n, r, z);
+        rz_next = dot(n, r, z);
+        k->scale(n, p, rz_next / rz, p);
+        k->axpy(n, 1.0, z, p);
+        rz = rz_next;
+    }
+
+    finish_solve(norm, target);
+    free(work);
+    return iterations;
+}
+
+
+int solve_bicgstab(const linear_operator* A, const linear_operator* M, const double* b, double* x,
+                   double tolerance, int max_iterations){
+    /*  Solves A * x = b for a general A by BiCGSTAB, right preconditioned
+        by M if it is not NULL. x holds the initial guess and receives the
+        solution. Iterates until ||b - A * x|| <= tolerance * ||b|| and
+        returns the number of iterations, each applying A and M twice.
+        Sets MATRIX_OTHER_ERROR, keeping the last iterate, if
+        max_iterations are not enough or the method breaks down. */
+
+    const simd_kernels* k = simd_get_kernels();
+    double *work, *r, *shadow, *p, *v, *pm, *sm, *t;
+    double target, norm, rho = 1.0, rho_next, alpha = 1.0, omega = 1.0, rv, tt;
+    int n, iterations = 0;
+
+    if (check_system(A, M, b, x, tolerance, max_iterations, &target))
+    {
+        return 0;
+    }
+
+    n = A->n;
+    if ((work = calloc(7 * (size_t)n, sizeof(double))) == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return 0;
+    }
+    r = work;
+    shadow = r + n;
+    p = shadow + n;
+    v = p + n;
+    pm = v + n;
+    sm = pm + n;
+    t = sm + n;
+
+    norm = residual(A, b, x, r);
+    memcpy(shadow, r, (size_t)n * sizeof(double));
+
+    while (norm > target && iterations < max_iterations)
+    {
+        rho_next = dot(n, shadow, r);
+        if (rho_next == 0.0)
+        {
+            break;
+        }
+
+        // p = r + beta * (p - omega * v)
+        k->axpy(n, -omega, v, p);
+        k->scale(n, p, rho_next / rho * (alpha / omega), p);
+        k->axpy(n, 1.0, r, p);
+
+        precondition(M, n, p, pm);
+        A->apply(A->ctx, pm, v);
+        rv = dot(n, shadow, v);
+        if (rv == 0.0)
+        {
+            break;
+        }
+
+        // r becomes s = r - alpha * v
+        alpha = rho_next / rv;
+        k->axpy(n, alpha, pm, x);
+        k->axpy(n, -alpha, v, r);
+        norm = sqrt(dot(n, r, r));
+        iterations++;
+        if (norm <= target)
+        {
+            break;
+        }
+
+        precondition(M, n, r, sm);
+        A->apply(A->ctx, sm, t);
+        tt = dot(n, t, t);
+        if (tt == 0.0)
+        {
+            break;
+        }
+
+        omega = dot(n, t, r) / tt;
+        k->axpy(n, omega, sm, x);
+        k->axpy(n, -omega, t, r);
+        norm = sqrt(dot(n, r, r));
+        rho = rho_next;
+        if (omega == 0.0)
+        {
+            break;
+        }
+    }
+
+    finish_solve(norm, target);
+    free(work);
+    return iterations;
+}
+
+
+static int gmres_cycle(const linear_operator* A, const linear_operator* M, double* basis, double* h,
+                       double* rotations, double* g, int m, int budget, double target, int* breakdown) {
+    /*  Builds up to m orthonormal basis vectors of the Krylov space of
+        A * M^-1, starting from the normalized residual in basis, and keeps
+        the Hessenberg matrix h ((m + 1) x m, by columns) triangular by
+        Givens rotations, whose cosines and sines fill rotations. g holds
+        the rotated right-hand side, |g[j]| the residual norm after j
+        steps. Stops early at the target residual or after budget steps.
+        A step whose rotated diagonal is zero would make h singular, it is
+        dropped and sets breakdown. Returns the number of kept steps. */
+    const simd_kernels* k = simd_get_kernels();
+    int n = A->n, i, j = 0;
+    double *w = basis + (size_t)(m + 1) * n, *col, *next, norm, c, s, tmp;
+
+    *breakdown = 0;
+    while (j < m && j < budget)
+    {
+        col = h + (size_t)j * (m + 1);
+        next = basis + (size_t)(j + 1) * n;
+        precondition(M, n, basis + (size_t)j * n, w);
+        A->apply(A->ctx, w, next);
+
+        // Modified Gram-Schmidt against the previous basis vectors
+        for (i = 0; i <= j; i++)
+        {
+            col[i] = dot(n, next, basis + (size_t)i * n);
+            k->axpy(n, -col[i], basis + (size_t)i * n, next);
+        }
+        col[j + 1] = norm = sqrt(dot(n, next, next));
+
+        for (i = 0; i < j; i++)
+        {
+            c = rotations[2 * i];
+            s = rotations[2 * i + 1];
+            tmp = c * col[i] + s * col[i + 1];
+            col[i + 1] = -s * col[i] + c * col[i + 1];
+            col[i] = tmp;
+        }
+
+        // A * M^-1 maps the new basis vector into the previous ones
+        if ((tmp = hypot(col[j], col[j + 1])) == 0.0)
+        {
+            *breakdown = 1;
+            break;
+        }
+        c = col[j] / tmp;
+        s = col[j + 1] / tmp;
+        rotations[2 * j] = c;
+        rotations[2 * j + 1] = s;
+        col[j] = tmp;
+        col[j + 1] = 0.0;
+        g[j + 1] = -s * g[j];
+        g[j] = c * g[j];
+        j++;
+
+        // A zero norm means the Krylov space is invariant and holds the solution
+        if (fabs(g[j]) <= target || norm == 0.0)
+        {
+            break;
+        }
+        k->scale(n, next, 1.0 / norm, next);
+    }
+    return j;
+}
+
+
+int solve_gmres(const linear_operator* A, const linear_operator* M, const double* b, double* x,
+                int restart, double tolerance, int max_iterations){
+    /*  Solves A * x = b for a general A by GMRES restarted after restart
+        steps (30 if restart is not positive), right preconditioned by M
+        if it is not NULL. x holds the initial guess and receives the
+        solution. Iterates until ||b - A * x|| <= tolerance * ||b|| and
+        returns the number of steps. Sets MATRIX_OTHER_ERROR, keeping the
+        last iterate, if max_iterations are not enough. Sets MATRIX_SINGULAR,
+        keeping the best iterate of the Krylov space, if it breaks down
+        before reaching the tolerance, which happens for a singular A.
+        Memory grows with restart + 2 vectors of n elements. */
+
+    const simd_kernels* k = simd_get_kernels();
+    double *basis, *h, *rotations, *g, *update, target, norm;
+    int n, m, i, l, steps, breakdown = 0, iterations = 0;
+
+    if (check_system(A, M, b, x, tolerance, max_iterations, &target))
+    {
+        return 0;
+    }
+
+    n = A->n;
+    m = restart > 0 ? restart : DEFAULT_RESTART;
+    m = m < n ? m : n;
+
+    // m + 1 basis vectors and the scratch vector of preconditioned ones
+    basis = malloc((size_t)(m + 2) * n * sizeof(double));
+    h = malloc((size_t)(m + 1) * m * sizeof(double));
+    rotations = malloc(2 * (size_t)m * sizeof(double));
+    g = malloc((size_t)(m + 1) * sizeof(double));
+    if (!basis || !h || !rotations || !g)
+    {
+        free(basis);
+        free(h);
+        free(rotations);
+        free(g);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return 0;
+    }
+
+    for (;;)
+    {
+        norm = residual(A, b, x, basis);
+        if (norm <= target || iterations >= max_iterations || breakdown)
+        {
+            break;
+        }
+
+        k->scale(n, basis, 1.0 / norm, basis);
+        g[0] = norm;
+        steps = gmres_cycle(A, M, basis, h, rotations, g, m, max_iterations - iterations, target, &breakdown);
+        iterations += steps;
+
+        // Back substitution of the triangular h, the coefficients replace g
+        for (i = steps - 1; i >= 0; i--)
+        {
+            for (l = i + 1; l < steps; l++)
+            {
+                g[i] -= h[(size_t)l * (m + 1) + i] * g[l];
+            }
+            g[i] /= h[(size_t)i * (m + 1) + i];
+        }
+
+        // x += M^-1 * basis * g, the last basis vector is free to hold the sum
+        update = basis + (size_t)steps * n;
+        memset(update, 0, (size_t)n * sizeof(double));
+        for (i = 0; i < steps; i++)
+        {
+            k->axpy(n, g[i], basis + (size_t)i * n, update);
+        }
+        precondition(M, n, update, basis + (size_t)(m + 1) * n);
+        k->axpy(n, 1.0, basis + (size_t)(m + 1) * n, x);
+    }
+
+    if (breakdown && norm > target)
+    {
+        error = MATRIX_SINGULAR;
+        LOG_ERROR("Krylov space broke down");
+    }else{
+        finish_solve(norm, target);
+    }
+    free(basis);
+    free(h);
+    free(rotations);
+    free(g);
+    return iterations;
+}
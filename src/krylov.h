@@ -0,0 +1,48 @@
+/*
+    krylov.h    version 1.0
+
+    Header file for krylov.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_KRYLOV
+#define MAT_KRYLOV
+
+#include "matrix.h"
+#include "sparse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Linear map y = A * x of vectors with n elements, preconditioners apply z = M^-1 * r
+typedef struct
+{
+    int n;
+    void (*apply)(void* ctx, const double* x, double* y);   // must not allocate, y does not overlap x
+    void* ctx;
+    void (*destroy)(void* ctx);     // frees ctx in destroy_operator, or NULL
+} linear_operator;
+
+extern linear_operator* dense_operator(matrix* A);
+extern linear_operator* sparse_operator(sparse_matrix* A);
+extern linear_operator* jacobi_preconditioner(matrix* A);
+extern linear_operator* sparse_jacobi_preconditioner(sparse_matrix* A);
+extern linear_operator* ilu0_preconditioner(sparse_matrix* A);
+extern void destroy_operator(linear_operator* op);
+extern int solve_cg(const linear_operator* A, const linear_operator* M, const double* b, double* x,
+                    double tolerance, int max_iterations);
+extern int solve_bicgstab(const linear_operator* A, const linear_operator* M, const double* b, double* x,
+                          double tolerance, int max_iterations);
+extern int solve_gmres(const linear_operator* A, const linear_operator* M, const double* b, double* x,
+                       int restart, double tolerance, int max_iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1202 @@
+/*
+    linalg.c    version 1.0
+
+    Module for matrix factorizations and linear solvers.
+    --------------------------
+
+    The factorizations are blocked so that most of their multiply-adds
+    run in gemm on views of the factored matrix. Only narrow panels and
+    small diagonal blocks are processed element by element.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "linalg.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "matrix_view.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+// Columns of the panels of the blocked LU factorization
+#define LU_BLOCK 128
+
+// Panels this narrow are factored column by column
+#define LU_LEAF 8
+
+// Columns of the panels of the blocked Cholesky factorization
+#define CHOL_BLOCK 128
+
+// Rows and columns of the tiles of the tiled Cholesky factorization
+#define CHOL_TILE 128
+
+// Blocks this small are factored, solved and updated element by element
+#define CHOL_LEAF 16
+
+// Reflectors of one block of the blocked Householder QR factorization
+#define QR_BLOCK 32
+
+// Rows of the diagonal blocks of triangular solves, the rest of T is applied by gemm
+#define TRSM_BLOCK 64
+
+// Columns of B solved by one task of a triangular solve
+#define TRSM_STRIP 256
+
+// Diagonal blocks with fewer multiply-adds than this are solved in the calling thread
+#define TRSM_PARALLEL (1 << 18)
+
+// Solve of one diagonal block of a triangular system, split into strips of columns of B
+typedef struct
+{
+    const simd_kernels* k;
+    const matrix* t;
+    matrix* b;
+    int lower;
+    int unit;
+    int strip;
+} trsm_job;
+
+// Step of the tiled Cholesky factorization, tiles below and right of the factored diagonal tile
+typedef struct
+{
+    matrix* a;
+    int tiles;
+    int k;
+} chol_job;
+
+// Workspace of the blocked Householder QR for block reflectors of QR_BLOCK columns
+typedef struct
+{
+    matrix* v;      // explicit unit lower trapezoidal reflectors, rows x QR_BLOCK
+    matrix* t;      // upper triangular factor of the block reflector
+    matrix* g;      // products of the reflectors V^T * V
+    matrix* w;      // V^T * C, QR_BLOCK x cols
+    matrix* tw;     // op(T) * V^T * C
+} qr_work;
+
+
+static void solve_diagonal(const trsm_job* job, int first, int n) {
+    /* Solves the diagonal block for columns [first, first + n) of b, row by row. */
+    const matrix *t = job->t, *b = job->b;
+    int i, p;
+
+    for (i = job->lower ? 0 : t->rows - 1; i >= 0 && i < t->rows; i += job->lower ? 1 : -1)
+    {
+        double* row = &MATRIX_AT(b, i, first);
+
+        for (p = job->lower ? 0 : i + 1; p < (job->lower ? i : t->rows); p++)
+        {
+            job->k->axpy(n, -MATRIX_AT(t, i, p), &MATRIX_AT(b, p, first), row);
+        }
+        if (!job->unit)
+        {
+            job->k->scale(n, row, 1.0 / MATRIX_AT(t, i, i), row);
+        }
+    }
+}
+
+
+static void trsm_task(void* ctx, int task, int worker) {
+    /* Solves the diagonal block for one strip of columns of b. */
+    const trsm_job* job = ctx;
+    int first = task * job->strip;
+    (void)worker;
+
+    solve_diagonal(job, first, job->b->cols - first < job->strip ? job->b->cols - first : job->strip);
+}
+
+
+static void triangular_blocks(const matrix* t, int lower, int unit, matrix* b) {
+    /*  Solves t * x = b in place of b, whose rows are contiguous. Diagonal
+        blocks are solved row by row, the blocks below (above) them update
+        the remaining rows of b through gemm. */
+    trsm_job job;
+    int n = t->rows, kb, nb, workers;
+
+    job.k = simd_get_kernels();
+    job.lower = lower;
+    job.unit = unit;
+
+    for (kb = lower ? 0 : (n - 1) / TRSM_BLOCK * TRSM_BLOCK; kb >= 0 && kb < n; kb += lower ? TRSM_BLOCK : -TRSM_BLOCK)
+    {
+        matrix tkk, bk, tr, br;
+
+        nb = n - kb < TRSM_BLOCK ? n - kb : TRSM_BLOCK;
+        tkk = sub_block(t, kb, kb, nb, nb);
+        bk = sub_block(b, kb, 0, nb, b->cols);
+
+        job.t = &tkk;
+        job.b = &bk;
+        workers = (double)nb * nb * b->cols < TRSM_PARALLEL ? 1 : thread_pool_size();
+        job.strip = workers > 1 ? TRSM_STRIP : b->cols;
+        thread_pool_run((b->cols + job.strip - 1) / job.strip, workers, trsm_task, &job);
+
+        if (lower && kb + nb < n)
+        {
+            tr = sub_block(t, kb + nb, kb, n - kb - nb, nb);
+            br = sub_block(b, kb + nb, 0, n - kb - nb, b->cols);
+            gemm(-1.0, &tr, MATRIX_NO_TRANS, &bk, MATRIX_NO_TRANS, 1.0, &br);
+        }else if (!lower && kb > 0){
+            tr = sub_block(t, 0, kb, kb, nb);
+            br = sub_block(b, 0, 0, kb, b->cols);
+            gemm(-1.0, &tr, MATRIX_NO_TRANS, &bk, MATRIX_NO_TRANS, 1.0, &br);
+        }
+    }
+}
+
+
+void solve_triangular(matrix* T, matrix_uplo uplo, matrix_op op, matrix_diag diag, matrix* B){
+    /*  Solves op(T) * X = B in place of B for a square triangular matrix T,
+        of which only the uplo triangle is read. B must not overlap T. */
+
+    matrix t, *b = B;
+    int i;
+
+    if (!T || !B || (uplo != MATRIX_LOWER && uplo != MATRIX_UPPER)) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (T->rows != T->cols || B->rows != T->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    for (i = 0; i < T->rows && diag == MATRIX_NON_UNIT; i++)
+    {
+        if (MATRIX_AT(T, i, i) == 0.0)
+        {
+            error = MATRIX_SINGULAR;
+            LOG_ERROR("Singular matrix");
+            return;
+        }
+    }
+
+    // The rows of B are updated with unit stride
+    if (B->col_stride != 1 && (b = materialize(B)) == NULL)
+    {
+        return;
+    }
+
+    // A transposed lower triangle is an upper one
+    t = op == MATRIX_TRANS ? transposed(T) : *T;
+    triangular_blocks(&t, (uplo == MATRIX_LOWER) != (op == MATRIX_TRANS), diag == MATRIX_UNIT, b);
+
+    if (b != B)
+    {
+        copy_into(B, b);
+        destroy_matrix(b);
+    }
+
+    error = MATRIX_OK;
+}
+
+
+static void swap_rows(matrix* a, int i, int p) {
+    /* Swaps whole rows i and p of a. */
+    double *x = &MATRIX_AT(a, i, 0), *y = &MATRIX_AT(a, p, 0);
+    int j;
+
+    for (j = 0; j < a->cols; j++)
+    {
+        double tmp = x[j];
+
+        x[j] = y[j];
+        y[j] = tmp;
+    }
+}
+
+
+static int factor_leaf(const simd_kernels* k, matrix* a, int col, int width, int* pivots) {
+    /*  Factors the columns [col, col + width) of the rows from col down one by
+        one with partial pivoting. Returns 1 if a pivot is zero, 0 otherwise. */
+    int i, j, p, singular = 0;
+
+    for (j = col; j < col + width; j++)
+    {
+        double max = fabs(MATRIX_AT(a, j, j)), inv;
+
+        for (i = j + 1, p = j; i < a->rows; i++)
+        {
+            if (fabs(MATRIX_AT(a, i, j)) > max)
+            {
+                max = fabs(MATRIX_AT(a, i, j));
+                p = i;
+            }
+        }
+
+        pivots[j] = p;
+        if (max == 0.0)
+        {
+            singular = 1;
+            continue;
+        }
+        if (p != j)
+        {
+            swap_rows(a, j, p);
+        }
+
+        inv = 1.0 / MATRIX_AT(a, j, j);
+        for (i = j + 1; i < a->rows; i++)
+        {
+            MATRIX_AT(a, i, j) *= inv;
+            if (j + 1 < col + width)
+            {
+                k->axpy(col + width - j - 1, -MATRIX_AT(a, i, j), &MATRIX_AT(a, j, j + 1), &MATRIX_AT(a, i, j + 1));
+            }
+        }
+    }
+
+    return singular;
+}
+
+
+static int factor_panel(const simd_kernels* k, matrix* a, int col, int width, int* pivots) {
+    /*  Factors the columns [col, col + width) of the rows from col down by
+        halves: the left half is factored, the right half updated through a
+        triangular solve and gemm, then factored. Rows are swapped whole, so
+        the swaps also apply to the columns outside the panel. */
+    int half = width / 2, singular;
+    matrix l11, a12, a21, a22;
+
+    if (width <= LU_LEAF)
+    {
+        return factor_leaf(k, a, col, width, pivots);
+    }
+
+    singular = factor_panel(k, a, col, half, pivots);
+
+    l11 = sub_block(a, col, col, half, half);
+    a12 = sub_block(a, col, col + half, half, width - half);
+    triangular_blocks(&l11, 1, 1, &a12);
+
+    if (col + half < a->rows)
+    {
+        a21 = sub_block(a, col + half, col, a->rows - col - half, half);
+        a22 = sub_block(a, col + half, col + half, a->rows - col - half, width - half);
+        gemm(-1.0, &a21, MATRIX_NO_TRANS, &a12, MATRIX_NO_TRANS, 1.0, &a22);
+    }
+
+    return factor_panel(k, a, col + half, width - half, pivots) | singular;
+}
+
+
+void lu_factor(matrix* A, int* pivots){
+    /*  Factors A = P * L * U in place with partial pivoting. L is unit lower
+        triangular and stored below the diagonal, U is stored on and above
+        it. Row i was swapped with row pivots[i] (indexed from 0) for each of
+        the min(rows, cols) pivots. The blocked right-looking algorithm
+        factors a panel of LU_BLOCK columns, solves the block row of U
+        right of it and updates the trailing matrix with gemm.
+        A zero pivot leaves error set to MATRIX_SINGULAR, the factorization
+        is still completed. */
+
+    const simd_kernels* k = simd_get_kernels();
+    matrix *a = A, u12, l11, a21, a22;
+    int kb, nb, steps, singular = 0;
+
+    if (!A || !pivots) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    // Rows are swapped and updated with unit stride
+    if (A->col_stride != 1 && (a = materialize(A)) == NULL)
+    {
+        return;
+    }
+
+    steps = a->rows < a->cols ? a->rows : a->cols;
+    for (kb = 0; kb < steps; kb += LU_BLOCK)
+    {
+        nb = steps - kb < LU_BLOCK ? steps - kb : LU_BLOCK;
+        singular |= factor_panel(k, a, kb, nb, pivots);
+
+        if (kb + nb < a->cols)
+        {
+            l11 = sub_block(a, kb, kb, nb, nb);
+            u12 = sub_block(a, kb, kb + nb, nb, a->cols - kb - nb);
+            triangular_blocks(&l11, 1, 1, &u12);
+
+            if (kb + nb < a->rows)
+            {
+                a21 = sub_block(a, kb + nb, kb, a->rows - kb - nb, nb);
+                a22 = sub_block(a, kb + nb, kb + nb, a->rows - kb - nb, a->cols - kb - nb);
+                gemm(-1.0, &a21, MATRIX_NO_TRANS, &u12, MATRIX_NO_TRANS, 1.0, &a22);
+            }
+        }
+    }
+
+    if (a != A)
+    {
+        copy_into(A, a);
+        destroy_matrix(a);
+    }
+
+    error = singular ? MATRIX_SINGULAR : MATRIX_OK;
+}
+
+
+void lu_solve(matrix* LU, const int* pivots, matrix* B){
+    /*  Solves A * X = B in place of B, where LU and pivots are the
+        factorization of a square matrix A computed by lu_factor. */
+
+    int i, j;
+
+    if (!LU || !pivots || !B) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (LU->rows != LU->cols || B->rows != LU->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    for (i = 0; i < B->rows; i++)
+    {
+        if (pivots[i] < i || pivots[i] >= B->rows)
+        {
+            error = MATRIX_INVARGS;
+            LOG_ERROR("Invalid arguments");
+            return;
+        }
+    }
+
+    for (i = 0; i < B->rows; i++)
+    {
+        for (j = 0; j < B->cols && pivots[i] != i; j++)
+        {
+            double tmp = MATRIX_AT(B, i, j);
+
+            MATRIX_AT(B, i, j) = MATRIX_AT(B, pivots[i], j);
+            MATRIX_AT(B, pivots[i], j) = tmp;
+        }
+    }
+
+    solve_triangular(LU, MATRIX_LOWER, MATRIX_NO_TRANS, MATRIX_UNIT, B);
+    if (error == MATRIX_OK)
+    {
+        solve_triangular(LU, MATRIX_UPPER, MATRIX_NO_TRANS, MATRIX_NON_UNIT, B);
+    }
+}
+
+
+static matrix* factor_copy(matrix* A, int** pivots) {
+    /* Returns the LU factorization of a copy of square matrix A and allocates its pivots. */
+    matrix* lu;
+
+    if (!A) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->rows != A->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if ((*pivots = malloc(A->rows * sizeof(int))) == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    if ((lu = materialize(A)) == NULL)
+    {
+        free(*pivots);
+        return NULL;
+    }
+
+    lu_factor(lu, *pivots);
+    return lu;
+}
+
+
+matrix* solve(matrix* A, matrix* B){
+    /*  Returns the solution X of A * X = B for a square matrix A, or NULL
+        with error MATRIX_SINGULAR if A is singular. A and B are kept. */
+
+    matrix *lu, *x;
+    int* pivots;
+
+    if (!A || !B) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (B->rows != A->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if ((lu = factor_copy(A, &pivots)) == NULL)
+    {
+        return NULL;
+    }
+
+    x = error == MATRIX_OK ? materialize(B) : NULL;
+    if (x != NULL)
+    {
+        lu_solve(lu, pivots, x);
+    }
+
+    if (x != NULL && error != MATRIX_OK)
+    {
+        destroy_matrix(x);
+        x = NULL;
+    }
+
+    destroy_matrix(lu);
+    free(pivots);
+    return x;
+}
+
+
+double determinant(matrix* A){
+    /* Returns the determinant of a square matrix A, the product of the pivots of its LU factorization. */
+
+    matrix* lu;
+    int* pivots;
+    double det = 1.0;
+    int i;
+
+    if ((lu = factor_copy(A, &pivots)) == NULL)
+    {
+        return 0.0;
+    }
+
+    for (i = 0; i < lu->rows; i++)
+    {
+        det *= pivots[i] != i ? -MATRIX_AT(lu, i, i) : MATRIX_AT(lu, i, i);
+    }
+
+    destroy_matrix(lu);
+    free(pivots);
+
+    // A singular matrix has a zero pivot and determinant 0
+    error = MATRIX_OK;
+    return det;
+}
+
+
+matrix* inverse(matrix* A){
+    /*  Returns the inverse of a square matrix A, or NULL with error
+        MATRIX_SINGULAR if A is singular. */
+
+    matrix *lu, *inv = NULL;
+    int* pivots;
+
+    if ((lu = factor_copy(A, &pivots)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (error == MATRIX_OK && (inv = create_unit_matrix(A->rows, A->cols)) != NULL)
+    {
+        lu_solve(lu, pivots, inv);
+        if (error != MATRIX_OK)
+        {
+            destroy_matrix(inv);
+            inv = NULL;
+        }
+    }
+
+    destroy_matrix(lu);
+    free(pivots);
+    return inv;
+}
+
+
+static void syrk_lower(matrix* c, const matrix* a) {
+    /*  Computes C = C - A * A^T on the lower triangle of C only. Halves are
+        handled recursively, the block below them by gemm. */
+    int n = c->rows, h = n / 2, i, j, p;
+    matrix c11, c21, c22, a1, a2;
+
+    if (n <= CHOL_LEAF)
+    {
+        for (i = 0; i < n; i++)
+        {
+            for (j = 0; j <= i; j++)
+            {
+                double sum = 0.0;
+
+                for (p = 0; p < a->cols; p++)
+                {
+                    sum += MATRIX_AT(a, i, p) * MATRIX_AT(a, j, p);
+                }
+                MATRIX_AT(c, i, j) -= sum;
+            }
+        }
+        return;
+    }
+
+    c11 = sub_block(c, 0, 0, h, h);
+    c21 = sub_block(c, h, 0, n - h, h);
+    c22 = sub_block(c, h, h, n - h, n - h);
+    a1 = sub_block(a, 0, 0, h, a->cols);
+    a2 = sub_block(a, h, 0, n - h, a->cols);
+
+    syrk_lower(&c11, &a1);
+    gemm(-1.0, &a2, MATRIX_NO_TRANS, &a1, MATRIX_TRANS, 1.0, &c21);
+    syrk_lower(&c22, &a2);
+}
+
+
+static void solve_right_lower(const matrix* l, matrix* b) {
+    /*  Solves X * L^T = B in place of B for a lower triangular L. Columns of
+        B are split in halves, the second half is updated by gemm. */
+    int n = l->rows, h = n / 2, r, j, p;
+    matrix l11, l21, l22, b1, b2;
+
+    if (n <= CHOL_LEAF)
+    {
+        for (r = 0; r < b->rows; r++)
+        {
+            for (j = 0; j < n; j++)
+            {
+                double sum = MATRIX_AT(b, r, j);
+
+                for (p = 0; p < j; p++)
+                {
+                    sum -= MATRIX_AT(b, r, p) * MATRIX_AT(l, j, p);
+                }
+                MATRIX_AT(b, r, j) = sum / MATRIX_AT(l, j, j);
+            }
+        }
+        return;
+    }
+
+    l11 = sub_block(l, 0, 0, h, h);
+    l21 = sub_block(l, h, 0, n - h, h);
+    l22 = sub_block(l, h, h, n - h, n - h);
+    b1 = sub_block(b, 0, 0, b->rows, h);
+    b2 = sub_block(b, 0, h, b->rows, n - h);
+
+    solve_right_lower(&l11, &b1);
+    gemm(-1.0, &b1, MATRIX_NO_TRANS, &l21, MATRIX_TRANS, 1.0, &b2);
+    solve_right_lower(&l22, &b2);
+}
+
+
+static int factor_lower(matrix* a) {
+    /*  Factors the square block a = L * L^T in its lower triangle by halves.
+        Returns 1 if a is not positive definite, 0 otherwise. */
+    int n = a->rows, h = n / 2, i, j, p;
+    matrix a11, a21, a22;
+
+    if (n <= CHOL_LEAF)
+    {
+        for (j = 0; j < n; j++)
+        {
+            double d = MATRIX_AT(a, j, j);
+
+            for (p = 0; p < j; p++)
+            {
+                d -= MATRIX_AT(a, j, p) * MATRIX_AT(a, j, p);
+            }
+            // Also catches NaN
+            if (!(d > 0.0))
+            {
+                return 1;
+            }
+            d = sqrt(d);
+            MATRIX_AT(a, j, j) = d;
+
+            for (i = j + 1; i < n; i++)
+            {
+                double sum = MATRIX_AT(a, i, j);
+
+                for (p = 0; p < j; p++)
+                {
+                    sum -= MATRIX_AT(a, i, p) * MATRIX_AT(a, j, p);
+                }
+                MATRIX_AT(a, i, j) = sum / d;
+            }
+        }
+        return 0;
+    }
+
+    a11 = sub_block(a, 0, 0, h, h);
+    a21 = sub_block(a, h, 0, n - h, h);
+    a22 = sub_block(a, h, h, n - h, n - h);
+
+    if (factor_lower(&a11))
+    {
+        return 1;
+    }
+    solve_right_lower(&a11, &a21);
+    syrk_lower(&a22, &a21);
+    return factor_lower(&a22);
+}
+
+
+static matrix tile(const matrix* a, int i, int j) {
+    /* Describes tile (i, j) of a, tiles in the last row and column may be smaller. */
+    int rows = a->rows - i * CHOL_TILE < CHOL_TILE ? a->rows - i * CHOL_TILE : CHOL_TILE;
+    int cols = a->cols - j * CHOL_TILE < CHOL_TILE ? a->cols - j * CHOL_TILE : CHOL_TILE;
+
+    return sub_block(a, i * CHOL_TILE, j * CHOL_TILE, rows, cols);
+}
+
+
+static void chol_solve_task(void* ctx, int task, int worker) {
+    /* Solves tile (i, k) below the factored diagonal tile. */
+    const chol_job* job = ctx;
+    matrix akk = tile(job->a, job->k, job->k), aik = tile(job->a, job->k + 1 + task, job->k);
+    (void)worker;
+
+    solve_right_lower(&akk, &aik);
+}
+
+
+static void chol_update_task(void* ctx, int task, int worker) {
+    /* Subtracts L(i, k) * L(j, k)^T from tile (i, j) of the trailing matrix, j <= i. */
+    const chol_job* job = ctx;
+    int i = job->k + 1, j;
+    matrix aij, aik, ajk;
+    (void)worker;
+
+    // Tasks enumerate the lower triangle of tiles row by row
+    while (task > i - job->k - 1)
+    {
+        task -= i - job->k;
+        i++;
+    }
+    j = job->k + 1 + task;
+
+    aij = tile(job->a, i, j);
+    aik = tile(job->a, i, job->k);
+    if (i == j)
+    {
+        syrk_lower(&aij, &aik);
+    }else{
+        ajk = tile(job->a, j, job->k);
+        gemm(-1.0, &aik, MATRIX_NO_TRANS, &ajk, MATRIX_TRANS, 1.0, &aij);
+    }
+}
+
+
+static int check_cholesky(matrix* A, matrix_uplo uplo) {
+    /* Checks the arguments of a Cholesky factorization, sets error and returns 0 if they are invalid. */
+
+    if (!A || (uplo != MATRIX_LOWER && uplo != MATRIX_UPPER)) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return 0;
+    }
+
+    if (A->rows != A->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+void cholesky_factor(matrix* A, matrix_uplo uplo){
+    /*  Factors a symmetric positive definite matrix A = L * L^T (uplo
+        MATRIX_LOWER) or A = U^T * U (MATRIX_UPPER) in place. Only the uplo
+        triangle of A is read and written. The blocked right-looking
+        algorithm factors a diagonal block of CHOL_BLOCK columns, solves
+        the panel below it and updates the trailing matrix through gemm.
+        Sets MATRIX_SINGULAR and stops if A is not positive definite. */
+
+    matrix a, akk, panel, trailing;
+    int kb, nb, n;
+
+    if (!check_cholesky(A, uplo))
+    {
+        return;
+    }
+
+    // The upper triangle of A is the lower triangle of its transposition
+    a = uplo == MATRIX_UPPER ? transposed(A) : *A;
+    n = a.rows;
+
+    for (kb = 0; kb < n; kb += CHOL_BLOCK)
+    {
+        nb = n - kb < CHOL_BLOCK ? n - kb : CHOL_BLOCK;
+        akk = sub_block(&a, kb, kb, nb, nb);
+
+        if (factor_lower(&akk))
+        {
+            error = MATRIX_SINGULAR;
+            LOG_ERROR("Matrix is not positive definite");
+            return;
+        }
+
+        if (kb + nb < n)
+        {
+            panel = sub_block(&a, kb + nb, kb, n - kb - nb, nb);
+            trailing = sub_block(&a, kb + nb, kb + nb, n - kb - nb, n - kb - nb);
+            solve_right_lower(&akk, &panel);
+            syrk_lower(&trailing, &panel);
+        }
+    }
+
+    error = MATRIX_OK;
+}
+
+
+void cholesky_factor_tiled(matrix* A, matrix_uplo uplo){
+    /*  Computes the same factorization as cholesky_factor on tiles of
+        CHOL_TILE x CHOL_TILE elements. Every step factors a diagonal tile,
+        then solves the tiles below it and updates the tiles of the trailing
+        matrix as independent tasks on the thread pool. */
+
+    chol_job job;
+    matrix a, akk;
+    int m, workers = thread_pool_size();
+
+    if (!check_cholesky(A, uplo))
+    {
+        return;
+    }
+
+    a = uplo == MATRIX_UPPER ? transposed(A) : *A;
+    job.a = &a;
+    job.tiles = (a.rows + CHOL_TILE - 1) / CHOL_TILE;
+
+    for (job.k = 0; job.k < job.tiles; job.k++)
+    {
+        akk = tile(&a, job.k, job.k);
+        if (factor_lower(&akk))
+        {
+            error = MATRIX_SINGULAR;
+            LOG_ERROR("Matrix is not positive definite");
+            return;
+        }
+
+        m = job.tiles - job.k - 1;
+        thread_pool_run(m, workers, chol_solve_task, &job);
+        thread_pool_run(m * (m + 1) / 2, workers, chol_update_task, &job);
+    }
+
+    error = MATRIX_OK;
+}
+
+
+void cholesky_solve(matrix* F, matrix_uplo uplo, matrix* B){
+    /*  Solves A * X = B in place of B, where F holds the Cholesky factor of
+        A in its uplo triangle as computed by cholesky_factor. */
+
+    if (!F || !B || (uplo != MATRIX_LOWER && uplo != MATRIX_UPPER)) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    // L * L^T * X = B or U^T * U * X = B
+    solve_triangular(F, uplo, uplo == MATRIX_LOWER ? MATRIX_NO_TRANS : MATRIX_TRANS, MATRIX_NON_UNIT, B);
+    if (error == MATRIX_OK)
+    {
+        solve_triangular(F, uplo, uplo == MATRIX_LOWER ? MATRIX_TRANS : MATRIX_NO_TRANS, MATRIX_NON_UNIT, B);
+    }
+}
+
+
+matrix* solve_spd(matrix* A, matrix* B){
+    /*  Returns the solution X of A * X = B for a symmetric positive definite
+        matrix A, of which only the lower triangle is read, or NULL with
+        error MATRIX_SINGULAR if A is not positive definite. A and B are
+        kept. Matrices of several tiles are factored by the tiled variant
+        when the thread pool has more than one thread. */
+
+    matrix *l, *x = NULL;
+
+    if (!A || !B) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->rows != A->cols || B->rows != A->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if ((l = materialize(A)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (thread_pool_size() > 1 && l->rows > 2 * CHOL_TILE)
+    {
+        cholesky_factor_tiled(l, MATRIX_LOWER);
+    }else{
+        cholesky_factor(l, MATRIX_LOWER);
+    }
+
+    if (error == MATRIX_OK && (x = materialize(B)) != NULL)
+    {
+        cholesky_solve(l, MATRIX_LOWER, x);
+        if (error != MATRIX_OK)
+        {
+            destroy_matrix(x);
+            x = NULL;
+        }
+    }
+
+    destroy_matrix(l);
+    return x;
+}
+
+
+static void destroy_qr_work(qr_work* work) {
+    destroy_matrix(work->v);
+    destroy_matrix(work->t);
+    destroy_matrix(work->g);
+    destroy_matrix(work->w);
+    destroy_matrix(work->tw);
+}
+
+
+static int init_qr_work(qr_work* work, int rows, int cols) {
+    /* Allocates the workspace for a matrix with rows rows and products with cols columns, returns 0 on failure. */
+    work->v = initialize_matrix(rows, QR_BLOCK);
+    work->t = create_zero_matrix(QR_BLOCK, QR_BLOCK);
+    work->g = initialize_matrix(QR_BLOCK, QR_BLOCK);
+    work->w = initialize_matrix(QR_BLOCK, cols);
+    work->tw = initialize_matrix(QR_BLOCK, cols);
+
+    if (!work->v || !work->t || !work->g || !work->w || !work->tw)
+    {
+        destroy_qr_work(work);
+        error = MATRIX_NOMEM;
+        return 0;
+    }
+    return 1;
+}
+
+
+static void householder(matrix* a, int col, double* tau) {
+    /*  Generates the reflector H = I - tau * v * v^T that maps column col of
+        a from the diagonal down to (beta, 0, ..., 0). beta overwrites the
+        diagonal element, v below it, the leading 1 of v is not stored. */
+    double alpha = MATRIX_AT(a, col, col), norm = 0.0, beta, scale;
+    int r;
+
+    for (r = col + 1; r < a->rows; r++)
+    {
+        norm += MATRIX_AT(a, r, col) * MATRIX_AT(a, r, col);
+    }
+
+    // The column is already reduced
+    if (norm == 0.0)
+    {
+        *tau = 0.0;
+        return;
+    }
+
+    beta = -copysign(sqrt(alpha * alpha + norm), alpha);
+    *tau = (beta - alpha) / beta;
+    scale = 1.0 / (alpha - beta);
+    for (r = col + 1; r < a->rows; r++)
+    {
+        MATRIX_AT(a, r, col) *= scale;
+    }
+    MATRIX_AT(a, col, col) = beta;
+}
+
+
+static void factor_qr_panel(matrix* a, int kb, int nb, double* tau, double* w) {
+    /*  Reduces columns [kb, kb + nb) of a column by column, each reflector
+        is applied to the rest of the panel at once. w holds nb sums. */
+    int c, r, q, last = kb + nb;
+
+    for (c = kb; c < last; c++)
+    {
+        householder(a, c, &tau[c]);
+
+        // w = tau * v^T * A(c:, c + 1 : last), accumulated row by row
+        for (q = c + 1; q < last; q++)
+        {
+            w[q - kb] = MATRIX_AT(a, c, q);
+        }
+        for (r = c + 1; r < a->rows; r++)
+        {
+            for (q = c + 1; q < last; q++)
+            {
+                w[q - kb] += MATRIX_AT(a, r, c) * MATRIX_AT(a, r, q);
+            }
+        }
+        for (q = c + 1; q < last; q++)
+        {
+            w[q - kb] *= tau[c];
+            MATRIX_AT(a, c, q) -= w[q - kb];
+        }
+        for (r = c + 1; r < a->rows; r++)
+        {
+            for (q = c + 1; q < last; q++)
+            {
+                MATRIX_AT(a, r, q) -= MATRIX_AT(a, r, c) * w[q - kb];
+            }
+        }
+    }
+}
+
+
+static void block_reflector(const matrix* qr, const double* tau, int kb, int nb, qr_work* work, matrix* v, matrix* t) {
+    /*  Builds the compact WY form H(kb) * ... * H(kb + nb - 1) = I - V * T * V^T
+        of nb reflectors stored in qr. V gets rows [kb, rows) of the
+        reflectors with explicit ones and zeros, T is upper triangular. */
+    matrix g;
+    int r, q, i, p;
+
+    *v = sub_block(work->v, 0, 0, qr->rows - kb, nb);
+    *t = sub_block(work->t, 0, 0, nb, nb);
+    g = sub_block(work->g, 0, 0, nb, nb);
+
+    for (r = 0; r < v->rows; r++)
+    {
+        for (q = 0; q < nb; q++)
+        {
+            MATRIX_AT(v, r, q) = r > q ? MATRIX_AT(qr, kb + r, kb + q) : (r == q ? 1.0 : 0.0);
+        }
+    }
+    gemm(1.0, v, MATRIX_TRANS, v, MATRIX_NO_TRANS, 0.0, &g);
+
+    // T(0:i, i) = -tau(i) * T(0:i, 0:i) * V(:, 0:i)^T * v(i)
+    for (i = 0; i < nb; i++)
+    {
+        for (p = 0; p < i; p++)
+        {
+            double sum = 0.0;
+
+            for (q = p; q < i; q++)
+            {
+                sum += MATRIX_AT(t, p, q) * MATRIX_AT(&g, q, i);
+            }
+            MATRIX_AT(t, p, i) = -tau[kb + i] * sum;
+        }
+        MATRIX_AT(t, i, i) = tau[kb + i];
+    }
+}
+
+
+static void apply_reflector(matrix* v, matrix* t, matrix_op op, matrix* c, qr_work* work) {
+    /*  Computes C = (I - V * op(T) * V^T) * C with three gemm calls, op
+        MATRIX_TRANS applies the transposition of the block reflector. */
+    matrix w = sub_block(work->w, 0, 0, v->cols, c->cols), tw = sub_block(work->tw, 0, 0, v->cols, c->cols);
+
+    gemm(1.0, v, MATRIX_TRANS, c, MATRIX_NO_TRANS, 0.0, &w);
+    gemm(1.0, t, op, &w, MATRIX_NO_TRANS, 0.0, &tw);
+    gemm(-1.0, v, MATRIX_NO_TRANS, &tw, MATRIX_NO_TRANS, 1.0, c);
+}
+
+
+void qr_factor(matrix* A, double* tau){
+    /*  Factors A = Q * R in place with Householder reflectors. R is stored
+        on and above the diagonal, reflector i below the diagonal of column
+        i with its leading 1 implied, tau holds the min(rows, cols) scalars
+        so that Q = H(0) * ... * H(k - 1), H(i) = I - tau[i] * v(i) * v(i)^T.
+        Panels of QR_BLOCK columns are reduced column by column, the
+        trailing matrix is updated by their compact WY form through gemm. */
+
+    qr_work work;
+    matrix v, t, c;
+    int kb, nb, steps;
+
+    if (!A || !tau) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (!init_qr_work(&work, A->rows, A->cols))
+    {
+        LOG_ERROR("Failed memory allocation");
+        return;
+    }
+
+    steps = A->rows < A->cols ? A->rows : A->cols;
+    for (kb = 0; kb < steps; kb += QR_BLOCK)
+    {
+        nb = steps - kb < QR_BLOCK ? steps - kb : QR_BLOCK;
+        // The first row of g is free until the block reflector is built
+        factor_qr_panel(A, kb, nb, tau, work.g->buffer);
+
+        if (kb + nb < A->cols)
+        {
+            block_reflector(A, tau, kb, nb, &work, &v, &t);
+            c = sub_block(A, kb, kb + nb, A->rows - kb, A->cols - kb - nb);
+            apply_reflector(&v, &t, MATRIX_TRANS, &c, &work);
+        }
+    }
+
+    destroy_qr_work(&work);
+    error = MATRIX_OK;
+}
+
+
+void qr_apply_q(matrix* QR, const double* tau, matrix_op op, matrix* C){
+    /*  Computes C = op(Q) * C in place of C, where QR and tau are the
+        factorization computed by qr_factor. Reflectors are applied in
+        blocks of QR_BLOCK, forwards for Q^T and backwards for Q. */
+
+    qr_work work;
+    matrix v, t, c;
+    int kb, nb, steps;
+
+    if (!QR || !tau || !C || (op != MATRIX_NO_TRANS && op != MATRIX_TRANS)) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (C->rows != QR->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    if (!init_qr_work(&work, QR->rows, C->cols))
+    {
+        LOG_ERROR("Failed memory allocation");
+        return;
+    }
+
+    steps = QR->rows < QR->cols ? QR->rows : QR->cols;
+    for (kb = op == MATRIX_TRANS ? 0 : (steps - 1) / QR_BLOCK * QR_BLOCK; kb >= 0 && kb < steps; kb += op == MATRIX_TRANS ? QR_BLOCK : -QR_BLOCK)
+    {
+        nb = steps - kb < QR_BLOCK ? steps - kb : QR_BLOCK;
+        block_reflector(QR, tau, kb, nb, &work, &v, &t);
+        c = sub_block(C, kb, 0, C->rows - kb, C->cols);
+        apply_reflector(&v, &t, op, &c, &work);
+    }
+
+    destroy_qr_work(&work);
+    error = MATRIX_OK;
+}
+
+
+matrix* qr_form_q(matrix* QR, const double* tau, int full){
+    /*  Returns Q of the factorization computed by qr_factor, the first
+        min(rows, cols) columns of it or all rows columns if full is set. */
+
+    matrix* q;
+
+    if (!QR || !tau) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    q = create_unit_matrix(QR->rows, full || QR->rows < QR->cols ? QR->rows : QR->cols);
+    if (q == NULL)
+    {
+        return NULL;
+    }
+
+    qr_apply_q(QR, tau, MATRIX_NO_TRANS, q);
+    if (error != MATRIX_OK)
+    {
+        destroy_matrix(q);
+        return NULL;
+    }
+    return q;
+}
+
+
+matrix* lstsq(matrix* A, matrix* B){
+    /*  Returns X minimizing the norm of A * X - B for A of full rank, A and
+        B are kept. Overdetermined systems solve R * X = (Q^T * B)(0:cols)
+        from A = Q * R, underdetermined ones get the minimum norm solution
+        X = Q * (R^-T * B) from A^T = Q * R. A rank deficiency that leaves
+        a zero on the diagonal of R sets MATRIX_SINGULAR. */
+
+    matrix *qr, *x = NULL, *y, r, top, at;
+    double* tau;
+    int steps;
+
+    if (!A || !B) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (B->rows != A->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    steps = A->rows < A->cols ? A->rows : A->cols;
+    at = transposed(A);
+    if ((tau = malloc(steps * sizeof(double))) == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    if ((qr = materialize(A->rows >= A->cols ? A : &at)) == NULL)
+    {
+        free(tau);
+        return NULL;
+    }
+
+    qr_factor(qr, tau);
+    r = sub_block(qr, 0, 0, steps, steps);
+
+    if (error == MATRIX_OK && A->rows >= A->cols && (y = materialize(B)) != NULL)
+    {
+        qr_apply_q(qr, tau, MATRIX_TRANS, y);
+        top = sub_block(y, 0, 0, steps, y->cols);
+        solve_triangular(&r, MATRIX_UPPER, MATRIX_NO_TRANS, MATRIX_NON_UNIT, &top);
+        x = error == MATRIX_OK ? materialize(&top) : NULL;
+        destroy_matrix(y);
+    }else if (error == MATRIX_OK && A->rows < A->cols && (x = create_zero_matrix(A->cols, B->cols)) != NULL)
+    {
+        top = sub_block(x, 0, 0, steps, x->cols);
+        copy_into(&top, B);
+        solve_triangular(&r, MATRIX_UPPER, MATRIX_TRANS, MATRIX_NON_UNIT, &top);
+        if (error == MATRIX_OK)
+        {
+            qr_apply_q(qr, tau, MATRIX_NO_TRANS, x);
+        }
+    }
+
+    if (x != NULL && error != MATRIX_OK)
+    {
+        destroy_matrix(x);
+        x = NULL;
+    }
+
+    destroy_matrix(qr);
+    free(tau);
+    return x;
+}
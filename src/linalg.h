@@ -0,0 +1,53 @@
+/*
+    linalg.h    version 1.0
+
+    Header file for linalg.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_LINALG
+#define MAT_LINALG
+
+#include "matrix.h"
+#include "gemm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    MATRIX_LOWER,       // elements below the diagonal
+    MATRIX_UPPER        // elements above the diagonal
+} matrix_uplo;
+
+typedef enum
+{
+    MATRIX_NON_UNIT,    // diagonal elements are stored
+    MATRIX_UNIT         // diagonal elements are ones and not read
+} matrix_diag;
+
+extern void solve_triangular(matrix* T, matrix_uplo uplo, matrix_op op, matrix_diag diag, matrix* B);
+extern void lu_factor(matrix* A, int* pivots);
+extern void lu_solve(matrix* LU, const int* pivots, matrix* B);
+extern matrix* solve(matrix* A, matrix* B);
+extern double determinant(matrix* A);
+extern matrix* inverse(matrix* A);
+extern void cholesky_factor(matrix* A, matrix_uplo uplo);
+extern void cholesky_factor_tiled(matrix* A, matrix_uplo uplo);
+extern void cholesky_solve(matrix* F, matrix_uplo uplo, matrix* B);
+extern matrix* solve_spd(matrix* A, matrix* B);
+extern void qr_factor(matrix* A, double* tau);
+extern void qr_apply_q(matrix* QR, const double* tau, matrix_op op, matrix* C);
+extern matrix* qr_form_q(matrix* QR, const double* tau, int full);
+extern matrix* lstsq(matrix* A, matrix* B);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,8 +11,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include "matrix.h"
+#include "gemm.h"
+#include "simd.h"
+#include "binary.h"
 
 // Define a macro for logging errors
 #ifdef ENABLE_LOGGING
@@ -21,7 +26,8 @@
 #define LOG_ERROR(fmt, ...)
 #endif
 
-matrix_error error = MATRIX_OK;
+// Status of the last operation called by this thread
+MATRIX_THREAD_LOCAL matrix_error error = MATRIX_OK;
 
 const char* const MATRIX_ERROR_STRS[] = 
 {
@@ -31,10 +37,18 @@ const char* const MATRIX_ERROR_STRS[] =
     "MATRIX_ERROR_OPENING_FAILED",
     "MATRIX_ERROR_CLOSING_FAILED",
     "MATRIX_ERROR_WRONG_TYPE",
-    "MATRIX_ERROR_OTHER"
+    "MATRIX_ERROR_OTHER",
+    "MATRIX_ERROR_SINGULAR"
 };
 
 
+matrix_error matrix_last_error(void)
+{
+    /* Returns the status of the last operation called by this thread. */
+    return error;
+}
+
+
 const char* matrix_error_str(matrix_error error)
 {
     const char* err_str = NULL;
@@ -49,74 +63,312 @@ const char* matrix_error_str(matrix_error error)
 }
 
 
-static int is_matrix_file(const char* filename, const char delimiter) {
-    /* Check if the file format represents a matrix.*/
-    FILE *file;
-    int rows = 0;
-    int cols = 0;  // Initialize to an invalid value
-    int prev_cols = -1;
-    char *token;
-    char buffer[100];  // Adjust the buffer size as needed
+// Bytes read from a text file at once
+#define READ_CHUNK (1 << 20)
 
-    if ((file = fopen(filename, "r")) == NULL) {
-        error = MATRIX_OPENING_ERROR;
-        LOG_ERROR("Failed opening file");
-        return 0;
+// Longest number handed to strtod when the fast path does not apply
+#define MAX_NUMBER_LEN 128
+
+// Powers of ten exactly representable as double
+static const double POW10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Matrix elements collected while parsing a text file
+typedef struct
+{
+    char* values;
+    size_t size;        // bytes of an element
+    size_t count;
+    size_t capacity;
+    int rows;
+    int cols;
+    matrix_text_parser parse;
+} text_matrix;
+
+
+static const char* parse_number_slow(const char* p, const char* end, double* value) {
+    /* Parses a number with strtod, used for long mantissas, big exponents, inf and nan. */
+    char number[MAX_NUMBER_LEN];
+    char* parsed_end;
+    size_t len = end - p < MAX_NUMBER_LEN - 1 ? (size_t)(end - p) : MAX_NUMBER_LEN - 1;
+
+    memcpy(number, p, len);
+    number[len] = '\0';
+
+    *value = strtod(number, &parsed_end);
+    if (parsed_end == number || (len == MAX_NUMBER_LEN - 1 && parsed_end == number + len))
+    {
+        return NULL;
     }
 
-    // Read the file buffer by buffer
-    while (fgets(buffer, sizeof(buffer), file) != NULL) {
-        if (prev_cols != -1 && strlen(buffer) == 1)
+    return p + (parsed_end - number);
+}
+
+
+const char* matrix_parse_number(const char* p, const char* end, double* value) {
+    /*  Parses a decimal number starting at p, returns the end of it or NULL.
+        Numbers with up to 19 significant digits and a small exponent are
+        converted exactly without strtod. */
+    const char* start = p;
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0, any = 0, truncated = 0, negative = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        any = 1;
+        if (digits < 19)
         {
-            break;
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }else{
+            exponent++;
+            truncated |= *p != '0';
         }
-        
-        if (strchr(buffer, delimiter) == NULL)
+    }
+
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
         {
-            prev_cols = -1;
-            break;
+            any = 1;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }else{
+                truncated |= *p != '0';
+            }
+        }
+    }
+
+    if (!any)
+    {
+        return parse_number_slow(start, end, value);
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        int exp_negative = 0, exp_value = 0;
+
+        if (q < end && (*q == '-' || *q == '+'))
+        {
+            exp_negative = *q == '-';
+            q++;
+        }
+        if (q == end || *q < '0' || *q > '9')
+        {
+            return NULL;
         }
-        
-        // Count the number of columns in every row
-        token = strtok(buffer, &delimiter);
-        while (token != NULL) {
-            cols++;
-            token = strtok(NULL, &delimiter);
+        for (; q < end && *q >= '0' && *q <= '9'; q++)
+        {
+            if (exp_value < 100000)
+            {
+                exp_value = exp_value * 10 + (*q - '0');
+            }
         }
-        if (prev_cols == -1)
+        exponent += exp_negative ? -exp_value : exp_value;
+        p = q;
+    }
+
+    if (truncated || mantissa > ((uint64_t)1 << 53) || exponent < -22 || exponent > 22)
+    {
+        return parse_number_slow(start, end, value);
+    }
+
+    *value = exponent < 0 ? (double)mantissa / POW10[-exponent] : (double)mantissa * POW10[exponent];
+    if (negative)
+    {
+        *value = -*value;
+    }
+
+    return p;
+}
+
+
+static const char* parse_double(const char* p, const char* end, void* value) {
+    /* Parses an element of a double matrix. */
+
+    return matrix_parse_number(p, end, value);
+}
+
+
+static matrix_error reserve_value(text_matrix* text) {
+    /* Makes room for one more element, doubling the aligned storage when it is full. */
+    char* values;
+
+    if (text->count == text->capacity)
+    {
+        size_t capacity = text->capacity ? text->capacity * 2 : 1024;
+
+        if (capacity > SIZE_MAX / text->size)
         {
-            prev_cols = cols;
+            return MATRIX_NOMEM;
         }
-        // Compare with previous columns number
-        if (cols != prev_cols) {
-            prev_cols = -1;
+        values = matrix_aligned_alloc(capacity * text->size);
+        if (values == NULL)
+        {
+            return MATRIX_NOMEM;
+        }
+        if (text->count > 0)
+        {
+            memcpy(values, text->values, text->count * text->size);
+        }
+        matrix_aligned_free(text->values);
+        text->values = values;
+        text->capacity = capacity;
+    }
+
+    return MATRIX_OK;
+}
+
+
+static matrix_error parse_line(text_matrix* text, const char* p, const char* end, char delimiter) {
+    /* Parses one matrix row and checks that it has as many columns as the first one. */
+    int cols = 0, blank_delimiter = delimiter == ' ' || delimiter == '\t';
+    const char* after;
+    matrix_error status;
+
+    while (p < end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t'))
+        {
+            p++;
+        }
+        if (p == end)
+        {
             break;
-        } else {
-            prev_cols = cols;
-            cols = 0;
         }
-        rows++;
+
+        if ((status = reserve_value(text)) != MATRIX_OK)
+        {
+            return status;
+        }
+        if ((p = text->parse(p, end, text->values + text->count * text->size)) == NULL)
+        {
+            return MATRIX_TYPE_ERROR;
+        }
+        text->count++;
+        cols++;
+
+        // Blanks after a number are either padding or the delimiter itself
+        after = p;
+        while (p < end && (*p == ' ' || *p == '\t'))
+        {
+            p++;
+        }
+        if (p < end && *p == delimiter && !blank_delimiter)
+        {
+            p++;
+        }else if (p < end && !(blank_delimiter && p > after)){
+            return MATRIX_TYPE_ERROR;
+        }
+    }
+
+    if (text->rows == 0)
+    {
+        text->cols = cols;
+    }
+    if (cols == 0 || cols != text->cols || text->rows == INT_MAX)
+    {
+        return MATRIX_TYPE_ERROR;
     }
+    text->rows++;
 
-    fclose(file);
+    return MATRIX_OK;
+}
 
-    // Determine if the file represents a matrix
-    if (rows > 0 && prev_cols > 0) {
-        error = MATRIX_OK;
-        return 1;
-    } else {
-        error = MATRIX_TYPE_ERROR;
-        LOG_ERROR("File does not represent a matrix");
-        return 0;
+
+static int is_blank_line(const char* p, const char* end) {
+    /* Checks if a line holds only whitespace. */
+
+    for (; p < end; p++)
+    {
+        if (*p != ' ' && *p != '\t' && *p != '\r')
+        {
+            return 0;
+        }
     }
+    return 1;
 }
 
 
-matrix* initialize_matrix(int rows, int cols){
-    /* Creates a matrix m * n and allocates an array for matrix elements. */
-    
+static matrix_error parse_lines(text_matrix* text, const char* p, const char* end, char delimiter, int* finished) {
+    /* Parses all lines in [p, end), an empty line after the matrix ends it. */
+    matrix_error status;
+
+    while (p < end && !*finished)
+    {
+        const char* eol = memchr(p, '\n', end - p);
+        const char* line_end = eol ? eol : end;
+
+        if (is_blank_line(p, line_end))
+        {
+            // Blank lines before the matrix are skipped, after it they end it
+            *finished = text->rows > 0;
+        }else{
+            if (line_end > p && line_end[-1] == '\r')
+            {
+                line_end--;
+            }
+            if ((status = parse_line(text, p, line_end, delimiter)) != MATRIX_OK)
+            {
+                return status;
+            }
+        }
+        p = eol ? eol + 1 : end;
+    }
+
+    return MATRIX_OK;
+}
+
+
+#ifndef MATRIX_NO_ROW_POINTERS
+static matrix_error set_row_pointers(matrix* mat) {
+    /* (Re)builds the row pointer compatibility view into the contiguous buffer. */
+    double** rows_ptr;
     int i;
-    matrix *mat = malloc(sizeof(matrix));
+
+    rows_ptr = realloc(mat->data, (size_t)mat->rows * sizeof(double *));
+    if (rows_ptr == NULL)
+    {
+        return MATRIX_NOMEM;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        rows_ptr[i] = mat->buffer + (size_t)i * mat->row_stride;
+    }
+    mat->data = rows_ptr;
+
+    return MATRIX_OK;
+}
+#endif
+
+
+matrix* matrix_from_buffer(double* buffer, int rows, int cols){
+    /*  Creates a matrix owning an already filled row-major buffer
+        allocated with matrix_aligned_alloc. */
+    matrix* mat;
+
+    if (buffer == NULL || rows <= 0 || cols <= 0)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat = malloc(sizeof(matrix));
 
     if (!mat) {
         error = MATRIX_NOMEM;
@@ -124,45 +376,102 @@ matrix* initialize_matrix(int rows, int cols){
         return NULL;
     }
 
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->row_stride = cols;
+    mat->col_stride = 1;
+    mat->buffer = buffer;
+    mat->data = NULL;
+    mat->mapping = NULL;
+    mat->is_view = 0;
+
+#ifndef MATRIX_NO_ROW_POINTERS
+    if (set_row_pointers(mat) != MATRIX_OK)
+    {
+        free(mat);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+#endif
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+void* matrix_aligned_alloc(size_t size){
+    /* Allocates size bytes aligned to MATRIX_ALIGNMENT. */
+    void* ptr = NULL;
+
+    if (size == 0)
+    {
+        size = MATRIX_ALIGNMENT;
+    }
+
+#ifdef _WIN32
+    ptr = _aligned_malloc(size, MATRIX_ALIGNMENT);
+#else
+    if (posix_memalign(&ptr, MATRIX_ALIGNMENT, size) != 0)
+    {
+        ptr = NULL;
+    }
+#endif
+
+    return ptr;
+}
+
+
+void matrix_aligned_free(void* ptr){
+    /* Frees memory allocated by matrix_aligned_alloc. */
+
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+
+matrix* initialize_matrix(int rows, int cols){
+    /*  Creates a matrix m * n and allocates an array for matrix elements.
+        Elements are stored in one contiguous aligned row-major buffer. */
+    
+    matrix *mat;
+    double *buffer;
+    size_t count;
+
     if (rows <= 0 || cols <= 0)
     {
         error = MATRIX_INVARGS;
         LOG_ERROR("Invalid arguments");
-        free(mat);
         return NULL;
     }
 
-    mat->rows = rows;
-    mat->cols = cols;
+    count = (size_t)rows * (size_t)cols;
+    if (count > SIZE_MAX / sizeof(double))
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Matrix too large");
+        return NULL;
+    }
 
-    mat->data = malloc(rows * sizeof(double *));
+    buffer = matrix_aligned_alloc(count * sizeof(double));
 
-    if (mat->data == NULL)
+    if (buffer == NULL)
     {
         error = MATRIX_NOMEM;
         LOG_ERROR("Failed memory allocation");
-        free(mat);
         return NULL;
     }
 
-    for (i = 0; i < rows; i++)
+    mat = matrix_from_buffer(buffer, rows, cols);
+    if (mat == NULL)
     {
-        mat->data[i] = malloc(cols * sizeof(double));
-        if (mat->data[i] == NULL)
-        {   
-            // free already allocated memory
-            for (int j = 0; j < i; j++) {
-                free(mat->data[j]);
-            }
-            free(mat->data);  
-            free(mat);     
-            error = MATRIX_NOMEM;
-            LOG_ERROR("Failed memory allocation");
-            return NULL;
-        }
+        matrix_aligned_free(buffer);
+        return NULL;
     }
-    
-    error = MATRIX_OK;
+
     return mat;
 }
 
@@ -170,7 +479,6 @@ matrix* initialize_matrix(int rows, int cols){
 matrix* create_zero_matrix(int rows, int cols){
     /* Creates a zero matrix of size rows * cols. */
 
-    int i, j;
     matrix *mat = initialize_matrix(rows, cols);
 
     if (error != MATRIX_OK)
@@ -178,13 +486,7 @@ matrix* create_zero_matrix(int rows, int cols){
         return NULL;
     }
 
-    for (i = 0; i < rows; i++)
-    {
-        for (j = 0; j < cols; j++)
-        {
-            mat->data[i][j] = 0.0;
-        }
-    }
+    memset(mat->buffer, 0, (size_t)rows * cols * sizeof(double));
 
     error = MATRIX_OK;
     return mat;
@@ -193,25 +495,17 @@ matrix* create_zero_matrix(int rows, int cols){
 matrix* create_unit_matrix(int rows, int cols){
     /* Creates a unit matrix of size m * n. */
 
-    int i, j;
-    matrix* mat = initialize_matrix(rows, cols);
+    int i;
+    matrix* mat = create_zero_matrix(rows, cols);
 
     if (error != MATRIX_OK)
     {
         return NULL;
     }
     
-    for (i = 0; i < rows; i++)
+    for (i = 0; i < rows && i < cols; i++)
     {
-        for (j = 0; j < cols; j++)
-        {
-            if (i == j)
-            {
-                mat->data[i][j] = 1.0;
-            }else{
-                mat->data[i][j] = 0.0;
-            }
-        }
+        MATRIX_AT(mat, i, i) = 1.0;
     }
 
     error = MATRIX_OK;
@@ -221,20 +515,27 @@ matrix* create_unit_matrix(int rows, int cols){
 
 void destroy_matrix(matrix* mat){
     /* Frees memory allocated for matrix mat. */
-    int i;
 
     if (!mat) {
         return;
     }
-    
-    for (i = 0; i < mat->rows; i++)
+
+    if (mat->is_view)
     {
-        free(mat->data[i]);
-        mat->data[i] = NULL;
+        free(mat);
+        return;
     }
     
     free(mat->data);
     mat->data = NULL;
+    if (mat->mapping)
+    {
+        matrix_unmap(mat->mapping);
+        mat->mapping = NULL;
+    }else{
+        matrix_aligned_free(mat->buffer);
+    }
+    mat->buffer = NULL;
     free(mat);
     mat = NULL;
 }
@@ -253,203 +554,127 @@ void print_matrix(matrix* mat){
     {
         for (j = 0; j < mat->cols; j++)
         {
-            printf("%lf ", mat->data[i][j]);
+            printf("%lf ", MATRIX_AT(mat, i, j));
         }
         printf("\n");
     }
 }
 
 
-matrix* add(matrix* mat1, matrix* mat2){
-    /* Returns an addition of two matrices mat1 and mat2. */
+// Operations shared with matrix_f32.c
+#define REAL_T double
+#define REAL_MATRIX matrix
+#define REAL_FN(name) name
+#define REAL_KERNELS simd_kernels
+#define REAL_GET_KERNELS simd_get_kernels
+#define REAL_INITIALIZE initialize_matrix
+#define REAL_DESTROY destroy_matrix
+#define REAL_GEMM gemm
+#define REAL_ROW_POINTERS
 
-    matrix* mat3;
-    int i, j;
+#include "matrix_real_template.h"
 
-    if (!mat1 || !mat2) {
-        error = MATRIX_INVARGS;
-        LOG_ERROR("Invalid arguments");
-        return NULL;
-    }
 
-    mat3 = initialize_matrix(mat1->rows, mat1->cols);
+matrix_error matrix_read_text(const char* filename, char delimiter, size_t size, matrix_text_parser parse,
+                              void** values, int* rows, int* cols){
+    /*  Reads the elements of a text matrix file into an aligned buffer of
+        rows * cols elements of size bytes, parsed by parse. The file is
+        read once in large chunks, rows are validated as they are parsed.
+        Shared by the read_from_file of every element type. */
 
-    if (error != MATRIX_OK)
+    FILE *f;
+    text_matrix text = { NULL, size, 0, 0, 0, 0, parse };
+    matrix_error status = MATRIX_OK;
+    char *chunk, *grown;
+    size_t capacity = READ_CHUNK, len = 0, n;
+    int eof = 0, finished = 0;
+
+    *values = NULL;
+
+    if ((f = fopen(filename, "rb")) == NULL)
     {
-        return NULL;
+        return MATRIX_OPENING_ERROR;
     }
 
-    if (mat1->rows == mat2->rows && mat1->cols == mat2->cols)
+    if ((chunk = malloc(capacity)) == NULL)
     {
-        for (i = 0; i < mat1->rows; i++)
-        {
-            for (j = 0; j < mat1->cols; j++)
-            {
-                mat3->data[i][j] = mat1->data[i][j] + mat2->data[i][j];
-            }
-        }
-    }else{
-        error = MATRIX_TYPE_ERROR;
-        LOG_ERROR("Invalid matrix types");
-        destroy_matrix(mat3);
-        return NULL;
+        fclose(f);
+        return MATRIX_NOMEM;
     }
-    
-    error = MATRIX_OK;
-    return mat3;
-}
-
-
-matrix* substract(matrix* mat1, matrix* mat2){
-    /* Returns a substraction of matrices mat1 and mat2. */
 
-    matrix* mat3;
-    int i, j;
-
-    if (!mat1 || !mat2) {
-        error = MATRIX_INVARGS;
-        LOG_ERROR("Invalid arguments");
-        return NULL;
-    }
+    while (!eof && !finished && status == MATRIX_OK)
+    {
+        char* last_newline;
 
-    mat3 = initialize_matrix(mat1->rows, mat1->cols);
+        n = fread(chunk + len, 1, capacity - len, f);
+        len += n;
+        eof = n == 0;
 
-    if (error != MATRIX_OK)
-    {
-        return NULL;
-    }
+        if (eof)
+        {
+            // The last line has no newline
+            status = parse_lines(&text, chunk, chunk + len, delimiter, &finished);
+            break;
+        }
 
-    if (mat1->rows == mat2->rows && mat1->cols == mat2->cols)
-    {
-        for (i = 0; i < mat1->rows; i++)
+        last_newline = NULL;
+        for (n = len; n > 0; n--)
         {
-            for (j = 0; j < mat1->cols; j++)
+            if (chunk[n - 1] == '\n')
             {
-                mat3->data[i][j] = mat1->data[i][j] - mat2->data[i][j];
+                last_newline = chunk + n - 1;
+                break;
             }
-            
         }
-    }else{
-        error = MATRIX_TYPE_ERROR;
-        LOG_ERROR("Invalid matrix types");
-        return NULL;
-    }
-    
-    error = MATRIX_OK;
-    return mat3;
-}
-
-
-matrix* multiply_by_scalar(matrix* mat, float scalar){
-    /* Return a matrix mat multiplied by a scalar. */
-
-    matrix* mat2;
-    int i, j;
-
-    if (!mat) {
-        error = MATRIX_INVARGS;
-        LOG_ERROR("Invalid arguments");
-        return NULL;
-    }
-
-    mat2 = initialize_matrix(mat->rows, mat->cols);
 
-    if (error != MATRIX_OK)
-    {
-        return NULL;
-    }
-
-    for (i = 0; i < mat->rows; i++)
-    {
-        for (j = 0; j < mat->cols; j++)
+        if (last_newline == NULL)
         {
-            mat2->data[i][j] = mat->data[i][j] * scalar;
+            // A single line longer than the buffer
+            if (len == capacity)
+            {
+                if ((grown = realloc(chunk, capacity * 2)) == NULL)
+                {
+                    status = MATRIX_NOMEM;
+                    break;
+                }
+                chunk = grown;
+                capacity *= 2;
+            }
+            continue;
         }
-    }
-
-    error = MATRIX_OK;
-    return mat2;
-}
-
 
-matrix* transpose(matrix* mat){
-    /* Returns a transposition of matrix mat. */
+        status = parse_lines(&text, chunk, last_newline + 1, delimiter, &finished);
 
-    matrix* mat2;
-    int i, j;
-
-    if (!mat) {
-        error = MATRIX_INVARGS;
-        LOG_ERROR("Invalid arguments");
-        return NULL;
+        // Keep the incomplete last line for the next chunk
+        len = chunk + len - (last_newline + 1);
+        memmove(chunk, last_newline + 1, len);
     }
 
-    mat2 = initialize_matrix(mat->rows, mat->cols);
+    free(chunk);
 
-    if (error != MATRIX_OK)
+    if (status == MATRIX_OK && ferror(f))
     {
-        return NULL;
+        status = MATRIX_OTHER_ERROR;
     }
-
-    for (i = 0; i < mat->cols; i++)
+    if (fclose(f) == EOF && status == MATRIX_OK)
     {
-        for (j = 0; j < mat->rows; j++)
-        {
-            if (i == j)
-            {
-                mat2->data[i][j] = mat->data[i][j];
-            }else{
-                mat2->data[i][j] = mat->data[j][i];
-            }
-        }
-    }
-
-    error = MATRIX_OK;
-    return mat2;
-}
-
-
-matrix* multiply_by_matrix(matrix* mat1, matrix* mat2){
-    /* Returns a multiplication of two matrices mat1 and mat2. */
-
-    matrix* mat3;
-    int i, j, k, sum = 0;
-
-    if (!mat1 || !mat2) {
-        error = MATRIX_INVARGS;
-        LOG_ERROR("Invalid arguments");
-        return NULL;
+        status = MATRIX_CLOSING_ERROR;
     }
-
-    mat3 = initialize_matrix(mat1->rows, mat2->cols);
-
-    if (error != MATRIX_OK)
+    if (status == MATRIX_OK && text.rows == 0)
     {
-        return NULL;
+        status = MATRIX_TYPE_ERROR;
     }
 
-    if (mat1->cols == mat2->rows)
+    if (status != MATRIX_OK)
     {
-        for (i = 0; i < mat1->rows; i++)
-        {
-            for (j = 0; j < mat2->cols; j++)
-            {
-                for (k = 0; k < mat1->cols; k++)
-                {
-                    sum += mat1->data[i][k] * mat2->data[k][j];
-                }
-                mat3->data[i][j] = sum;
-                sum = 0;
-            }
-        }   
-    }else{
-        error = MATRIX_TYPE_ERROR;
-        LOG_ERROR("Invalid matrix types");
-        return NULL;
+        matrix_aligned_free(text.values);
+        return status;
     }
-    
-    error = MATRIX_OK;
-    return mat3;
+
+    *values = text.values;
+    *rows = text.rows;
+    *cols = text.cols;
+    return MATRIX_OK;
 }
 
 
@@ -457,92 +682,28 @@ matrix* read_from_file(const char *filename, const char delimiter){
     /*  Reads matrix from a text file.
         Every row represents a matrix row and elements must be seperated by separator. */
     
-    FILE *f;
     matrix *mat;
-    int rows = 0, cols = 0, i, j, ch, prev_ch;
-    float num;
+    matrix_error status;
+    void* values;
+    int rows, cols;
 
-    if (filename == NULL){
+    if (filename == NULL || delimiter == '\n' || delimiter == '\r' || delimiter == '\0'){
         error = MATRIX_INVARGS;
         LOG_ERROR("Invalid arguments");
         return NULL;
     }
 
-    // Check if file represents a matrix
-    if (is_matrix_file(filename, delimiter) == 0)
+    if ((status = matrix_read_text(filename, delimiter, sizeof(double), parse_double, &values, &rows, &cols)) != MATRIX_OK)
     {
+        error = status;
+        LOG_ERROR("Failed reading matrix from file");
         return NULL;
     }
 
-    if ((f = fopen(filename, "r")) == NULL)
+    mat = matrix_from_buffer(values, rows, cols);
+    if (mat == NULL)
     {
-        error = MATRIX_OPENING_ERROR;
-        LOG_ERROR("Failed opening file");
-        return NULL;
-    }
-    
-    ch = fgetc(f);
-    while (ch != EOF)
-    {
-        if(ch == '\n' || ch == EOF){
-            rows++;
-        }
-        prev_ch = ch;
-        ch = fgetc(f);
-        // add last row
-        if (ch == EOF && prev_ch != '\n')
-        {
-            rows++;
-        }
-        // break if newlines after matrix
-        if (ch == '\n' && prev_ch == '\n')
-        {
-            break;
-        }
-    }
-
-    rewind(f);
-
-    while (fscanf(f, "%f", &num) == 1) {
-        // Increment count for each successfully read float value
-        cols++;
-
-        // Skip over the delimiter ';'
-        if (fgetc(f) != delimiter) {
-            break;  // Exit loop if ';' is not found
-        }
-    }
-    
-    rewind(f);
-    
-    mat = initialize_matrix(rows, cols);
-    if (mat == NULL) {
-        fclose(f);
-        return NULL;
-    }
-
-    for (i = 0; i < rows; i++)
-    {
-        for (j = 0; j < cols; j++)
-        {   
-            if (fscanf(f, "%lf", &mat->data[i][j]) != 1) {
-                error = MATRIX_OTHER_ERROR;
-                LOG_ERROR("Failed reading from file");
-                destroy_matrix(mat); // Free matrix of already loaded values
-                fclose(f);
-                return NULL;
-            }
-            // skip the next character - delimiter but not the last one in the row
-            if (j < cols - 1) {
-                fgetc(f);
-            }
-        }
-    }
-    
-    if (fclose(f) == EOF) {
-        error = MATRIX_CLOSING_ERROR;
-        LOG_ERROR("Failed closing file");
-        destroy_matrix(mat);
+        matrix_aligned_free(values);
         return NULL;
     }
     
@@ -576,10 +737,10 @@ void save_to_file(matrix* mat, const char* filename, const char delimiter){
         {
             if (j > 0)
             {
-                fprintf(f, &delimiter);
+                fputc(delimiter, f);
             }
             
-            fprintf(f, "%lf", mat->data[i][j]);
+            fprintf(f, "%lf", MATRIX_AT(mat, i, j));
         }
         fprintf(f, "\n");
     }
@@ -631,7 +792,7 @@ double get_value(matrix* mat, int i, int j){
     }
     
     error = MATRIX_OK;
-    return mat->data[i-1][j-1];
+    return MATRIX_AT(mat, i-1, j-1);
 }
 
 
@@ -649,5 +810,5 @@ void set_value(matrix* mat, int i , int j, double value){
         return;
     }
     error = MATRIX_OK;
-    mat->data[i-1][j-1] = value;
+    MATRIX_AT(mat, i-1, j-1) = value;
 }
\ No newline at end of file
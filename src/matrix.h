@@ -12,9 +12,30 @@
 #ifndef MAT_FUN
 #define MAT_FUN
 
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // get the number of elements in C array
 #define ARRAY_LEN(array) (sizeof(array) / sizeof((array)[0]))
 
+// every thread has its own error variable
+#if defined(__cplusplus)
+#define MATRIX_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define MATRIX_THREAD_LOCAL __declspec(thread)
+#else
+#define MATRIX_THREAD_LOCAL _Thread_local
+#endif
+
+// alignment of matrix element storage in bytes (one cache line)
+#define MATRIX_ALIGNMENT 64
+
+// element in the i-th row and j-th column, both indexed from 0
+#define MATRIX_AT(mat, i, j) ((mat)->buffer[(ptrdiff_t)(i) * (mat)->row_stride + (ptrdiff_t)(j) * (mat)->col_stride])
+
 typedef enum
 {
     MATRIX_OK,
@@ -24,34 +45,75 @@ typedef enum
     MATRIX_CLOSING_ERROR,
     MATRIX_TYPE_ERROR,
     MATRIX_OTHER_ERROR,
+    MATRIX_SINGULAR,
     MATRIX_ERROR_COUNT
 } matrix_error;
 
+// storage of a matrix mapped from a file, defined in binary.c
+struct matrix_mapping;
+
 typedef struct
 {
     int rows;
     int cols;
-    double** data;
+    int row_stride;     // leading dimension, distance between rows in elements
+    int col_stride;     // distance between columns in elements, 1 unless the matrix is a view
+    double* buffer;     // contiguous row-major storage aligned to MATRIX_ALIGNMENT
+    double** data;      // row pointers into buffer, NULL for views and with MATRIX_NO_ROW_POINTERS
+    struct matrix_mapping* mapping;     // mapped file holding buffer, NULL for heap storage
+    int is_view;        // buffer belongs to another matrix, destroy_matrix frees only the header
 } matrix;
 
+// parses one element in [p, end) into value, returns the end of it or NULL
+typedef const char* (*matrix_text_parser)(const char* p, const char* end, void* value);
+
 extern const char* const MATRIX_ERROR_STRS[];
-extern matrix_error error;
+extern MATRIX_THREAD_LOCAL matrix_error error;
+extern matrix_error matrix_last_error(void);
 extern const char* matrix_error_str(matrix_error error);
 
+extern void* matrix_aligned_alloc(size_t size);
+extern void matrix_aligned_free(void* ptr);
+extern const char* matrix_parse_number(const char* p, const char* end, double* value);
+extern matrix_error matrix_read_text(const char* filename, char delimiter, size_t size, matrix_text_parser parse,
+                                     void** values, int* rows, int* cols);
+
 extern matrix* initialize_matrix(int rows, int cols);
+extern matrix* matrix_from_buffer(double* buffer, int rows, int cols);
 extern matrix* create_zero_matrix(int rows, int cols);
 extern matrix* create_unit_matrix(int rows, int cols);
 extern void destroy_matrix(matrix* mat);
 extern void print_matrix(matrix* mat);
 extern matrix* add(matrix* mat1, matrix* mat2);
+extern void add_into(matrix* dst, matrix* mat1, matrix* mat2);
+extern void add_inplace(matrix* mat1, matrix* mat2);
 extern matrix* substract(matrix* mat1, matrix* mat2);
-extern matrix* multiply_by_scalar(matrix* mat, float scalar);
+extern void substract_into(matrix* dst, matrix* mat1, matrix* mat2);
+extern void substract_inplace(matrix* mat1, matrix* mat2);
+extern matrix* multiply_by_scalar(matrix* mat, double scalar);
+extern void multiply_by_scalar_into(matrix* dst, matrix* mat, double scalar);
+extern void scale_inplace(matrix* mat, double scalar);
 extern matrix* transpose(matrix* mat);
+extern void transpose_into(matrix* dst, matrix* mat);
+extern void transpose_inplace(matrix* mat);
+extern matrix* transpose_view(matrix* mat);
+extern matrix* materialize(matrix* mat);
+extern void copy_into(matrix* dst, matrix* src);
+extern matrix* matrix_view_block(matrix* mat, int row, int col, int rows, int cols);
+extern matrix* matrix_view_slice(matrix* mat, int row, int col, int rows, int cols, int row_step, int col_step);
+extern matrix* matrix_view_row(matrix* mat, int row);
+extern matrix* matrix_view_col(matrix* mat, int col);
+extern matrix* matrix_view_diag(matrix* mat);
 extern matrix* multiply_by_matrix(matrix* mat1, matrix* mat2);
+extern void multiply_by_matrix_into(matrix* dst, matrix* mat1, matrix* mat2);
 extern matrix* read_from_file(const char* file, const char delimiter);
 extern void save_to_file(matrix* mat, const char* file, const char delimiter);
 extern int get_size(matrix* mat, int dimension);
 extern double get_value(matrix* mat, int i, int j);
 extern void set_value(matrix* mat, int i , int j, double value);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,275 @@
+/*
+    matrix.hpp    version 1.0
+
+    Header-only C++ matrices of sizes fixed at compile time.
+    ------------------------------------
+
+    Matrix<T, R, C> keeps its R * C elements by rows in the object itself,
+    so small matrices live on the stack and in registers, never on the
+    heap. Sizes are template arguments, every operation is unrolled over
+    the elements by index sequences and is constexpr where the C++17
+    standard library allows it. Double and float matrices convert to
+    views of the C matrix and matrix_f32 types to call the C library for
+    larger or dynamic work, and copy from them. Requires C++17.
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_HPP
+#define MAT_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include "matrix.h"
+#include "matrix_f32.h"
+
+namespace mat
+{
+
+namespace detail
+{
+
+// Calls f(std::integral_constant<std::size_t, I>) for I in [0, N), expanded at compile time
+template <std::size_t... I, typename F>
+constexpr void unroll(std::index_sequence<I...>, F&& f) {
+    (f(std::integral_constant<std::size_t, I>{}), ...);
+}
+
+template <std::size_t N, typename F>
+constexpr void unroll(F&& f) {
+    unroll(std::make_index_sequence<N>{}, std::forward<F>(f));
+}
+
+// Sum of f(I) for I in [0, N), expanded at compile time
+template <typename T, std::size_t... I, typename F>
+constexpr T sum(std::index_sequence<I...>, F&& f) {
+    return (T(0) + ... + f(std::integral_constant<std::size_t, I>{}));
+}
+
+// C matrix type viewing elements of type T, void if there is none
+template <typename T>
+struct c_matrix { using type = void; };
+
+template <>
+struct c_matrix<double> { using type = ::matrix; };
+
+template <>
+struct c_matrix<float> { using type = ::matrix_f32; };
+
+}   // namespace detail
+
+template <typename T, int R, int C>
+class Matrix
+{
+    static_assert(R > 0 && C > 0, "matrix dimensions must be positive");
+    static_assert(std::is_arithmetic<T>::value, "matrix elements must be arithmetic");
+
+public:
+    using value_type = T;
+    static constexpr int rows = R;
+    static constexpr int cols = C;
+    static constexpr int size = R * C;
+
+    // elements by rows, public so that a Matrix is an aggregate-like value type
+    T data[R * C];
+
+    // zero matrix
+    constexpr Matrix() : data{} {}
+
+    // elements listed by rows, all R * C of them
+    template <typename... Args, typename = std::enable_if_t<sizeof...(Args) == R * C>>
+    constexpr explicit Matrix(Args... args) : data{ static_cast<T>(args)... } {}
+
+    static constexpr Matrix filled(T value) {
+        Matrix m;
+        detail::unroll<R * C>([&](auto k) { m.data[k] = value; });
+        return m;
+    }
+
+    static constexpr Matrix identity() {
+        static_assert(R == C, "identity matrix must be square");
+        Matrix m;
+        detail::unroll<R>([&](auto i) { m.data[i * C + i] = T(1); });
+        return m;
+    }
+
+    constexpr T& operator()(int i, int j) { return data[i * C + j]; }
+    constexpr const T& operator()(int i, int j) const { return data[i * C + j]; }
+
+    // element of a vector, a matrix with one row or column
+    constexpr T& operator[](int k) {
+        static_assert(R == 1 || C == 1, "single index needs a vector");
+        return data[k];
+    }
+    constexpr const T& operator[](int k) const {
+        static_assert(R == 1 || C == 1, "single index needs a vector");
+        return data[k];
+    }
+
+    constexpr Matrix& operator+=(const Matrix& other) {
+        detail::unroll<R * C>([&](auto k) { data[k] += other.data[k]; });
+        return *this;
+    }
+
+    constexpr Matrix& operator-=(const Matrix& other) {
+        detail::unroll<R * C>([&](auto k) { data[k] -= other.data[k]; });
+        return *this;
+    }
+
+    constexpr Matrix& operator*=(T scalar) {
+        detail::unroll<R * C>([&](auto k) { data[k] *= scalar; });
+        return *this;
+    }
+
+    constexpr Matrix& operator/=(T scalar) {
+        detail::unroll<R * C>([&](auto k) { data[k] /= scalar; });
+        return *this;
+    }
+
+    constexpr Matrix& operator*=(const Matrix& other) {
+        static_assert(R == C, "in-place product needs a square matrix");
+        return *this = *this * other;
+    }
+
+    constexpr Matrix<T, C, R> transpose() const {
+        Matrix<T, C, R> t;
+        detail::unroll<R * C>([&](auto k) { t.data[(k % C) * R + k / C] = data[k]; });
+        return t;
+    }
+
+    constexpr T trace() const {
+        static_assert(R == C, "trace needs a square matrix");
+        return detail::sum<T>(std::make_index_sequence<R>{}, [&](auto i) { return data[i * C + i]; });
+    }
+
+    // sum of element-wise products, the dot product of vectors
+    constexpr T dot(const Matrix& other) const {
+        return detail::sum<T>(std::make_index_sequence<R * C>{}, [&](auto k) { return data[k] * other.data[k]; });
+    }
+
+    // Frobenius norm, the Euclidean norm of vectors
+    T norm() const {
+        return std::sqrt(dot(*this));
+    }
+
+    // view of the elements for the C library, valid while this matrix lives
+    typename detail::c_matrix<T>::type view() {
+        using view_type = typename detail::c_matrix<T>::type;
+        static_assert(!std::is_void<view_type>::value, "only double and float matrices have C views");
+        view_type v{};
+
+        v.rows = R;
+        v.cols = C;
+        v.row_stride = C;
+        v.col_stride = 1;
+        v.buffer = data;
+        v.is_view = 1;
+        return v;
+    }
+
+    // copies a C matrix or view of the same size, sets MATRIX_TYPE_ERROR and keeps this matrix otherwise
+    template <typename M>
+    bool assign(const M* mat) {
+        using view_type = typename detail::c_matrix<T>::type;
+        static_assert(std::is_same<M, view_type>::value, "only C matrices of the same element type can be copied");
+
+        if (!mat)
+        {
+            ::error = MATRIX_INVARGS;
+            return false;
+        }
+        if (mat->rows != R || mat->cols != C)
+        {
+            ::error = MATRIX_TYPE_ERROR;
+            return false;
+        }
+        for (int i = 0; i < R; i++)
+        {
+            for (int j = 0; j < C; j++)
+            {
+                data[i * C + j] = mat->buffer[(std::ptrdiff_t)i * mat->row_stride + (std::ptrdiff_t)j * mat->col_stride];
+            }
+        }
+        ::error = MATRIX_OK;
+        return true;
+    }
+};
+
+template <typename T, int N>
+using Vector = Matrix<T, N, 1>;
+
+using Matrix2d = Matrix<double, 2, 2>;
+using Matrix3d = Matrix<double, 3, 3>;
+using Matrix4d = Matrix<double, 4, 4>;
+using Matrix2f = Matrix<float, 2, 2>;
+using Matrix3f = Matrix<float, 3, 3>;
+using Matrix4f = Matrix<float, 4, 4>;
+using Vector2d = Vector<double, 2>;
+using Vector3d = Vector<double, 3>;
+using Vector4d = Vector<double, 4>;
+using Vector2f = Vector<float, 2>;
+using Vector3f = Vector<float, 3>;
+using Vector4f = Vector<float, 4>;
+
+template <typename T, int R, int C>
+constexpr Matrix<T, R, C> operator+(Matrix<T, R, C> a, const Matrix<T, R, C>& b) {
+    return a += b;
+}
+
+template <typename T, int R, int C>
+constexpr Matrix<T, R, C> operator-(Matrix<T, R, C> a, const Matrix<T, R, C>& b) {
+    return a -= b;
+}
+
+template <typename T, int R, int C>
+constexpr Matrix<T, R, C> operator-(Matrix<T, R, C> a) {
+    return a *= T(-1);
+}
+
+template <typename T, int R, int C>
+constexpr Matrix<T, R, C> operator*(Matrix<T, R, C> a, T scalar) {
+    return a *= scalar;
+}
+
+template <typename T, int R, int C>
+constexpr Matrix<T, R, C> operator*(T scalar, Matrix<T, R, C> a) {
+    return a *= scalar;
+}
+
+template <typename T, int R, int C>
+constexpr Matrix<T, R, C> operator/(Matrix<T, R, C> a, T scalar) {
+    return a /= scalar;
+}
+
+template <typename T, int R, int K, int C>
+constexpr Matrix<T, R, C> operator*(const Matrix<T, R, K>& a, const Matrix<T, K, C>& b) {
+    /*  Every element of the product is a sum over K, all of them unrolled,
+        so the compiler sees the whole product as straight-line code. */
+    Matrix<T, R, C> c;
+
+    detail::unroll<R * C>([&](auto e) {
+        constexpr std::size_t i = e / C, j = e % C;
+        c.data[e] = detail::sum<T>(std::make_index_sequence<K>{}, [&](auto p) { return a.data[i * K + p] * b.data[p * C + j]; });
+    });
+    return c;
+}
+
+template <typename T, int R, int C>
+constexpr bool operator==(const Matrix<T, R, C>& a, const Matrix<T, R, C>& b) {
+    bool equal = true;
+
+    detail::unroll<R * C>([&](auto k) { equal = equal && a.data[k] == b.data[k]; });
+    return equal;
+}
+
+template <typename T, int R, int C>
+constexpr bool operator!=(const Matrix<T, R, C>& a, const Matrix<T, R, C>& b) {
+    return !(a == b);
+}
+
+}   // namespace mat
+
+#endif
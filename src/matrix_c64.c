@@ -0,0 +1,83 @@
+/*
+    matrix_c64.c    version 1.0
+
+    Module for matrices of complex double elements.
+    --------------------------
+
+    The operations of matrix_template.h compiled for matrix_complex, e.g.
+    for signal matrices. Elements are written as "re+imi", e.g. "1.5-2i".
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <complex.h>
+#include "matrix_types.h"
+#include "binary.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+
+static matrix_complex multiply_c64(matrix_complex a, matrix_complex b) {
+    /*  Textbook complex product. The C operator recovers infinities from
+        NaN results through a library call, which keeps loops from vectorizing. */
+
+    return CMPLX(creal(a) * creal(b) - cimag(a) * cimag(b), creal(a) * cimag(b) + cimag(a) * creal(b));
+}
+
+
+static const char* parse_c64(const char* p, matrix_complex* value) {
+    /* Parses "re", "imi" or "re+imi", returns the end of it or NULL. */
+    char* end;
+    double re, im = 0.0;
+
+    re = strtod(p, &end);
+    if (end == p)
+    {
+        return NULL;
+    }
+
+    if (*end == 'i')
+    {
+        *value = CMPLX(0.0, re);
+        return end + 1;
+    }
+
+    if (*end == '+' || *end == '-')
+    {
+        p = end;
+        im = strtod(p, &end);
+        if (end == p || *end != 'i')
+        {
+            return NULL;
+        }
+        end++;
+    }
+
+    *value = CMPLX(re, im);
+    return end;
+}
+
+
+#define TYPED_T matrix_complex
+#define TYPED_MATRIX matrix_c64
+#define TYPED_FN(name) name##_c64
+#define TYPED_FROM_BUFFER matrix_c64_from_buffer
+#define TYPED_ONE 1.0
+#define TYPED_MUL(a, b) multiply_c64(a, b)
+#define TYPED_PARSE(p, value) parse_c64(p, value)
+#define TYPED_PRINT(f, value) fprintf(f, "%lf%+lfi", creal(value), cimag(value))
+
+#include "matrix_template.h"
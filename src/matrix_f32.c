@@ -0,0 +1,394 @@
+/*
+    matrix_f32.c    version 1.0
+
+    Module for matrices of float32 elements.
+    --------------------------
+
+    The operations of matrix_real_template.h compiled for matrix_f32.
+    Elements take half the memory of double and the SIMD kernels process
+    twice as many of them per instruction. Conversions to and from matrix
+    are vectorized.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "matrix_f32.h"
+#include "gemm.h"
+#include "simd.h"
+#include "binary.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+
+matrix_f32* matrix_f32_from_buffer(float* buffer, int rows, int cols){
+    /*  Creates a matrix owning an already filled row-major buffer
+        allocated with matrix_aligned_alloc. */
+    matrix_f32* mat;
+
+    if (buffer == NULL || rows <= 0 || cols <= 0)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat = malloc(sizeof(matrix_f32));
+
+    if (!mat) {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->row_stride = cols;
+    mat->col_stride = 1;
+    mat->buffer = buffer;
+    mat->mapping = NULL;
+    mat->is_view = 0;
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+matrix_f32* initialize_matrix_f32(int rows, int cols){
+    /* Creates a matrix of size m * n with uninitialized elements. */
+
+    matrix_f32* mat;
+    float* buffer;
+
+    if (rows <= 0 || cols <= 0)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if ((size_t)rows > SIZE_MAX / sizeof(float) / (size_t)cols)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Matrix too large");
+        return NULL;
+    }
+
+    buffer = matrix_aligned_alloc((size_t)rows * cols * sizeof(float));
+
+    if (buffer == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    mat = matrix_f32_from_buffer(buffer, rows, cols);
+
+    if (mat == NULL)
+    {
+        matrix_aligned_free(buffer);
+    }
+
+    return mat;
+}
+
+
+matrix_f32* create_zero_matrix_f32(int rows, int cols){
+    /* Creates a zero matrix of size m * n. */
+
+    matrix_f32* mat = initialize_matrix_f32(rows, cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    memset(mat->buffer, 0, (size_t)rows * cols * sizeof(float));
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+matrix_f32* create_unit_matrix_f32(int rows, int cols){
+    /* Creates a unit matrix of size m * n. */
+
+    int i;
+    matrix_f32* mat = create_zero_matrix_f32(rows, cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < rows && i < cols; i++)
+    {
+        MATRIX_AT(mat, i, i) = 1.0f;
+    }
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+void destroy_matrix_f32(matrix_f32* mat){
+    /* Frees memory allocated for matrix mat. */
+
+    if (!mat) {
+        return;
+    }
+
+    if (!mat->is_view)
+    {
+        if (mat->mapping)
+        {
+            matrix_unmap(mat->mapping);
+        }else{
+            matrix_aligned_free(mat->buffer);
+        }
+    }
+    free(mat);
+}
+
+
+void print_matrix_f32(matrix_f32* mat){
+    /* Prints out matrix in a formatted style. */
+    int i, j;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        for (j = 0; j < mat->cols; j++)
+        {
+            printf("%f ", MATRIX_AT(mat, i, j));
+        }
+        printf("\n");
+    }
+}
+
+
+matrix_f32* matrix_to_f32(matrix* mat){
+    /* Returns a float32 copy of matrix mat, values are rounded to nearest. */
+
+    const simd_kernels_f32* k = simd_get_kernels_f32();
+    matrix_f32* mat2;
+    int i, j;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = initialize_matrix_f32(mat->rows, mat->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        if (mat->col_stride == 1)
+        {
+            k->from_f64(mat->cols, &MATRIX_AT(mat, i, 0), &MATRIX_AT(mat2, i, 0));
+            continue;
+        }
+        for (j = 0; j < mat->cols; j++)
+        {
+            MATRIX_AT(mat2, i, j) = (float)MATRIX_AT(mat, i, j);
+        }
+    }
+
+    error = MATRIX_OK;
+    return mat2;
+}
+
+
+matrix* matrix_f32_to_f64(matrix_f32* mat){
+    /* Returns a double copy of matrix mat, the conversion is exact. */
+
+    const simd_kernels_f32* k = simd_get_kernels_f32();
+    matrix* mat2;
+    int i, j;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = initialize_matrix(mat->rows, mat->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        if (mat->col_stride == 1)
+        {
+            k->to_f64(mat->cols, &MATRIX_AT(mat, i, 0), &MATRIX_AT(mat2, i, 0));
+            continue;
+        }
+        for (j = 0; j < mat->cols; j++)
+        {
+            MATRIX_AT(mat2, i, j) = MATRIX_AT(mat, i, j);
+        }
+    }
+
+    error = MATRIX_OK;
+    return mat2;
+}
+
+
+// Operations shared with matrix.c
+#define REAL_T float
+#define REAL_MATRIX matrix_f32
+#define REAL_FN(name) name##_f32
+#define REAL_KERNELS simd_kernels_f32
+#define REAL_GET_KERNELS simd_get_kernels_f32
+#define REAL_INITIALIZE initialize_matrix_f32
+#define REAL_DESTROY destroy_matrix_f32
+#define REAL_GEMM gemm_f32
+
+#include "matrix_real_template.h"
+
+
+static const char* parse_float(const char* p, const char* end, void* value) {
+    /* Parses an element of a float32 matrix in double precision and rounds it once. */
+    double number;
+
+    p = matrix_parse_number(p, end, &number);
+    if (p != NULL)
+    {
+        *(float*)value = (float)number;
+    }
+
+    return p;
+}
+
+
+matrix_f32* read_from_file_f32(const char* filename, const char delimiter){
+    /*  Creates a new matrix by reading a text file in the format of read_from_file.
+        The elements are parsed straight into float32 storage. */
+
+    matrix_f32* mat;
+    matrix_error status;
+    void* values;
+    int rows, cols;
+
+    if (filename == NULL || delimiter == '\n' || delimiter == '\r' || delimiter == '\0'){
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if ((status = matrix_read_text(filename, delimiter, sizeof(float), parse_float, &values, &rows, &cols)) != MATRIX_OK)
+    {
+        error = status;
+        LOG_ERROR("Failed reading matrix from file");
+        return NULL;
+    }
+
+    mat = matrix_f32_from_buffer(values, rows, cols);
+    if (mat == NULL)
+    {
+        matrix_aligned_free(values);
+        return NULL;
+    }
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+void save_to_file_f32(matrix_f32* mat, const char* filename, const char delimiter){
+    /* Saves matrix to a text file in the format of save_to_file. */
+
+    FILE *f;
+    int i, j;
+
+    if (mat == NULL || filename == NULL){
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if ((f = fopen(filename, "w")) == NULL)
+    {
+        error = MATRIX_OPENING_ERROR;
+        LOG_ERROR("Failed opening file");
+        return;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        for (j = 0; j < mat->cols; j++)
+        {
+            if (j > 0)
+            {
+                fputc(delimiter, f);
+            }
+
+            fprintf(f, "%f", MATRIX_AT(mat, i, j));
+        }
+        fprintf(f, "\n");
+    }
+
+    if (fclose(f) == EOF)
+    {
+        error = MATRIX_CLOSING_ERROR;
+        LOG_ERROR("Failed closing file");
+        return;
+    }
+
+    error = MATRIX_OK;
+}
+
+
+float get_value_f32(matrix_f32* mat, int i, int j){
+    /* Returns the value of the element from the matrix in the i-th row and j-th column. */
+
+    if (!mat || i > mat->rows || j > mat->cols || i < 1 || j < 1)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return 0;
+    }
+
+    error = MATRIX_OK;
+    return MATRIX_AT(mat, i-1, j-1);
+}
+
+
+void set_value_f32(matrix_f32* mat, int i, int j, float value){
+    /* Set the value of a matrix element in the i-th row and j-th column. */
+
+    if (!mat || i > mat->rows || j > mat->cols || i < 1 || j < 1)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    error = MATRIX_OK;
+    MATRIX_AT(mat, i-1, j-1) = value;
+}
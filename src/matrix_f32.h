@@ -0,0 +1,72 @@
+/*
+    matrix_f32.h    version 1.0
+
+    Header file for matrix_f32.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_F32
+#define MAT_F32
+
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Matrix of float32 elements, laid out like matrix but without row pointers
+typedef struct
+{
+    int rows;
+    int cols;
+    int row_stride;     // leading dimension, distance between rows in elements
+    int col_stride;     // distance between columns in elements, 1 unless the matrix is a view
+    float* buffer;      // contiguous row-major storage aligned to MATRIX_ALIGNMENT
+    struct matrix_mapping* mapping;     // mapped file holding buffer, NULL for heap storage
+    int is_view;        // buffer belongs to another matrix, destroy_matrix_f32 frees only the header
+} matrix_f32;
+
+extern matrix_f32* initialize_matrix_f32(int rows, int cols);
+extern matrix_f32* matrix_f32_from_buffer(float* buffer, int rows, int cols);
+extern matrix_f32* create_zero_matrix_f32(int rows, int cols);
+extern matrix_f32* create_unit_matrix_f32(int rows, int cols);
+extern void destroy_matrix_f32(matrix_f32* mat);
+extern void print_matrix_f32(matrix_f32* mat);
+extern matrix_f32* matrix_to_f32(matrix* mat);
+extern matrix* matrix_f32_to_f64(matrix_f32* mat);
+extern matrix_f32* add_f32(matrix_f32* mat1, matrix_f32* mat2);
+extern void add_into_f32(matrix_f32* dst, matrix_f32* mat1, matrix_f32* mat2);
+extern void add_inplace_f32(matrix_f32* mat1, matrix_f32* mat2);
+extern matrix_f32* substract_f32(matrix_f32* mat1, matrix_f32* mat2);
+extern void substract_into_f32(matrix_f32* dst, matrix_f32* mat1, matrix_f32* mat2);
+extern void substract_inplace_f32(matrix_f32* mat1, matrix_f32* mat2);
+extern matrix_f32* multiply_by_scalar_f32(matrix_f32* mat, float scalar);
+extern void multiply_by_scalar_into_f32(matrix_f32* dst, matrix_f32* mat, float scalar);
+extern void scale_inplace_f32(matrix_f32* mat, float scalar);
+extern matrix_f32* transpose_f32(matrix_f32* mat);
+extern void transpose_into_f32(matrix_f32* dst, matrix_f32* mat);
+extern matrix_f32* transpose_view_f32(matrix_f32* mat);
+extern void transpose_inplace_f32(matrix_f32* mat);
+extern matrix_f32* matrix_view_block_f32(matrix_f32* mat, int row, int col, int rows, int cols);
+extern matrix_f32* matrix_view_slice_f32(matrix_f32* mat, int row, int col, int rows, int cols, int row_step, int col_step);
+extern matrix_f32* matrix_view_row_f32(matrix_f32* mat, int row);
+extern matrix_f32* matrix_view_col_f32(matrix_f32* mat, int col);
+extern matrix_f32* matrix_view_diag_f32(matrix_f32* mat);
+extern matrix_f32* materialize_f32(matrix_f32* mat);
+extern void copy_into_f32(matrix_f32* dst, matrix_f32* src);
+extern matrix_f32* multiply_by_matrix_f32(matrix_f32* mat1, matrix_f32* mat2);
+extern void multiply_by_matrix_into_f32(matrix_f32* dst, matrix_f32* mat1, matrix_f32* mat2);
+extern matrix_f32* read_from_file_f32(const char* file, const char delimiter);
+extern void save_to_file_f32(matrix_f32* mat, const char* file, const char delimiter);
+extern float get_value_f32(matrix_f32* mat, int i, int j);
+extern void set_value_f32(matrix_f32* mat, int i, int j, float value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,60 @@
+/*
+    matrix_i64.c    version 1.0
+
+    Module for matrices of int64 elements.
+    --------------------------
+
+    The operations of matrix_template.h compiled for int64_t, e.g. for
+    count matrices. Results must fit the type as in C integer arithmetic.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+#include "matrix_types.h"
+#include "binary.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+
+static const char* parse_i64(const char* p, int64_t* value) {
+    /* Parses a decimal integer, returns the end of it or NULL. */
+    char* end;
+    long long parsed;
+
+    errno = 0;
+    parsed = strtoll(p, &end, 10);
+    if (end == p || errno == ERANGE || parsed < INT64_MIN || parsed > INT64_MAX)
+    {
+        return NULL;
+    }
+
+    *value = (int64_t)parsed;
+    return end;
+}
+
+
+#define TYPED_T int64_t
+#define TYPED_MATRIX matrix_i64
+#define TYPED_FN(name) name##_i64
+#define TYPED_FROM_BUFFER matrix_i64_from_buffer
+#define TYPED_ONE 1
+#define TYPED_MUL(a, b) ((a) * (b))
+#define TYPED_PARSE(p, value) parse_i64(p, value)
+#define TYPED_PRINT(f, value) fprintf(f, "%" PRId64, value)
+
+#include "matrix_template.h"
@@ -0,0 +1,817 @@
+/*
+    matrix_real_template.h    version 1.0
+
+    Operations shared by the floating point matrix types.
+    --------------------------
+
+    Included by matrix.c and matrix_f32.c after defining:
+        REAL_T              element type
+        REAL_MATRIX         matrix type holding REAL_T elements
+        REAL_FN(name)       name of a public function for the type
+        REAL_KERNELS        kernel table type from simd.h
+        REAL_GET_KERNELS    function returning the active kernel table
+        REAL_INITIALIZE, REAL_DESTROY
+                            initialize_matrix and destroy_matrix of REAL_MATRIX
+        REAL_GEMM           gemm of REAL_MATRIX
+        REAL_ROW_POINTERS   defined when REAL_MATRIX has row pointers in data
+
+    Creation, conversions and text files stay in the including modules,
+    whose element formats differ.
+
+    Jakub Novák     March 2024
+
+*/
+
+#define VIEW_MATRIX REAL_MATRIX
+#ifndef REAL_ROW_POINTERS
+#define VIEW_NO_ROW_POINTERS
+#endif
+#include "matrix_view.h"
+
+// transpose_inplace rebuilds the row pointers unless the build leaves them out
+#if defined(REAL_ROW_POINTERS) && !defined(MATRIX_NO_ROW_POINTERS)
+#define REAL_REBUILD_ROW_POINTERS
+#endif
+
+// Blocks at most this wide are transposed tile by tile, larger ones are split
+#define TRANSPOSE_LEAF 32
+
+
+static void transpose_leaf(const REAL_KERNELS* k, const REAL_T* src, ptrdiff_t rs_src,
+                           REAL_T* dst, ptrdiff_t rs_dst, int rows, int cols) {
+    /* Transposes a small block with the tile kernel, edges element by element. */
+    int t = k->transpose_tile;
+    int full_rows = rows - rows % t, full_cols = cols - cols % t;
+    int i, j;
+
+    for (i = 0; i < full_rows; i += t)
+    {
+        for (j = 0; j < full_cols; j += t)
+        {
+            k->transpose(src + i * rs_src + j, rs_src, dst + j * rs_dst + i, rs_dst);
+        }
+        for (j = full_cols; j < cols; j++)
+        {
+            int ii;
+            for (ii = i; ii < i + t; ii++)
+            {
+                dst[j * rs_dst + ii] = src[ii * rs_src + j];
+            }
+        }
+    }
+
+    for (i = full_rows; i < rows; i++)
+    {
+        for (j = 0; j < cols; j++)
+        {
+            dst[j * rs_dst + i] = src[i * rs_src + j];
+        }
+    }
+}
+
+
+static void transpose_block(const REAL_KERNELS* k, const REAL_T* src, ptrdiff_t rs_src,
+                            REAL_T* dst, ptrdiff_t rs_dst, int rows, int cols) {
+    /*  Cache-oblivious transposition: the longer side is halved until the
+        block fits the cache at every level, splits stay on tile boundaries. */
+    int half;
+
+    while (rows > TRANSPOSE_LEAF || cols > TRANSPOSE_LEAF)
+    {
+        if (rows >= cols)
+        {
+            half = rows / 2 / k->transpose_tile * k->transpose_tile;
+            transpose_block(k, src, rs_src, dst, rs_dst, half, cols);
+            src += half * rs_src;
+            dst += half;
+            rows -= half;
+        }else{
+            half = cols / 2 / k->transpose_tile * k->transpose_tile;
+            transpose_block(k, src, rs_src, dst, rs_dst, rows, half);
+            src += half;
+            dst += half * rs_dst;
+            cols -= half;
+        }
+    }
+
+    transpose_leaf(k, src, rs_src, dst, rs_dst, rows, cols);
+}
+
+
+static void transpose_square_inplace(const REAL_KERNELS* k, REAL_T* a, ptrdiff_t rs, int n) {
+    /*  Swaps mirrored TRANSPOSE_LEAF blocks through two transposed copies
+        small enough to stay in L1, diagonal blocks go through one copy. */
+    REAL_T upper[TRANSPOSE_LEAF * TRANSPOSE_LEAF];
+    REAL_T lower[TRANSPOSE_LEAF * TRANSPOSE_LEAF];
+    int bi, bj, i, rows, cols;
+
+    for (bi = 0; bi < n; bi += TRANSPOSE_LEAF)
+    {
+        rows = n - bi < TRANSPOSE_LEAF ? n - bi : TRANSPOSE_LEAF;
+
+        transpose_leaf(k, a + bi * rs + bi, rs, upper, TRANSPOSE_LEAF, rows, rows);
+        for (i = 0; i < rows; i++)
+        {
+            memcpy(a + (bi + i) * rs + bi, upper + i * TRANSPOSE_LEAF, rows * sizeof(REAL_T));
+        }
+
+        for (bj = bi + TRANSPOSE_LEAF; bj < n; bj += TRANSPOSE_LEAF)
+        {
+            cols = n - bj < TRANSPOSE_LEAF ? n - bj : TRANSPOSE_LEAF;
+
+            transpose_leaf(k, a + bi * rs + bj, rs, upper, TRANSPOSE_LEAF, rows, cols);
+            transpose_leaf(k, a + bj * rs + bi, rs, lower, TRANSPOSE_LEAF, cols, rows);
+            for (i = 0; i < cols; i++)
+            {
+                memcpy(a + (bj + i) * rs + bi, upper + i * TRANSPOSE_LEAF, rows * sizeof(REAL_T));
+            }
+            for (i = 0; i < rows; i++)
+            {
+                memcpy(a + (bi + i) * rs + bj, lower + i * TRANSPOSE_LEAF, cols * sizeof(REAL_T));
+            }
+        }
+    }
+}
+
+
+static matrix_error transpose_cycles(REAL_T* a, int rows, int cols) {
+    /*  Transposes a contiguous rows x cols array in place by following the
+        cycles of the permutation k -> k * rows mod (rows * cols - 1).
+        Visited positions are kept in a bitmap of rows * cols bits. */
+    size_t total = (size_t)rows * cols, last = total - 1;
+    size_t start, k, src;
+    unsigned char* visited;
+    REAL_T value;
+
+    if (total < 3)
+    {
+        return MATRIX_OK;
+    }
+
+    // k * cols must not overflow while following a cycle
+    if (last > SIZE_MAX / (size_t)cols)
+    {
+        return MATRIX_INVARGS;
+    }
+
+    if ((visited = calloc(total / CHAR_BIT + 1, 1)) == NULL)
+    {
+        return MATRIX_NOMEM;
+    }
+
+    for (start = 1; start < last; start++)
+    {
+        if (visited[start / CHAR_BIT] & (1u << start % CHAR_BIT))
+        {
+            continue;
+        }
+
+        // Position k of the transposition takes the element from position k * cols mod last
+        value = a[start];
+        k = start;
+        for (;;)
+        {
+            visited[k / CHAR_BIT] |= (unsigned char)(1u << k % CHAR_BIT);
+            src = k * cols % last;
+            if (src == start)
+            {
+                a[k] = value;
+                break;
+            }
+            a[k] = a[src];
+            k = src;
+        }
+    }
+
+    free(visited);
+    return MATRIX_OK;
+}
+
+
+static REAL_MATRIX scratch_tile(REAL_T* tile, int rows, int cols) {
+    /* Describes a row-major TRANSPOSE_LEAF wide scratch tile as a matrix. */
+    REAL_MATRIX mat;
+
+    mat.rows = rows;
+    mat.cols = cols;
+    mat.row_stride = TRANSPOSE_LEAF;
+    mat.col_stride = 1;
+    mat.buffer = tile;
+#ifdef REAL_ROW_POINTERS
+    mat.data = NULL;
+#endif
+    mat.mapping = NULL;
+    mat.is_view = 1;
+
+    return mat;
+}
+
+
+static void copy_block(const REAL_KERNELS* k, const REAL_MATRIX* dst, const REAL_MATRIX* src) {
+    /*  Copies src to dst of the same shape. Row and column ordered storage
+        is copied by rows or columns, mixed orders by the tiled transposition. */
+    int i, j;
+
+    if (dst->col_stride == 1 && src->col_stride == 1)
+    {
+        for (i = 0; i < src->rows; i++)
+        {
+            memcpy(&MATRIX_AT(dst, i, 0), &MATRIX_AT(src, i, 0), src->cols * sizeof(REAL_T));
+        }
+    }else if (dst->col_stride == 1 && src->row_stride == 1){
+        transpose_block(k, src->buffer, src->col_stride, dst->buffer, dst->row_stride, src->cols, src->rows);
+    }else if (dst->row_stride == 1 && src->col_stride == 1){
+        transpose_block(k, src->buffer, src->row_stride, dst->buffer, dst->col_stride, src->rows, src->cols);
+    }else if (dst->row_stride == 1 && src->row_stride == 1){
+        for (j = 0; j < src->cols; j++)
+        {
+            memcpy(&MATRIX_AT(dst, 0, j), &MATRIX_AT(src, 0, j), src->rows * sizeof(REAL_T));
+        }
+    }else{
+        for (i = 0; i < src->rows; i++)
+        {
+            for (j = 0; j < src->cols; j++)
+            {
+                MATRIX_AT(dst, i, j) = MATRIX_AT(src, i, j);
+            }
+        }
+    }
+}
+
+
+// Row operation of map_rows: c = a + b, c = a - b or c = scalar * a
+typedef struct
+{
+    void (*binary)(int n, const REAL_T* a, const REAL_T* b, REAL_T* c);
+    void (*scale)(int n, const REAL_T* a, REAL_T scalar, REAL_T* c);
+    REAL_T scalar;
+} row_op;
+
+
+static void apply_row(const row_op* op, int n, const REAL_T* a, const REAL_T* b, REAL_T* c) {
+    if (op->binary)
+    {
+        op->binary(n, a, b, c);
+    }else{
+        op->scale(n, a, op->scalar, c);
+    }
+}
+
+
+static void map_rows(const row_op* op, REAL_MATRIX* dst, REAL_MATRIX* mat1, REAL_MATRIX* mat2) {
+    /*  Applies a row operation to matrices of the same shape in the order
+        of their storage. When the orders differ, the matrices are processed
+        by tiles and the ones stored by columns go through row-major copies. */
+    const REAL_KERNELS* k = REAL_GET_KERNELS();
+    REAL_T tiles[3][TRANSPOSE_LEAF * TRANSPOSE_LEAF];
+    REAL_MATRIX* mats[3] = { mat1, mat2, dst };
+    int i, j, t, bi, bj;
+
+    if (dst->col_stride == 1 && mat1->col_stride == 1 && mat2->col_stride == 1)
+    {
+        for (i = 0; i < dst->rows; i++)
+        {
+            apply_row(op, dst->cols, &MATRIX_AT(mat1, i, 0), &MATRIX_AT(mat2, i, 0), &MATRIX_AT(dst, i, 0));
+        }
+        return;
+    }
+
+    if (dst->row_stride == 1 && mat1->row_stride == 1 && mat2->row_stride == 1)
+    {
+        for (j = 0; j < dst->cols; j++)
+        {
+            apply_row(op, dst->rows, &MATRIX_AT(mat1, 0, j), &MATRIX_AT(mat2, 0, j), &MATRIX_AT(dst, 0, j));
+        }
+        return;
+    }
+
+    for (bi = 0; bi < dst->rows; bi += TRANSPOSE_LEAF)
+    {
+        int rows = dst->rows - bi < TRANSPOSE_LEAF ? dst->rows - bi : TRANSPOSE_LEAF;
+
+        for (bj = 0; bj < dst->cols; bj += TRANSPOSE_LEAF)
+        {
+            int cols = dst->cols - bj < TRANSPOSE_LEAF ? dst->cols - bj : TRANSPOSE_LEAF;
+            REAL_MATRIX blocks[3], rowwise[3];
+
+            for (t = 0; t < 3; t++)
+            {
+                blocks[t] = sub_block(mats[t], bi, bj, rows, cols);
+                rowwise[t] = blocks[t];
+                if (blocks[t].col_stride != 1)
+                {
+                    rowwise[t] = scratch_tile(tiles[t], rows, cols);
+                    if (t < 2)
+                    {
+                        copy_block(k, &rowwise[t], &blocks[t]);
+                    }
+                }
+            }
+
+            for (i = 0; i < rows; i++)
+            {
+                apply_row(op, cols, &MATRIX_AT(&rowwise[0], i, 0), &MATRIX_AT(&rowwise[1], i, 0),
+                          &MATRIX_AT(&rowwise[2], i, 0));
+            }
+
+            if (blocks[2].col_stride != 1)
+            {
+                copy_block(k, &blocks[2], &rowwise[2]);
+            }
+        }
+    }
+}
+
+
+static void elementwise_into(REAL_MATRIX* dst, REAL_MATRIX* mat1, REAL_MATRIX* mat2,
+                             void (*kernel)(int n, const REAL_T* a, const REAL_T* b, REAL_T* c)) {
+    /*  Applies a row kernel to matrices of the same type, dst may be mat1 or mat2
+        but not a view of them in another order. */
+    row_op op = { kernel, NULL, 0.0 };
+
+    if (!dst || !mat1 || !mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (mat1->rows != mat2->rows || mat1->cols != mat2->cols ||
+        dst->rows != mat1->rows || dst->cols != mat1->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    map_rows(&op, dst, mat1, mat2);
+
+    error = MATRIX_OK;
+}
+
+
+void REAL_FN(add_into)(REAL_MATRIX* dst, REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Stores an addition of matrices mat1 and mat2 to dst. */
+
+    elementwise_into(dst, mat1, mat2, REAL_GET_KERNELS()->add);
+}
+
+
+void REAL_FN(add_inplace)(REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Adds matrix mat2 to matrix mat1. */
+
+    elementwise_into(mat1, mat1, mat2, REAL_GET_KERNELS()->add);
+}
+
+
+REAL_MATRIX* REAL_FN(add)(REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Returns an addition of two matrices mat1 and mat2. */
+
+    REAL_MATRIX* mat3;
+
+    if (!mat1 || !mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat3 = REAL_INITIALIZE(mat1->rows, mat1->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    REAL_FN(add_into)(mat3, mat1, mat2);
+
+    if (error != MATRIX_OK)
+    {
+        REAL_DESTROY(mat3);
+        return NULL;
+    }
+
+    return mat3;
+}
+
+
+void REAL_FN(substract_into)(REAL_MATRIX* dst, REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Stores a substraction of matrices mat1 and mat2 to dst. */
+
+    elementwise_into(dst, mat1, mat2, REAL_GET_KERNELS()->sub);
+}
+
+
+void REAL_FN(substract_inplace)(REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Substracts matrix mat2 from matrix mat1. */
+
+    elementwise_into(mat1, mat1, mat2, REAL_GET_KERNELS()->sub);
+}
+
+
+REAL_MATRIX* REAL_FN(substract)(REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Returns a substraction of matrices mat1 and mat2. */
+
+    REAL_MATRIX* mat3;
+
+    if (!mat1 || !mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat3 = REAL_INITIALIZE(mat1->rows, mat1->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    REAL_FN(substract_into)(mat3, mat1, mat2);
+
+    if (error != MATRIX_OK)
+    {
+        REAL_DESTROY(mat3);
+        return NULL;
+    }
+
+    return mat3;
+}
+
+
+void REAL_FN(multiply_by_scalar_into)(REAL_MATRIX* dst, REAL_MATRIX* mat, REAL_T scalar){
+    /* Stores a matrix mat multiplied by a scalar to dst, dst may be mat. */
+
+    row_op op = { NULL, REAL_GET_KERNELS()->scale, scalar };
+
+    if (!dst || !mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (dst->rows != mat->rows || dst->cols != mat->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    map_rows(&op, dst, mat, mat);
+
+    error = MATRIX_OK;
+}
+
+
+void REAL_FN(scale_inplace)(REAL_MATRIX* mat, REAL_T scalar){
+    /* Multiplies matrix mat by a scalar. */
+
+    REAL_FN(multiply_by_scalar_into)(mat, mat, scalar);
+}
+
+
+REAL_MATRIX* REAL_FN(multiply_by_scalar)(REAL_MATRIX* mat, REAL_T scalar){
+    /* Return a matrix mat multiplied by a scalar. */
+
+    REAL_MATRIX* mat2;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = REAL_INITIALIZE(mat->rows, mat->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    REAL_FN(multiply_by_scalar_into)(mat2, mat, scalar);
+
+    return mat2;
+}
+
+
+void REAL_FN(transpose_into)(REAL_MATRIX* dst, REAL_MATRIX* mat){
+    /* Stores a transposition of matrix mat to dst, dst must not be mat. */
+
+    REAL_MATRIX view;
+
+    if (!dst || !mat || dst == mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (dst->rows != mat->cols || dst->cols != mat->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    view = transposed(mat);
+    copy_block(REAL_GET_KERNELS(), dst, &view);
+
+    error = MATRIX_OK;
+}
+
+
+REAL_MATRIX* REAL_FN(transpose)(REAL_MATRIX* mat){
+    /* Returns a transposition of matrix mat. */
+
+    REAL_MATRIX* mat2;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = REAL_INITIALIZE(mat->cols, mat->rows);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    REAL_FN(transpose_into)(mat2, mat);
+
+    return mat2;
+}
+
+
+static REAL_MATRIX* new_view(const REAL_MATRIX* view) {
+    /* Copies a view description to a new header that REAL_DESTROY frees. */
+    REAL_MATRIX* mat = malloc(sizeof(REAL_MATRIX));
+
+    if (!mat) {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    *mat = *view;
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+REAL_MATRIX* REAL_FN(transpose_view)(REAL_MATRIX* mat){
+    /*  Returns a transposition of matrix mat without copying its elements.
+        The view reads and writes the elements of mat, so it must not be
+        used after mat is destroyed. */
+
+    REAL_MATRIX view;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    view = transposed(mat);
+
+    return new_view(&view);
+}
+
+
+REAL_MATRIX* REAL_FN(matrix_view_slice)(REAL_MATRIX* mat, int row, int col, int rows, int cols, int row_step, int col_step){
+    /*  Returns a view of rows x cols elements of matrix mat starting at (row, col),
+        indexed from 0, taking every row_step-th row and col_step-th column. */
+
+    REAL_MATRIX view;
+
+    if (!mat || row < 0 || col < 0 || rows <= 0 || cols <= 0 || row_step <= 0 || col_step <= 0 ||
+        row + (long long)(rows - 1) * row_step >= mat->rows || col + (long long)(cols - 1) * col_step >= mat->cols)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    view = strided_block(mat, row, col, rows, cols, row_step, col_step);
+
+    return new_view(&view);
+}
+
+
+REAL_MATRIX* REAL_FN(matrix_view_block)(REAL_MATRIX* mat, int row, int col, int rows, int cols){
+    /* Returns a view of the rows x cols block of matrix mat starting at (row, col), indexed from 0. */
+
+    return REAL_FN(matrix_view_slice)(mat, row, col, rows, cols, 1, 1);
+}
+
+
+REAL_MATRIX* REAL_FN(matrix_view_row)(REAL_MATRIX* mat, int row){
+    /* Returns a view of the row of matrix mat indexed from 0 as a 1 x cols matrix. */
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    return REAL_FN(matrix_view_slice)(mat, row, 0, 1, mat->cols, 1, 1);
+}
+
+
+REAL_MATRIX* REAL_FN(matrix_view_col)(REAL_MATRIX* mat, int col){
+    /* Returns a view of the column of matrix mat indexed from 0 as a rows x 1 matrix. */
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    return REAL_FN(matrix_view_slice)(mat, 0, col, mat->rows, 1, 1, 1);
+}
+
+
+REAL_MATRIX* REAL_FN(matrix_view_diag)(REAL_MATRIX* mat){
+    /* Returns a view of the main diagonal of matrix mat as a column of min(rows, cols) elements. */
+
+    REAL_MATRIX view;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    view = sub_block(mat, 0, 0, mat->rows < mat->cols ? mat->rows : mat->cols, 1);
+    view.row_stride = mat->row_stride + mat->col_stride;
+
+    return new_view(&view);
+}
+
+
+void REAL_FN(copy_into)(REAL_MATRIX* dst, REAL_MATRIX* src){
+    /* Copies elements of matrix src to dst of the same type, either may be a view. */
+
+    if (!dst || !src) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (dst->rows != src->rows || dst->cols != src->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    if (dst->buffer != src->buffer || dst->row_stride != src->row_stride || dst->col_stride != src->col_stride)
+    {
+        copy_block(REAL_GET_KERNELS(), dst, src);
+    }
+
+    error = MATRIX_OK;
+}
+
+
+REAL_MATRIX* REAL_FN(materialize)(REAL_MATRIX* mat){
+    /* Returns a new contiguous copy of matrix mat, usually of a view. */
+
+    REAL_MATRIX* mat2;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = REAL_INITIALIZE(mat->rows, mat->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    copy_block(REAL_GET_KERNELS(), mat2, mat);
+
+    return mat2;
+}
+
+
+void REAL_FN(transpose_inplace)(REAL_MATRIX* mat){
+    /*  Transposes matrix mat in its own storage. Square matrices are
+        transposed by blocks, rectangular ones must be contiguous
+        (row_stride equal to cols) and swap their rows and cols. */
+
+    matrix_error status;
+#ifdef REAL_REBUILD_ROW_POINTERS
+    REAL_T** rows_ptr;
+    int i;
+#endif
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    // A square view stored by columns is the transposition of a square block stored by rows
+    if (mat->rows == mat->cols && (mat->col_stride == 1 || mat->row_stride == 1))
+    {
+        transpose_square_inplace(REAL_GET_KERNELS(), mat->buffer,
+                                 mat->col_stride == 1 ? mat->row_stride : mat->col_stride, mat->rows);
+        error = MATRIX_OK;
+        return;
+    }
+
+    // Views share storage with a matrix whose shape would not change, and the
+    // header of a mapped file would no longer describe its elements
+    if (mat->rows == mat->cols || mat->row_stride != mat->cols || mat->col_stride != 1 ||
+        mat->is_view || mat->mapping != NULL)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+#ifdef REAL_REBUILD_ROW_POINTERS
+    // Allocated before the elements move so that a failed allocation leaves the matrix untouched
+    rows_ptr = malloc((size_t)mat->cols * sizeof(REAL_T *));
+    if (rows_ptr == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return;
+    }
+#endif
+
+    if ((status = transpose_cycles(mat->buffer, mat->rows, mat->cols)) != MATRIX_OK)
+    {
+#ifdef REAL_REBUILD_ROW_POINTERS
+        free(rows_ptr);
+#endif
+        error = status;
+        LOG_ERROR("Failed transposing matrix");
+        return;
+    }
+
+    mat->row_stride = mat->rows;
+    mat->rows = mat->cols;
+    mat->cols = mat->row_stride;
+
+#ifdef REAL_REBUILD_ROW_POINTERS
+    for (i = 0; i < mat->rows; i++)
+    {
+        rows_ptr[i] = mat->buffer + (size_t)i * mat->row_stride;
+    }
+    free(mat->data);
+    mat->data = rows_ptr;
+#endif
+
+    error = MATRIX_OK;
+}
+
+
+void REAL_FN(multiply_by_matrix_into)(REAL_MATRIX* dst, REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Stores a multiplication of matrices mat1 and mat2 to dst, dst must not be mat1 or mat2. */
+
+    REAL_GEMM(1.0, mat1, MATRIX_NO_TRANS, mat2, MATRIX_NO_TRANS, 0.0, dst);
+}
+
+
+REAL_MATRIX* REAL_FN(multiply_by_matrix)(REAL_MATRIX* mat1, REAL_MATRIX* mat2){
+    /* Returns a multiplication of two matrices mat1 and mat2. */
+
+    REAL_MATRIX* mat3;
+
+    if (!mat1 || !mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (mat1->cols != mat2->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    mat3 = REAL_INITIALIZE(mat1->rows, mat2->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    REAL_FN(multiply_by_matrix_into)(mat3, mat1, mat2);
+
+    if (error != MATRIX_OK)
+    {
+        REAL_DESTROY(mat3);
+        return NULL;
+    }
+
+    return mat3;
+}
+
+
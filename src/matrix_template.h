@@ -0,0 +1,905 @@
+/*
+    matrix_template.h    version 1.0
+
+    Core matrix operations shared by the element types of matrix_types.h.
+    --------------------------
+
+    Included by matrix_i32.c, matrix_i64.c and matrix_c64.c after defining:
+        TYPED_T             element type
+        TYPED_MATRIX        matrix type holding TYPED_T elements
+        TYPED_FN(name)      name with the suffix of the type
+        TYPED_FROM_BUFFER   name of the matrix_from_buffer of the type
+        TYPED_ONE           unit element
+        TYPED_MUL(a, b)     product of two elements
+        TYPED_PARSE(p, value)
+                            parses an element at p of a zero terminated
+                            string, returns the end of it or NULL
+        TYPED_PRINT(f, value)
+                            writes an element to a stream
+
+    Every operation is compiled for the element type, so the loops carry
+    no per-element dispatch and vectorize where the type allows it.
+
+    Jakub Novák     March 2024
+
+*/
+
+// Side of the blocks the transposition is done by
+#define TYPED_TRANSPOSE_BLOCK 32
+
+// Depth and width of the blocks of B a row block of C is updated with, kept in L2
+#define TYPED_KC 128
+#define TYPED_NC ((1 << 18) / (TYPED_KC * (int)sizeof(TYPED_T)))
+
+// Rows of C computed by one task of multiply_by_matrix_into
+#define TYPED_MB 32
+
+// Products with fewer multiply-adds than this stay in the calling thread
+#define TYPED_PARALLEL (96 * 96 * 96)
+
+// Elements of a row of C updated by one fixed length loop the compiler vectorizes
+#define TYPED_CHUNK 16
+
+// Longest element text TYPED_PARSE is given by read_from_file
+#define TYPED_TEXT_LEN 128
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define TYPED_X86 1
+#else
+#define TYPED_X86 0
+#endif
+
+typedef enum
+{
+    TYPED_ADD,
+    TYPED_SUB,
+    TYPED_SCALE
+} typed_op;
+
+// Product C = A * B of contiguous operands split into row blocks of C
+typedef struct
+{
+    const TYPED_MATRIX* a;
+    const TYPED_MATRIX* b;
+    TYPED_MATRIX* c;
+    void (*axpy)(int n, TYPED_T alpha, const TYPED_T* restrict x, TYPED_T* restrict y);
+} typed_product;
+
+
+TYPED_MATRIX* TYPED_FROM_BUFFER(TYPED_T* buffer, int rows, int cols){
+    /*  Creates a matrix owning an already filled row-major buffer
+        allocated with matrix_aligned_alloc. */
+    TYPED_MATRIX* mat;
+
+    if (buffer == NULL || rows <= 0 || cols <= 0)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat = malloc(sizeof(TYPED_MATRIX));
+
+    if (!mat) {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->row_stride = cols;
+    mat->col_stride = 1;
+    mat->buffer = buffer;
+    mat->mapping = NULL;
+    mat->is_view = 0;
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+TYPED_MATRIX* TYPED_FN(initialize_matrix)(int rows, int cols){
+    /* Creates a matrix of size m * n with uninitialized elements. */
+
+    TYPED_MATRIX* mat;
+    TYPED_T* buffer;
+
+    if (rows <= 0 || cols <= 0)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if ((size_t)rows > SIZE_MAX / sizeof(TYPED_T) / (size_t)cols)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Matrix too large");
+        return NULL;
+    }
+
+    buffer = matrix_aligned_alloc((size_t)rows * cols * sizeof(TYPED_T));
+
+    if (buffer == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    mat = TYPED_FROM_BUFFER(buffer, rows, cols);
+
+    if (mat == NULL)
+    {
+        matrix_aligned_free(buffer);
+    }
+
+    return mat;
+}
+
+
+TYPED_MATRIX* TYPED_FN(create_zero_matrix)(int rows, int cols){
+    /* Creates a zero matrix of size m * n. */
+
+    TYPED_MATRIX* mat = TYPED_FN(initialize_matrix)(rows, cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    // All bits zero is the zero of every element type
+    memset(mat->buffer, 0, (size_t)rows * cols * sizeof(TYPED_T));
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+TYPED_MATRIX* TYPED_FN(create_unit_matrix)(int rows, int cols){
+    /* Creates a unit matrix of size m * n. */
+
+    int i;
+    TYPED_MATRIX* mat = TYPED_FN(create_zero_matrix)(rows, cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    for (i = 0; i < rows && i < cols; i++)
+    {
+        MATRIX_AT(mat, i, i) = TYPED_ONE;
+    }
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+void TYPED_FN(destroy_matrix)(TYPED_MATRIX* mat){
+    /* Frees memory allocated for matrix mat. */
+
+    if (!mat) {
+        return;
+    }
+
+    if (!mat->is_view)
+    {
+        if (mat->mapping)
+        {
+            matrix_unmap(mat->mapping);
+        }else{
+            matrix_aligned_free(mat->buffer);
+        }
+    }
+    free(mat);
+}
+
+
+void TYPED_FN(print_matrix)(TYPED_MATRIX* mat){
+    /* Prints out matrix in a formatted style. */
+    int i, j;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        for (j = 0; j < mat->cols; j++)
+        {
+            TYPED_PRINT(stdout, MATRIX_AT(mat, i, j));
+            putchar(' ');
+        }
+        printf("\n");
+    }
+}
+
+
+static void apply_row(typed_op op, int n, TYPED_T scalar, const TYPED_T* a, ptrdiff_t as,
+                      const TYPED_T* b, ptrdiff_t bs, TYPED_T* c, ptrdiff_t cs) {
+    /*  Applies an operation to n elements of the given strides, the unit
+        stride loops are kept separate so the compiler vectorizes them. */
+    int k;
+
+    switch (op)
+    {
+    case TYPED_ADD:
+        if (as == 1 && bs == 1 && cs == 1)
+        {
+            for (k = 0; k < n; k++) c[k] = a[k] + b[k];
+        }else{
+            for (k = 0; k < n; k++) c[k * cs] = a[k * as] + b[k * bs];
+        }
+        break;
+    case TYPED_SUB:
+        if (as == 1 && bs == 1 && cs == 1)
+        {
+            for (k = 0; k < n; k++) c[k] = a[k] - b[k];
+        }else{
+            for (k = 0; k < n; k++) c[k * cs] = a[k * as] - b[k * bs];
+        }
+        break;
+    case TYPED_SCALE:
+        if (as == 1 && cs == 1)
+        {
+            for (k = 0; k < n; k++) c[k] = TYPED_MUL(scalar, a[k]);
+        }else{
+            for (k = 0; k < n; k++) c[k * cs] = TYPED_MUL(scalar, a[k * as]);
+        }
+        break;
+    }
+}
+
+
+static void map_rows(typed_op op, TYPED_T scalar, TYPED_MATRIX* dst, TYPED_MATRIX* mat1, TYPED_MATRIX* mat2) {
+    /* Applies an operation to matrices of the same shape, by columns when all of them are stored by columns. */
+    int i;
+
+    if (dst->row_stride == 1 && mat1->row_stride == 1 && mat2->row_stride == 1)
+    {
+        for (i = 0; i < dst->cols; i++)
+        {
+            apply_row(op, dst->rows, scalar, &MATRIX_AT(mat1, 0, i), 1, &MATRIX_AT(mat2, 0, i), 1, &MATRIX_AT(dst, 0, i), 1);
+        }
+        return;
+    }
+
+    for (i = 0; i < dst->rows; i++)
+    {
+        apply_row(op, dst->cols, scalar, &MATRIX_AT(mat1, i, 0), mat1->col_stride,
+                  &MATRIX_AT(mat2, i, 0), mat2->col_stride, &MATRIX_AT(dst, i, 0), dst->col_stride);
+    }
+}
+
+
+static void elementwise_into(typed_op op, TYPED_MATRIX* dst, TYPED_MATRIX* mat1, TYPED_MATRIX* mat2) {
+    /*  Applies an operation to matrices of the same type, dst may be mat1 or mat2
+        but not a view of them in another order. */
+
+    if (!dst || !mat1 || !mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (mat1->rows != mat2->rows || mat1->cols != mat2->cols ||
+        dst->rows != mat1->rows || dst->cols != mat1->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    map_rows(op, TYPED_ONE, dst, mat1, mat2);
+
+    error = MATRIX_OK;
+}
+
+
+static TYPED_MATRIX* elementwise(typed_op op, TYPED_MATRIX* mat1, TYPED_MATRIX* mat2) {
+    /* Returns a new matrix with the result of an operation. */
+    TYPED_MATRIX* mat3;
+
+    if (!mat1 || !mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat3 = TYPED_FN(initialize_matrix)(mat1->rows, mat1->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    elementwise_into(op, mat3, mat1, mat2);
+
+    if (error != MATRIX_OK)
+    {
+        TYPED_FN(destroy_matrix)(mat3);
+        return NULL;
+    }
+
+    return mat3;
+}
+
+
+void TYPED_FN(add_into)(TYPED_MATRIX* dst, TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /* Stores an addition of matrices mat1 and mat2 to dst. */
+
+    elementwise_into(TYPED_ADD, dst, mat1, mat2);
+}
+
+
+void TYPED_FN(add_inplace)(TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /* Adds matrix mat2 to matrix mat1. */
+
+    elementwise_into(TYPED_ADD, mat1, mat1, mat2);
+}
+
+
+TYPED_MATRIX* TYPED_FN(add)(TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /* Returns an addition of two matrices mat1 and mat2. */
+
+    return elementwise(TYPED_ADD, mat1, mat2);
+}
+
+
+void TYPED_FN(substract_into)(TYPED_MATRIX* dst, TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /* Stores a substraction of matrices mat1 and mat2 to dst. */
+
+    elementwise_into(TYPED_SUB, dst, mat1, mat2);
+}
+
+
+void TYPED_FN(substract_inplace)(TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /* Substracts matrix mat2 from matrix mat1. */
+
+    elementwise_into(TYPED_SUB, mat1, mat1, mat2);
+}
+
+
+TYPED_MATRIX* TYPED_FN(substract)(TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /* Returns a substraction of two matrices mat1 and mat2. */
+
+    return elementwise(TYPED_SUB, mat1, mat2);
+}
+
+
+void TYPED_FN(multiply_by_scalar_into)(TYPED_MATRIX* dst, TYPED_MATRIX* mat, TYPED_T scalar){
+    /* Stores a matrix mat multiplied by a scalar to dst, dst may be mat. */
+
+    if (!dst || !mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (dst->rows != mat->rows || dst->cols != mat->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    map_rows(TYPED_SCALE, scalar, dst, mat, mat);
+
+    error = MATRIX_OK;
+}
+
+
+void TYPED_FN(scale_inplace)(TYPED_MATRIX* mat, TYPED_T scalar){
+    /* Multiplies matrix mat by a scalar. */
+
+    TYPED_FN(multiply_by_scalar_into)(mat, mat, scalar);
+}
+
+
+TYPED_MATRIX* TYPED_FN(multiply_by_scalar)(TYPED_MATRIX* mat, TYPED_T scalar){
+    /* Returns a matrix mat multiplied by a scalar. */
+
+    TYPED_MATRIX* mat2;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = TYPED_FN(initialize_matrix)(mat->rows, mat->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    TYPED_FN(multiply_by_scalar_into)(mat2, mat, scalar);
+
+    return mat2;
+}
+
+
+static void copy_block(TYPED_MATRIX* dst, const TYPED_MATRIX* src) {
+    /*  Copies src to dst of the same shape. Matching storage is copied by
+        rows, other orders by square blocks that stay in L1. */
+    int bi, bj, i, j;
+
+    if (dst->col_stride == 1 && src->col_stride == 1)
+    {
+        for (i = 0; i < src->rows; i++)
+        {
+            memcpy(&MATRIX_AT(dst, i, 0), &MATRIX_AT(src, i, 0), src->cols * sizeof(TYPED_T));
+        }
+        return;
+    }
+
+    for (bi = 0; bi < src->rows; bi += TYPED_TRANSPOSE_BLOCK)
+    {
+        int i_end = src->rows - bi < TYPED_TRANSPOSE_BLOCK ? src->rows : bi + TYPED_TRANSPOSE_BLOCK;
+
+        for (bj = 0; bj < src->cols; bj += TYPED_TRANSPOSE_BLOCK)
+        {
+            int j_end = src->cols - bj < TYPED_TRANSPOSE_BLOCK ? src->cols : bj + TYPED_TRANSPOSE_BLOCK;
+
+            for (i = bi; i < i_end; i++)
+            {
+                for (j = bj; j < j_end; j++)
+                {
+                    MATRIX_AT(dst, i, j) = MATRIX_AT(src, i, j);
+                }
+            }
+        }
+    }
+}
+
+
+static TYPED_MATRIX transposed(const TYPED_MATRIX* mat) {
+    /* Describes the transposition of mat as a view by swapping its dimensions and strides. */
+    TYPED_MATRIX view = *mat;
+
+    view.rows = mat->cols;
+    view.cols = mat->rows;
+    view.row_stride = mat->col_stride;
+    view.col_stride = mat->cols == 1 || mat->rows == 1 ? 1 : mat->row_stride;
+    view.mapping = NULL;
+    view.is_view = 1;
+
+    return view;
+}
+
+
+void TYPED_FN(copy_into)(TYPED_MATRIX* dst, TYPED_MATRIX* src){
+    /* Copies elements of matrix src to dst of the same type, either may be a view. */
+
+    if (!dst || !src) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (dst->rows != src->rows || dst->cols != src->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    if (dst->buffer != src->buffer || dst->row_stride != src->row_stride || dst->col_stride != src->col_stride)
+    {
+        copy_block(dst, src);
+    }
+
+    error = MATRIX_OK;
+}
+
+
+TYPED_MATRIX* TYPED_FN(materialize)(TYPED_MATRIX* mat){
+    /* Returns a new contiguous copy of matrix mat, usually of a view. */
+
+    TYPED_MATRIX* mat2;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = TYPED_FN(initialize_matrix)(mat->rows, mat->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    copy_block(mat2, mat);
+
+    return mat2;
+}
+
+
+void TYPED_FN(transpose_into)(TYPED_MATRIX* dst, TYPED_MATRIX* mat){
+    /* Stores a transposition of matrix mat to dst, dst must not be mat. */
+
+    TYPED_MATRIX view;
+
+    if (!dst || !mat || dst == mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (dst->rows != mat->cols || dst->cols != mat->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    view = transposed(mat);
+    copy_block(dst, &view);
+
+    error = MATRIX_OK;
+}
+
+
+TYPED_MATRIX* TYPED_FN(transpose)(TYPED_MATRIX* mat){
+    /* Returns a transposition of matrix mat. */
+
+    TYPED_MATRIX* mat2;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    mat2 = TYPED_FN(initialize_matrix)(mat->cols, mat->rows);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    TYPED_FN(transpose_into)(mat2, mat);
+
+    return mat2;
+}
+
+
+TYPED_MATRIX* TYPED_FN(transpose_view)(TYPED_MATRIX* mat){
+    /*  Returns a transposition of matrix mat without copying its elements.
+        The view must not be used after mat is destroyed. */
+
+    TYPED_MATRIX* view;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    view = malloc(sizeof(TYPED_MATRIX));
+
+    if (!view) {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    *view = transposed(mat);
+
+    error = MATRIX_OK;
+    return view;
+}
+
+
+// y += alpha * x, the loops of fixed length are vectorized even at -O2
+#define TYPED_AXPY_BODY \
+    int j = 0, k; \
+    for (; j + TYPED_CHUNK <= n; j += TYPED_CHUNK) \
+    { \
+        for (k = 0; k < TYPED_CHUNK; k++) \
+        { \
+            y[j + k] += TYPED_MUL(alpha, x[j + k]); \
+        } \
+    } \
+    for (; j < n; j++) \
+    { \
+        y[j] += TYPED_MUL(alpha, x[j]); \
+    }
+
+static void axpy_row(int n, TYPED_T alpha, const TYPED_T* restrict x, TYPED_T* restrict y) {
+    TYPED_AXPY_BODY
+}
+
+#if TYPED_X86
+// The same loop compiled for wider vectors, selected by the ISA level of simd.h
+__attribute__((target("avx2,fma")))
+static void axpy_row_avx2(int n, TYPED_T alpha, const TYPED_T* restrict x, TYPED_T* restrict y) {
+    TYPED_AXPY_BODY
+}
+
+__attribute__((target("avx512f")))
+static void axpy_row_avx512(int n, TYPED_T alpha, const TYPED_T* restrict x, TYPED_T* restrict y) {
+    TYPED_AXPY_BODY
+}
+#endif
+
+
+static void product_task(void* ctx, int task, int worker) {
+    /*  Computes TYPED_MB rows of C. A row of C is updated by rows of a
+        TYPED_KC * TYPED_NC block of B, so the inner loop is a unit stride
+        multiply-add. */
+    const typed_product* job = ctx;
+    const TYPED_MATRIX *a = job->a, *b = job->b;
+    TYPED_MATRIX* c = job->c;
+    int i_end = (task + 1) * TYPED_MB < c->rows ? (task + 1) * TYPED_MB : c->rows;
+    int i, p, pc, jc;
+    (void)worker;
+
+    for (i = task * TYPED_MB; i < i_end; i++)
+    {
+        memset(&MATRIX_AT(c, i, 0), 0, c->cols * sizeof(TYPED_T));
+    }
+
+    for (jc = 0; jc < c->cols; jc += TYPED_NC)
+    {
+        int j_end = c->cols - jc < TYPED_NC ? c->cols : jc + TYPED_NC;
+
+        for (pc = 0; pc < a->cols; pc += TYPED_KC)
+        {
+            int p_end = a->cols - pc < TYPED_KC ? a->cols : pc + TYPED_KC;
+
+            for (i = task * TYPED_MB; i < i_end; i++)
+            {
+                for (p = pc; p < p_end; p++)
+                {
+                    job->axpy(j_end - jc, MATRIX_AT(a, i, p), &MATRIX_AT(b, p, jc), &MATRIX_AT(c, i, jc));
+                }
+            }
+        }
+    }
+}
+
+
+void TYPED_FN(multiply_by_matrix_into)(TYPED_MATRIX* dst, TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /*  Stores a multiplication of matrices mat1 and mat2 to dst, dst must not be mat1 or mat2.
+        Operands stored by columns are copied by rows first. */
+
+    TYPED_MATRIX *a = mat1, *b = mat2, *c = dst;
+    typed_product job;
+    int workers;
+
+    if (!dst || !mat1 || !mat2 || dst == mat1 || dst == mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (mat1->cols != mat2->rows || dst->rows != mat1->rows || dst->cols != mat2->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    if ((mat1->col_stride != 1 && (a = TYPED_FN(materialize)(mat1)) == NULL) ||
+        (mat2->col_stride != 1 && (b = TYPED_FN(materialize)(mat2)) == NULL) ||
+        (dst->col_stride != 1 && (c = TYPED_FN(initialize_matrix)(dst->rows, dst->cols)) == NULL))
+    {
+        // error is set by the failed allocation, destroying NULL does nothing
+        if (a != mat1)
+        {
+            TYPED_FN(destroy_matrix)(a);
+        }
+        if (b != mat2)
+        {
+            TYPED_FN(destroy_matrix)(b);
+        }
+        return;
+    }
+
+    job.a = a;
+    job.b = b;
+    job.c = c;
+    job.axpy = axpy_row;
+#if TYPED_X86
+    if (matrix_get_isa() >= MATRIX_ISA_AVX512)
+    {
+        job.axpy = axpy_row_avx512;
+    }else if (matrix_get_isa() >= MATRIX_ISA_AVX2){
+        job.axpy = axpy_row_avx2;
+    }
+#endif
+    workers = (double)c->rows * c->cols * a->cols < TYPED_PARALLEL ? 1 : thread_pool_size();
+    thread_pool_run((c->rows + TYPED_MB - 1) / TYPED_MB, workers, product_task, &job);
+
+    if (c != dst)
+    {
+        copy_block(dst, c);
+        TYPED_FN(destroy_matrix)(c);
+    }
+    if (a != mat1)
+    {
+        TYPED_FN(destroy_matrix)(a);
+    }
+    if (b != mat2)
+    {
+        TYPED_FN(destroy_matrix)(b);
+    }
+
+    error = MATRIX_OK;
+}
+
+
+TYPED_MATRIX* TYPED_FN(multiply_by_matrix)(TYPED_MATRIX* mat1, TYPED_MATRIX* mat2){
+    /* Returns a multiplication of two matrices mat1 and mat2. */
+
+    TYPED_MATRIX* mat3;
+
+    if (!mat1 || !mat2) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (mat1->cols != mat2->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    mat3 = TYPED_FN(initialize_matrix)(mat1->rows, mat2->cols);
+
+    if (error != MATRIX_OK)
+    {
+        return NULL;
+    }
+
+    TYPED_FN(multiply_by_matrix_into)(mat3, mat1, mat2);
+
+    if (error != MATRIX_OK)
+    {
+        TYPED_FN(destroy_matrix)(mat3);
+        return NULL;
+    }
+
+    return mat3;
+}
+
+
+static const char* parse_element(const char* p, const char* end, void* value) {
+    /*  Parses an element in [p, end) of a file chunk, which is not zero
+        terminated, by TYPED_PARSE of a zero terminated copy. */
+    char text[TYPED_TEXT_LEN];
+    size_t len = end - p < TYPED_TEXT_LEN - 1 ? (size_t)(end - p) : TYPED_TEXT_LEN - 1;
+    const char* parsed_end;
+
+    memcpy(text, p, len);
+    text[len] = '\0';
+
+    parsed_end = TYPED_PARSE(text, value);
+    if (parsed_end == NULL || (len == TYPED_TEXT_LEN - 1 && parsed_end == text + len))
+    {
+        return NULL;
+    }
+
+    return p + (parsed_end - text);
+}
+
+
+TYPED_MATRIX* TYPED_FN(read_from_file)(const char* filename, const char delimiter){
+    /*  Reads matrix from a text file.
+        Every row represents a matrix row and elements must be seperated by separator. */
+
+    TYPED_MATRIX* mat;
+    matrix_error status;
+    void* values;
+    int rows, cols;
+
+    if (filename == NULL || delimiter == '\n' || delimiter == '\r' || delimiter == '\0'){
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    status = matrix_read_text(filename, delimiter, sizeof(TYPED_T), parse_element, &values, &rows, &cols);
+
+    if (status != MATRIX_OK)
+    {
+        error = status;
+        LOG_ERROR("Failed reading matrix from file");
+        return NULL;
+    }
+
+    mat = TYPED_FROM_BUFFER(values, rows, cols);
+    if (mat == NULL)
+    {
+        matrix_aligned_free(values);
+        return NULL;
+    }
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+void TYPED_FN(save_to_file)(TYPED_MATRIX* mat, const char* filename, const char delimiter){
+    /* Saves matrix to a text file in the format of save_to_file. */
+
+    FILE *f;
+    int i, j;
+
+    if (mat == NULL || filename == NULL){
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if ((f = fopen(filename, "w")) == NULL)
+    {
+        error = MATRIX_OPENING_ERROR;
+        LOG_ERROR("Failed opening file");
+        return;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        for (j = 0; j < mat->cols; j++)
+        {
+            if (j > 0)
+            {
+                fputc(delimiter, f);
+            }
+
+            TYPED_PRINT(f, MATRIX_AT(mat, i, j));
+        }
+        fprintf(f, "\n");
+    }
+
+    if (fclose(f) == EOF)
+    {
+        error = MATRIX_CLOSING_ERROR;
+        LOG_ERROR("Failed closing file");
+        return;
+    }
+
+    error = MATRIX_OK;
+}
+
+
+TYPED_T TYPED_FN(get_value)(TYPED_MATRIX* mat, int i, int j){
+    /* Returns the value of the element from the matrix in the i-th row and j-th column. */
+
+    if (!mat || i > mat->rows || j > mat->cols || i < 1 || j < 1)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return 0;
+    }
+
+    error = MATRIX_OK;
+    return MATRIX_AT(mat, i-1, j-1);
+}
+
+
+void TYPED_FN(set_value)(TYPED_MATRIX* mat, int i, int j, TYPED_T value){
+    /* Set the value of a matrix element in the i-th row and j-th column. */
+
+    if (!mat || i > mat->rows || j > mat->cols || i < 1 || j < 1)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    error = MATRIX_OK;
+    MATRIX_AT(mat, i-1, j-1) = value;
+}
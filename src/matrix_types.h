@@ -0,0 +1,94 @@
+/*
+    matrix_types.h    version 1.0
+
+    Header file for matrix_i32.c, matrix_i64.c and matrix_c64.c modules.
+    ------------------------------------
+
+    Matrices of int32, int64 and complex double elements. Every type has
+    the core operations of matrix with its own suffix, generated from
+    matrix_template.h, so nothing branches on the element type at run time.
+    The MATRIX_GENERIC macros pick the function by the matrix type.
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_TYPES
+#define MAT_TYPES
+
+#include <stdint.h>
+#include "matrix.h"
+#include "matrix_f32.h"
+
+typedef double _Complex matrix_complex;
+
+// Declares the matrix type MATRIX of T elements and its functions with suffix S
+#define MATRIX_TYPE_DECLARE(T, MATRIX, S) \
+    typedef struct \
+    { \
+        int rows; \
+        int cols; \
+        int row_stride; \
+        int col_stride; \
+        T* buffer; \
+        struct matrix_mapping* mapping; \
+        int is_view; \
+    } MATRIX; \
+    \
+    extern MATRIX* initialize_matrix##S(int rows, int cols); \
+    extern MATRIX* matrix##S##_from_buffer(T* buffer, int rows, int cols); \
+    extern MATRIX* create_zero_matrix##S(int rows, int cols); \
+    extern MATRIX* create_unit_matrix##S(int rows, int cols); \
+    extern void destroy_matrix##S(MATRIX* mat); \
+    extern void print_matrix##S(MATRIX* mat); \
+    extern MATRIX* add##S(MATRIX* mat1, MATRIX* mat2); \
+    extern void add_into##S(MATRIX* dst, MATRIX* mat1, MATRIX* mat2); \
+    extern void add_inplace##S(MATRIX* mat1, MATRIX* mat2); \
+    extern MATRIX* substract##S(MATRIX* mat1, MATRIX* mat2); \
+    extern void substract_into##S(MATRIX* dst, MATRIX* mat1, MATRIX* mat2); \
+    extern void substract_inplace##S(MATRIX* mat1, MATRIX* mat2); \
+    extern MATRIX* multiply_by_scalar##S(MATRIX* mat, T scalar); \
+    extern void multiply_by_scalar_into##S(MATRIX* dst, MATRIX* mat, T scalar); \
+    extern void scale_inplace##S(MATRIX* mat, T scalar); \
+    extern MATRIX* transpose##S(MATRIX* mat); \
+    extern void transpose_into##S(MATRIX* dst, MATRIX* mat); \
+    extern MATRIX* transpose_view##S(MATRIX* mat); \
+    extern MATRIX* materialize##S(MATRIX* mat); \
+    extern void copy_into##S(MATRIX* dst, MATRIX* src); \
+    extern MATRIX* multiply_by_matrix##S(MATRIX* mat1, MATRIX* mat2); \
+    extern void multiply_by_matrix_into##S(MATRIX* dst, MATRIX* mat1, MATRIX* mat2); \
+    extern MATRIX* read_from_file##S(const char* file, const char delimiter); \
+    extern void save_to_file##S(MATRIX* mat, const char* file, const char delimiter); \
+    extern T get_value##S(MATRIX* mat, int i, int j); \
+    extern void set_value##S(MATRIX* mat, int i, int j, T value);
+
+MATRIX_TYPE_DECLARE(int32_t, matrix_i32, _i32)
+MATRIX_TYPE_DECLARE(int64_t, matrix_i64, _i64)
+MATRIX_TYPE_DECLARE(matrix_complex, matrix_c64, _c64)
+
+// Function of the family NAME for the type of matrix mat
+#define MATRIX_GENERIC(NAME, mat) _Generic((mat), \
+    matrix*: NAME, \
+    matrix_f32*: NAME##_f32, \
+    matrix_i32*: NAME##_i32, \
+    matrix_i64*: NAME##_i64, \
+    matrix_c64*: NAME##_c64)
+
+#define matrix_destroy(mat) MATRIX_GENERIC(destroy_matrix, mat)(mat)
+#define matrix_print(mat) MATRIX_GENERIC(print_matrix, mat)(mat)
+#define matrix_add(mat1, mat2) MATRIX_GENERIC(add, mat1)(mat1, mat2)
+#define matrix_add_into(dst, mat1, mat2) MATRIX_GENERIC(add_into, dst)(dst, mat1, mat2)
+#define matrix_substract(mat1, mat2) MATRIX_GENERIC(substract, mat1)(mat1, mat2)
+#define matrix_substract_into(dst, mat1, mat2) MATRIX_GENERIC(substract_into, dst)(dst, mat1, mat2)
+#define matrix_multiply_by_scalar(mat, scalar) MATRIX_GENERIC(multiply_by_scalar, mat)(mat, scalar)
+#define matrix_transpose(mat) MATRIX_GENERIC(transpose, mat)(mat)
+#define matrix_transpose_view(mat) MATRIX_GENERIC(transpose_view, mat)(mat)
+#define matrix_materialize(mat) MATRIX_GENERIC(materialize, mat)(mat)
+#define matrix_copy_into(dst, src) MATRIX_GENERIC(copy_into, dst)(dst, src)
+#define matrix_multiply(mat1, mat2) MATRIX_GENERIC(multiply_by_matrix, mat1)(mat1, mat2)
+#define matrix_multiply_into(dst, mat1, mat2) MATRIX_GENERIC(multiply_by_matrix_into, dst)(dst, mat1, mat2)
+#define matrix_save_to_file(mat, file, delimiter) MATRIX_GENERIC(save_to_file, mat)(mat, file, delimiter)
+#define matrix_get_value(mat, i, j) MATRIX_GENERIC(get_value, mat)(mat, i, j)
+#define matrix_set_value(mat, i, j, value) MATRIX_GENERIC(set_value, mat)(mat, i, j, value)
+
+#endif
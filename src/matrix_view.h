@@ -0,0 +1,83 @@
+/*
+    matrix_view.h    version 1.0
+
+    View descriptions shared by the modules.
+    --------------------------
+
+    Internal header describing blocks and transpositions of a matrix as views
+    held by value, which the modules pass to kernels without allocating headers.
+    Included after optionally defining:
+        VIEW_MATRIX             matrix type, matrix when not defined
+        VIEW_NO_ROW_POINTERS    VIEW_MATRIX has no row pointers
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_VIEW
+#define MAT_VIEW
+
+#include "matrix.h"
+
+#ifndef VIEW_MATRIX
+#define VIEW_MATRIX matrix
+#endif
+
+
+static inline VIEW_MATRIX strided_block(const VIEW_MATRIX* mat, int i, int j, int rows, int cols, int row_step, int col_step) {
+    /*  Describes every row_step-th row and col_step-th column of the rows x cols
+        block of mat starting at (i, j) as a view. */
+    VIEW_MATRIX block = *mat;
+
+    block.rows = rows;
+    block.cols = cols;
+    block.row_stride = mat->row_stride * row_step;
+    block.col_stride = mat->col_stride * col_step;
+    block.buffer = &MATRIX_AT(mat, i, j);
+#ifndef VIEW_NO_ROW_POINTERS
+    block.data = NULL;
+#endif
+    block.mapping = NULL;
+    block.is_view = 1;
+
+    // The column stride of a single column is never used, 1 lets it take the row paths
+    if (block.cols == 1)
+    {
+        block.col_stride = 1;
+    }
+
+    return block;
+}
+
+
+static inline VIEW_MATRIX sub_block(const VIEW_MATRIX* mat, int i, int j, int rows, int cols) {
+    /* Describes the rows x cols block of mat starting at (i, j) as a view. */
+
+    return strided_block(mat, i, j, rows, cols, 1, 1);
+}
+
+
+static inline VIEW_MATRIX transposed(const VIEW_MATRIX* mat) {
+    /* Describes the transposition of mat as a view by swapping its dimensions and strides. */
+    VIEW_MATRIX view = *mat;
+
+    view.rows = mat->cols;
+    view.cols = mat->rows;
+    view.row_stride = mat->col_stride;
+    view.col_stride = mat->row_stride;
+#ifndef VIEW_NO_ROW_POINTERS
+    view.data = NULL;
+#endif
+    view.mapping = NULL;
+    view.is_view = 1;
+
+    // The column stride of a single column is never used, 1 lets it take the row paths
+    if (view.cols == 1)
+    {
+        view.col_stride = 1;
+    }
+
+    return view;
+}
+
+#endif
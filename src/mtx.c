@@ -0,0 +1,829 @@
+/*
+    mtx.c    version 1.0
+
+    Module for the Matrix Market exchange format.
+    --------------------------
+
+    A .mtx file starts with a %%MatrixMarket banner, comment lines and a
+    size line, followed by the elements either as (row, column, value)
+    entries (coordinate) or as all values column by column (array). Real,
+    integer and pattern fields and general, symmetric and skew-symmetric
+    matrices are supported.
+
+    Files are read in large chunks. Every chunk is split at line breaks
+    into pieces parsed on the thread pool: the pieces first count their
+    entries, so each one knows where its entries go, and then parse them
+    straight into the result.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include "mtx.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+// Bytes of a file read at once
+#define MTX_CHUNK (1 << 22)
+
+// Smallest piece of a chunk worth parsing in its own task
+#define MTX_MIN_PIECE (1 << 16)
+
+// Most pieces a chunk is split into
+#define MTX_MAX_TASKS 64
+
+typedef enum
+{
+    MTX_COORDINATE,
+    MTX_ARRAY
+} mtx_format;
+
+typedef enum
+{
+    MTX_REAL,
+    MTX_INTEGER,
+    MTX_PATTERN
+} mtx_field;
+
+typedef enum
+{
+    MTX_GENERAL,
+    MTX_SYMMETRIC,
+    MTX_SKEW_SYMMETRIC
+} mtx_symmetry;
+
+typedef enum
+{
+    MTX_BANNER,
+    MTX_SIZE,
+    MTX_ENTRIES
+} mtx_stage;
+
+// State of a file being read and the storage its entries are parsed into
+typedef struct
+{
+    mtx_format format;
+    mtx_field field;
+    mtx_symmetry symmetry;
+    mtx_stage stage;
+    int rows;
+    int cols;
+    size_t entries;         // entries announced by the size line
+    size_t parsed;          // entries parsed from the previous chunks
+    int want_sparse;
+    sparse_format sparse;
+    matrix* dense;          // result of array files and of dense reads
+    int* outer;             // row (CSC: column) of every coordinate entry
+    int* inner;             // column (CSC: row) of every coordinate entry
+    double* values;         // value of every coordinate entry
+    int tasks;
+    const char* bounds[MTX_MAX_TASKS + 1];      // pieces of the current chunk
+    size_t first[MTX_MAX_TASKS + 1];            // first entry of every piece
+    matrix_error status[MTX_MAX_TASKS];
+} mtx_reader;
+
+
+static const char* skip_blanks(const char* p, const char* end) {
+    /* Skips spaces, tabs and the carriage return of CRLF line breaks. */
+
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    {
+        p++;
+    }
+    return p;
+}
+
+
+static int is_entry_line(const char* p, const char* end) {
+    /* Checks if a line holds an entry, that is it is neither blank nor a comment. */
+
+    p = skip_blanks(p, end);
+    return p < end && *p != '%';
+}
+
+
+static const char* parse_word(const char* p, const char* end, const char* word) {
+    /* Matches a word case-insensitively, returns the end of it or NULL. */
+
+    p = skip_blanks(p, end);
+    for (; *word != '\0'; word++, p++)
+    {
+        if (p == end || tolower((unsigned char)*p) != *word)
+        {
+            return NULL;
+        }
+    }
+    return p == end || *p == ' ' || *p == '\t' || *p == '\r' ? p : NULL;
+}
+
+
+static const char* parse_size(const char* p, const char* end, size_t* value) {
+    /* Parses an unsigned decimal integer, returns the end of it or NULL. */
+    const char* start;
+
+    p = skip_blanks(p, end);
+    start = p;
+    *value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        if (*value > (SIZE_MAX - 9) / 10)
+        {
+            return NULL;
+        }
+        *value = *value * 10 + (size_t)(*p - '0');
+    }
+    return p > start ? p : NULL;
+}
+
+
+static const char* parse_index(const char* p, const char* end, int size, int* index) {
+    /* Parses an index from 1 to size and converts it to an index from 0. */
+    size_t value;
+
+    if ((p = parse_size(p, end, &value)) == NULL || value == 0 || value > (size_t)size)
+    {
+        return NULL;
+    }
+    *index = (int)value - 1;
+    return p;
+}
+
+
+static matrix_error parse_banner(mtx_reader* r, const char* p, const char* end) {
+    /* Parses the %%MatrixMarket matrix <format> <field> <symmetry> line. */
+    const char* q;
+
+    if ((p = parse_word(p, end, "%%matrixmarket")) == NULL || (p = parse_word(p, end, "matrix")) == NULL)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    if ((q = parse_word(p, end, "coordinate")) != NULL)
+    {
+        r->format = MTX_COORDINATE;
+    }else if ((q = parse_word(p, end, "array")) != NULL){
+        r->format = MTX_ARRAY;
+    }else{
+        return MATRIX_TYPE_ERROR;
+    }
+
+    if ((p = parse_word(q, end, "real")) != NULL || (p = parse_word(q, end, "double")) != NULL)
+    {
+        r->field = MTX_REAL;
+    }else if ((p = parse_word(q, end, "integer")) != NULL){
+        r->field = MTX_INTEGER;
+    }else if (r->format == MTX_COORDINATE && (p = parse_word(q, end, "pattern")) != NULL){
+        r->field = MTX_PATTERN;
+    }else{
+        // complex matrices and patterns in array format
+        return MATRIX_TYPE_ERROR;
+    }
+
+    if ((q = parse_word(p, end, "general")) != NULL)
+    {
+        r->symmetry = MTX_GENERAL;
+    }else if ((q = parse_word(p, end, "symmetric")) != NULL){
+        r->symmetry = MTX_SYMMETRIC;
+    }else if ((q = parse_word(p, end, "skew-symmetric")) != NULL){
+        r->symmetry = MTX_SKEW_SYMMETRIC;
+    }else{
+        return MATRIX_TYPE_ERROR;
+    }
+
+    return skip_blanks(q, end) == end ? MATRIX_OK : MATRIX_TYPE_ERROR;
+}
+
+
+static size_t array_entries(const mtx_reader* r) {
+    /* Number of values of an array file, symmetric files store the lower triangle. */
+    size_t n = (size_t)r->rows;
+
+    switch (r->symmetry)
+    {
+    case MTX_SYMMETRIC:
+        return n * (n + 1) / 2;
+    case MTX_SKEW_SYMMETRIC:
+        return n * (n - 1) / 2;
+    default:
+        return n * (size_t)r->cols;
+    }
+}
+
+
+static matrix_error parse_size_line(mtx_reader* r, const char* p, const char* end) {
+    /*  Parses the dimensions (and for coordinate files the number of entries)
+        and allocates the storage the entries are parsed into. */
+    size_t rows, cols, capacity;
+
+    if ((p = parse_size(p, end, &rows)) == NULL || (p = parse_size(p, end, &cols)) == NULL ||
+        rows == 0 || cols == 0 || rows > INT_MAX || cols > INT_MAX)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+    r->rows = (int)rows;
+    r->cols = (int)cols;
+
+    if (r->symmetry != MTX_GENERAL && rows != cols)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    if (r->format == MTX_COORDINATE)
+    {
+        if ((p = parse_size(p, end, &r->entries)) == NULL)
+        {
+            return MATRIX_TYPE_ERROR;
+        }
+    }else{
+        r->entries = array_entries(r);
+    }
+
+    if (skip_blanks(p, end) != end)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    if (!r->want_sparse || r->format == MTX_ARRAY)
+    {
+        if ((r->dense = create_zero_matrix(r->rows, r->cols)) == NULL)
+        {
+            return error;
+        }
+        if (r->format == MTX_ARRAY)
+        {
+            return MATRIX_OK;
+        }
+        // Coordinate entries of dense reads are added up once all are parsed
+        r->sparse = SPARSE_CSR;
+    }
+
+    // Room for the mirrored entries of symmetric sparse reads
+    capacity = r->symmetry == MTX_GENERAL || r->dense ? r->entries : 2 * r->entries;
+    if (r->entries > SIZE_MAX / 2 / sizeof(double) - 1)
+    {
+        return MATRIX_NOMEM;
+    }
+    r->outer = malloc((capacity + 1) * sizeof(int));
+    r->inner = malloc((capacity + 1) * sizeof(int));
+    r->values = malloc((capacity + 1) * sizeof(double));
+
+    return r->outer && r->inner && r->values ? MATRIX_OK : MATRIX_NOMEM;
+}
+
+
+static void array_position(const mtx_reader* r, size_t k, int* i, int* j) {
+    /* Row and column of the k-th value of an array file, values are stored column by column. */
+
+    if (r->symmetry == MTX_GENERAL)
+    {
+        *i = (int)(k % (size_t)r->rows);
+        *j = (int)(k / (size_t)r->rows);
+        return;
+    }
+
+    // Column j holds the rows from j (skew-symmetric: j + 1) down
+    for (*j = 0; ; (*j)++)
+    {
+        size_t len = (size_t)(r->rows - *j) - (r->symmetry == MTX_SKEW_SYMMETRIC);
+
+        if (k < len)
+        {
+            *i = *j + (r->symmetry == MTX_SKEW_SYMMETRIC) + (int)k;
+            return;
+        }
+        k -= len;
+    }
+}
+
+
+static void store_dense(const mtx_reader* r, int i, int j, double value) {
+    /*  Adds an element to a dense result together with its mirror, so that
+        repeated coordinate entries are summed as in the sparse result. */
+
+    MATRIX_AT(r->dense, i, j) += value;
+    if (r->symmetry != MTX_GENERAL && i != j)
+    {
+        MATRIX_AT(r->dense, j, i) += r->symmetry == MTX_SYMMETRIC ? value : -value;
+    }
+}
+
+
+static matrix_error parse_entry(const mtx_reader* r, const char* p, const char* end, size_t k, int* i, int* j) {
+    /*  Parses the k-th entry of the file from one line. For array files i and
+        j hold the position of the value and are advanced to the next one. */
+    double value = 1.0;
+    int row, col;
+
+    if (r->format == MTX_COORDINATE)
+    {
+        if ((p = parse_index(p, end, r->rows, &row)) == NULL || (p = parse_index(p, end, r->cols, &col)) == NULL)
+        {
+            return MATRIX_TYPE_ERROR;
+        }
+    }else{
+        row = *i;
+        col = *j;
+        if (++*i == r->rows)
+        {
+            (*j)++;
+            *i = r->symmetry == MTX_GENERAL ? 0 : *j + (r->symmetry == MTX_SKEW_SYMMETRIC);
+        }
+    }
+
+    if (r->field != MTX_PATTERN && (p = matrix_parse_number(skip_blanks(p, end), end, &value)) == NULL)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+    if (skip_blanks(p, end) != end)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    if (r->format == MTX_ARRAY)
+    {
+        store_dense(r, row, col, value);
+    }else{
+        r->outer[k] = r->sparse == SPARSE_CSR ? row : col;
+        r->inner[k] = r->sparse == SPARSE_CSR ? col : row;
+        r->values[k] = value;
+    }
+
+    return MATRIX_OK;
+}
+
+
+static void count_task(void* ctx, int task, int worker) {
+    /* Counts the entries of a piece of the chunk. */
+    mtx_reader* r = ctx;
+    const char *p = r->bounds[task], *end = r->bounds[task + 1];
+    size_t n = 0;
+    (void)worker;
+
+    while (p < end)
+    {
+        const char* eol = memchr(p, '\n', end - p);
+        const char* line_end = eol ? eol : end;
+
+        n += is_entry_line(p, line_end);
+        p = eol ? eol + 1 : end;
+    }
+
+    r->first[task + 1] = n;
+}
+
+
+static void parse_task(void* ctx, int task, int worker) {
+    /* Parses the entries of a piece of the chunk, starting at the entry counted for it. */
+    mtx_reader* r = ctx;
+    const char *p = r->bounds[task], *end = r->bounds[task + 1];
+    size_t k = r->first[task];
+    int i = 0, j = 0;
+    (void)worker;
+
+    if (r->format == MTX_ARRAY && k < r->first[task + 1])
+    {
+        array_position(r, k, &i, &j);
+    }
+
+    r->status[task] = MATRIX_OK;
+    while (p < end)
+    {
+        const char* eol = memchr(p, '\n', end - p);
+        const char* line_end = eol ? eol : end;
+
+        if (is_entry_line(p, line_end))
+        {
+            if ((r->status[task] = parse_entry(r, p, line_end, k, &i, &j)) != MATRIX_OK)
+            {
+                return;
+            }
+            k++;
+        }
+        p = eol ? eol + 1 : end;
+    }
+}
+
+
+static matrix_error parse_entries(mtx_reader* r, const char* p, const char* end) {
+    /* Parses the entry lines in [p, end) on the thread pool. */
+    int workers = thread_pool_size(), t;
+    size_t piece;
+
+    r->tasks = (int)((size_t)(end - p) / MTX_MIN_PIECE);
+    r->tasks = r->tasks > workers ? workers : r->tasks;
+    r->tasks = r->tasks > MTX_MAX_TASKS ? MTX_MAX_TASKS : r->tasks;
+    r->tasks = r->tasks < 1 ? 1 : r->tasks;
+    piece = (size_t)(end - p) / r->tasks;
+
+    // Pieces of about the same size, every one ends after a line break
+    r->bounds[0] = p;
+    for (t = 1; t < r->tasks; t++)
+    {
+        const char* q = p + piece * t > r->bounds[t - 1] ? p + piece * t : r->bounds[t - 1];
+        const char* eol = q < end ? memchr(q, '\n', end - q) : NULL;
+
+        r->bounds[t] = eol ? eol + 1 : end;
+    }
+    r->bounds[r->tasks] = end;
+
+    thread_pool_run(r->tasks, r->tasks, count_task, r);
+
+    r->first[0] = r->parsed;
+    for (t = 0; t < r->tasks; t++)
+    {
+        r->first[t + 1] += r->first[t];
+    }
+    if (r->first[r->tasks] > r->entries)
+    {
+        return MATRIX_TYPE_ERROR;
+    }
+
+    thread_pool_run(r->tasks, r->tasks, parse_task, r);
+
+    for (t = 0; t < r->tasks; t++)
+    {
+        if (r->status[t] != MATRIX_OK)
+        {
+            return r->status[t];
+        }
+    }
+
+    r->parsed = r->first[r->tasks];
+    return MATRIX_OK;
+}
+
+
+static matrix_error parse_chunk(mtx_reader* r, const char* p, const char* end) {
+    /* Parses the complete lines in [p, end), the header line by line and the entries at once. */
+    matrix_error status;
+
+    while (p < end && r->stage != MTX_ENTRIES)
+    {
+        const char* eol = memchr(p, '\n', end - p);
+        const char* line_end = eol ? eol : end;
+
+        if (r->stage == MTX_BANNER)
+        {
+            if ((status = parse_banner(r, p, line_end)) != MATRIX_OK)
+            {
+                return status;
+            }
+            r->stage = MTX_SIZE;
+        }else if (is_entry_line(p, line_end)){
+            if ((status = parse_size_line(r, p, line_end)) != MATRIX_OK)
+            {
+                return status;
+            }
+            r->stage = MTX_ENTRIES;
+        }
+        p = eol ? eol + 1 : end;
+    }
+
+    return p < end ? parse_entries(r, p, end) : MATRIX_OK;
+}
+
+
+static matrix_error read_mtx(mtx_reader* r, const char* filename) {
+    /*  Reads a file chunk by chunk, every chunk ends after its last line
+        break and the rest of the line is kept for the next one. */
+    FILE* f;
+    matrix_error status = MATRIX_OK;
+    char *chunk, *grown;
+    size_t capacity = MTX_CHUNK, len = 0, n;
+
+    if ((f = fopen(filename, "rb")) == NULL)
+    {
+        return MATRIX_OPENING_ERROR;
+    }
+
+    if ((chunk = malloc(capacity)) == NULL)
+    {
+        fclose(f);
+        return MATRIX_NOMEM;
+    }
+
+    while (status == MATRIX_OK)
+    {
+        char* last_newline = NULL;
+
+        n = fread(chunk + len, 1, capacity - len, f);
+        len += n;
+
+        if (n == 0)
+        {
+            // The last line has no line break
+            status = parse_chunk(r, chunk, chunk + len);
+            break;
+        }
+
+        for (n = len; n > 0; n--)
+        {
+            if (chunk[n - 1] == '\n')
+            {
+                last_newline = chunk + n - 1;
+                break;
+            }
+        }
+
+        if (last_newline == NULL)
+        {
+            // A single line longer than the buffer
+            if (len == capacity)
+            {
+                if ((grown = realloc(chunk, capacity * 2)) == NULL)
+                {
+                    status = MATRIX_NOMEM;
+                    break;
+                }
+                chunk = grown;
+                capacity *= 2;
+            }
+            continue;
+        }
+
+        status = parse_chunk(r, chunk, last_newline + 1);
+
+        len = chunk + len - (last_newline + 1);
+        memmove(chunk, last_newline + 1, len);
+    }
+
+    free(chunk);
+
+    if (status == MATRIX_OK && ferror(f))
+    {
+        status = MATRIX_OTHER_ERROR;
+    }
+    if (fclose(f) == EOF && status == MATRIX_OK)
+    {
+        status = MATRIX_CLOSING_ERROR;
+    }
+    if (status == MATRIX_OK && (r->stage != MTX_ENTRIES || r->parsed != r->entries))
+    {
+        status = MATRIX_TYPE_ERROR;
+    }
+
+    return status;
+}
+
+
+static void free_reader(mtx_reader* r) {
+    /* Frees the storage of a reader that did not become the result. */
+
+    destroy_matrix(r->dense);
+    free(r->outer);
+    free(r->inner);
+    free(r->values);
+}
+
+
+static void build_dense(mtx_reader* r) {
+    /*  Adds the parsed coordinate entries into the dense result in file
+        order. The pieces of a chunk parse in parallel, so repeated entries
+        are summed here rather than racing for one element. */
+    size_t k;
+
+    for (k = 0; k < r->entries; k++)
+    {
+        store_dense(r, r->outer[k], r->inner[k], r->values[k]);
+    }
+}
+
+
+static sparse_matrix* build_sparse(mtx_reader* r) {
+    /*  Turns the parsed coordinate entries into a sparse matrix. Entries
+        already sorted by row (CSC: column) and column without repeats become
+        its storage directly, others are sorted as triplets. */
+    sparse_matrix* mat;
+    size_t k, n = r->entries;
+    int sorted = r->symmetry == MTX_GENERAL;
+
+    for (k = 1; k < n && sorted; k++)
+    {
+        sorted = r->outer[k - 1] < r->outer[k] || (r->outer[k - 1] == r->outer[k] && r->inner[k - 1] < r->inner[k]);
+    }
+
+    if (!sorted)
+    {
+        // Mirrored elements of symmetric matrices are appended behind the stored ones
+        for (k = 0; k < r->entries && r->symmetry != MTX_GENERAL; k++)
+        {
+            if (r->outer[k] != r->inner[k])
+            {
+                r->outer[n] = r->inner[k];
+                r->inner[n] = r->outer[k];
+                r->values[n++] = r->symmetry == MTX_SYMMETRIC ? r->values[k] : -r->values[k];
+            }
+        }
+
+        return r->sparse == SPARSE_CSR ?
+            sparse_from_triplets(r->rows, r->cols, n, r->outer, r->inner, r->values, r->sparse) :
+            sparse_from_triplets(r->rows, r->cols, n, r->inner, r->outer, r->values, r->sparse);
+    }
+
+    if ((mat = create_sparse_matrix(r->rows, r->cols, 0, r->sparse)) == NULL)
+    {
+        return NULL;
+    }
+
+    free(mat->idx);
+    free(mat->values);
+    mat->nnz = n;
+    mat->idx = r->inner;
+    mat->values = r->values;
+    r->inner = NULL;
+    r->values = NULL;
+
+    for (k = 0; k < n; k++)
+    {
+        mat->ptr[r->outer[k] + 1]++;
+    }
+    for (k = 0; k < (size_t)(r->sparse == SPARSE_CSR ? r->rows : r->cols); k++)
+    {
+        mat->ptr[k + 1] += mat->ptr[k];
+    }
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+matrix* read_from_mtx(const char* filename){
+    /*  Reads a dense matrix from a Matrix Market file in coordinate or array
+        format. Elements missing from coordinate files are zero, repeated
+        ones are summed. */
+
+    mtx_reader r;
+    matrix_error status;
+    matrix* mat;
+
+    if (filename == NULL) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    memset(&r, 0, sizeof(r));
+    if ((status = read_mtx(&r, filename)) != MATRIX_OK)
+    {
+        free_reader(&r);
+        error = status;
+        LOG_ERROR("Failed reading matrix from file");
+        return NULL;
+    }
+
+    if (r.format == MTX_COORDINATE)
+    {
+        build_dense(&r);
+    }
+    mat = r.dense;
+    r.dense = NULL;
+    free_reader(&r);
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+sparse_matrix* read_sparse_from_mtx(const char* filename, sparse_format format){
+    /*  Reads a sparse matrix from a Matrix Market file. Entries of coordinate
+        files are parsed straight into the storage of the result when they
+        are sorted by rows (CSC: columns), others are sorted and repeated
+        positions summed. Array files are read dense and their nonzero
+        elements stored. */
+
+    mtx_reader r;
+    matrix_error status;
+    sparse_matrix* mat;
+
+    if (filename == NULL || format < SPARSE_CSR || format >= SPARSE_FORMAT_COUNT) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    memset(&r, 0, sizeof(r));
+    r.want_sparse = 1;
+    r.sparse = format;
+    if ((status = read_mtx(&r, filename)) != MATRIX_OK)
+    {
+        free_reader(&r);
+        error = status;
+        LOG_ERROR("Failed reading matrix from file");
+        return NULL;
+    }
+
+    mat = r.dense ? dense_to_sparse(r.dense, format) : build_sparse(&r);
+    free_reader(&r);
+
+    return mat;
+}
+
+
+void save_to_mtx(matrix* mat, const char* filename){
+    /* Saves a dense matrix to a Matrix Market file in array format, values are written exactly. */
+
+    FILE* f;
+    int i, j;
+
+    if (mat == NULL || filename == NULL) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if ((f = fopen(filename, "w")) == NULL)
+    {
+        error = MATRIX_OPENING_ERROR;
+        LOG_ERROR("Failed opening file");
+        return;
+    }
+
+    fprintf(f, "%%%%MatrixMarket matrix array real general\n%d %d\n", mat->rows, mat->cols);
+    for (j = 0; j < mat->cols; j++)
+    {
+        for (i = 0; i < mat->rows; i++)
+        {
+            fprintf(f, "%.17g\n", MATRIX_AT(mat, i, j));
+        }
+    }
+
+    if (ferror(f))
+    {
+        fclose(f);
+        error = MATRIX_OTHER_ERROR;
+        LOG_ERROR("Failed writing file");
+        return;
+    }
+
+    if (fclose(f) == EOF)
+    {
+        error = MATRIX_CLOSING_ERROR;
+        LOG_ERROR("Failed closing file");
+        return;
+    }
+
+    error = MATRIX_OK;
+}
+
+
+void save_sparse_to_mtx(sparse_matrix* mat, const char* filename){
+    /* Saves a sparse matrix to a Matrix Market file in coordinate format, in its storage order. */
+
+    FILE* f;
+    int outer;
+    size_t k;
+
+    if (mat == NULL || filename == NULL) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if ((f = fopen(filename, "w")) == NULL)
+    {
+        error = MATRIX_OPENING_ERROR;
+        LOG_ERROR("Failed opening file");
+        return;
+    }
+
+    fprintf(f, "%%%%MatrixMarket matrix coordinate real general\n%d %d %zu\n", mat->rows, mat->cols, mat->nnz);
+    for (outer = 0; outer < (mat->format == SPARSE_CSR ? mat->rows : mat->cols); outer++)
+    {
+        for (k = mat->ptr[outer]; k < mat->ptr[outer + 1]; k++)
+        {
+            int i = mat->format == SPARSE_CSR ? outer : mat->idx[k];
+            int j = mat->format == SPARSE_CSR ? mat->idx[k] : outer;
+
+            fprintf(f, "%d %d %.17g\n", i + 1, j + 1, mat->values[k]);
+        }
+    }
+
+    if (ferror(f))
+    {
+        fclose(f);
+        error = MATRIX_OTHER_ERROR;
+        LOG_ERROR("Failed writing file");
+        return;
+    }
+
+    if (fclose(f) == EOF)
+    {
+        error = MATRIX_CLOSING_ERROR;
+        LOG_ERROR("Failed closing file");
+        return;
+    }
+
+    error = MATRIX_OK;
+}
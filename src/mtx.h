@@ -0,0 +1,31 @@
+/*
+    mtx.h    version 1.0
+
+    Header file for mtx.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_MTX
+#define MAT_MTX
+
+#include "matrix.h"
+#include "sparse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern matrix* read_from_mtx(const char* file);
+extern sparse_matrix* read_sparse_from_mtx(const char* file, sparse_format format);
+extern void save_to_mtx(matrix* mat, const char* file);
+extern void save_sparse_to_mtx(sparse_matrix* mat, const char* file);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
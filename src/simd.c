@@ -0,0 +1,1398 @@
+/*
+    simd.c    version 1.0
+
+    Module for runtime selection of SIMD kernels.
+    --------------------------
+
+    Every kernel exists in a scalar variant and, on x86 with GCC or Clang,
+    in SSE2, AVX2+FMA and AVX-512 variants, for double and float32
+    elements. The best level supported by the CPU is detected with cpuid
+    at first use. It can be lowered with the MATRIX_ISA environment
+    variable (scalar, sse2, avx2, avx512) or with matrix_set_isa.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "matrix.h"
+#include "simd.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define SIMD_X86 0
+#endif
+
+static const char* const MATRIX_ISA_STRS[] =
+{
+    "scalar",
+    "sse2",
+    "avx2",
+    "avx512"
+};
+
+
+/* ---------------- scalar ---------------- */
+
+static void add_scalar(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = a[i] + b[i];
+    }
+}
+
+
+static void sub_scalar(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = a[i] - b[i];
+    }
+}
+
+
+static void scale_scalar(int n, const double* a, double scalar, double* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = a[i] * scalar;
+    }
+}
+
+
+static void axpy_scalar(int n, double alpha, const double* x, double* y) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+#define SCALAR_MR 4
+#define SCALAR_NR 4
+
+static void gemm_scalar(int kc, const double* a, const double* b, double* c, ptrdiff_t rs_c, double alpha) {
+    /* Portable 4 * 4 micro-kernel, accumulators stay in registers. */
+    double ab[SCALAR_MR][SCALAR_NR] = {{0}};
+    int i, j, p;
+
+    for (p = 0; p < kc; p++)
+    {
+        for (i = 0; i < SCALAR_MR; i++)
+        {
+            for (j = 0; j < SCALAR_NR; j++)
+            {
+                ab[i][j] += a[i] * b[j];
+            }
+        }
+        a += SCALAR_MR;
+        b += SCALAR_NR;
+    }
+
+    for (i = 0; i < SCALAR_MR; i++)
+    {
+        for (j = 0; j < SCALAR_NR; j++)
+        {
+            c[i * rs_c + j] += alpha * ab[i][j];
+        }
+    }
+}
+
+
+#define SCALAR_TILE 4
+
+static void transpose_scalar(const double* src, ptrdiff_t rs_src, double* dst, ptrdiff_t rs_dst) {
+    int i, j;
+
+    for (i = 0; i < SCALAR_TILE; i++)
+    {
+        for (j = 0; j < SCALAR_TILE; j++)
+        {
+            dst[j * rs_dst + i] = src[i * rs_src + j];
+        }
+    }
+}
+
+
+static double sparse_dot_scalar(int n, const double* values, const int* idx, const double* x) {
+    /* Two accumulators hide the latency of the dependent additions. */
+    double s0 = 0.0, s1 = 0.0;
+    int k;
+
+    for (k = 0; k + 2 <= n; k += 2)
+    {
+        s0 += values[k] * x[idx[k]];
+        s1 += values[k + 1] * x[idx[k + 1]];
+    }
+    if (k < n)
+    {
+        s0 += values[k] * x[idx[k]];
+    }
+    return s0 + s1;
+}
+
+
+static const simd_kernels scalar_kernels =
+{
+    MATRIX_ISA_SCALAR, add_scalar, sub_scalar, scale_scalar, axpy_scalar,
+    SCALAR_MR, SCALAR_NR, gemm_scalar, SCALAR_TILE, transpose_scalar,
+    sparse_dot_scalar
+};
+
+
+/* ---------------- scalar float32 ---------------- */
+
+static void add_scalar_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = a[i] + b[i];
+    }
+}
+
+
+static void sub_scalar_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = a[i] - b[i];
+    }
+}
+
+
+static void scale_scalar_f32(int n, const float* a, float scalar, float* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = a[i] * scalar;
+    }
+}
+
+
+static void axpy_scalar_f32(int n, float alpha, const float* x, float* y) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+static void gemm_scalar_f32(int kc, const float* a, const float* b, float* c, ptrdiff_t rs_c, float alpha) {
+    /* Portable 4 * 4 micro-kernel, accumulators stay in registers. */
+    float ab[SCALAR_MR][SCALAR_NR] = {{0}};
+    int i, j, p;
+
+    for (p = 0; p < kc; p++)
+    {
+        for (i = 0; i < SCALAR_MR; i++)
+        {
+            for (j = 0; j < SCALAR_NR; j++)
+            {
+                ab[i][j] += a[i] * b[j];
+            }
+        }
+        a += SCALAR_MR;
+        b += SCALAR_NR;
+    }
+
+    for (i = 0; i < SCALAR_MR; i++)
+    {
+        for (j = 0; j < SCALAR_NR; j++)
+        {
+            c[i * rs_c + j] += alpha * ab[i][j];
+        }
+    }
+}
+
+
+static void from_f64_scalar(int n, const double* a, float* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = (float)a[i];
+    }
+}
+
+
+static void to_f64_scalar(int n, const float* a, double* c) {
+    int i;
+
+    for (i = 0; i < n; i++)
+    {
+        c[i] = a[i];
+    }
+}
+
+
+static void transpose_scalar_f32(const float* src, ptrdiff_t rs_src, float* dst, ptrdiff_t rs_dst) {
+    int i, j;
+
+    for (i = 0; i < SCALAR_TILE; i++)
+    {
+        for (j = 0; j < SCALAR_TILE; j++)
+        {
+            dst[j * rs_dst + i] = src[i * rs_src + j];
+        }
+    }
+}
+
+
+static const simd_kernels_f32 scalar_kernels_f32 =
+{
+    MATRIX_ISA_SCALAR, add_scalar_f32, sub_scalar_f32, scale_scalar_f32, axpy_scalar_f32,
+    SCALAR_MR, SCALAR_NR, gemm_scalar_f32, SCALAR_TILE, transpose_scalar_f32,
+    from_f64_scalar, to_f64_scalar
+};
+
+
+#if SIMD_X86
+
+/* ---------------- SSE2 ---------------- */
+
+TARGET_SSE2
+static void add_sse2(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(c + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] + b[i];
+    }
+}
+
+
+TARGET_SSE2
+static void sub_sse2(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(c + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] - b[i];
+    }
+}
+
+
+TARGET_SSE2
+static void scale_sse2(int n, const double* a, double scalar, double* c) {
+    __m128d s = _mm_set1_pd(scalar);
+    int i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(c + i, _mm_mul_pd(_mm_loadu_pd(a + i), s));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] * scalar;
+    }
+}
+
+
+TARGET_SSE2
+static void axpy_sse2(int n, double alpha, const double* x, double* y) {
+    __m128d s = _mm_set1_pd(alpha);
+    int i;
+
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(s, _mm_loadu_pd(x + i))));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+#define SSE2_MR 4
+#define SSE2_NR 4
+
+TARGET_SSE2
+static void gemm_sse2(int kc, const double* a, const double* b, double* c, ptrdiff_t rs_c, double alpha) {
+    /* 4 * 4 micro-kernel, each C row held in two 128-bit registers. */
+    __m128d acc[SSE2_MR][2];
+    __m128d s = _mm_set1_pd(alpha);
+    int i, p;
+
+    for (i = 0; i < SSE2_MR; i++)
+    {
+        acc[i][0] = _mm_setzero_pd();
+        acc[i][1] = _mm_setzero_pd();
+    }
+
+    for (p = 0; p < kc; p++)
+    {
+        __m128d b0 = _mm_loadu_pd(b);
+        __m128d b1 = _mm_loadu_pd(b + 2);
+
+        for (i = 0; i < SSE2_MR; i++)
+        {
+            __m128d ai = _mm_set1_pd(a[i]);
+            acc[i][0] = _mm_add_pd(acc[i][0], _mm_mul_pd(ai, b0));
+            acc[i][1] = _mm_add_pd(acc[i][1], _mm_mul_pd(ai, b1));
+        }
+        a += SSE2_MR;
+        b += SSE2_NR;
+    }
+
+    for (i = 0; i < SSE2_MR; i++)
+    {
+        double* c_row = c + i * rs_c;
+        _mm_storeu_pd(c_row, _mm_add_pd(_mm_loadu_pd(c_row), _mm_mul_pd(s, acc[i][0])));
+        _mm_storeu_pd(c_row + 2, _mm_add_pd(_mm_loadu_pd(c_row + 2), _mm_mul_pd(s, acc[i][1])));
+    }
+}
+
+
+#define SSE2_TILE 4
+
+TARGET_SSE2
+static void transpose_sse2(const double* src, ptrdiff_t rs_src, double* dst, ptrdiff_t rs_dst) {
+    /* Transposes a 4 * 4 tile as four 2 * 2 blocks of unpacked register pairs. */
+    int i, j;
+
+    for (i = 0; i < SSE2_TILE; i += 2)
+    {
+        for (j = 0; j < SSE2_TILE; j += 2)
+        {
+            __m128d r0 = _mm_loadu_pd(src + i * rs_src + j);
+            __m128d r1 = _mm_loadu_pd(src + (i + 1) * rs_src + j);
+
+            _mm_storeu_pd(dst + j * rs_dst + i, _mm_unpacklo_pd(r0, r1));
+            _mm_storeu_pd(dst + (j + 1) * rs_dst + i, _mm_unpackhi_pd(r0, r1));
+        }
+    }
+}
+
+
+static const simd_kernels sse2_kernels =
+{
+    MATRIX_ISA_SSE2, add_sse2, sub_sse2, scale_sse2, axpy_sse2,
+    SSE2_MR, SSE2_NR, gemm_sse2, SSE2_TILE, transpose_sse2,
+    sparse_dot_scalar   // SSE2 has no gather
+};
+
+
+/* ---------------- AVX2 + FMA ---------------- */
+
+TARGET_AVX2
+static void add_avx2(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_pd(c + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        _mm256_storeu_pd(c + i + 4, _mm256_add_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] + b[i];
+    }
+}
+
+
+TARGET_AVX2
+static void sub_avx2(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_pd(c + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        _mm256_storeu_pd(c + i + 4, _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] - b[i];
+    }
+}
+
+
+TARGET_AVX2
+static void scale_avx2(int n, const double* a, double scalar, double* c) {
+    __m256d s = _mm256_set1_pd(scalar);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_pd(c + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), s));
+        _mm256_storeu_pd(c + i + 4, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), s));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] * scalar;
+    }
+}
+
+
+TARGET_AVX2
+static void axpy_avx2(int n, double alpha, const double* x, double* y) {
+    __m256d s = _mm256_set1_pd(alpha);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(s, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        _mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(s, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+#define AVX2_MR 6
+#define AVX2_NR 8
+
+TARGET_AVX2
+static void gemm_avx2(int kc, const double* a, const double* b, double* c, ptrdiff_t rs_c, double alpha) {
+    /* 6 * 8 micro-kernel, 12 accumulators fill the 16 ymm registers with B and A. */
+    __m256d acc[AVX2_MR][2];
+    __m256d s = _mm256_set1_pd(alpha);
+    int i, p;
+
+    for (i = 0; i < AVX2_MR; i++)
+    {
+        acc[i][0] = _mm256_setzero_pd();
+        acc[i][1] = _mm256_setzero_pd();
+    }
+
+    for (p = 0; p < kc; p++)
+    {
+        __m256d b0 = _mm256_loadu_pd(b);
+        __m256d b1 = _mm256_loadu_pd(b + 4);
+
+        for (i = 0; i < AVX2_MR; i++)
+        {
+            __m256d ai = _mm256_broadcast_sd(a + i);
+            acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+        }
+        a += AVX2_MR;
+        b += AVX2_NR;
+    }
+
+    for (i = 0; i < AVX2_MR; i++)
+    {
+        double* c_row = c + i * rs_c;
+        _mm256_storeu_pd(c_row, _mm256_fmadd_pd(s, acc[i][0], _mm256_loadu_pd(c_row)));
+        _mm256_storeu_pd(c_row + 4, _mm256_fmadd_pd(s, acc[i][1], _mm256_loadu_pd(c_row + 4)));
+    }
+}
+
+
+#define AVX2_TILE 4
+
+TARGET_AVX2
+static void transpose_avx2(const double* src, ptrdiff_t rs_src, double* dst, ptrdiff_t rs_dst) {
+    /* Transposes a 4 * 4 tile held in four ymm registers. */
+    __m256d r0 = _mm256_loadu_pd(src);
+    __m256d r1 = _mm256_loadu_pd(src + rs_src);
+    __m256d r2 = _mm256_loadu_pd(src + 2 * rs_src);
+    __m256d r3 = _mm256_loadu_pd(src + 3 * rs_src);
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+    _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(dst + rs_dst, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(dst + 2 * rs_dst, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(dst + 3 * rs_dst, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+
+TARGET_AVX2
+static double sparse_dot_avx2(int n, const double* values, const int* idx, const double* x) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    double t[4];
+    int k;
+
+    for (k = 0; k + 8 <= n; k += 8)
+    {
+        __m256d x0 = _mm256_i32gather_pd(x, _mm_loadu_si128((const __m128i*)(idx + k)), 8);
+        __m256d x1 = _mm256_i32gather_pd(x, _mm_loadu_si128((const __m128i*)(idx + k + 4)), 8);
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(values + k), x0, s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(values + k + 4), x1, s1);
+    }
+    _mm256_storeu_pd(t, _mm256_add_pd(s0, s1));
+    for (; k < n; k++)
+    {
+        t[0] += values[k] * x[idx[k]];
+    }
+    return (t[0] + t[1]) + (t[2] + t[3]);
+}
+
+
+static const simd_kernels avx2_kernels =
+{
+    MATRIX_ISA_AVX2, add_avx2, sub_avx2, scale_avx2, axpy_avx2,
+    AVX2_MR, AVX2_NR, gemm_avx2, AVX2_TILE, transpose_avx2,
+    sparse_dot_avx2
+};
+
+
+/* ---------------- AVX-512 ---------------- */
+
+TARGET_AVX512
+static void add_avx512(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_pd(c + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    }
+    if (i < n)
+    {
+        __mmask8 mask = (__mmask8)((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd(c + i, mask, _mm512_add_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i)));
+    }
+}
+
+
+TARGET_AVX512
+static void sub_avx512(int n, const double* a, const double* b, double* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_pd(c + i, _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    }
+    if (i < n)
+    {
+        __mmask8 mask = (__mmask8)((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd(c + i, mask, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i)));
+    }
+}
+
+
+TARGET_AVX512
+static void scale_avx512(int n, const double* a, double scalar, double* c) {
+    __m512d s = _mm512_set1_pd(scalar);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_pd(c + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), s));
+    }
+    if (i < n)
+    {
+        __mmask8 mask = (__mmask8)((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd(c + i, mask, _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, a + i), s));
+    }
+}
+
+
+TARGET_AVX512
+static void axpy_avx512(int n, double alpha, const double* x, double* y) {
+    __m512d s = _mm512_set1_pd(alpha);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(s, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    if (i < n)
+    {
+        __mmask8 mask = (__mmask8)((1u << (n - i)) - 1);
+        _mm512_mask_storeu_pd(y + i, mask, _mm512_fmadd_pd(s, _mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i)));
+    }
+}
+
+
+#define AVX512_MR 8
+#define AVX512_NR 16
+
+TARGET_AVX512
+static void gemm_avx512(int kc, const double* a, const double* b, double* c, ptrdiff_t rs_c, double alpha) {
+    /* 8 * 16 micro-kernel, 16 zmm accumulators. */
+    __m512d acc[AVX512_MR][2];
+    __m512d s = _mm512_set1_pd(alpha);
+    int i, p;
+
+    for (i = 0; i < AVX512_MR; i++)
+    {
+        acc[i][0] = _mm512_setzero_pd();
+        acc[i][1] = _mm512_setzero_pd();
+    }
+
+    for (p = 0; p < kc; p++)
+    {
+        __m512d b0 = _mm512_loadu_pd(b);
+        __m512d b1 = _mm512_loadu_pd(b + 8);
+
+        for (i = 0; i < AVX512_MR; i++)
+        {
+            __m512d ai = _mm512_set1_pd(a[i]);
+            acc[i][0] = _mm512_fmadd_pd(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_pd(ai, b1, acc[i][1]);
+        }
+        a += AVX512_MR;
+        b += AVX512_NR;
+    }
+
+    for (i = 0; i < AVX512_MR; i++)
+    {
+        double* c_row = c + i * rs_c;
+        _mm512_storeu_pd(c_row, _mm512_fmadd_pd(s, acc[i][0], _mm512_loadu_pd(c_row)));
+        _mm512_storeu_pd(c_row + 8, _mm512_fmadd_pd(s, acc[i][1], _mm512_loadu_pd(c_row + 8)));
+    }
+}
+
+
+#define AVX512_TILE 8
+
+TARGET_AVX512
+static void transpose_avx512(const double* src, ptrdiff_t rs_src, double* dst, ptrdiff_t rs_dst) {
+    /* Transposes an 8 * 8 tile: pairs are unpacked, then 128-bit lanes are shuffled twice. */
+    __m512d r[8], t[8], u[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        r[i] = _mm512_loadu_pd(src + i * rs_src);
+    }
+    for (i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm512_unpacklo_pd(r[i], r[i + 1]);
+        t[i + 1] = _mm512_unpackhi_pd(r[i], r[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm512_shuffle_f64x2(t[i], t[i + 2], 0x88);
+        u[i + 1] = _mm512_shuffle_f64x2(t[i], t[i + 2], 0xDD);
+        u[i + 2] = _mm512_shuffle_f64x2(t[i + 1], t[i + 3], 0x88);
+        u[i + 3] = _mm512_shuffle_f64x2(t[i + 1], t[i + 3], 0xDD);
+    }
+
+    _mm512_storeu_pd(dst, _mm512_shuffle_f64x2(u[0], u[4], 0x88));
+    _mm512_storeu_pd(dst + 4 * rs_dst, _mm512_shuffle_f64x2(u[0], u[4], 0xDD));
+    _mm512_storeu_pd(dst + 2 * rs_dst, _mm512_shuffle_f64x2(u[1], u[5], 0x88));
+    _mm512_storeu_pd(dst + 6 * rs_dst, _mm512_shuffle_f64x2(u[1], u[5], 0xDD));
+    _mm512_storeu_pd(dst + rs_dst, _mm512_shuffle_f64x2(u[2], u[6], 0x88));
+    _mm512_storeu_pd(dst + 5 * rs_dst, _mm512_shuffle_f64x2(u[2], u[6], 0xDD));
+    _mm512_storeu_pd(dst + 3 * rs_dst, _mm512_shuffle_f64x2(u[3], u[7], 0x88));
+    _mm512_storeu_pd(dst + 7 * rs_dst, _mm512_shuffle_f64x2(u[3], u[7], 0xDD));
+}
+
+
+TARGET_AVX512
+static double sparse_dot_avx512(int n, const double* values, const int* idx, const double* x) {
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    int k;
+
+    for (k = 0; k + 16 <= n; k += 16)
+    {
+        __m512d x0 = _mm512_i32gather_pd(_mm256_loadu_si256((const __m256i*)(idx + k)), x, 8);
+        __m512d x1 = _mm512_i32gather_pd(_mm256_loadu_si256((const __m256i*)(idx + k + 8)), x, 8);
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(values + k), x0, s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(values + k + 8), x1, s1);
+    }
+    for (; k < n; k += 8)
+    {
+        __mmask8 mask = n - k >= 8 ? 0xFF : (__mmask8)((1u << (n - k)) - 1);
+        __m256i i0 = _mm512_castsi512_si256(_mm512_maskz_loadu_epi32((__mmask16)mask, idx + k));
+        __m512d x0 = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), mask, i0, x, 8);
+        s0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, values + k), x0, s0);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+
+static const simd_kernels avx512_kernels =
+{
+    MATRIX_ISA_AVX512, add_avx512, sub_avx512, scale_avx512, axpy_avx512,
+    AVX512_MR, AVX512_NR, gemm_avx512, AVX512_TILE, transpose_avx512,
+    sparse_dot_avx512
+};
+
+/* ---------------- SSE2 float32 ---------------- */
+TARGET_SSE2
+static void add_sse2_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm_storeu_ps(c + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        _mm_storeu_ps(c + i + 4, _mm_add_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] + b[i];
+    }
+}
+
+
+TARGET_SSE2
+static void sub_sse2_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm_storeu_ps(c + i, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        _mm_storeu_ps(c + i + 4, _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] - b[i];
+    }
+}
+
+
+TARGET_SSE2
+static void scale_sse2_f32(int n, const float* a, float scalar, float* c) {
+    __m128 s = _mm_set1_ps(scalar);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm_storeu_ps(c + i, _mm_mul_ps(_mm_loadu_ps(a + i), s));
+        _mm_storeu_ps(c + i + 4, _mm_mul_ps(_mm_loadu_ps(a + i + 4), s));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] * scalar;
+    }
+}
+
+
+TARGET_SSE2
+static void axpy_sse2_f32(int n, float alpha, const float* x, float* y) {
+    __m128 s = _mm_set1_ps(alpha);
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(s, _mm_loadu_ps(x + i))));
+        _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_mul_ps(s, _mm_loadu_ps(x + i + 4))));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+#define SSE2_MR_F32 4
+#define SSE2_NR_F32 8
+
+TARGET_SSE2
+static void gemm_sse2_f32(int kc, const float* a, const float* b, float* c, ptrdiff_t rs_c, float alpha) {
+    /* 4 * 8 micro-kernel, 8 xmm accumulators. */
+    __m128 acc[SSE2_MR_F32][2];
+    __m128 s = _mm_set1_ps(alpha);
+    int i, p;
+
+    for (i = 0; i < SSE2_MR_F32; i++)
+    {
+        acc[i][0] = _mm_setzero_ps();
+        acc[i][1] = _mm_setzero_ps();
+    }
+
+    for (p = 0; p < kc; p++)
+    {
+        __m128 b0 = _mm_loadu_ps(b);
+        __m128 b1 = _mm_loadu_ps(b + 4);
+
+        for (i = 0; i < SSE2_MR_F32; i++)
+        {
+            __m128 ai = _mm_set1_ps(a[i]);
+            acc[i][0] = _mm_add_ps(acc[i][0], _mm_mul_ps(ai, b0));
+            acc[i][1] = _mm_add_ps(acc[i][1], _mm_mul_ps(ai, b1));
+        }
+        a += SSE2_MR_F32;
+        b += SSE2_NR_F32;
+    }
+
+    for (i = 0; i < SSE2_MR_F32; i++)
+    {
+        float* c_row = c + i * rs_c;
+        _mm_storeu_ps(c_row, _mm_add_ps(_mm_loadu_ps(c_row), _mm_mul_ps(s, acc[i][0])));
+        _mm_storeu_ps(c_row + 4, _mm_add_ps(_mm_loadu_ps(c_row + 4), _mm_mul_ps(s, acc[i][1])));
+    }
+}
+
+
+TARGET_SSE2
+static void from_f64_sse2(int n, const double* a, float* c) {
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(a + i));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(a + i + 2));
+        _mm_storeu_ps(c + i, _mm_movelh_ps(lo, hi));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = (float)a[i];
+    }
+}
+
+
+TARGET_SSE2
+static void to_f64_sse2(int n, const float* a, double* c) {
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(a + i);
+        _mm_storeu_pd(c + i, _mm_cvtps_pd(x));
+        _mm_storeu_pd(c + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i];
+    }
+}
+
+
+TARGET_SSE2
+static void transpose_sse2_f32(const float* src, ptrdiff_t rs_src, float* dst, ptrdiff_t rs_dst) {
+    /* Transposes a 4 * 4 tile: pairs are unpacked, then halves of the pairs are moved together. */
+    __m128 r0 = _mm_loadu_ps(src);
+    __m128 r1 = _mm_loadu_ps(src + rs_src);
+    __m128 r2 = _mm_loadu_ps(src + 2 * rs_src);
+    __m128 r3 = _mm_loadu_ps(src + 3 * rs_src);
+    __m128 t0 = _mm_unpacklo_ps(r0, r1);
+    __m128 t1 = _mm_unpackhi_ps(r0, r1);
+    __m128 t2 = _mm_unpacklo_ps(r2, r3);
+    __m128 t3 = _mm_unpackhi_ps(r2, r3);
+
+    _mm_storeu_ps(dst, _mm_movelh_ps(t0, t2));
+    _mm_storeu_ps(dst + rs_dst, _mm_movehl_ps(t2, t0));
+    _mm_storeu_ps(dst + 2 * rs_dst, _mm_movelh_ps(t1, t3));
+    _mm_storeu_ps(dst + 3 * rs_dst, _mm_movehl_ps(t3, t1));
+}
+
+
+static const simd_kernels_f32 sse2_kernels_f32 =
+{
+    MATRIX_ISA_SSE2, add_sse2_f32, sub_sse2_f32, scale_sse2_f32, axpy_sse2_f32,
+    SSE2_MR_F32, SSE2_NR_F32, gemm_sse2_f32, SSE2_TILE, transpose_sse2_f32,
+    from_f64_sse2, to_f64_sse2
+};
+
+
+/* ---------------- AVX2 + FMA float32 ---------------- */
+TARGET_AVX2
+static void add_avx2_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        _mm256_storeu_ps(c + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        _mm256_storeu_ps(c + i + 8, _mm256_add_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] + b[i];
+    }
+}
+
+
+TARGET_AVX2
+static void sub_avx2_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        _mm256_storeu_ps(c + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        _mm256_storeu_ps(c + i + 8, _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] - b[i];
+    }
+}
+
+
+TARGET_AVX2
+static void scale_avx2_f32(int n, const float* a, float scalar, float* c) {
+    __m256 s = _mm256_set1_ps(scalar);
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        _mm256_storeu_ps(c + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), s));
+        _mm256_storeu_ps(c + i + 8, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), s));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] * scalar;
+    }
+}
+
+
+TARGET_AVX2
+static void axpy_avx2_f32(int n, float alpha, const float* x, float* y) {
+    __m256 s = _mm256_set1_ps(alpha);
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(s, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+        _mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(s, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+#define AVX2_MR_F32 6
+#define AVX2_NR_F32 16
+
+TARGET_AVX2
+static void gemm_avx2_f32(int kc, const float* a, const float* b, float* c, ptrdiff_t rs_c, float alpha) {
+    /* 6 * 16 micro-kernel, 12 ymm accumulators. */
+    __m256 acc[AVX2_MR_F32][2];
+    __m256 s = _mm256_set1_ps(alpha);
+    int i, p;
+
+    for (i = 0; i < AVX2_MR_F32; i++)
+    {
+        acc[i][0] = _mm256_setzero_ps();
+        acc[i][1] = _mm256_setzero_ps();
+    }
+
+    for (p = 0; p < kc; p++)
+    {
+        __m256 b0 = _mm256_loadu_ps(b);
+        __m256 b1 = _mm256_loadu_ps(b + 8);
+
+        for (i = 0; i < AVX2_MR_F32; i++)
+        {
+            __m256 ai = _mm256_set1_ps(a[i]);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += AVX2_MR_F32;
+        b += AVX2_NR_F32;
+    }
+
+    for (i = 0; i < AVX2_MR_F32; i++)
+    {
+        float* c_row = c + i * rs_c;
+        _mm256_storeu_ps(c_row, _mm256_fmadd_ps(s, acc[i][0], _mm256_loadu_ps(c_row)));
+        _mm256_storeu_ps(c_row + 8, _mm256_fmadd_ps(s, acc[i][1], _mm256_loadu_ps(c_row + 8)));
+    }
+}
+
+
+TARGET_AVX2
+static void from_f64_avx2(int n, const double* a, float* c) {
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm_storeu_ps(c + i, _mm256_cvtpd_ps(_mm256_loadu_pd(a + i)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = (float)a[i];
+    }
+}
+
+
+TARGET_AVX2
+static void to_f64_avx2(int n, const float* a, double* c) {
+    int i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+    {
+        _mm256_storeu_pd(c + i, _mm256_cvtps_pd(_mm_loadu_ps(a + i)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i];
+    }
+}
+
+
+#define AVX2_TILE_F32 8
+
+TARGET_AVX2
+static void transpose_avx2_f32(const float* src, ptrdiff_t rs_src, float* dst, ptrdiff_t rs_dst) {
+    /*  Transposes an 8 * 8 tile: 4 * 4 blocks are transposed within the
+        128-bit lanes by unpacks and shuffles, then the lanes are swapped. */
+    __m256 r[8], t[8], u[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+    {
+        r[i] = _mm256_loadu_ps(src + i * rs_src);
+    }
+    for (i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_shuffle_ps(t[i], t[i + 2], 0x44);
+        u[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], 0xEE);
+        u[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0x44);
+        u[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], 0xEE);
+    }
+    for (i = 0; i < 4; i++)
+    {
+        _mm256_storeu_ps(dst + i * rs_dst, _mm256_permute2f128_ps(u[i], u[i + 4], 0x20));
+        _mm256_storeu_ps(dst + (i + 4) * rs_dst, _mm256_permute2f128_ps(u[i], u[i + 4], 0x31));
+    }
+}
+
+
+static const simd_kernels_f32 avx2_kernels_f32 =
+{
+    MATRIX_ISA_AVX2, add_avx2_f32, sub_avx2_f32, scale_avx2_f32, axpy_avx2_f32,
+    AVX2_MR_F32, AVX2_NR_F32, gemm_avx2_f32, AVX2_TILE_F32, transpose_avx2_f32,
+    from_f64_avx2, to_f64_avx2
+};
+
+
+/* ---------------- AVX-512 float32 ---------------- */
+TARGET_AVX512
+static void add_avx512_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        _mm512_storeu_ps(c + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+        _mm512_storeu_ps(c + i + 16, _mm512_add_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] + b[i];
+    }
+}
+
+
+TARGET_AVX512
+static void sub_avx512_f32(int n, const float* a, const float* b, float* c) {
+    int i;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        _mm512_storeu_ps(c + i, _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+        _mm512_storeu_ps(c + i + 16, _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] - b[i];
+    }
+}
+
+
+TARGET_AVX512
+static void scale_avx512_f32(int n, const float* a, float scalar, float* c) {
+    __m512 s = _mm512_set1_ps(scalar);
+    int i;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        _mm512_storeu_ps(c + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), s));
+        _mm512_storeu_ps(c + i + 16, _mm512_mul_ps(_mm512_loadu_ps(a + i + 16), s));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i] * scalar;
+    }
+}
+
+
+TARGET_AVX512
+static void axpy_avx512_f32(int n, float alpha, const float* x, float* y) {
+    __m512 s = _mm512_set1_ps(alpha);
+    int i;
+
+    for (i = 0; i + 32 <= n; i += 32)
+    {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(s, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+        _mm512_storeu_ps(y + i + 16, _mm512_fmadd_ps(s, _mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16)));
+    }
+    for (; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+    }
+}
+
+
+#define AVX512_MR_F32 8
+#define AVX512_NR_F32 32
+
+TARGET_AVX512
+static void gemm_avx512_f32(int kc, const float* a, const float* b, float* c, ptrdiff_t rs_c, float alpha) {
+    /* 8 * 32 micro-kernel, 16 zmm accumulators. */
+    __m512 acc[AVX512_MR_F32][2];
+    __m512 s = _mm512_set1_ps(alpha);
+    int i, p;
+
+    for (i = 0; i < AVX512_MR_F32; i++)
+    {
+        acc[i][0] = _mm512_setzero_ps();
+        acc[i][1] = _mm512_setzero_ps();
+    }
+
+    for (p = 0; p < kc; p++)
+    {
+        __m512 b0 = _mm512_loadu_ps(b);
+        __m512 b1 = _mm512_loadu_ps(b + 16);
+
+        for (i = 0; i < AVX512_MR_F32; i++)
+        {
+            __m512 ai = _mm512_set1_ps(a[i]);
+            acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += AVX512_MR_F32;
+        b += AVX512_NR_F32;
+    }
+
+    for (i = 0; i < AVX512_MR_F32; i++)
+    {
+        float* c_row = c + i * rs_c;
+        _mm512_storeu_ps(c_row, _mm512_fmadd_ps(s, acc[i][0], _mm512_loadu_ps(c_row)));
+        _mm512_storeu_ps(c_row + 16, _mm512_fmadd_ps(s, acc[i][1], _mm512_loadu_ps(c_row + 16)));
+    }
+}
+
+
+TARGET_AVX512
+static void from_f64_avx512(int n, const double* a, float* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm256_storeu_ps(c + i, _mm512_cvtpd_ps(_mm512_loadu_pd(a + i)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = (float)a[i];
+    }
+}
+
+
+TARGET_AVX512
+static void to_f64_avx512(int n, const float* a, double* c) {
+    int i;
+
+    for (i = 0; i + 8 <= n; i += 8)
+    {
+        _mm512_storeu_pd(c + i, _mm512_cvtps_pd(_mm256_loadu_ps(a + i)));
+    }
+    for (; i < n; i++)
+    {
+        c[i] = a[i];
+    }
+}
+
+
+#define AVX512_TILE_F32 16
+
+TARGET_AVX512
+static void transpose_avx512_f32(const float* src, ptrdiff_t rs_src, float* dst, ptrdiff_t rs_dst) {
+    /*  Transposes a 16 * 16 tile: 4 * 4 blocks are transposed within the
+        128-bit lanes, then the lanes are gathered by two rounds of shuffles. */
+    __m512 r[16], t[16], u[16];
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        r[i] = _mm512_loadu_ps(src + i * rs_src);
+    }
+    for (i = 0; i < 16; i += 2)
+    {
+        t[i] = _mm512_unpacklo_ps(r[i], r[i + 1]);
+        t[i + 1] = _mm512_unpackhi_ps(r[i], r[i + 1]);
+    }
+    for (i = 0; i < 16; i += 4)
+    {
+        u[i] = _mm512_shuffle_ps(t[i], t[i + 2], 0x44);
+        u[i + 1] = _mm512_shuffle_ps(t[i], t[i + 2], 0xEE);
+        u[i + 2] = _mm512_shuffle_ps(t[i + 1], t[i + 3], 0x44);
+        u[i + 3] = _mm512_shuffle_ps(t[i + 1], t[i + 3], 0xEE);
+    }
+
+    // Lane l of u[4 * b + q] holds rows 4 * b to 4 * b + 3 of column 4 * l + q
+    for (i = 0; i < 4; i++)
+    {
+        __m512 even_lo = _mm512_shuffle_f32x4(u[i], u[i + 4], 0x88);
+        __m512 odd_lo = _mm512_shuffle_f32x4(u[i], u[i + 4], 0xDD);
+        __m512 even_hi = _mm512_shuffle_f32x4(u[i + 8], u[i + 12], 0x88);
+        __m512 odd_hi = _mm512_shuffle_f32x4(u[i + 8], u[i + 12], 0xDD);
+
+        _mm512_storeu_ps(dst + i * rs_dst, _mm512_shuffle_f32x4(even_lo, even_hi, 0x88));
+        _mm512_storeu_ps(dst + (i + 8) * rs_dst, _mm512_shuffle_f32x4(even_lo, even_hi, 0xDD));
+        _mm512_storeu_ps(dst + (i + 4) * rs_dst, _mm512_shuffle_f32x4(odd_lo, odd_hi, 0x88));
+        _mm512_storeu_ps(dst + (i + 12) * rs_dst, _mm512_shuffle_f32x4(odd_lo, odd_hi, 0xDD));
+    }
+}
+
+
+static const simd_kernels_f32 avx512_kernels_f32 =
+{
+    MATRIX_ISA_AVX512, add_avx512_f32, sub_avx512_f32, scale_avx512_f32, axpy_avx512_f32,
+    AVX512_MR_F32, AVX512_NR_F32, gemm_avx512_f32, AVX512_TILE_F32, transpose_avx512_f32,
+    from_f64_avx512, to_f64_avx512
+};
+
+#endif
+
+
+static const simd_kernels* const KERNELS[MATRIX_ISA_COUNT] =
+{
+#if SIMD_X86
+    &scalar_kernels, &sse2_kernels, &avx2_kernels, &avx512_kernels
+#else
+    &scalar_kernels, NULL, NULL, NULL
+#endif
+};
+
+static const simd_kernels_f32* const KERNELS_F32[MATRIX_ISA_COUNT] =
+{
+#if SIMD_X86
+    &scalar_kernels_f32, &sse2_kernels_f32, &avx2_kernels_f32, &avx512_kernels_f32
+#else
+    &scalar_kernels_f32, NULL, NULL, NULL
+#endif
+};
+
+static _Atomic(const simd_kernels*) active_kernels = NULL;
+
+
+const char* matrix_isa_str(matrix_isa isa)
+{
+    const char* isa_str = NULL;
+
+    if (isa < MATRIX_ISA_COUNT && isa >= 0)
+    {
+        isa_str = MATRIX_ISA_STRS[isa];
+    }
+
+    return isa_str;
+}
+
+
+matrix_isa matrix_detect_isa(void){
+    /* Returns the best instruction set level supported by the CPU. */
+
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return MATRIX_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return MATRIX_ISA_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return MATRIX_ISA_SSE2;
+    }
+#endif
+
+    return MATRIX_ISA_SCALAR;
+}
+
+
+static const simd_kernels* select_kernels(void) {
+    /* Picks the detected level, lowered by the MATRIX_ISA environment variable. */
+    matrix_isa isa = matrix_detect_isa();
+    const char* requested = getenv("MATRIX_ISA");
+    int i;
+
+    if (requested != NULL)
+    {
+        for (i = 0; i < MATRIX_ISA_COUNT; i++)
+        {
+            if (strcmp(requested, MATRIX_ISA_STRS[i]) == 0 && (matrix_isa)i <= isa)
+            {
+                isa = (matrix_isa)i;
+                break;
+            }
+        }
+    }
+
+    return KERNELS[isa];
+}
+
+
+const simd_kernels* simd_get_kernels(void){
+    /* Returns the active kernel table, selecting it at first use. */
+
+    const simd_kernels* kernels = atomic_load_explicit(&active_kernels, memory_order_acquire);
+
+    if (kernels == NULL)
+    {
+        kernels = select_kernels();
+        atomic_store_explicit(&active_kernels, kernels, memory_order_release);
+    }
+
+    return kernels;
+}
+
+
+const simd_kernels_f32* simd_get_kernels_f32(void){
+    /* Returns the float32 kernels of the active instruction set level. */
+
+    return KERNELS_F32[simd_get_kernels()->isa];
+}
+
+
+matrix_isa matrix_get_isa(void){
+    /* Returns the instruction set level used by the kernels. */
+
+    return simd_get_kernels()->isa;
+}
+
+
+void matrix_set_isa(matrix_isa isa){
+    /* Forces kernels of instruction set level isa, which the CPU must support. */
+
+    if (isa < 0 || isa >= MATRIX_ISA_COUNT || isa > matrix_detect_isa() || KERNELS[isa] == NULL)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    atomic_store_explicit(&active_kernels, KERNELS[isa], memory_order_release);
+    error = MATRIX_OK;
+}
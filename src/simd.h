@@ -0,0 +1,78 @@
+/*
+    simd.h    version 1.0
+
+    Header file for simd.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_SIMD
+#define MAT_SIMD
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    MATRIX_ISA_SCALAR,
+    MATRIX_ISA_SSE2,
+    MATRIX_ISA_AVX2,
+    MATRIX_ISA_AVX512,
+    MATRIX_ISA_COUNT
+} matrix_isa;
+
+// Kernels of one instruction set level, selected at first use
+typedef struct
+{
+    matrix_isa isa;
+    void (*add)(int n, const double* a, const double* b, double* c);
+    void (*sub)(int n, const double* a, const double* b, double* c);
+    void (*scale)(int n, const double* a, double scalar, double* c);
+    void (*axpy)(int n, double alpha, const double* x, double* y);
+    int gemm_mr;
+    int gemm_nr;
+    // computes c += alpha * a * b for packed gemm_mr * kc and kc * gemm_nr micro-panels
+    void (*gemm)(int kc, const double* a, const double* b, double* c, ptrdiff_t rs_c, double alpha);
+    int transpose_tile;
+    // writes the transposition of a transpose_tile * transpose_tile block of src to dst
+    void (*transpose)(const double* src, ptrdiff_t rs_src, double* dst, ptrdiff_t rs_dst);
+    // returns the sum of values[k] * x[idx[k]] over n stored elements of a sparse row
+    double (*sparse_dot)(int n, const double* values, const int* idx, const double* x);
+} simd_kernels;
+
+// Float32 kernels of one instruction set level, same contracts as simd_kernels
+typedef struct
+{
+    matrix_isa isa;
+    void (*add)(int n, const float* a, const float* b, float* c);
+    void (*sub)(int n, const float* a, const float* b, float* c);
+    void (*scale)(int n, const float* a, float scalar, float* c);
+    void (*axpy)(int n, float alpha, const float* x, float* y);
+    int gemm_mr;
+    int gemm_nr;
+    void (*gemm)(int kc, const float* a, const float* b, float* c, ptrdiff_t rs_c, float alpha);
+    int transpose_tile;
+    void (*transpose)(const float* src, ptrdiff_t rs_src, float* dst, ptrdiff_t rs_dst);
+    // conversions between double and float32 arrays
+    void (*from_f64)(int n, const double* a, float* c);
+    void (*to_f64)(int n, const float* a, double* c);
+} simd_kernels_f32;
+
+extern const char* matrix_isa_str(matrix_isa isa);
+extern matrix_isa matrix_detect_isa(void);
+extern matrix_isa matrix_get_isa(void);
+extern void matrix_set_isa(matrix_isa isa);
+extern const simd_kernels* simd_get_kernels(void);
+extern const simd_kernels_f32* simd_get_kernels_f32(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1039 @@
+/*
+    sparse.c    version 1.0
+
+    Module for sparse matrices in CSR and CSC format.
+    --------------------------
+
+    A sparse matrix stores only its nonzero elements, grouped by rows
+    (CSR) or by columns (CSC). Products with dense vectors and matrices
+    touch only the stored elements, split across the thread pool so that
+    every task gets about the same number of them.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "sparse.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+// Products with fewer multiply-adds than this stay in the calling thread
+#define SPARSE_PARALLEL (1 << 16)
+
+// Tasks per worker, more tasks even out rows of different cost
+#define SPARSE_TASKS_PER_WORKER 4
+
+// Narrowest column strip of C computed by one task of a CSC product
+#define SPARSE_MIN_STRIP 64
+
+// Columns of B and C a CSR product with a matrix sweeps at once when C is wider than 4 strips
+#define SPARSE_STRIP 256
+
+// Sparse-sparse products accumulate rows of C in dense arrays up to this many columns, wider ones in hash tables
+#define SPARSE_DENSE_COLUMNS (1 << 18)
+
+// Product y = alpha * A * x + beta * y or C = alpha * A * B + beta * C split into tasks
+typedef struct
+{
+    const sparse_matrix* a;
+    const simd_kernels* k;
+    double alpha;
+    double beta;
+    int tasks;
+    const double* x;
+    double* y;
+    double* partial;    // rows elements per worker for CSC products with a vector, or NULL
+    const matrix* b;
+    matrix* c;
+    int strip;          // columns of C swept at once (CSR) or per task (CSC) of products with a matrix
+} sparse_job;
+
+// Sparse-sparse product C = A * B of CSR matrices split into tasks of about the same number of multiply-adds
+typedef struct
+{
+    const sparse_matrix* a;
+    const sparse_matrix* b;
+    sparse_matrix* c;       // NULL during the symbolic phase
+    const size_t* flops;    // rows + 1 prefix sums of the multiply-adds of the rows of C
+    size_t* counts;         // number of elements of every row of C found by the symbolic phase
+    int tasks;
+    int hashed;             // rows are accumulated in hash tables instead of dense arrays
+    size_t width;           // elements of the accumulator of one worker
+    int* keys;              // per worker: row that last touched a column (dense) or hash table keys
+    double* acc;            // per worker: sums of the columns of the current row
+    int* found;             // per worker: B->cols + 1 columns of the current row, dense accumulators only
+} spgemm_job;
+
+
+static int outer_size(const sparse_matrix* mat) {
+    /* Number of compressed rows (CSC: columns). */
+    return mat->format == SPARSE_CSR ? mat->rows : mat->cols;
+}
+
+
+static int inner_size(const sparse_matrix* mat) {
+    /* Range of the stored indices. */
+    return mat->format == SPARSE_CSR ? mat->cols : mat->rows;
+}
+
+
+sparse_matrix* create_sparse_matrix(int rows, int cols, size_t nnz, sparse_format format){
+    /*  Creates a sparse matrix with room for nnz elements. All offsets are
+        zero, the caller fills ptr, idx and values. */
+
+    sparse_matrix* mat;
+    size_t room = nnz > 0 ? nnz : 1;
+
+    if (rows <= 0 || cols <= 0 || format < SPARSE_CSR || format >= SPARSE_FORMAT_COUNT)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (room > SIZE_MAX / sizeof(double))
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Matrix too large");
+        return NULL;
+    }
+
+    if ((mat = malloc(sizeof(sparse_matrix))) == NULL)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->format = format;
+    mat->nnz = nnz;
+    mat->ptr = calloc((size_t)outer_size(mat) + 1, sizeof(size_t));
+    mat->idx = malloc(room * sizeof(int));
+    mat->values = malloc(room * sizeof(double));
+
+    if (mat->ptr == NULL || mat->idx == NULL || mat->values == NULL)
+    {
+        destroy_sparse_matrix(mat);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+void destroy_sparse_matrix(sparse_matrix* mat){
+    /* Frees memory allocated for sparse matrix mat. */
+
+    if (!mat) {
+        return;
+    }
+
+    free(mat->ptr);
+    free(mat->idx);
+    free(mat->values);
+    free(mat);
+}
+
+
+sparse_matrix* sparse_from_triplets(int rows, int cols, size_t nnz, const int* row_idx, const int* col_idx,
+                                    const double* values, sparse_format format){
+    /*  Creates a sparse matrix from nnz (row, column, value) triplets indexed
+        from 0 in any order. Values of repeated positions are summed. The
+        triplets are sorted by two stable counting passes in O(nnz + rows + cols). */
+
+    const int *outer, *inner;
+    size_t *count, *by_inner, *order, n, k;
+    sparse_matrix* mat;
+    int n_outer, n_inner, i, last_outer = -1, last_inner = -1;
+
+    if (rows <= 0 || cols <= 0 || (nnz > 0 && (!row_idx || !col_idx || !values)) ||
+        format < SPARSE_CSR || format >= SPARSE_FORMAT_COUNT)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    for (k = 0; k < nnz; k++)
+    {
+        if (row_idx[k] < 0 || row_idx[k] >= rows || col_idx[k] < 0 || col_idx[k] >= cols)
+        {
+            error = MATRIX_INVARGS;
+            LOG_ERROR("Index out of range");
+            return NULL;
+        }
+    }
+
+    outer = format == SPARSE_CSR ? row_idx : col_idx;
+    inner = format == SPARSE_CSR ? col_idx : row_idx;
+    n_outer = format == SPARSE_CSR ? rows : cols;
+    n_inner = format == SPARSE_CSR ? cols : rows;
+
+    mat = create_sparse_matrix(rows, cols, nnz, format);
+    count = calloc((size_t)(n_outer > n_inner ? n_outer : n_inner) + 1, sizeof(size_t));
+    by_inner = malloc((nnz > 0 ? nnz : 1) * sizeof(size_t));
+    order = malloc((nnz > 0 ? nnz : 1) * sizeof(size_t));
+
+    if (mat == NULL || count == NULL || by_inner == NULL || order == NULL)
+    {
+        destroy_sparse_matrix(mat);
+        free(count);
+        free(by_inner);
+        free(order);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    // Sort by the inner index, then stably by the outer index
+    for (k = 0; k < nnz; k++)
+    {
+        count[inner[k] + 1]++;
+    }
+    for (i = 0; i < n_inner; i++)
+    {
+        count[i + 1] += count[i];
+    }
+    for (k = 0; k < nnz; k++)
+    {
+        by_inner[count[inner[k]]++] = k;
+    }
+
+    memset(count, 0, ((size_t)n_outer + 1) * sizeof(size_t));
+    for (k = 0; k < nnz; k++)
+    {
+        count[outer[k] + 1]++;
+    }
+    for (i = 0; i < n_outer; i++)
+    {
+        count[i + 1] += count[i];
+    }
+    for (k = 0; k < nnz; k++)
+    {
+        order[count[outer[by_inner[k]]]++] = by_inner[k];
+    }
+
+    // Repeated positions are now adjacent
+    for (n = 0, k = 0; k < nnz; k++)
+    {
+        size_t t = order[k];
+
+        if (outer[t] == last_outer && inner[t] == last_inner)
+        {
+            mat->values[n - 1] += values[t];
+            continue;
+        }
+        mat->idx[n] = inner[t];
+        mat->values[n] = values[t];
+        mat->ptr[outer[t] + 1]++;
+        last_outer = outer[t];
+        last_inner = inner[t];
+        n++;
+    }
+    for (i = 0; i < n_outer; i++)
+    {
+        mat->ptr[i + 1] += mat->ptr[i];
+    }
+    mat->nnz = n;
+
+    free(count);
+    free(by_inner);
+    free(order);
+
+    error = MATRIX_OK;
+    return mat;
+}
+
+
+sparse_matrix* dense_to_sparse(matrix* mat, sparse_format format){
+    /* Creates a sparse matrix holding the nonzero elements of matrix mat. */
+
+    sparse_matrix* mat2;
+    size_t nnz = 0, n = 0;
+    int i, j, o, in, n_outer, n_inner;
+
+    if (!mat || format < SPARSE_CSR || format >= SPARSE_FORMAT_COUNT) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        for (j = 0; j < mat->cols; j++)
+        {
+            nnz += MATRIX_AT(mat, i, j) != 0.0;
+        }
+    }
+
+    if ((mat2 = create_sparse_matrix(mat->rows, mat->cols, nnz, format)) == NULL)
+    {
+        return NULL;
+    }
+
+    n_outer = outer_size(mat2);
+    n_inner = inner_size(mat2);
+    for (o = 0; o < n_outer; o++)
+    {
+        for (in = 0; in < n_inner; in++)
+        {
+            double value = format == SPARSE_CSR ? MATRIX_AT(mat, o, in) : MATRIX_AT(mat, in, o);
+
+            if (value != 0.0)
+            {
+                mat2->idx[n] = in;
+                mat2->values[n] = value;
+                n++;
+            }
+        }
+        mat2->ptr[o + 1] = n;
+    }
+
+    error = MATRIX_OK;
+    return mat2;
+}
+
+
+matrix* sparse_to_dense(sparse_matrix* mat){
+    /* Returns a dense copy of sparse matrix mat. */
+
+    matrix* mat2;
+    size_t k;
+    int o;
+
+    if (!mat) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if ((mat2 = create_zero_matrix(mat->rows, mat->cols)) == NULL)
+    {
+        return NULL;
+    }
+
+    for (o = 0; o < outer_size(mat); o++)
+    {
+        for (k = mat->ptr[o]; k < mat->ptr[o + 1]; k++)
+        {
+            if (mat->format == SPARSE_CSR)
+            {
+                MATRIX_AT(mat2, o, mat->idx[k]) = mat->values[k];
+            }else{
+                MATRIX_AT(mat2, mat->idx[k], o) = mat->values[k];
+            }
+        }
+    }
+
+    error = MATRIX_OK;
+    return mat2;
+}
+
+
+sparse_matrix* sparse_convert(sparse_matrix* mat, sparse_format format){
+    /*  Returns a copy of sparse matrix mat in the given format. Switching
+        formats scatters the elements by their index, which keeps the new
+        indices sorted. */
+
+    sparse_matrix* mat2;
+    size_t* next;
+    size_t k;
+    int o, i, n_inner;
+
+    if (!mat || format < SPARSE_CSR || format >= SPARSE_FORMAT_COUNT) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if ((mat2 = create_sparse_matrix(mat->rows, mat->cols, mat->nnz, format)) == NULL)
+    {
+        return NULL;
+    }
+
+    if (format == mat->format)
+    {
+        memcpy(mat2->ptr, mat->ptr, ((size_t)outer_size(mat) + 1) * sizeof(size_t));
+        memcpy(mat2->idx, mat->idx, mat->nnz * sizeof(int));
+        memcpy(mat2->values, mat->values, mat->nnz * sizeof(double));
+        error = MATRIX_OK;
+        return mat2;
+    }
+
+    n_inner = inner_size(mat);
+    if ((next = malloc((size_t)n_inner * sizeof(size_t))) == NULL)
+    {
+        destroy_sparse_matrix(mat2);
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        return NULL;
+    }
+
+    for (k = 0; k < mat->nnz; k++)
+    {
+        mat2->ptr[mat->idx[k] + 1]++;
+    }
+    for (i = 0; i < n_inner; i++)
+    {
+        mat2->ptr[i + 1] += mat2->ptr[i];
+        next[i] = mat2->ptr[i];
+    }
+
+    for (o = 0; o < outer_size(mat); o++)
+    {
+        for (k = mat->ptr[o]; k < mat->ptr[o + 1]; k++)
+        {
+            size_t dst = next[mat->idx[k]]++;
+
+            mat2->idx[dst] = o;
+            mat2->values[dst] = mat->values[k];
+        }
+    }
+
+    free(next);
+
+    error = MATRIX_OK;
+    return mat2;
+}
+
+
+double sparse_get_value(sparse_matrix* mat, int i, int j){
+    /* Returns the value of the element in the i-th row and j-th column, both indexed from 1. */
+
+    size_t lo, hi;
+    int o, in;
+
+    if (!mat || i > mat->rows || j > mat->cols || i < 1 || j < 1)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return 0;
+    }
+
+    o = mat->format == SPARSE_CSR ? i - 1 : j - 1;
+    in = mat->format == SPARSE_CSR ? j - 1 : i - 1;
+
+    // Binary search in the sorted indices of the row
+    lo = mat->ptr[o];
+    hi = mat->ptr[o + 1];
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (mat->idx[mid] < in)
+        {
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+
+    error = MATRIX_OK;
+    return lo < mat->ptr[o + 1] && mat->idx[lo] == in ? mat->values[lo] : 0.0;
+}
+
+
+static int prefix_start(const size_t* prefix, int n, int task, int tasks) {
+    /* First of n items of a task, tasks get about the same share of the total prefix[n]. */
+    int lo = 0, hi = n;
+    size_t target;
+
+    if (task >= tasks)
+    {
+        return n;
+    }
+
+    target = prefix[n] / tasks * task + prefix[n] % tasks * task / tasks;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+
+        if (prefix[mid] < target)
+        {
+            lo = mid + 1;
+        }else{
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+
+static int task_start(const sparse_matrix* a, int task, int tasks) {
+    /* First row (CSC: column) of a task, tasks get about the same number of stored elements. */
+
+    return prefix_start(a->ptr, outer_size(a), task, tasks);
+}
+
+
+static int sparse_workers(size_t work) {
+    /* Number of workers for a product of the given number of multiply-adds. */
+
+    return work < SPARSE_PARALLEL ? 1 : thread_pool_size();
+}
+
+
+static void csr_vector_task(void* ctx, int task, int worker) {
+    /* Computes the elements of y of the rows of a task, one gathered dot product per row. */
+    const sparse_job* job = ctx;
+    const sparse_matrix* a = job->a;
+    int i, end = task_start(a, task + 1, job->tasks);
+    (void)worker;
+
+    for (i = task_start(a, task, job->tasks); i < end; i++)
+    {
+        size_t first = a->ptr[i];
+        double dot = job->k->sparse_dot((int)(a->ptr[i + 1] - first), a->values + first, a->idx + first, job->x);
+
+        job->y[i] = job->alpha * dot + (job->beta == 0.0 ? 0.0 : job->beta * job->y[i]);
+    }
+}
+
+
+static void csc_vector_task(void* ctx, int task, int worker) {
+    /*  Scatters the columns of a task to y, or to the partial sums of the
+        worker when columns are split across workers. */
+    const sparse_job* job = ctx;
+    const sparse_matrix* a = job->a;
+    double* acc = job->partial ? job->partial + (size_t)worker * a->rows : job->y;
+    int j, end = task_start(a, task + 1, job->tasks);
+    size_t k;
+
+    for (j = task_start(a, task, job->tasks); j < end; j++)
+    {
+        double s = job->alpha * job->x[j];
+
+        for (k = a->ptr[j]; k < a->ptr[j + 1]; k++)
+        {
+            acc[a->idx[k]] += s * a->values[k];
+        }
+    }
+}
+
+
+void sparse_multiply_vector(double alpha, sparse_matrix* A, const double* x, double beta, double* y){
+    /*  Computes y = alpha * A * x + beta * y for vectors x of A->cols and y of
+        A->rows elements, y must not overlap x. With beta 0 y is only written. */
+
+    sparse_job job;
+    int workers, w, i;
+
+    if (!A || !x || !y) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.a = A;
+    job.k = simd_get_kernels();
+    job.alpha = alpha;
+    job.beta = beta;
+    job.x = x;
+    job.y = y;
+    workers = sparse_workers(A->nnz);
+    job.tasks = workers > 1 ? workers * SPARSE_TASKS_PER_WORKER : 1;
+
+    if (A->format == SPARSE_CSR)
+    {
+        thread_pool_run(job.tasks, workers, csr_vector_task, &job);
+        error = MATRIX_OK;
+        return;
+    }
+
+    // Columns scatter to any row, so every worker sums into its own copy of y
+    if (workers > 1 && (job.partial = calloc((size_t)workers * A->rows, sizeof(double))) == NULL)
+    {
+        workers = 1;
+        job.tasks = 1;
+    }
+
+    if (job.partial == NULL)
+    {
+        for (i = 0; i < A->rows; i++)
+        {
+            y[i] = beta == 0.0 ? 0.0 : beta * y[i];
+        }
+    }
+
+    thread_pool_run(job.tasks, workers, csc_vector_task, &job);
+
+    if (job.partial != NULL)
+    {
+        for (i = 0; i < A->rows; i++)
+        {
+            double sum = beta == 0.0 ? 0.0 : beta * y[i];
+
+            for (w = 0; w < workers; w++)
+            {
+                sum += job.partial[(size_t)w * A->rows + i];
+            }
+            y[i] = sum;
+        }
+        free(job.partial);
+    }
+
+    error = MATRIX_OK;
+}
+
+
+static void csr_matrix_task(void* ctx, int task, int worker) {
+    /* Adds alpha * A(i, j) * B(j, :) to C(i, :) for the stored elements of the rows of a task, strip by strip. */
+    const sparse_job* job = ctx;
+    const sparse_matrix* a = job->a;
+    int i, first, start = task_start(a, task, job->tasks), end = task_start(a, task + 1, job->tasks);
+    size_t k;
+    (void)worker;
+
+    for (first = 0; first < job->c->cols; first += job->strip)
+    {
+        int n = job->c->cols - first < job->strip ? job->c->cols - first : job->strip;
+
+        for (i = start; i < end; i++)
+        {
+            for (k = a->ptr[i]; k < a->ptr[i + 1]; k++)
+            {
+                job->k->axpy(n, job->alpha * a->values[k], &MATRIX_AT(job->b, a->idx[k], first), &MATRIX_AT(job->c, i, first));
+            }
+        }
+    }
+}
+
+
+static void csc_matrix_task(void* ctx, int task, int worker) {
+    /*  Adds alpha * A(i, j) * B(j, :) to C(i, :) restricted to a strip of
+        columns of C, so tasks never write the same element. */
+    const sparse_job* job = ctx;
+    const sparse_matrix* a = job->a;
+    int j, first = task * job->strip;
+    int n = job->c->cols - first < job->strip ? job->c->cols - first : job->strip;
+    size_t k;
+    (void)worker;
+
+    for (j = 0; j < a->cols; j++)
+    {
+        for (k = a->ptr[j]; k < a->ptr[j + 1]; k++)
+        {
+            job->k->axpy(n, job->alpha * a->values[k], &MATRIX_AT(job->b, j, first), &MATRIX_AT(job->c, a->idx[k], first));
+        }
+    }
+}
+
+
+void sparse_multiply_dense(double alpha, sparse_matrix* A, matrix* B, double beta, matrix* C){
+    /*  Computes C = alpha * A * B + beta * C for dense matrices B and C, which
+        may be views but must not overlap. With beta 0 C is only written. */
+
+    sparse_job job;
+    matrix *b = B, *c = C;
+    int workers, i;
+
+    if (!A || !B || !C) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    if (A->cols != B->rows || C->rows != A->rows || C->cols != B->cols)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    // The kernels walk rows of B and C with unit stride
+    if ((B->col_stride != 1 && (b = materialize(B)) == NULL) ||
+        (C->col_stride != 1 && (c = materialize(C)) == NULL))
+    {
+        if (b != B)
+        {
+            destroy_matrix(b);
+        }
+        return;
+    }
+
+    if (beta == 0.0)
+    {
+        for (i = 0; i < c->rows; i++)
+        {
+            memset(&MATRIX_AT(c, i, 0), 0, c->cols * sizeof(double));
+        }
+    }else if (beta != 1.0){
+        scale_inplace(c, beta);
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.a = A;
+    job.k = simd_get_kernels();
+    job.alpha = alpha;
+    job.b = b;
+    job.c = c;
+    workers = sparse_workers(A->nnz * (size_t)c->cols);
+
+    if (A->format == SPARSE_CSR)
+    {
+        // Narrow strips keep the rows of B in cache when rows of C are long
+        job.strip = c->cols > 4 * SPARSE_STRIP ? SPARSE_STRIP : c->cols;
+        job.tasks = workers > 1 ? workers * SPARSE_TASKS_PER_WORKER : 1;
+        thread_pool_run(job.tasks, workers, csr_matrix_task, &job);
+    }else{
+        job.strip = (c->cols + workers - 1) / workers;
+        job.strip = job.strip < SPARSE_MIN_STRIP ? SPARSE_MIN_STRIP : job.strip;
+        job.tasks = (c->cols + job.strip - 1) / job.strip;
+        thread_pool_run(job.tasks, workers, csc_matrix_task, &job);
+    }
+
+    if (c != C)
+    {
+        copy_into(C, c);
+        destroy_matrix(c);
+    }
+    if (b != B)
+    {
+        destroy_matrix(b);
+    }
+
+    error = MATRIX_OK;
+}
+
+
+matrix* sparse_multiply_by_matrix(sparse_matrix* A, matrix* B){
+    /* Returns a multiplication of sparse matrix A and dense matrix B. */
+
+    matrix* C;
+
+    if (!A || !B) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->cols != B->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    if ((C = initialize_matrix(A->rows, B->cols)) == NULL)
+    {
+        return NULL;
+    }
+
+    sparse_multiply_dense(1.0, A, B, 0.0, C);
+
+    if (error != MATRIX_OK)
+    {
+        destroy_matrix(C);
+        return NULL;
+    }
+
+    return C;
+}
+
+
+static size_t row_flops(const sparse_matrix* a, const sparse_matrix* b, int i) {
+    /* Number of multiply-adds of row i of A * B. */
+    size_t k, flops = 0;
+
+    for (k = a->ptr[i]; k < a->ptr[i + 1]; k++)
+    {
+        flops += b->ptr[a->idx[k] + 1] - b->ptr[a->idx[k]];
+    }
+    return flops;
+}
+
+
+static size_t table_size(size_t flops, int cols) {
+    /* Hash table size of a row, a power of two at least twice its possible elements. */
+    size_t limit = flops < (size_t)cols ? flops : (size_t)cols;
+    size_t size = 8;
+
+    while (size < 2 * limit)
+    {
+        size *= 2;
+    }
+    return size;
+}
+
+
+static int compare_int(const void* x, const void* y) {
+    /* Ascending order of ints for qsort. */
+    int a = *(const int*)x, b = *(const int*)y;
+
+    return (a > b) - (a < b);
+}
+
+
+static size_t dense_row(const spgemm_job* job, int i, int* keys, double* acc, int* found) {
+    /*  Accumulates row i of C in arrays of B->cols elements, keys marks the
+        columns already touched by the row and found lists them. Returns the
+        number of elements, the numeric phase also stores them sorted to C
+        and leaves acc zero. */
+    const sparse_matrix *a = job->a, *b = job->b;
+    size_t k, l, n = 0;
+
+    // Branchless marking, whether a column is new is hard to predict
+    if (!job->c)
+    {
+        for (k = a->ptr[i]; k < a->ptr[i + 1]; k++)
+        {
+            for (l = b->ptr[a->idx[k]]; l < b->ptr[a->idx[k] + 1]; l++)
+            {
+                n += keys[b->idx[l]] != i;
+                keys[b->idx[l]] = i;
+            }
+        }
+    }else{
+        int* idx = job->c->idx + job->c->ptr[i];
+        double* values = job->c->values + job->c->ptr[i];
+        int j;
+
+        for (k = a->ptr[i]; k < a->ptr[i + 1]; k++)
+        {
+            double s = a->values[k];
+
+            for (l = b->ptr[a->idx[k]]; l < b->ptr[a->idx[k] + 1]; l++)
+            {
+                j = b->idx[l];
+                found[n] = j;
+                n += keys[j] != i;
+                keys[j] = i;
+                acc[j] += s * b->values[l];
+            }
+        }
+
+        // A scan of the markers is cheaper than sorting rows that fill much of C
+        if (n > (size_t)b->cols / 16)
+        {
+            for (j = 0, k = 0; j < b->cols; j++)
+            {
+                found[k] = j;
+                k += keys[j] == i;
+            }
+        }else{
+            qsort(found, n, sizeof(int), compare_int);
+        }
+
+        for (k = 0; k < n; k++)
+        {
+            idx[k] = found[k];
+            values[k] = acc[found[k]];
+            acc[found[k]] = 0.0;
+        }
+    }
+
+    return n;
+}
+
+
+static size_t hash_slot(const int* keys, size_t mask, int j) {
+    /* Slot of column j in a hash table with linear probing, an empty slot if j is not present. */
+    size_t h = ((uint32_t)j * 2654435761u) & mask;
+
+    while (keys[h] != -1 && keys[h] != j)
+    {
+        h = (h + 1) & mask;
+    }
+    return h;
+}
+
+
+static size_t hash_row(const spgemm_job* job, int i, int* keys, double* acc) {
+    /*  Accumulates row i of C in a hash table sized for its multiply-adds and
+        leaves the table empty. Returns the number of elements, the numeric
+        phase also stores them sorted to C. */
+    const sparse_matrix *a = job->a, *b = job->b;
+    int* idx = job->c ? job->c->idx + job->c->ptr[i] : NULL;
+    size_t k, l, n = 0, size = table_size(job->flops[i + 1] - job->flops[i], b->cols), mask = size - 1;
+
+    for (k = a->ptr[i]; k < a->ptr[i + 1]; k++)
+    {
+        double s = a->values[k];
+
+        for (l = b->ptr[a->idx[k]]; l < b->ptr[a->idx[k] + 1]; l++)
+        {
+            size_t h = hash_slot(keys, mask, b->idx[l]);
+
+            if (keys[h] == -1)
+            {
+                keys[h] = b->idx[l];
+                acc[h] = 0.0;
+                if (idx)
+                {
+                    idx[n] = b->idx[l];
+                }
+                n++;
+            }
+            acc[h] += s * b->values[l];
+        }
+    }
+
+    if (idx)
+    {
+        qsort(idx, n, sizeof(int), compare_int);
+
+        for (k = 0; k < n; k++)
+        {
+            job->c->values[job->c->ptr[i] + k] = acc[hash_slot(keys, mask, idx[k])];
+        }
+    }
+
+    for (k = 0; k < size; k++)
+    {
+        keys[k] = -1;
+    }
+
+    return n;
+}
+
+
+static void spgemm_task(void* ctx, int task, int worker) {
+    /* Counts (symbolic phase) or computes (numeric phase) the rows of C of a task. */
+    const spgemm_job* job = ctx;
+    int* keys = job->keys + (size_t)worker * job->width;
+    double* acc = job->acc + (size_t)worker * job->width;
+    int* found = job->found ? job->found + (size_t)worker * (job->width + 1) : NULL;
+    int i, end = prefix_start(job->flops, job->a->rows, task + 1, job->tasks);
+
+    for (i = prefix_start(job->flops, job->a->rows, task, job->tasks); i < end; i++)
+    {
+        size_t n = job->hashed ? hash_row(job, i, keys, acc) : dense_row(job, i, keys, acc, found);
+
+        if (!job->c)
+        {
+            job->counts[i] = n;
+        }
+    }
+}
+
+
+sparse_matrix* sparse_multiply_sparse(sparse_matrix* A, sparse_matrix* B){
+    /*  Returns a multiplication of sparse matrices A and B in CSR format. A
+        symbolic phase counts the elements of every row of the result, a
+        numeric phase then fills them in place. Both split rows across the
+        thread pool by their number of multiply-adds. Sums that cancel out
+        stay stored as zeros. */
+
+    sparse_matrix *a = A, *b = B, *c = NULL;
+    spgemm_job job;
+    size_t* flops = NULL;
+    size_t* counts = NULL;
+    size_t widest = 0, total;
+    int workers = 1, i;
+
+    if (!A || !B) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return NULL;
+    }
+
+    if (A->cols != B->rows)
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return NULL;
+    }
+
+    // Rows of C are combinations of rows of B, so both are needed row by row
+    if ((A->format != SPARSE_CSR && (a = sparse_convert(A, SPARSE_CSR)) == NULL) ||
+        (B->format != SPARSE_CSR && (b = sparse_convert(B, SPARSE_CSR)) == NULL))
+    {
+        if (a != A)
+        {
+            destroy_sparse_matrix(a);
+        }
+        return NULL;
+    }
+
+    memset(&job, 0, sizeof(job));
+    flops = malloc(((size_t)a->rows + 1) * sizeof(size_t));
+    counts = malloc(((size_t)a->rows + 1) * sizeof(size_t));
+
+    if (flops != NULL && counts != NULL)
+    {
+        flops[0] = 0;
+        for (i = 0; i < a->rows; i++)
+        {
+            size_t n = row_flops(a, b, i);
+
+            widest = n > widest ? n : widest;
+            flops[i + 1] = flops[i] + n;
+        }
+
+        job.a = a;
+        job.b = b;
+        job.flops = flops;
+        job.counts = counts;
+        job.hashed = b->cols > SPARSE_DENSE_COLUMNS;
+        job.width = job.hashed ? table_size(widest, b->cols) : (size_t)b->cols;
+        workers = sparse_workers(flops[a->rows]);
+        job.tasks = workers > 1 ? workers * SPARSE_TASKS_PER_WORKER : 1;
+        job.keys = malloc((size_t)workers * job.width * sizeof(int));
+        job.acc = calloc((size_t)workers * job.width, sizeof(double));
+        job.found = job.hashed ? NULL : malloc((size_t)workers * (job.width + 1) * sizeof(int));
+    }
+
+    if (job.keys == NULL || job.acc == NULL || (!job.hashed && job.found == NULL))
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+    }else{
+        memset(job.keys, -1, (size_t)workers * job.width * sizeof(int));
+        thread_pool_run(job.tasks, workers, spgemm_task, &job);
+
+        for (i = 0, total = 0; i < a->rows; i++)
+        {
+            size_t n = counts[i];
+
+            counts[i] = total;
+            total += n;
+        }
+        counts[a->rows] = total;
+
+        if ((c = create_sparse_matrix(a->rows, b->cols, total, SPARSE_CSR)) != NULL)
+        {
+            memcpy(c->ptr, counts, ((size_t)a->rows + 1) * sizeof(size_t));
+
+            // Dense markers still hold the rows of the symbolic phase
+            if (!job.hashed)
+            {
+                memset(job.keys, -1, (size_t)workers * job.width * sizeof(int));
+            }
+            job.c = c;
+            thread_pool_run(job.tasks, workers, spgemm_task, &job);
+            error = MATRIX_OK;
+        }
+    }
+
+    free(job.keys);
+    free(job.acc);
+    free(job.found);
+    free(flops);
+    free(counts);
+    if (a != A)
+    {
+        destroy_sparse_matrix(a);
+    }
+    if (b != B)
+    {
+        destroy_sparse_matrix(b);
+    }
+    return c;
+}
@@ -0,0 +1,58 @@
+/*
+    sparse.h    version 1.0
+
+    Header file for sparse.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_SPARSE
+#define MAT_SPARSE
+
+#include <stddef.h>
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    SPARSE_CSR,     // compressed sparse rows
+    SPARSE_CSC,     // compressed sparse columns
+    SPARSE_FORMAT_COUNT
+} sparse_format;
+
+// Matrix storing only its nonzero elements, indices within a row (column) are sorted and unique
+typedef struct
+{
+    int rows;
+    int cols;
+    sparse_format format;
+    size_t nnz;         // number of stored elements
+    size_t* ptr;        // rows + 1 (CSC: cols + 1) offsets, row i is stored at [ptr[i], ptr[i + 1])
+    int* idx;           // column (CSC: row) index of every stored element
+    double* values;     // value of every stored element
+} sparse_matrix;
+
+extern sparse_matrix* create_sparse_matrix(int rows, int cols, size_t nnz, sparse_format format);
+extern sparse_matrix* sparse_from_triplets(int rows, int cols, size_t nnz, const int* row_idx, const int* col_idx,
+                                           const double* values, sparse_format format);
+extern void destroy_sparse_matrix(sparse_matrix* mat);
+extern sparse_matrix* dense_to_sparse(matrix* mat, sparse_format format);
+extern matrix* sparse_to_dense(sparse_matrix* mat);
+extern sparse_matrix* sparse_convert(sparse_matrix* mat, sparse_format format);
+extern double sparse_get_value(sparse_matrix* mat, int i, int j);
+extern void sparse_multiply_vector(double alpha, sparse_matrix* A, const double* x, double beta, double* y);
+extern void sparse_multiply_dense(double alpha, sparse_matrix* A, matrix* B, double beta, matrix* C);
+extern matrix* sparse_multiply_by_matrix(sparse_matrix* A, matrix* B);
+extern sparse_matrix* sparse_multiply_sparse(sparse_matrix* A, sparse_matrix* B);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,454 @@
+/*
+    svd.c    version 1.0
+
+    Module for singular value decompositions.
+    --------------------------
+
+    The full decomposition factors A = Q * R first and applies one-sided
+    Jacobi rotations to the columns of R until they are orthogonal, which
+    is accurate and fast for small and moderate matrices. Rotations of
+    disjoint pairs of columns run in parallel in round-robin order.
+
+    The randomized decomposition of a large matrix finds an orthonormal
+    basis Q of the range of A * Omega for a Gaussian Omega of a few more
+    columns than the wanted rank, refined by power iterations, and
+    decomposes the small matrix Q^T * A. Its cost is a few products with
+    A through gemm.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include "svd.h"
+#include "thread_pool.h"
+#include "matrix_view.h"
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+// Sweeps over all pairs of columns allowed before Jacobi gives up
+#define JACOBI_SWEEPS 60
+
+// Columns of the sketch above the wanted rank when the caller passes a negative oversampling
+#define DEFAULT_OVERSAMPLING 10
+
+// Seed of the Gaussian sketch, fixed so that results are reproducible
+#define SKETCH_SEED 0x9E3779B97F4A7C15ull
+
+// One round of Jacobi rotations, the pairs of a round share no column
+typedef struct
+{
+    matrix* g;          // columns of the factored matrix as rows
+    matrix* vt;         // columns of V as rows, NULL if V is not wanted
+    int count;          // columns, odd counts get a dummy column
+    int round;
+    int* rotated;       // set by every pair that was rotated
+} jacobi_job;
+
+
+static void rotate_rows(matrix* mat, int p, int q, double c, double s) {
+    /* Replaces rows p and q of mat by c * p - s * q and s * p + c * q. */
+    double *x = &MATRIX_AT(mat, p, 0), *y = &MATRIX_AT(mat, q, 0), tmp;
+    int i;
+
+    for (i = 0; i < mat->cols; i++)
+    {
+        tmp = x[i];
+        x[i] = c * tmp - s * y[i];
+        y[i] = s * tmp + c * y[i];
+    }
+}
+
+
+static void jacobi_task(void* ctx, int task, int worker) {
+    /*  Orthogonalizes one pair of the round by the rotation that zeroes
+        their inner product, unless it is already negligible. */
+    jacobi_job* job = ctx;
+    int n = job->count + (job->count & 1), p, q, i;
+    double *x, *y, alpha = 0.0, beta = 0.0, gamma = 0.0, zeta, t, c;
+    (void)worker;
+
+    // Round-robin pairing: column 0 stays, the others rotate by one per round
+    p = task == 0 ? 0 : (task - 1 + job->round) % (n - 1) + 1;
+    q = (n - 2 - task + job->round) % (n - 1) + 1;
+    job->rotated[task] = 0;
+    if (p >= job->count || q >= job->count)
+    {
+        return;
+    }
+
+    x = &MATRIX_AT(job->g, p, 0);
+    y = &MATRIX_AT(job->g, q, 0);
+    for (i = 0; i < job->g->cols; i++)
+    {
+        alpha += x[i] * x[i];
+        beta += y[i] * y[i];
+        gamma += x[i] * y[i];
+    }
+
+    if (fabs(gamma) <= job->g->cols * DBL_EPSILON * sqrt(alpha * beta) || gamma == 0.0)
+    {
+        return;
+    }
+
+    zeta = (beta - alpha) / (2.0 * gamma);
+    t = copysign(1.0, zeta) / (fabs(zeta) + sqrt(1.0 + zeta * zeta));
+    c = 1.0 / sqrt(1.0 + t * t);
+
+    rotate_rows(job->g, p, q, c, c * t);
+    if (job->vt)
+    {
+        rotate_rows(job->vt, p, q, c, c * t);
+    }
+    job->rotated[task] = 1;
+}
+
+
+static int jacobi(matrix* g, matrix* vt) {
+    /*  Rotates the rows of g, the columns of the matrix being decomposed,
+        until they are mutually orthogonal. The same rotations are applied
+        to the rows of vt if it is given. Returns 1 if Jacobi does not
+        converge. */
+    jacobi_job job;
+    int sweep, pairs = (g->rows + 1) / 2, rotations = 1, i;
+
+    if (g->rows < 2)
+    {
+        return 0;
+    }
+
+    if ((job.rotated = malloc(pairs * sizeof(int))) == NULL)
+    {
+        return -1;
+    }
+    job.g = g;
+    job.vt = vt;
+    job.count = g->rows;
+
+    for (sweep = 0; sweep < JACOBI_SWEEPS && rotations > 0; sweep++)
+    {
+        rotations = 0;
+        for (job.round = 0; job.round < job.count + (job.count & 1) - 1; job.round++)
+        {
+            thread_pool_run(pairs, thread_pool_size(), jacobi_task, &job);
+            for (i = 0; i < pairs; i++)
+            {
+                rotations += job.rotated[i];
+            }
+        }
+    }
+
+    free(job.rotated);
+    return rotations > 0;
+}
+
+
+static void tall_svd(matrix* a, double* s, matrix* u, matrix* v) {
+    /*  Decomposes a with at least as many rows as columns. Jacobi works on
+        the rows of g = R^T from a = Q * R, then U = Q * (R's left vectors). */
+    int m = a->rows, n = a->cols, i, j, p, failed;
+    matrix *qr = NULL, *g = NULL, *vt = NULL, *ur = NULL, top;
+    double *tau = malloc(n * sizeof(double)), norm, tmp;
+    int* order = malloc(n * sizeof(int));
+
+    if (tau && order && (qr = materialize(a)) != NULL)
+    {
+        qr_factor(qr, tau);
+        g = create_zero_matrix(n, n);
+        vt = v ? create_unit_matrix(n, n) : NULL;
+        ur = u ? create_zero_matrix(m, n) : NULL;
+    }
+
+    if (!tau || !order || !qr || !g || (v && !vt) || (u && !ur))
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+        free(tau);
+        free(order);
+        destroy_matrix(qr);
+        destroy_matrix(g);
+        destroy_matrix(vt);
+        destroy_matrix(ur);
+        return;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0; j <= i; j++)
+        {
+            MATRIX_AT(g, i, j) = MATRIX_AT(qr, j, i);
+        }
+    }
+
+    failed = jacobi(g, vt);
+
+    // Singular values are the norms of the orthogonal columns, sorted in descending order
+    for (i = 0; i < n; i++)
+    {
+        norm = 0.0;
+        for (j = 0; j < n; j++)
+        {
+            norm += MATRIX_AT(g, i, j) * MATRIX_AT(g, i, j);
+        }
+        s[i] = sqrt(norm);
+        order[i] = i;
+    }
+    for (i = 1; i < n; i++)
+    {
+        for (j = i; j > 0 && s[j - 1] < s[j]; j--)
+        {
+            tmp = s[j];
+            s[j] = s[j - 1];
+            s[j - 1] = tmp;
+            p = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = p;
+        }
+    }
+
+    if (u && !failed)
+    {
+        // U = Q * [G^T / s; 0], a zero singular value leaves its column zero
+        top = sub_block(ur, 0, 0, n, n);
+        for (j = 0; j < n; j++)
+        {
+            for (i = 0; i < n; i++)
+            {
+                MATRIX_AT(&top, i, j) = s[j] > 0.0 ? MATRIX_AT(g, order[j], i) / s[j] : 0.0;
+            }
+        }
+        qr_apply_q(qr, tau, MATRIX_NO_TRANS, ur);
+        copy_into(u, ur);
+    }
+    if (v && !failed)
+    {
+        for (j = 0; j < n; j++)
+        {
+            for (i = 0; i < n; i++)
+            {
+                MATRIX_AT(v, i, j) = MATRIX_AT(vt, order[j], i);
+            }
+        }
+    }
+
+    if (failed)
+    {
+        error = failed < 0 ? MATRIX_NOMEM : MATRIX_OTHER_ERROR;
+        LOG_ERROR("Jacobi did not converge");
+    }else{
+        error = MATRIX_OK;
+    }
+
+    free(tau);
+    free(order);
+    destroy_matrix(qr);
+    destroy_matrix(g);
+    destroy_matrix(vt);
+    destroy_matrix(ur);
+}
+
+
+void svd(matrix* A, double* s, matrix* U, matrix* V){
+    /*  Computes the thin singular value decomposition A = U * diag(s) * V^T
+        with k = min(rows, cols) singular values s in descending order.
+        U (rows x k) and V (cols x k) receive the singular vectors as
+        columns, either may be NULL. A is kept. Sets MATRIX_OTHER_ERROR if
+        Jacobi does not converge. */
+
+    int k;
+    matrix* at;
+
+    if (!A || !s) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    k = A->rows < A->cols ? A->rows : A->cols;
+    if ((U && (U->rows != A->rows || U->cols != k)) || (V && (V->rows != A->cols || V->cols != k)))
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    if (A->rows >= A->cols)
+    {
+        tall_svd(A, s, U, V);
+        return;
+    }
+
+    // A^T = V * diag(s) * U^T
+    if ((at = transpose_view(A)) == NULL)
+    {
+        return;
+    }
+    tall_svd(at, s, V, U);
+    destroy_matrix(at);
+}
+
+
+static uint64_t next_random(uint64_t* state) {
+    /* Returns the next number of a xorshift64* generator. */
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+
+static void gaussian_fill(matrix* mat) {
+    /* Fills mat with independent standard normal numbers by the Box-Muller transform. */
+    uint64_t state = SKETCH_SEED;
+    double u1, u2, radius;
+    int i, j;
+
+    for (i = 0; i < mat->rows; i++)
+    {
+        for (j = 0; j < mat->cols; j += 2)
+        {
+            // 53 random bits, u1 is never 0
+            u1 = ((next_random(&state) >> 11) + 1.0) / 9007199254740993.0;
+            u2 = (next_random(&state) >> 11) / 9007199254740992.0;
+            radius = sqrt(-2.0 * log(u1));
+            MATRIX_AT(mat, i, j) = radius * cos(2.0 * M_PI * u2);
+            if (j + 1 < mat->cols)
+            {
+                MATRIX_AT(mat, i, j + 1) = radius * sin(2.0 * M_PI * u2);
+            }
+        }
+    }
+}
+
+
+static matrix* orthonormalize(matrix* y) {
+    /* Returns an orthonormal basis of the columns of y from its QR factorization and destroys y. */
+    double* tau = malloc(y->cols * sizeof(double));
+    matrix* q = NULL;
+
+    if (tau)
+    {
+        qr_factor(y, tau);
+        q = error == MATRIX_OK ? qr_form_q(y, tau, 0) : NULL;
+    }else{
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+    }
+
+    free(tau);
+    destroy_matrix(y);
+    return q;
+}
+
+
+static matrix* product(matrix* A, matrix_op op, matrix* q) {
+    /* Returns op(A) * q, or NULL if it can not be allocated. */
+    matrix* result = initialize_matrix(op == MATRIX_NO_TRANS ? A->rows : A->cols, q->cols);
+
+    if (result)
+    {
+        gemm(1.0, A, op, q, MATRIX_NO_TRANS, 0.0, result);
+    }
+    return result;
+}
+
+
+void svd_randomized(matrix* A, int rank, int oversampling, int power_iterations, double* s, matrix* U, matrix* V){
+    /*  Computes the rank largest singular values s of A in descending order
+        and, unless U or V is NULL, their singular vectors as columns of U
+        (rows x rank) and V (cols x rank). A Gaussian sketch of rank +
+        oversampling columns (10 if oversampling is negative) is multiplied
+        by A, refined by power_iterations products with A^T and A and
+        orthonormalized to Q. The small matrix Q^T * A is decomposed by
+        svd. Every power iteration makes the result more accurate for
+        slowly decaying singular values. A is kept. */
+
+    int m, n, l, i;
+    matrix *omega, *q = NULL, *z, *b = NULL, *ub = NULL, *vb = NULL, view;
+    double* sb = NULL;
+
+    if (!A || !s || rank < 1 || power_iterations < 0 || rank > (A->rows < A->cols ? A->rows : A->cols)) {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    m = A->rows;
+    n = A->cols;
+    if ((U && (U->rows != m || U->cols != rank)) || (V && (V->rows != n || V->cols != rank)))
+    {
+        error = MATRIX_TYPE_ERROR;
+        LOG_ERROR("Invalid matrix types");
+        return;
+    }
+
+    l = rank + (oversampling < 0 ? DEFAULT_OVERSAMPLING : oversampling);
+    l = l < m ? l : m;
+    l = l < n ? l : n;
+
+    // Q is an orthonormal basis of the range of (A * A^T)^power_iterations * A * Omega
+    if ((omega = initialize_matrix(n, l)) != NULL)
+    {
+        gaussian_fill(omega);
+        z = product(A, MATRIX_NO_TRANS, omega);
+        q = z ? orthonormalize(z) : NULL;
+        destroy_matrix(omega);
+    }
+    for (i = 0; i < power_iterations && q; i++)
+    {
+        z = product(A, MATRIX_TRANS, q);
+        destroy_matrix(q);
+        q = z ? orthonormalize(z) : NULL;
+        z = q ? product(A, MATRIX_NO_TRANS, q) : NULL;
+        destroy_matrix(q);
+        q = z ? orthonormalize(z) : NULL;
+    }
+
+    // B = Q^T * A = Ub * diag(s) * V^T, then U = Q * Ub
+    if (q && (b = product(A, MATRIX_TRANS, q)) != NULL)
+    {
+        sb = malloc(l * sizeof(double));
+        ub = initialize_matrix(l, l);
+        vb = initialize_matrix(n, l);
+    }
+
+    if (!q || !b || !sb || !ub || !vb)
+    {
+        error = MATRIX_NOMEM;
+        LOG_ERROR("Failed memory allocation");
+    }else{
+        // b holds B^T, so its left vectors are V and its right vectors Ub
+        svd(b, sb, vb, ub);
+    }
+
+    if (error == MATRIX_OK)
+    {
+        memcpy(s, sb, rank * sizeof(double));
+        if (U)
+        {
+            view = sub_block(ub, 0, 0, l, rank);
+            gemm(1.0, q, MATRIX_NO_TRANS, &view, MATRIX_NO_TRANS, 0.0, U);
+        }
+        if (V)
+        {
+            view = sub_block(vb, 0, 0, n, rank);
+            copy_into(V, &view);
+        }
+    }
+
+    destroy_matrix(q);
+    destroy_matrix(b);
+    destroy_matrix(ub);
+    destroy_matrix(vb);
+    free(sb);
+}
@@ -0,0 +1,29 @@
+/*
+    svd.h    version 1.0
+
+    Header file for svd.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_SVD
+#define MAT_SVD
+
+#include "matrix.h"
+#include "linalg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void svd(matrix* A, double* s, matrix* U, matrix* V);
+extern void svd_randomized(matrix* A, int rank, int oversampling, int power_iterations, double* s, matrix* U, matrix* V);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
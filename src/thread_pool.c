@@ -0,0 +1,317 @@
+/*
+    thread_pool.c    version 1.0
+
+    Module with the persistent worker threads of the library.
+    --------------------------
+
+    Workers are started at the first parallel call and then sleep between
+    jobs, so parallel kernels pay no thread start-up cost per call. The
+    size is taken from matrix_set_num_threads, the MATRIX_NUM_THREADS
+    environment variable or the number of online processors.
+
+    Jakub Novák     March 2024
+
+*/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "matrix.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Define a macro for logging errors
+#ifdef ENABLE_LOGGING
+#include <stdio.h>
+#define LOG_ERROR(fmt, ...) fprintf(stderr, "[ERROR] %s:%d: " fmt "\n", __func__, __LINE__, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)
+#endif
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t wake;            // signals a new job or shutdown to workers
+    pthread_cond_t done;            // signals the caller that workers finished
+    pthread_t* threads;
+    int size;                       // participants including the calling thread
+    int started;                    // worker threads actually running
+    int shutdown;
+    unsigned long generation;       // incremented for every job
+    int pending;                    // workers still inside the current job
+
+    thread_pool_task fn;
+    void* ctx;
+    int tasks;
+    int max_workers;
+    atomic_int next_task;
+} thread_pool;
+
+typedef struct
+{
+    thread_pool* pool;
+    int worker;
+} worker_arg;
+
+// Serializes jobs and resizing, a busy pool makes other callers run serially
+static pthread_mutex_t submit_lock = PTHREAD_MUTEX_INITIALIZER;
+static thread_pool* pool = NULL;
+static atomic_int requested_threads = 0;
+static atomic_int default_threads = 0;
+
+
+static int default_num_threads(void) {
+    /* Returns MATRIX_NUM_THREADS or the number of online processors. */
+    const char* env;
+    long n = atomic_load(&default_threads);
+
+    if (n > 0)
+    {
+        return (int)n;
+    }
+
+    env = getenv("MATRIX_NUM_THREADS");
+    if (env != NULL && (n = strtol(env, NULL, 10)) > 0)
+    {
+        atomic_store(&default_threads, (int)n);
+        return (int)n;
+    }
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    n = info.dwNumberOfProcessors;
+#else
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    n = n > 0 ? n : 1;
+    atomic_store(&default_threads, (int)n);
+    return (int)n;
+}
+
+
+static void run_tasks(thread_pool* p, int worker) {
+    /* Takes tasks of the current job until none is left. */
+    int task;
+
+    if (worker >= p->max_workers)
+    {
+        return;
+    }
+
+    while ((task = atomic_fetch_add(&p->next_task, 1)) < p->tasks)
+    {
+        p->fn(p->ctx, task, worker);
+    }
+}
+
+
+static void* worker_main(void* arg) {
+    /* Sleeps until a job is published, helps with it and reports back. */
+    thread_pool* p = ((worker_arg*)arg)->pool;
+    int worker = ((worker_arg*)arg)->worker;
+    unsigned long seen = 0;
+
+    free(arg);
+
+    pthread_mutex_lock(&p->lock);
+    for (;;)
+    {
+        while (p->generation == seen && !p->shutdown)
+        {
+            pthread_cond_wait(&p->wake, &p->lock);
+        }
+        if (p->shutdown)
+        {
+            break;
+        }
+        seen = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        run_tasks(p, worker);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->pending == 0)
+        {
+            pthread_cond_signal(&p->done);
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+
+static thread_pool* create_pool(int size) {
+    /* Starts size - 1 workers, the calling thread is worker 0. */
+    thread_pool* p = calloc(1, sizeof(thread_pool));
+    int i;
+
+    if (p == NULL)
+    {
+        return NULL;
+    }
+
+    p->threads = calloc(size, sizeof(pthread_t));
+    if (p->threads == NULL)
+    {
+        free(p);
+        return NULL;
+    }
+
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    pthread_cond_init(&p->done, NULL);
+    atomic_init(&p->next_task, 0);
+
+    for (i = 1; i < size; i++)
+    {
+        worker_arg* arg = malloc(sizeof(worker_arg));
+
+        if (arg == NULL)
+        {
+            break;
+        }
+        arg->pool = p;
+        arg->worker = i;
+        if (pthread_create(&p->threads[i], NULL, worker_main, arg) != 0)
+        {
+            free(arg);
+            LOG_ERROR("Failed creating worker thread");
+            break;
+        }
+        p->started++;
+    }
+    p->size = p->started + 1;
+
+    return p;
+}
+
+
+static void destroy_pool(thread_pool* p) {
+    /* Wakes all workers for shutdown and joins them. */
+    int i;
+
+    if (p == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    p->shutdown = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    for (i = 1; i <= p->started; i++)
+    {
+        pthread_join(p->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->wake);
+    pthread_mutex_destroy(&p->lock);
+    free(p->threads);
+    free(p);
+}
+
+
+void matrix_set_num_threads(int num_threads){
+    /* Sets the number of threads used by parallel operations, 0 restores the default. */
+
+    if (num_threads < 0)
+    {
+        error = MATRIX_INVARGS;
+        LOG_ERROR("Invalid arguments");
+        return;
+    }
+
+    pthread_mutex_lock(&submit_lock);
+    atomic_store(&requested_threads, num_threads);
+    destroy_pool(pool);
+    pool = NULL;
+    pthread_mutex_unlock(&submit_lock);
+
+    error = MATRIX_OK;
+}
+
+
+int matrix_get_num_threads(void){
+    /* Returns the number of threads used by parallel operations. */
+
+    int n = atomic_load(&requested_threads);
+
+    return n > 0 ? n : default_num_threads();
+}
+
+
+int thread_pool_size(void){
+    /* Returns how many threads a parallel call may use. */
+
+    return matrix_get_num_threads();
+}
+
+
+void thread_pool_run(int tasks, int max_workers, thread_pool_task fn, void* ctx){
+    /*  Calls fn for every task in [0, tasks) on at most max_workers threads.
+        Returns when all tasks are finished. Nested or concurrent calls
+        run in the calling thread. */
+
+    int task;
+
+    if (tasks <= 0)
+    {
+        return;
+    }
+
+    if (tasks == 1 || max_workers <= 1 || pthread_mutex_trylock(&submit_lock) != 0)
+    {
+        for (task = 0; task < tasks; task++)
+        {
+            fn(ctx, task, 0);
+        }
+        return;
+    }
+
+    if (pool == NULL)
+    {
+        pool = create_pool(matrix_get_num_threads());
+    }
+
+    if (pool == NULL || pool->size == 1)
+    {
+        pthread_mutex_unlock(&submit_lock);
+        for (task = 0; task < tasks; task++)
+        {
+            fn(ctx, task, 0);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->tasks = tasks;
+    pool->max_workers = max_workers;
+    atomic_store(&pool->next_task, 0);
+    pool->pending = pool->started;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_tasks(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&submit_lock);
+}
@@ -0,0 +1,32 @@
+/*
+    thread_pool.h    version 1.0
+
+    Header file for thread_pool.c module.
+    ------------------------------------
+
+
+    Jakub Novák     March 2024
+
+*/
+
+#ifndef MAT_THREAD_POOL
+#define MAT_THREAD_POOL
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Runs one task of a parallel loop, worker is below max_workers of thread_pool_run
+typedef void (*thread_pool_task)(void* ctx, int task, int worker);
+
+extern void matrix_set_num_threads(int num_threads);
+extern int matrix_get_num_threads(void);
+
+extern int thread_pool_size(void);
+extern void thread_pool_run(int tasks, int max_workers, thread_pool_task fn, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
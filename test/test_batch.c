@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "unity.h"
+#include "matrix.h"
+#include "simd.h"
+#include "batch.h"
+#include "thread_pool.h"
+
+matrix *mat1, *mat2, *mat3;
+
+
+static double* random_array(size_t n) {
+    double* data = malloc(n * sizeof(double));
+
+    for (size_t i = 0; i < n; i++) {
+        data[i] = (double)rand() / RAND_MAX - 0.5;
+    }
+    return data;
+}
+
+
+static double reference(int m, int n, int k, double alpha, const double* a, const double* b, double beta,
+                        double c, int i, int j, ptrdiff_t stride_a, ptrdiff_t stride_b) {
+    // Element (i, j) of alpha * A * B + beta * C with elements of A and B stride apart
+    double sum = 0.0;
+    (void)m;
+
+    for (int p = 0; p < k; p++) {
+        sum += a[(i * k + p) * stride_a] * b[(p * n + j) * stride_b];
+    }
+    return alpha * sum + beta * c;
+}
+
+
+static void check_strided(int count, int m, int n, int k, int broadcast) {
+    // Compares a strided batch with products computed element by element
+    ptrdiff_t stride_a = broadcast ? 0 : (ptrdiff_t)m * k + 1, stride_b = (ptrdiff_t)k * n, stride_c = (ptrdiff_t)m * n + 3;
+    double *a = random_array(broadcast ? (size_t)m * k : (size_t)count * stride_a), *b = random_array((size_t)count * stride_b);
+    double *c = random_array((size_t)count * stride_c), *old = malloc((size_t)count * stride_c * sizeof(double));
+
+    for (size_t i = 0; i < (size_t)count * stride_c; i++) {
+        old[i] = c[i];
+    }
+    gemm_batch_strided(count, m, n, k, 1.5, a, stride_a, b, stride_b, -0.5, c, stride_c);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    for (int t = 0; t < count; t++) {
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                double expected = reference(m, n, k, 1.5, a + t * stride_a, b + t * stride_b, -0.5,
+                                            old[t * stride_c + i * n + j], i, j, 1, 1);
+                TEST_ASSERT_DOUBLE_WITHIN(1e-12, expected, c[t * stride_c + i * n + j]);
+            }
+        }
+        // Padding between the matrices of C is kept
+        TEST_ASSERT_EQUAL_DOUBLE(old[t * stride_c + m * n], c[t * stride_c + m * n]);
+    }
+
+    free(a);
+    free(b);
+    free(c);
+    free(old);
+}
+
+
+static void check_interleaved(int count, int m, int n, int k) {
+    // Compares an interleaved batch with products computed element by element
+    double *a = random_array((size_t)count * m * k), *b = random_array((size_t)count * k * n);
+    double *c = random_array((size_t)count * m * n);
+
+    // beta 0 ignores NaN in C
+    for (size_t i = 0; i < (size_t)count * m * n; i++) {
+        c[i] = NAN;
+    }
+    gemm_batch_interleaved(count, m, n, k, 2.0, a, b, 0.0, c);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    for (int t = 0; t < count; t++) {
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < n; j++) {
+                double expected = reference(m, n, k, 2.0, a + t, b + t, 0.0, 0.0, i, j, count, count);
+                TEST_ASSERT_DOUBLE_WITHIN(1e-12, expected, c[(i * n + j) * count + t]);
+            }
+        }
+    }
+
+    free(a);
+    free(b);
+    free(c);
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_isa(matrix_detect_isa());
+    matrix_set_num_threads(0);
+}
+
+
+void test_gemm_batch_strided(void) {
+    int sizes[] = { 1, 3, 4, 5, 6, 8, 16, 17, 64 };
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        for (int s = 0; s < (int)ARRAY_LEN(sizes); s++) {
+            check_strided(7, sizes[s], sizes[s], sizes[s], 0);
+        }
+        check_strided(9, 4, 7, 3, 0);
+        check_strided(5, 13, 2, 9, 1);
+    }
+
+    // Batches large enough to be split across workers
+    matrix_set_num_threads(3);
+    check_strided(5000, 4, 4, 4, 0);
+    check_strided(300, 12, 10, 11, 1);
+}
+
+
+void test_gemm_batch_interleaved(void) {
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        check_interleaved(1, 3, 3, 3);
+        check_interleaved(21, 4, 4, 4);
+        check_interleaved(37, 5, 7, 2);
+    }
+
+    matrix_set_num_threads(3);
+    check_interleaved(5003, 4, 4, 4);
+    check_interleaved(100, 40, 30, 20);
+}
+
+
+void test_gemm_batch_should_fail(void) {
+    double a[16] = { 0 }, b[16] = { 0 }, c[16] = { 0 };
+
+    gemm_batch_strided(2, 2, 2, 2, 1.0, NULL, 4, b, 4, 0.0, c, 4);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    gemm_batch_strided(2, 2, 2, 2, 1.0, a, 3, b, 4, 0.0, c, 4);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    gemm_batch_strided(2, 2, 2, 2, 1.0, a, 4, b, 4, 0.0, c, 0);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    gemm_batch_interleaved(2, 0, 2, 2, 1.0, a, b, 0.0, c);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    // An empty batch does nothing
+    gemm_batch_interleaved(0, 2, 2, 2, 1.0, a, b, 0.0, c);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_gemm_batch_strided);
+    RUN_TEST(test_gemm_batch_interleaved);
+    RUN_TEST(test_gemm_batch_should_fail);
+    return UNITY_END();
+}
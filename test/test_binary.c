@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "matrix.h"
+#include "binary.h"
+
+matrix *mat1, *mat2, *mat3;
+
+static const char* temp_filename = "temp_test_matrix.bin";
+
+
+static matrix* counting_matrix(int rows, int cols) {
+    matrix* mat = initialize_matrix(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            MATRIX_AT(mat, i, j) = i * 1000 + j + 0.25;
+        }
+    }
+    return mat;
+}
+
+
+static int equal_matrices(matrix* a, matrix* b) {
+    if (a->rows != b->rows || a->cols != b->cols) {
+        return 0;
+    }
+    for (int i = 0; i < a->rows; i++) {
+        if (memcmp(&MATRIX_AT(a, i, 0), &MATRIX_AT(b, i, 0), a->cols * sizeof(double)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = counting_matrix(13, 7);
+    save_to_binary(mat1, temp_filename);
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    destroy_matrix(mat1);
+    remove(temp_filename);
+}
+
+
+void test_binary_header_layout(void) {
+    FILE* f = fopen(temp_filename, "rb");
+    matrix_bin_header header;
+
+    TEST_ASSERT_EQUAL_INT(64, sizeof(matrix_bin_header));
+    TEST_ASSERT_EQUAL_INT(1, fread(&header, sizeof(header), 1, f));
+    fclose(f);
+
+    TEST_ASSERT_EQUAL_STRING(MATRIX_BIN_MAGIC, header.magic);
+    TEST_ASSERT_EQUAL_UINT64(13, header.rows);
+    TEST_ASSERT_EQUAL_UINT64(7, header.cols);
+    TEST_ASSERT_EQUAL_UINT64(0, header.data_offset % MATRIX_ALIGNMENT);
+}
+
+
+void test_binary_round_trip(void) {
+    mat2 = read_from_binary(temp_filename);
+
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_TRUE(equal_matrices(mat1, mat2));
+
+    destroy_matrix(mat2);
+}
+
+
+void test_binary_mmap_read(void) {
+    mat2 = mmap_matrix(temp_filename, MATRIX_MAP_READ);
+
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_NOT_NULL(mat2->mapping);
+    TEST_ASSERT_EQUAL_INT(0, (size_t)mat2->buffer % MATRIX_ALIGNMENT);
+    TEST_ASSERT_TRUE(equal_matrices(mat1, mat2));
+
+    // Mapped matrices work as operands of every operation
+    mat3 = add(mat1, mat2);
+    TEST_ASSERT_EQUAL_DOUBLE(2 * (12 * 1000 + 6 + 0.25), get_value(mat3, 13, 7));
+
+    destroy_matrix(mat3);
+    destroy_matrix(mat2);
+}
+
+
+void test_binary_mmap_write_and_copy(void) {
+    mat2 = mmap_matrix(temp_filename, MATRIX_MAP_COPY);
+    set_value(mat2, 1, 1, -1.0);
+    destroy_matrix(mat2);
+
+    mat2 = mmap_matrix(temp_filename, MATRIX_MAP_WRITE);
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, get_value(mat2, 1, 1));
+    set_value(mat2, 1, 1, -1.0);
+    destroy_matrix(mat2);
+
+    mat2 = read_from_binary(temp_filename);
+    TEST_ASSERT_EQUAL_DOUBLE(-1.0, get_value(mat2, 1, 1));
+    destroy_matrix(mat2);
+}
+
+
+void test_binary_should_reject_other_files(void) {
+    FILE* f = fopen(temp_filename, "wb");
+    fputs("1 2 3\n4 5 6\n", f);
+    fclose(f);
+
+    TEST_ASSERT_NULL(read_from_binary(temp_filename));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    TEST_ASSERT_NULL(mmap_matrix(temp_filename, MATRIX_MAP_READ));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    TEST_ASSERT_NULL(mmap_matrix("does_not_exist.bin", MATRIX_MAP_READ));
+    TEST_ASSERT_EQUAL(MATRIX_OPENING_ERROR, error);
+}
+
+
+void test_binary_should_reject_truncated_file(void) {
+    FILE* f = fopen(temp_filename, "r+b");
+    matrix_bin_header header;
+
+    TEST_ASSERT_EQUAL_INT(1, fread(&header, sizeof(header), 1, f));
+    header.rows = 1000;
+    fseek(f, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, f);
+    fclose(f);
+
+    TEST_ASSERT_NULL(mmap_matrix(temp_filename, MATRIX_MAP_READ));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_binary_header_layout);
+    RUN_TEST(test_binary_round_trip);
+    RUN_TEST(test_binary_mmap_read);
+    RUN_TEST(test_binary_mmap_write_and_copy);
+    RUN_TEST(test_binary_should_reject_other_files);
+    RUN_TEST(test_binary_should_reject_truncated_file);
+    return UNITY_END();
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "unity.h"
+#include "matrix.h"
+#include "gemm.h"
+#include "eigen.h"
+#include "thread_pool.h"
+
+matrix *mat1, *mat2, *mat3;
+
+
+static matrix* random_symmetric(int n) {
+    // The upper triangle is garbage, only the lower one is read
+    matrix* mat = initialize_matrix(n, n);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            MATRIX_AT(mat, i, j) = j <= i ? (double)rand() / RAND_MAX - 0.5 : 1e3;
+        }
+    }
+    return mat;
+}
+
+
+static matrix* with_eigenvalues(int n, const double* values) {
+    // H * diag(values) * H for the reflector H = I - 2 * u * u^T / (u^T * u)
+    matrix *h = create_unit_matrix(n, n), *tmp = create_zero_matrix(n, n), *mat = create_zero_matrix(n, n);
+    double* u = malloc(n * sizeof(double));
+    double norm = 0.0;
+
+    for (int i = 0; i < n; i++) {
+        u[i] = (double)rand() / RAND_MAX - 0.5;
+        norm += u[i] * u[i];
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            MATRIX_AT(h, i, j) -= 2.0 * u[i] * u[j] / norm;
+            MATRIX_AT(tmp, i, j) = MATRIX_AT(h, i, j) * values[j];
+        }
+    }
+    gemm(1.0, tmp, MATRIX_NO_TRANS, h, MATRIX_NO_TRANS, 0.0, mat);
+
+    destroy_matrix(h);
+    destroy_matrix(tmp);
+    free(u);
+    return mat;
+}
+
+
+static void check_eigenpairs(matrix* a, const double* values, matrix* vectors, double tolerance) {
+    // A * V = V * diag(values) for the lower triangle of A, V^T * V = I and ascending values
+    int n = a->rows, k = vectors->cols;
+    matrix *full = initialize_matrix(n, n), *av = create_zero_matrix(n, k), *vtv = create_zero_matrix(k, k);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            MATRIX_AT(full, i, j) = j <= i ? MATRIX_AT(a, i, j) : MATRIX_AT(a, j, i);
+        }
+    }
+    gemm(1.0, full, MATRIX_NO_TRANS, vectors, MATRIX_NO_TRANS, 0.0, av);
+    gemm(1.0, vectors, MATRIX_TRANS, vectors, MATRIX_NO_TRANS, 0.0, vtv);
+
+    for (int j = 0; j < k; j++) {
+        if (j > 0) {
+            TEST_ASSERT_TRUE(values[j - 1] <= values[j]);
+        }
+        for (int i = 0; i < n; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(tolerance, MATRIX_AT(vectors, i, j) * values[j], MATRIX_AT(av, i, j));
+        }
+        for (int i = 0; i < k; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(tolerance, i == j ? 1.0 : 0.0, MATRIX_AT(vtv, i, j));
+        }
+    }
+
+    destroy_matrix(full);
+    destroy_matrix(av);
+    destroy_matrix(vtv);
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = random_symmetric(300);
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_num_threads(0);
+    destroy_matrix(mat1);
+}
+
+
+void test_eigen_symmetric(void) {
+    // Several panels of the reduction and levels of divide and conquer
+    double *values = malloc(300 * sizeof(double)), *only = malloc(300 * sizeof(double));
+    int threads[] = { 1, 3 };
+
+    mat2 = initialize_matrix(300, 300);
+    for (int t = 0; t < 2; t++) {
+        matrix_set_num_threads(threads[t]);
+        eigen_symmetric(mat1, values, mat2);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+        check_eigenpairs(mat1, values, mat2, 1e-11);
+
+        eigen_symmetric(mat1, only, NULL);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+        for (int i = 0; i < 300; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-12, values[i], only[i]);
+        }
+    }
+
+    // Eigenvectors written through a transposed view
+    mat3 = transpose_view(mat2);
+    eigen_symmetric(mat1, values, mat3);
+    check_eigenpairs(mat1, values, mat3, 1e-11);
+
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+    free(values);
+    free(only);
+}
+
+
+void test_eigen_repeated_values(void) {
+    // Clusters of equal eigenvalues are deflated and still get orthogonal eigenvectors
+    double expected[200], values[200];
+
+    for (int i = 0; i < 200; i++) {
+        expected[i] = (i % 7) - 3.0;
+    }
+    mat2 = with_eigenvalues(200, expected);
+    mat3 = initialize_matrix(200, 200);
+
+    eigen_symmetric(mat2, values, mat3);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    check_eigenpairs(mat2, values, mat3, 1e-11);
+    for (int i = 0, v = -3, count = 0; i < 200; i++, count++) {
+        // 29 copies of -3, ..., 0 and 28 copies of 1, 2, 3
+        if (count == (v <= 0 ? 29 : 28)) {
+            v++;
+            count = 0;
+        }
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, v, values[i]);
+    }
+    destroy_matrix(mat3);
+
+    // The range solver orthogonalizes a whole cluster
+    mat3 = initialize_matrix(200, 40);
+    eigen_symmetric_range(mat2, 20, 40, values, mat3);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    check_eigenpairs(mat2, values, mat3, 1e-10);
+
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_eigen_symmetric_range(void) {
+    double *all = malloc(300 * sizeof(double)), values[25];
+    int threads[] = { 1, 3 };
+
+    eigen_symmetric(mat1, all, NULL);
+    mat2 = initialize_matrix(300, 25);
+    for (int t = 0; t < 2; t++) {
+        matrix_set_num_threads(threads[t]);
+        eigen_symmetric_range(mat1, 140, 25, values, mat2);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+        check_eigenpairs(mat1, values, mat2, 1e-11);
+        for (int i = 0; i < 25; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-12, all[140 + i], values[i]);
+        }
+    }
+
+    // Largest eigenvalue only
+    eigen_symmetric_range(mat1, 299, 1, values, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, all[299], values[0]);
+
+    destroy_matrix(mat2);
+    free(all);
+}
+
+
+void test_eigen_small_matrices(void) {
+    // The path graph Laplacian has eigenvalues 2 - 2 cos(k pi / (n + 1))
+    double values[5], single;
+
+    mat2 = create_zero_matrix(5, 5);
+    for (int i = 0; i < 5; i++) {
+        MATRIX_AT(mat2, i, i) = 2.0;
+        if (i > 0) {
+            MATRIX_AT(mat2, i, i - 1) = -1.0;
+        }
+    }
+    mat3 = initialize_matrix(5, 5);
+    eigen_symmetric(mat2, values, mat3);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int k = 0; k < 5; k++) {
+        TEST_ASSERT_DOUBLE_WITHIN(1e-14, 2.0 - 2.0 * cos((k + 1) * M_PI / 6.0), values[k]);
+    }
+    check_eigenpairs(mat2, values, mat3, 1e-14);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+
+    mat2 = initialize_matrix(1, 1);
+    mat3 = initialize_matrix(1, 1);
+    MATRIX_AT(mat2, 0, 0) = -4.5;
+    eigen_symmetric(mat2, &single, mat3);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_EQUAL_DOUBLE(-4.5, single);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, fabs(MATRIX_AT(mat3, 0, 0)));
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_eigen_should_fail(void) {
+    double values[300];
+
+    mat2 = initialize_matrix(300, 299);
+    eigen_symmetric(mat2, values, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    eigen_symmetric(mat1, values, mat2);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    eigen_symmetric(mat1, NULL, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    eigen_symmetric_range(mat1, 290, 11, values, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    eigen_symmetric_range(mat1, 0, 10, values, mat2);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    destroy_matrix(mat2);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_eigen_symmetric);
+    RUN_TEST(test_eigen_repeated_values);
+    RUN_TEST(test_eigen_symmetric_range);
+    RUN_TEST(test_eigen_small_matrices);
+    RUN_TEST(test_eigen_should_fail);
+    return UNITY_END();
+}
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "matrix.h"
+#include "gemm.h"
+#include "matrix_f32.h"
+#include "thread_pool.h"
+#include "math.h"
+#include "test_helpers.h"
+
+matrix *mat1, *mat2, *mat3;
+
+
+static double reference_element(matrix* a, matrix_op op_a, matrix* b, matrix_op op_b, int i, int j) {
+    // Naive dot product of the i-th row of op(a) and the j-th column of op(b)
+    int depth = op_a == MATRIX_TRANS ? a->rows : a->cols;
+    double sum = 0.0;
+
+    for (int p = 0; p < depth; p++) {
+        double x = op_a == MATRIX_TRANS ? MATRIX_AT(a, p, i) : MATRIX_AT(a, i, p);
+        double y = op_b == MATRIX_TRANS ? MATRIX_AT(b, j, p) : MATRIX_AT(b, p, j);
+        sum += x * y;
+    }
+    return sum;
+}
+
+
+static int check_gemm(int m, int n, int k, matrix_op op_a, matrix_op op_b, double alpha, double beta) {
+    // Runs gemm on random data and compares it with the naive product
+    matrix *a, *b, *c, *c0;
+    int ok = 1;
+
+    a = op_a == MATRIX_TRANS ? random_matrix(k, m) : random_matrix(m, k);
+    b = op_b == MATRIX_TRANS ? random_matrix(n, k) : random_matrix(k, n);
+    c = random_matrix(m, n);
+    c0 = multiply_by_scalar(c, 1);
+
+    gemm(alpha, a, op_a, b, op_b, beta, c);
+    if (error != MATRIX_OK) {
+        ok = 0;
+    }
+
+    for (int i = 0; i < m && ok; i++) {
+        for (int j = 0; j < n && ok; j++) {
+            double expected = alpha * reference_element(a, op_a, b, op_b, i, j) + beta * MATRIX_AT(c0, i, j);
+            if (fabs(expected - MATRIX_AT(c, i, j)) > 1e-9 * (1 + k)) {
+                ok = 0;
+            }
+        }
+    }
+
+    destroy_matrix(a);
+    destroy_matrix(b);
+    destroy_matrix(c);
+    destroy_matrix(c0);
+    return ok;
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+}
+
+
+void test_gemm_small_product(void) {
+    TEST_ASSERT_TRUE(check_gemm(3, 5, 4, MATRIX_NO_TRANS, MATRIX_NO_TRANS, 1.0, 0.0));
+}
+
+
+void test_gemm_blocked_product(void) {
+    // Sizes not divisible by any block size exercise the edge tiles
+    TEST_ASSERT_TRUE(check_gemm(131, 77, 301, MATRIX_NO_TRANS, MATRIX_NO_TRANS, 1.0, 0.0));
+}
+
+
+void test_gemm_transposed_operands(void) {
+    TEST_ASSERT_TRUE(check_gemm(67, 45, 90, MATRIX_TRANS, MATRIX_NO_TRANS, 1.0, 0.0));
+    TEST_ASSERT_TRUE(check_gemm(67, 45, 90, MATRIX_NO_TRANS, MATRIX_TRANS, 1.0, 0.0));
+    TEST_ASSERT_TRUE(check_gemm(67, 45, 90, MATRIX_TRANS, MATRIX_TRANS, 1.0, 0.0));
+}
+
+
+void test_gemm_alpha_beta(void) {
+    TEST_ASSERT_TRUE(check_gemm(50, 60, 70, MATRIX_NO_TRANS, MATRIX_NO_TRANS, -2.5, 0.5));
+    TEST_ASSERT_TRUE(check_gemm(5, 6, 7, MATRIX_NO_TRANS, MATRIX_NO_TRANS, 0.0, 3.0));
+}
+
+
+void test_gemm_should_fail_on_mismatch(void) {
+    mat1 = create_unit_matrix(3, 4);
+    mat2 = create_unit_matrix(3, 4);
+    mat3 = create_zero_matrix(3, 4);
+
+    gemm(1.0, mat1, MATRIX_NO_TRANS, mat2, MATRIX_NO_TRANS, 0.0, mat3);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    gemm(1.0, mat1, MATRIX_NO_TRANS, mat2, MATRIX_TRANS, 0.0, mat3);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_multiply_by_matrix_large(void) {
+    mat1 = random_matrix(90, 110);
+    mat2 = random_matrix(110, 70);
+    mat3 = multiply_by_matrix(mat1, mat2);
+
+    TEST_ASSERT_NOT_NULL(mat3);
+    TEST_ASSERT_EQUAL_INT(90, mat3->rows);
+    TEST_ASSERT_EQUAL_INT(70, mat3->cols);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-9, reference_element(mat1, MATRIX_NO_TRANS, mat2, MATRIX_NO_TRANS, 89, 69), MATRIX_AT(mat3, 89, 69));
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_multiply_transposed_views(void) {
+    matrix *at, *bt, *ct, *expected;
+
+    mat1 = random_matrix(110, 90);
+    mat2 = random_matrix(70, 110);
+    at = transpose_view(mat1);
+    bt = transpose_view(mat2);
+
+    // A^T * B^T through views matches gemm with transposed operands
+    expected = initialize_matrix(90, 70);
+    gemm(1.0, mat1, MATRIX_TRANS, mat2, MATRIX_TRANS, 0.0, expected);
+    mat3 = multiply_by_matrix(at, bt);
+    TEST_ASSERT_NOT_NULL(mat3);
+    for (int i = 0; i < 90; i++) {
+        for (int j = 0; j < 70; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-12, MATRIX_AT(expected, i, j), MATRIX_AT(mat3, i, j));
+        }
+    }
+
+    // A result stored by columns receives the same product
+    destroy_matrix(mat3);
+    mat3 = create_zero_matrix(70, 90);
+    ct = transpose_view(mat3);
+    multiply_by_matrix_into(ct, at, bt);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < 90; i++) {
+        for (int j = 0; j < 70; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-12, MATRIX_AT(expected, i, j), MATRIX_AT(mat3, j, i));
+        }
+    }
+
+    destroy_matrix(ct);
+    destroy_matrix(at);
+    destroy_matrix(bt);
+    destroy_matrix(expected);
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_gemm_tall_skinny_many_threads(void) {
+    // Panels narrower than the workers still get whole micro-panels to pack
+    matrix_f32 *a, *b, *c;
+
+    matrix_set_num_threads(64);
+    TEST_ASSERT_TRUE(check_gemm(20000, 2, 48, MATRIX_NO_TRANS, MATRIX_NO_TRANS, 1.0, 0.0));
+
+    mat1 = random_matrix(20000, 48);
+    mat2 = random_matrix(48, 2);
+    mat3 = multiply_by_matrix(mat1, mat2);
+    TEST_ASSERT_NOT_NULL(mat3);
+
+    a = matrix_to_f32(mat1);
+    b = matrix_to_f32(mat2);
+    c = create_zero_matrix_f32(20000, 2);
+    gemm_f32(1.0f, a, MATRIX_NO_TRANS, b, MATRIX_NO_TRANS, 0.0f, c);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < 20000; i++) {
+        for (int j = 0; j < 2; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-4, MATRIX_AT(mat3, i, j), MATRIX_AT(c, i, j));
+        }
+    }
+    matrix_set_num_threads(0);
+
+    destroy_matrix_f32(a);
+    destroy_matrix_f32(b);
+    destroy_matrix_f32(c);
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_gemm_small_product);
+    RUN_TEST(test_gemm_blocked_product);
+    RUN_TEST(test_gemm_transposed_operands);
+    RUN_TEST(test_gemm_alpha_beta);
+    RUN_TEST(test_gemm_should_fail_on_mismatch);
+    RUN_TEST(test_multiply_by_matrix_large);
+    RUN_TEST(test_multiply_transposed_views);
+    RUN_TEST(test_gemm_tall_skinny_many_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,35 @@
+#ifndef TEST_HELPERS
+#define TEST_HELPERS
+
+#include <stdlib.h>
+#include <math.h>
+#include "matrix.h"
+
+// Helpers shared by the unit tests
+
+
+static inline matrix* random_matrix(int rows, int cols) {
+    matrix* mat = initialize_matrix(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            MATRIX_AT(mat, i, j) = (double)rand() / RAND_MAX - 0.5;
+        }
+    }
+    return mat;
+}
+
+
+static inline double max_difference(matrix* a, matrix* b) {
+    double diff = 0.0;
+
+    for (int i = 0; i < a->rows; i++) {
+        for (int j = 0; j < a->cols; j++) {
+            double d = fabs(MATRIX_AT(a, i, j) - MATRIX_AT(b, i, j));
+            diff = d > diff ? d : diff;
+        }
+    }
+    return diff;
+}
+
+#endif
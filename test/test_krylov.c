@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "unity.h"
+#include "matrix.h"
+#include "sparse.h"
+#include "linalg.h"
+#include "krylov.h"
+#include "thread_pool.h"
+
+#define GRID 30
+#define UNKNOWNS (GRID * GRID)
+
+matrix *mat1, *mat2, *mat3;
+sparse_matrix *poisson, *convection;
+double b[UNKNOWNS], x[UNKNOWNS];
+
+
+static sparse_matrix* grid_matrix(double wind) {
+    // 5-point Laplacian on a GRID x GRID grid, wind adds a nonsymmetric upwind convection term
+    int* rows = malloc(5 * UNKNOWNS * sizeof(int));
+    int* cols = malloc(5 * UNKNOWNS * sizeof(int));
+    double* values = malloc(5 * UNKNOWNS * sizeof(double));
+    sparse_matrix* mat;
+    size_t nnz = 0;
+
+    for (int i = 0; i < GRID; i++) {
+        for (int j = 0; j < GRID; j++) {
+            int k = i * GRID + j;
+            int neighbors[4][2] = { { i - 1, j }, { i + 1, j }, { i, j - 1 }, { i, j + 1 } };
+
+            rows[nnz] = cols[nnz] = k;
+            values[nnz++] = 4.0 + wind;
+            for (int d = 0; d < 4; d++) {
+                if (neighbors[d][0] >= 0 && neighbors[d][0] < GRID && neighbors[d][1] >= 0 && neighbors[d][1] < GRID) {
+                    rows[nnz] = k;
+                    cols[nnz] = neighbors[d][0] * GRID + neighbors[d][1];
+                    values[nnz++] = d == 2 ? -1.0 - wind : -1.0;
+                }
+            }
+        }
+    }
+    mat = sparse_from_triplets(UNKNOWNS, UNKNOWNS, nnz, rows, cols, values, SPARSE_CSR);
+
+    free(rows);
+    free(cols);
+    free(values);
+    return mat;
+}
+
+
+static double relative_residual(sparse_matrix* A) {
+    double r[UNKNOWNS], rr = 0.0, bb = 0.0;
+
+    sparse_multiply_vector(1.0, A, x, 0.0, r);
+    for (int i = 0; i < UNKNOWNS; i++) {
+        rr += (b[i] - r[i]) * (b[i] - r[i]);
+        bb += b[i] * b[i];
+    }
+    return sqrt(rr / bb);
+}
+
+
+static void tridiagonal_apply(void* ctx, const double* in, double* out) {
+    // Matrix-free operator of tridiag(-1, *ctx, -1)
+    double diagonal = *(double*)ctx;
+
+    for (int i = 0; i < UNKNOWNS; i++) {
+        out[i] = diagonal * in[i] - (i > 0 ? in[i - 1] : 0.0) - (i + 1 < UNKNOWNS ? in[i + 1] : 0.0);
+    }
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    poisson = grid_matrix(0.0);
+    convection = grid_matrix(2.0);
+    for (int i = 0; i < UNKNOWNS; i++) {
+        b[i] = (double)rand() / RAND_MAX - 0.5;
+        x[i] = 0.0;
+    }
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_num_threads(0);
+    destroy_sparse_matrix(poisson);
+    destroy_sparse_matrix(convection);
+}
+
+
+void test_solve_cg(void) {
+    linear_operator *A = sparse_operator(poisson), *jacobi = sparse_jacobi_preconditioner(poisson);
+    linear_operator* ilu = ilu0_preconditioner(poisson);
+    int plain, with_jacobi, with_ilu;
+
+    plain = solve_cg(A, NULL, b, x, 1e-10, 1000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(poisson) <= 1e-10);
+
+    for (int i = 0; i < UNKNOWNS; i++) {
+        x[i] = 0.0;
+    }
+    matrix_set_num_threads(3);
+    with_jacobi = solve_cg(A, jacobi, b, x, 1e-10, 1000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(poisson) <= 1e-10);
+
+    for (int i = 0; i < UNKNOWNS; i++) {
+        x[i] = 0.0;
+    }
+    with_ilu = solve_cg(A, ilu, b, x, 1e-10, 1000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(poisson) <= 1e-10);
+    TEST_ASSERT_TRUE(with_ilu < plain / 2);
+    TEST_ASSERT_TRUE(with_jacobi <= plain + 1);
+
+    // A converged initial guess takes no iterations
+    TEST_ASSERT_EQUAL(0, solve_cg(A, ilu, b, x, 1e-8, 1000));
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    destroy_operator(A);
+    destroy_operator(jacobi);
+    destroy_operator(ilu);
+}
+
+
+void test_solve_bicgstab(void) {
+    sparse_matrix* csc = sparse_convert(convection, SPARSE_CSC);
+    linear_operator *A = sparse_operator(csc), *ilu = ilu0_preconditioner(csc);
+    int plain, with_ilu;
+
+    plain = solve_bicgstab(A, NULL, b, x, 1e-10, 1000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(convection) <= 1e-10);
+
+    for (int i = 0; i < UNKNOWNS; i++) {
+        x[i] = 0.0;
+    }
+    with_ilu = solve_bicgstab(A, ilu, b, x, 1e-10, 1000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(convection) <= 1e-10);
+    TEST_ASSERT_TRUE(with_ilu < plain);
+
+    destroy_operator(A);
+    destroy_operator(ilu);
+    destroy_sparse_matrix(csc);
+}
+
+
+void test_solve_gmres(void) {
+    linear_operator *A = sparse_operator(convection), *ilu = ilu0_preconditioner(convection);
+    int plain, with_ilu;
+
+    plain = solve_gmres(A, NULL, b, x, 20, 1e-10, 5000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(convection) <= 1e-10);
+
+    for (int i = 0; i < UNKNOWNS; i++) {
+        x[i] = 0.0;
+    }
+    with_ilu = solve_gmres(A, ilu, b, x, 0, 1e-10, 5000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(convection) <= 1e-10);
+    TEST_ASSERT_TRUE(with_ilu < plain);
+
+    // Without restarts GMRES needs at most n steps
+    for (int i = 0; i < UNKNOWNS; i++) {
+        x[i] = 0.0;
+    }
+    solve_gmres(A, NULL, b, x, UNKNOWNS, 1e-10, UNKNOWNS);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(relative_residual(convection) <= 1e-10);
+
+    destroy_operator(A);
+    destroy_operator(ilu);
+}
+
+
+void test_solve_dense(void) {
+    // Dense operators and views give the same solution as the direct solver
+    matrix *dense = sparse_to_dense(convection), *view, *exact, *rhs = initialize_matrix(UNKNOWNS, 1);
+    linear_operator *A, *jacobi;
+
+    mat1 = initialize_matrix(UNKNOWNS, UNKNOWNS + 3);
+    view = matrix_view_block(mat1, 0, 3, UNKNOWNS, UNKNOWNS);
+    copy_into(view, dense);
+    A = dense_operator(view);
+    jacobi = jacobi_preconditioner(view);
+    for (int i = 0; i < UNKNOWNS; i++) {
+        MATRIX_AT(rhs, i, 0) = b[i];
+    }
+    exact = solve(dense, rhs);
+
+    matrix_set_num_threads(3);
+    solve_gmres(A, jacobi, b, x, 30, 1e-12, 5000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < UNKNOWNS; i++) {
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, MATRIX_AT(exact, i, 0), x[i]);
+    }
+
+    for (int i = 0; i < UNKNOWNS; i++) {
+        x[i] = 0.0;
+    }
+    solve_bicgstab(A, jacobi, b, x, 1e-12, 1000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < UNKNOWNS; i++) {
+        TEST_ASSERT_DOUBLE_WITHIN(1e-10, MATRIX_AT(exact, i, 0), x[i]);
+    }
+
+    destroy_operator(A);
+    destroy_operator(jacobi);
+    destroy_matrix(view);
+    destroy_matrix(mat1);
+    destroy_matrix(dense);
+    destroy_matrix(exact);
+    destroy_matrix(rhs);
+}
+
+
+void test_solve_callback(void) {
+    // User operators need no matrix at all
+    double diagonal = 2.5, r[UNKNOWNS], norm = 0.0;
+    linear_operator A = { UNKNOWNS, tridiagonal_apply, &diagonal, NULL };
+
+    solve_cg(&A, NULL, b, x, 1e-12, 1000);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    tridiagonal_apply(&diagonal, x, r);
+    for (int i = 0; i < UNKNOWNS; i++) {
+        norm += (r[i] - b[i]) * (r[i] - b[i]);
+    }
+    TEST_ASSERT_TRUE(sqrt(norm) < 1e-10);
+
+    // b = 0 has the solution x = 0
+    for (int i = 0; i < UNKNOWNS; i++) {
+        b[i] = 0.0;
+    }
+    TEST_ASSERT_EQUAL(0, solve_bicgstab(&A, NULL, b, x, 1e-12, 1000));
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, x[17]);
+}
+
+
+void test_solve_should_fail(void) {
+    linear_operator *A = sparse_operator(poisson), *small;
+    sparse_matrix* gap;
+    int rows[2] = { 0, 1 }, cols[2] = { 1, 0 };
+    double values[2] = { 1.0, 1.0 };
+
+    // Too few iterations keep the last iterate
+    TEST_ASSERT_EQUAL(5, solve_cg(A, NULL, b, x, 1e-10, 5));
+    TEST_ASSERT_EQUAL(MATRIX_OTHER_ERROR, error);
+    TEST_ASSERT_TRUE(relative_residual(poisson) < 1.0);
+    TEST_ASSERT_EQUAL(7, solve_gmres(A, NULL, b, x, 3, 1e-10, 7));
+    TEST_ASSERT_EQUAL(MATRIX_OTHER_ERROR, error);
+
+    solve_cg(NULL, NULL, b, x, 1e-10, 5);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    solve_bicgstab(A, NULL, b, x, -1.0, 5);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    // Missing diagonal elements
+    gap = sparse_from_triplets(2, 2, 2, rows, cols, values, SPARSE_CSR);
+    TEST_ASSERT_NULL(ilu0_preconditioner(gap));
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+    TEST_ASSERT_NULL(sparse_jacobi_preconditioner(gap));
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+
+    small = sparse_operator(gap);
+    solve_gmres(A, small, b, x, 10, 1e-10, 5);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    mat1 = initialize_matrix(3, 4);
+    TEST_ASSERT_NULL(dense_operator(mat1));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix(mat1);
+    destroy_operator(A);
+    destroy_operator(small);
+    destroy_sparse_matrix(gap);
+}
+
+
+void test_solve_gmres_breakdown(void) {
+    // A nilpotent A maps e3 to e2, e2 to e1 and e1 to 0, its Krylov space for b = e3 breaks down
+    double rhs[3] = { 0.0, 0.0, 1.0 }, guess[3] = { 0.0, 0.0, 0.0 };
+    linear_operator* A;
+
+    mat1 = create_zero_matrix(3, 3);
+    MATRIX_AT(mat1, 0, 1) = 1.0;
+    MATRIX_AT(mat1, 1, 2) = 1.0;
+    A = dense_operator(mat1);
+
+    TEST_ASSERT_EQUAL(2, solve_gmres(A, NULL, rhs, guess, 10, 1e-10, 100));
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(isfinite(guess[i]));
+    }
+
+    destroy_operator(A);
+    destroy_matrix(mat1);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_solve_cg);
+    RUN_TEST(test_solve_bicgstab);
+    RUN_TEST(test_solve_gmres);
+    RUN_TEST(test_solve_gmres_breakdown);
+    RUN_TEST(test_solve_dense);
+    RUN_TEST(test_solve_callback);
+    RUN_TEST(test_solve_should_fail);
+    return UNITY_END();
+}
@@ -0,0 +1,488 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "unity.h"
+#include "matrix.h"
+#include "gemm.h"
+#include "linalg.h"
+#include "thread_pool.h"
+#include "test_helpers.h"
+
+matrix *mat1, *mat2, *mat3;
+
+
+static double residual(matrix* a, matrix_op op, matrix* x, matrix* b) {
+    // Largest element of op(A) * X - B
+    matrix* r = materialize(b);
+
+    gemm(1.0, a, op, x, MATRIX_NO_TRANS, -1.0, r);
+    double diff = 0.0;
+    for (int i = 0; i < r->rows; i++) {
+        for (int j = 0; j < r->cols; j++) {
+            diff = fabs(MATRIX_AT(r, i, j)) > diff ? fabs(MATRIX_AT(r, i, j)) : diff;
+        }
+    }
+    destroy_matrix(r);
+    return diff;
+}
+
+
+static void check_lu(matrix* a, int threads) {
+    // Rows of A swapped as recorded by the pivots equal L * U
+    int steps = a->rows < a->cols ? a->rows : a->cols;
+    matrix *lu = materialize(a), *l = create_zero_matrix(a->rows, steps), *u = create_zero_matrix(steps, a->cols);
+    matrix *pa = materialize(a), *product;
+    int* pivots = malloc(steps * sizeof(int));
+
+    matrix_set_num_threads(threads);
+    lu_factor(lu, pivots);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    for (int i = 0; i < a->rows; i++) {
+        for (int j = 0; j < a->cols; j++) {
+            if (j < i && j < steps) {
+                MATRIX_AT(l, i, j) = MATRIX_AT(lu, i, j);
+            }else if (i < steps) {
+                MATRIX_AT(u, i, j) = MATRIX_AT(lu, i, j);
+            }
+        }
+        if (i < steps) {
+            MATRIX_AT(l, i, i) = 1.0;
+        }
+    }
+    for (int i = 0; i < steps; i++) {
+        TEST_ASSERT_TRUE(pivots[i] >= i && pivots[i] < a->rows);
+        for (int j = 0; j < a->cols; j++) {
+            double tmp = MATRIX_AT(pa, i, j);
+            MATRIX_AT(pa, i, j) = MATRIX_AT(pa, pivots[i], j);
+            MATRIX_AT(pa, pivots[i], j) = tmp;
+        }
+    }
+
+    product = multiply_by_matrix(l, u);
+    TEST_ASSERT_TRUE(max_difference(product, pa) < 1e-10);
+
+    // Partial pivoting keeps every multiplier at most 1
+    for (int i = 0; i < a->rows; i++) {
+        for (int j = 0; j < i && j < steps; j++) {
+            TEST_ASSERT_TRUE(fabs(MATRIX_AT(l, i, j)) <= 1.0);
+        }
+    }
+
+    destroy_matrix(lu);
+    destroy_matrix(l);
+    destroy_matrix(u);
+    destroy_matrix(pa);
+    destroy_matrix(product);
+    free(pivots);
+}
+
+
+static matrix* spd_matrix(int n) {
+    // A * A^T + n * I is symmetric positive definite
+    matrix *a = random_matrix(n, n), *spd = create_zero_matrix(n, n);
+
+    gemm(1.0, a, MATRIX_NO_TRANS, a, MATRIX_TRANS, 0.0, spd);
+    for (int i = 0; i < n; i++) {
+        MATRIX_AT(spd, i, i) += n;
+    }
+    destroy_matrix(a);
+    return spd;
+}
+
+
+static void check_cholesky(matrix* a, matrix_uplo uplo, int tiled, int threads) {
+    // The factor times its transposition equals A, the other triangle is untouched
+    int n = a->rows;
+    matrix *f = materialize(a), *factor = create_zero_matrix(n, n), *product;
+
+    matrix_set_num_threads(threads);
+    if (tiled) {
+        cholesky_factor_tiled(f, uplo);
+    }else{
+        cholesky_factor(f, uplo);
+    }
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            int stored = uplo == MATRIX_LOWER ? j <= i : j >= i;
+            if (stored) {
+                MATRIX_AT(factor, i, j) = MATRIX_AT(f, i, j);
+            }else{
+                TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(a, i, j), MATRIX_AT(f, i, j));
+            }
+        }
+        TEST_ASSERT_TRUE(MATRIX_AT(factor, i, i) > 0.0);
+    }
+
+    product = create_zero_matrix(n, n);
+    if (uplo == MATRIX_LOWER) {
+        gemm(1.0, factor, MATRIX_NO_TRANS, factor, MATRIX_TRANS, 0.0, product);
+    }else{
+        gemm(1.0, factor, MATRIX_TRANS, factor, MATRIX_NO_TRANS, 0.0, product);
+    }
+    TEST_ASSERT_TRUE(max_difference(product, a) < 1e-10);
+
+    destroy_matrix(f);
+    destroy_matrix(factor);
+    destroy_matrix(product);
+}
+
+
+static void check_qr(matrix* a, int threads) {
+    // Q * R equals A, Q has orthonormal columns and the explicit Q agrees with qr_apply_q
+    int steps = a->rows < a->cols ? a->rows : a->cols;
+    matrix *qr = materialize(a), *r = create_zero_matrix(steps, a->cols), *q, *full, *product, *identity;
+    double* tau = malloc(steps * sizeof(double));
+
+    matrix_set_num_threads(threads);
+    qr_factor(qr, tau);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    for (int i = 0; i < steps; i++) {
+        for (int j = i; j < a->cols; j++) {
+            MATRIX_AT(r, i, j) = MATRIX_AT(qr, i, j);
+        }
+    }
+    q = qr_form_q(qr, tau, 0);
+    TEST_ASSERT_NOT_NULL(q);
+    TEST_ASSERT_EQUAL(steps, q->cols);
+    product = multiply_by_matrix(q, r);
+    TEST_ASSERT_TRUE(max_difference(product, a) < 1e-12);
+    destroy_matrix(product);
+
+    full = qr_form_q(qr, tau, 1);
+    identity = create_unit_matrix(a->rows, a->rows);
+    product = create_zero_matrix(a->rows, a->rows);
+    gemm(1.0, full, MATRIX_TRANS, full, MATRIX_NO_TRANS, 0.0, product);
+    TEST_ASSERT_TRUE(max_difference(product, identity) < 1e-12);
+
+    // Q^T * Q = I computed by applying Q^T to the explicit Q
+    qr_apply_q(qr, tau, MATRIX_TRANS, full);
+    TEST_ASSERT_TRUE(max_difference(full, identity) < 1e-12);
+
+    destroy_matrix(qr);
+    destroy_matrix(r);
+    destroy_matrix(q);
+    destroy_matrix(full);
+    destroy_matrix(product);
+    destroy_matrix(identity);
+    free(tau);
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = random_matrix(300, 300);
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_num_threads(0);
+    destroy_matrix(mat1);
+}
+
+
+void test_solve_triangular(void) {
+    // Diagonal dominance keeps the triangles well conditioned
+    matrix *b = random_matrix(300, 70), *bt = transpose(b), *x = initialize_matrix(300, 70);
+    matrix *t = create_zero_matrix(300, 300), *x_view = transpose_view(bt);
+    matrix_uplo uplos[] = { MATRIX_LOWER, MATRIX_UPPER };
+    matrix_op ops[] = { MATRIX_NO_TRANS, MATRIX_TRANS };
+    matrix_diag diags[] = { MATRIX_NON_UNIT, MATRIX_UNIT };
+    int threads[] = { 1, 3 };
+
+    for (int u = 0; u < 2; u++) {
+        for (int i = 0; i < 300; i++) {
+            for (int j = 0; j < 300; j++) {
+                int stored = uplos[u] == MATRIX_LOWER ? j <= i : j >= i;
+                MATRIX_AT(mat1, i, j) = stored ? (i == j ? 4.0 : ((double)rand() / RAND_MAX - 0.5) / 30.0) : 99.0;
+            }
+        }
+        for (int o = 0; o < 2; o++) {
+            for (int d = 0; d < 2; d++) {
+                // The triangle actually solved, without the element outside it
+                for (int i = 0; i < 300; i++) {
+                    for (int j = 0; j < 300; j++) {
+                        int stored = uplos[u] == MATRIX_LOWER ? j <= i : j >= i;
+                        MATRIX_AT(t, i, j) = !stored ? 0.0 : (i == j && diags[d] == MATRIX_UNIT ? 1.0 : MATRIX_AT(mat1, i, j));
+                    }
+                }
+                for (int th = 0; th < 2; th++) {
+                    matrix_set_num_threads(threads[th]);
+                    copy_into(x, b);
+                    solve_triangular(mat1, uplos[u], ops[o], diags[d], x);
+                    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+                    TEST_ASSERT_TRUE(residual(t, ops[o], x, b) < 1e-12);
+
+                    // B read and written through a transposed view
+                    transpose_into(bt, b);
+                    solve_triangular(mat1, uplos[u], ops[o], diags[d], x_view);
+                    TEST_ASSERT_TRUE(max_difference(x, x_view) < 1e-14);
+                }
+            }
+        }
+    }
+
+    MATRIX_AT(mat1, 5, 5) = 0.0;
+    solve_triangular(mat1, MATRIX_UPPER, MATRIX_NO_TRANS, MATRIX_NON_UNIT, x);
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+    solve_triangular(mat1, MATRIX_UPPER, MATRIX_NO_TRANS, MATRIX_NON_UNIT, bt);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix(b);
+    destroy_matrix(bt);
+    destroy_matrix(x);
+    destroy_matrix(t);
+    destroy_matrix(x_view);
+}
+
+
+void test_lu_factor(void) {
+    // Several panels, a partial last panel and both rectangular shapes
+    matrix *tall = random_matrix(301, 133), *wide = random_matrix(133, 301);
+
+    check_lu(mat1, 1);
+    check_lu(mat1, 3);
+    check_lu(tall, 3);
+    check_lu(wide, 1);
+
+    destroy_matrix(tall);
+    destroy_matrix(wide);
+}
+
+
+void test_solve_and_inverse(void) {
+    matrix *b = random_matrix(300, 5), *x, *inv, *identity = create_unit_matrix(300, 300), *at = transpose_view(mat1);
+
+    x = solve(mat1, b);
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_TRUE(residual(mat1, MATRIX_NO_TRANS, x, b) < 1e-10);
+    destroy_matrix(x);
+
+    // A view of A is factored through a copy
+    x = solve(at, b);
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_TRUE(residual(mat1, MATRIX_TRANS, x, b) < 1e-10);
+    destroy_matrix(x);
+
+    inv = inverse(mat1);
+    TEST_ASSERT_NOT_NULL(inv);
+    mat2 = multiply_by_matrix(mat1, inv);
+    TEST_ASSERT_TRUE(max_difference(mat2, identity) < 1e-10);
+
+    destroy_matrix(mat2);
+    destroy_matrix(inv);
+    destroy_matrix(b);
+    destroy_matrix(identity);
+    destroy_matrix(at);
+}
+
+
+void test_determinant(void) {
+    double values[] = { 2.0, -1.0, 0.0, 1.0, 3.0, 2.0, 0.0, 1.0, 4.0 };
+    double swapped[] = { 0.0, 1.0, 1.0, 0.0 };
+
+    mat2 = initialize_matrix(3, 3);
+    for (int k = 0; k < 9; k++) {
+        mat2->buffer[k] = values[k];
+    }
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 24.0, determinant(mat2));
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    destroy_matrix(mat2);
+
+    mat2 = initialize_matrix(2, 2);
+    for (int k = 0; k < 4; k++) {
+        mat2->buffer[k] = swapped[k];
+    }
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, -1.0, determinant(mat2));
+    destroy_matrix(mat2);
+
+    // det(A^T) = det(A) and det(2A) = 2^n det(A)
+    mat2 = random_matrix(150, 150);
+    mat3 = transpose(mat2);
+    double det = determinant(mat2);
+    TEST_ASSERT_DOUBLE_WITHIN(fabs(det) * 1e-10, det, determinant(mat3));
+    scale_inplace(mat3, 2.0);
+    TEST_ASSERT_DOUBLE_WITHIN(fabs(ldexp(det, 150)) * 1e-10, ldexp(det, 150), determinant(mat3));
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_singular_matrix(void) {
+    matrix* b = random_matrix(300, 2);
+    int pivots[300];
+
+    // A zero column gives an exactly zero pivot
+    for (int i = 0; i < 300; i++) {
+        MATRIX_AT(mat1, i, 3) = 0.0;
+    }
+
+    TEST_ASSERT_NULL(solve(mat1, b));
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+    TEST_ASSERT_NULL(inverse(mat1));
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, determinant(mat1));
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    lu_factor(mat1, pivots);
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+
+    TEST_ASSERT_NULL(solve(mat1, NULL));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    destroy_matrix(b);
+    b = random_matrix(299, 2);
+    TEST_ASSERT_NULL(solve(mat1, b));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    TEST_ASSERT_NULL(inverse(b));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix(b);
+}
+
+
+void test_cholesky_factor(void) {
+    // Several blocks and tiles with a partial last one
+    matrix* a = spd_matrix(300);
+
+    check_cholesky(a, MATRIX_LOWER, 0, 1);
+    check_cholesky(a, MATRIX_UPPER, 0, 3);
+    check_cholesky(a, MATRIX_LOWER, 1, 1);
+    check_cholesky(a, MATRIX_LOWER, 1, 3);
+    check_cholesky(a, MATRIX_UPPER, 1, 3);
+
+    destroy_matrix(a);
+}
+
+
+void test_solve_spd(void) {
+    matrix *a = spd_matrix(300), *b = random_matrix(300, 7), *x, *f = materialize(a);
+    int threads[] = { 1, 3 };
+
+    for (int t = 0; t < 2; t++) {
+        matrix_set_num_threads(threads[t]);
+        x = solve_spd(a, b);
+        TEST_ASSERT_NOT_NULL(x);
+        TEST_ASSERT_TRUE(residual(a, MATRIX_NO_TRANS, x, b) < 1e-10);
+        destroy_matrix(x);
+    }
+
+    // Solving with an upper factor gives the same result
+    cholesky_factor(f, MATRIX_UPPER);
+    x = materialize(b);
+    cholesky_solve(f, MATRIX_UPPER, x);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(residual(a, MATRIX_NO_TRANS, x, b) < 1e-10);
+    destroy_matrix(x);
+
+    // A negative pivot late in the factorization
+    MATRIX_AT(a, 250, 250) = -1.0;
+    TEST_ASSERT_NULL(solve_spd(a, b));
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+    copy_into(f, a);
+    cholesky_factor_tiled(f, MATRIX_LOWER);
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+
+    cholesky_factor(b, MATRIX_LOWER);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    TEST_ASSERT_NULL(solve_spd(a, NULL));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    destroy_matrix(a);
+    destroy_matrix(b);
+    destroy_matrix(f);
+}
+
+
+void test_qr_factor(void) {
+    // Several blocks, a partial last block, both rectangular shapes and a transposed view
+    matrix *tall = random_matrix(301, 133), *wide = random_matrix(45, 100), *view = transpose_view(tall);
+
+    check_qr(mat1, 1);
+    check_qr(tall, 3);
+    check_qr(wide, 1);
+    check_qr(view, 3);
+
+    destroy_matrix(tall);
+    destroy_matrix(wide);
+    destroy_matrix(view);
+}
+
+
+void test_lstsq(void) {
+    matrix *a = random_matrix(300, 80), *b = random_matrix(300, 3), *x, *r, *normal, *at = transpose_view(a);
+
+    // The residual of the least squares solution is orthogonal to the columns of A
+    x = lstsq(a, b);
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_EQUAL(80, x->rows);
+    r = materialize(b);
+    gemm(1.0, a, MATRIX_NO_TRANS, x, MATRIX_NO_TRANS, -1.0, r);
+    normal = create_zero_matrix(80, 3);
+    gemm(1.0, a, MATRIX_TRANS, r, MATRIX_NO_TRANS, 0.0, normal);
+    for (int i = 0; i < 80; i++) {
+        for (int j = 0; j < 3; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-11, 0.0, MATRIX_AT(normal, i, j));
+        }
+    }
+    destroy_matrix(x);
+    destroy_matrix(r);
+    destroy_matrix(normal);
+
+    // A square system has the exact solution
+    mat2 = random_matrix(300, 3);
+    x = lstsq(mat1, mat2);
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_TRUE(residual(mat1, MATRIX_NO_TRANS, x, mat2) < 1e-10);
+    destroy_matrix(x);
+    destroy_matrix(mat2);
+
+    // An underdetermined system has the solution of minimum norm, A^T * (A * A^T)^-1 * B
+    mat2 = random_matrix(80, 2);
+    x = lstsq(at, mat2);
+    TEST_ASSERT_NOT_NULL(x);
+    TEST_ASSERT_EQUAL(300, x->rows);
+    TEST_ASSERT_TRUE(residual(a, MATRIX_TRANS, x, mat2) < 1e-12);
+    normal = create_zero_matrix(80, 80);
+    gemm(1.0, a, MATRIX_TRANS, a, MATRIX_NO_TRANS, 0.0, normal);
+    mat3 = solve(normal, mat2);
+    r = multiply_by_matrix(a, mat3);
+    TEST_ASSERT_TRUE(max_difference(r, x) < 1e-12);
+    destroy_matrix(x);
+    destroy_matrix(r);
+    destroy_matrix(normal);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+
+    // A zero column leaves a zero on the diagonal of R
+    for (int i = 0; i < 300; i++) {
+        MATRIX_AT(a, i, 7) = 0.0;
+    }
+    TEST_ASSERT_NULL(lstsq(a, b));
+    TEST_ASSERT_EQUAL(MATRIX_SINGULAR, error);
+    TEST_ASSERT_NULL(lstsq(at, b));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    TEST_ASSERT_NULL(lstsq(NULL, b));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    destroy_matrix(a);
+    destroy_matrix(b);
+    destroy_matrix(at);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_solve_triangular);
+    RUN_TEST(test_lu_factor);
+    RUN_TEST(test_solve_and_inverse);
+    RUN_TEST(test_determinant);
+    RUN_TEST(test_singular_matrix);
+    RUN_TEST(test_cholesky_factor);
+    RUN_TEST(test_solve_spd);
+    RUN_TEST(test_qr_factor);
+    RUN_TEST(test_lstsq);
+    return UNITY_END();
+}
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
 #include "unity.h"
 #include "matrix.h"
 #include "math.h"
@@ -40,6 +42,20 @@ void test_matrix_should_be_initialized(void) {
 }
 
 
+void test_matrix_storage_should_be_contiguous(void) {
+    mat1 = initialize_matrix(4, 3);
+
+    TEST_ASSERT_NOT_NULL(mat1);
+    TEST_ASSERT_EQUAL_INT(3, mat1->row_stride);
+    TEST_ASSERT_EQUAL_INT(0, (size_t)mat1->buffer % MATRIX_ALIGNMENT);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_PTR(mat1->buffer + i * 3, mat1->data[i]);
+    }
+
+    destroy_matrix(mat1);
+}
+
+
 void test_matrix_should_fail_initialization(void) {
     mat1 = initialize_matrix(-1, -3);
 
@@ -50,6 +66,51 @@ void test_matrix_should_fail_initialization(void) {
 }
 
 
+static void* failing_worker(void* arg) {
+    // Every call fails, the error must never be overwritten by the other thread
+    int* mismatches = arg;
+
+    for (int i = 0; i < 10000; i++) {
+        initialize_matrix(-1, 1);
+        if (error != MATRIX_INVARGS || matrix_last_error() != MATRIX_INVARGS) {
+            (*mismatches)++;
+        }
+    }
+    return NULL;
+}
+
+
+static void* succeeding_worker(void* arg) {
+    // Every call succeeds, the error must stay MATRIX_OK
+    int* mismatches = arg;
+
+    for (int i = 0; i < 10000; i++) {
+        matrix* mat = create_zero_matrix(2, 2);
+        if (error != MATRIX_OK) {
+            (*mismatches)++;
+        }
+        destroy_matrix(mat);
+    }
+    return NULL;
+}
+
+
+void test_matrix_error_is_per_thread(void) {
+    pthread_t failing, succeeding;
+    int failing_mismatches = 0, succeeding_mismatches = 0;
+
+    create_unit_matrix(-1, -1);
+    pthread_create(&failing, NULL, failing_worker, &failing_mismatches);
+    pthread_create(&succeeding, NULL, succeeding_worker, &succeeding_mismatches);
+    pthread_join(failing, NULL);
+    pthread_join(succeeding, NULL);
+
+    TEST_ASSERT_EQUAL_INT(0, failing_mismatches);
+    TEST_ASSERT_EQUAL_INT(0, succeeding_mismatches);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+}
+
+
 void test_matrix_should_be_unit(void) {
     mat1 = create_unit_matrix(3, 3);
     double expected_mat[][3] = { {1.0, 0.0, 0.0},
@@ -162,6 +223,302 @@ void test_matrix_should_transposed(void) {
 }
 
 
+void test_matrix_add_into(void){
+    mat1 = create_unit_matrix(3, 3);
+    mat2 = create_unit_matrix(3, 3);
+    mat3 = create_zero_matrix(3, 3);
+    double expected_mat[][3] = { {2.0, 0.0, 0.0},
+                                {0.0, 2.0, 0.0},
+                                {0.0, 0.0, 2.0}};
+
+    add_into(mat3, mat1, mat2);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(compare_2d_arrays(expected_mat, mat3->data, 3, 3));
+
+    substract_into(mat3, mat3, mat2);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, get_value(mat3, 2, 2));
+    multiply_by_scalar_into(mat3, mat3, 2.0);
+    TEST_ASSERT_TRUE(compare_2d_arrays(expected_mat, mat3->data, 3, 3));
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_matrix_inplace_operations(void){
+    mat1 = create_unit_matrix(3, 3);
+    mat2 = create_unit_matrix(3, 3);
+    double expected_mat[][3] = { {3.0, 0.0, 0.0},
+                                {0.0, 3.0, 0.0},
+                                {0.0, 0.0, 3.0}};
+
+    add_inplace(mat1, mat2);
+    add_inplace(mat1, mat2);
+    substract_inplace(mat1, mat2);
+    scale_inplace(mat1, 1.5);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(compare_2d_arrays(expected_mat, mat1->data, 3, 3));
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+}
+
+
+void test_matrix_into_should_fail_on_mismatch(void){
+    mat1 = create_unit_matrix(3, 3);
+    mat2 = create_unit_matrix(3, 3);
+    mat3 = create_zero_matrix(2, 3);
+
+    add_into(mat3, mat1, mat2);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    transpose_into(mat3, mat1);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    multiply_by_matrix_into(mat3, mat1, mat2);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    transpose_into(mat1, mat1);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_matrix_multiply_by_matrix_into(void){
+    mat1 = create_unit_matrix(2, 3);
+    mat2 = create_unit_matrix(3, 2);
+    mat3 = create_unit_matrix(2, 2);
+    set_value(mat1, 1, 3, 4);
+    set_value(mat2, 3, 1, 2);
+
+    multiply_by_matrix_into(mat3, mat1, mat2);
+
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_EQUAL_DOUBLE(9.0, get_value(mat3, 1, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, get_value(mat3, 1, 2));
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, get_value(mat3, 2, 2));
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_matrix_rectangular_transpose(void) {
+    mat1 = create_zero_matrix(2, 3);
+    set_value(mat1, 1, 3, 7);
+    mat2 = transpose(mat1);
+
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_EQUAL_INT(3, mat2->rows);
+    TEST_ASSERT_EQUAL_INT(2, mat2->cols);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, get_value(mat2, 3, 1));
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+}
+
+
+void test_matrix_transpose_inplace(void) {
+    int sizes[][2] = { { 70, 70 }, { 3, 5 }, { 37, 53 }, { 1, 9 } };
+
+    for (size_t s = 0; s < ARRAY_LEN(sizes); s++) {
+        int rows = sizes[s][0], cols = sizes[s][1];
+
+        mat1 = initialize_matrix(rows, cols);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                MATRIX_AT(mat1, i, j) = i * 1000 + j;
+            }
+        }
+
+        transpose_inplace(mat1);
+
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+        TEST_ASSERT_EQUAL_INT(cols, mat1->rows);
+        TEST_ASSERT_EQUAL_INT(rows, mat1->cols);
+        for (int i = 0; i < rows; i++) {
+            for (int j = 0; j < cols; j++) {
+                TEST_ASSERT_EQUAL_DOUBLE(i * 1000 + j, mat1->data[j][i]);
+            }
+        }
+
+        destroy_matrix(mat1);
+    }
+}
+
+
+void test_matrix_transpose_view(void) {
+    matrix* view;
+
+    mat1 = create_zero_matrix(2, 3);
+    set_value(mat1, 1, 3, 7);
+    view = transpose_view(mat1);
+
+    TEST_ASSERT_NOT_NULL(view);
+    TEST_ASSERT_EQUAL_INT(3, view->rows);
+    TEST_ASSERT_EQUAL_INT(2, view->cols);
+    TEST_ASSERT_TRUE(view->buffer == mat1->buffer);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, get_value(view, 3, 1));
+
+    // Writes through the view reach the viewed matrix
+    set_value(view, 2, 2, 4);
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, get_value(mat1, 2, 2));
+
+    mat2 = materialize(view);
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_EQUAL_INT(1, mat2->col_stride);
+    TEST_ASSERT_EQUAL_INT(2, mat2->row_stride);
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, mat2->data[2][0]);
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, mat2->data[1][1]);
+
+    destroy_matrix(view);
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+}
+
+
+void test_matrix_mixed_layout_operations(void) {
+    matrix *view, *expected;
+
+    mat1 = initialize_matrix(45, 70);
+    mat2 = initialize_matrix(70, 45);
+    for (int i = 0; i < 45; i++) {
+        for (int j = 0; j < 70; j++) {
+            MATRIX_AT(mat1, i, j) = i - j;
+            MATRIX_AT(mat2, j, i) = i * j;
+        }
+    }
+    view = transpose_view(mat2);
+
+    // A + B^T read in mixed orders
+    mat3 = add(mat1, view);
+    TEST_ASSERT_NOT_NULL(mat3);
+    for (int i = 0; i < 45; i++) {
+        for (int j = 0; j < 70; j++) {
+            TEST_ASSERT_EQUAL_DOUBLE(i - j + i * j, MATRIX_AT(mat3, i, j));
+        }
+    }
+
+    // Results written into a view stored by columns
+    expected = multiply_by_scalar(mat1, 2);
+    multiply_by_scalar_into(view, mat1, 2);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < 45; i++) {
+        for (int j = 0; j < 70; j++) {
+            TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(expected, i, j), MATRIX_AT(mat2, j, i));
+        }
+    }
+
+    copy_into(mat3, view);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(expected, 44, 69), MATRIX_AT(mat3, 44, 69));
+    copy_into(mat2, mat3);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix(view);
+    destroy_matrix(expected);
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_matrix_block_views(void) {
+    matrix *block, *row, *col, *diag, *ones;
+
+    mat1 = create_zero_matrix(6, 8);
+    ones = create_unit_matrix(2, 3);
+
+    // Views write through to the viewed matrix
+    block = matrix_view_block(mat1, 2, 4, 2, 3);
+    TEST_ASSERT_NOT_NULL(block);
+    add_inplace(block, ones);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, MATRIX_AT(mat1, 2, 4));
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, MATRIX_AT(mat1, 3, 5));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, MATRIX_AT(mat1, 3, 4));
+
+    row = matrix_view_row(mat1, 3);
+    TEST_ASSERT_EQUAL_INT(1, row->rows);
+    TEST_ASSERT_EQUAL_INT(8, row->cols);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, MATRIX_AT(row, 0, 5));
+
+    col = matrix_view_col(mat1, 4);
+    TEST_ASSERT_EQUAL_INT(6, col->rows);
+    TEST_ASSERT_EQUAL_INT(1, col->cols);
+    scale_inplace(col, 3.0);
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, MATRIX_AT(mat1, 2, 4));
+
+    diag = matrix_view_diag(mat1);
+    TEST_ASSERT_EQUAL_INT(6, diag->rows);
+    for (int i = 0; i < diag->rows; i++) {
+        MATRIX_AT(diag, i, 0) = 5.0;
+    }
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, MATRIX_AT(mat1, 5, 5));
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, get_value(mat1, 3, 3));
+
+    destroy_matrix(block);
+    destroy_matrix(row);
+    destroy_matrix(col);
+    destroy_matrix(diag);
+    destroy_matrix(ones);
+    destroy_matrix(mat1);
+}
+
+
+void test_matrix_strided_views(void) {
+    matrix *slice, *block, *copy;
+
+    mat1 = initialize_matrix(40, 50);
+    for (int i = 0; i < 40; i++) {
+        for (int j = 0; j < 50; j++) {
+            MATRIX_AT(mat1, i, j) = i * 100 + j;
+        }
+    }
+
+    // Every 3rd row and 2nd column, neither stride is 1
+    slice = matrix_view_slice(mat1, 1, 2, 13, 24, 3, 2);
+    TEST_ASSERT_NOT_NULL(slice);
+    copy = materialize(slice);
+    mat2 = transpose(slice);
+    for (int i = 0; i < 13; i++) {
+        for (int j = 0; j < 24; j++) {
+            TEST_ASSERT_EQUAL_DOUBLE((1 + 3 * i) * 100 + 2 + 2 * j, MATRIX_AT(copy, i, j));
+            TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(copy, i, j), MATRIX_AT(mat2, j, i));
+        }
+    }
+
+    // Product stored into a block of another matrix
+    destroy_matrix(copy);
+    copy = create_zero_matrix(30, 30);
+    block = matrix_view_block(copy, 3, 4, 24, 24);
+    mat3 = multiply_by_matrix(mat2, slice);
+    multiply_by_matrix_into(block, mat2, slice);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < 24; i++) {
+        for (int j = 0; j < 24; j++) {
+            TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(mat3, i, j), MATRIX_AT(copy, i + 3, j + 4));
+        }
+    }
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, MATRIX_AT(copy, 2, 4));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, MATRIX_AT(copy, 3, 28));
+
+    TEST_ASSERT_NULL(matrix_view_slice(mat1, 1, 2, 14, 24, 3, 2));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    TEST_ASSERT_NULL(matrix_view_block(mat1, 30, 0, 11, 1));
+    TEST_ASSERT_NULL(matrix_view_row(mat1, 40));
+    TEST_ASSERT_NULL(matrix_view_col(mat1, -1));
+
+    destroy_matrix(slice);
+    destroy_matrix(block);
+    destroy_matrix(copy);
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
 void test_matrix_file_operations(void) {
     const char* temp_filename = "temp_test_matrix.txt";
     const char delimiter = ' ';
@@ -183,6 +540,74 @@ void test_matrix_file_operations(void) {
 }
 
 
+static matrix* read_text(const char* content, const char delimiter) {
+    // Writes content to a temporary file and reads it back as a matrix
+    const char* temp_filename = "temp_test_matrix.txt";
+    FILE* f = fopen(temp_filename, "wb");
+    matrix* mat;
+
+    fputs(content, f);
+    fclose(f);
+    mat = read_from_file(temp_filename, delimiter);
+    remove(temp_filename);
+    return mat;
+}
+
+
+void test_matrix_read_formats(void) {
+    mat1 = read_text("\r\n 1; -2.5E-3 ;0.1\r\n4;5e+1;1e300;\r\n\r\n7;8\r\n", ';');
+
+    TEST_ASSERT_NOT_NULL(mat1);
+    TEST_ASSERT_EQUAL_INT(2, mat1->rows);
+    TEST_ASSERT_EQUAL_INT(3, mat1->cols);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, MATRIX_AT(mat1, 0, 0));
+    TEST_ASSERT_TRUE(-2.5E-3 == MATRIX_AT(mat1, 0, 1));
+    TEST_ASSERT_TRUE(0.1 == MATRIX_AT(mat1, 0, 2));
+    TEST_ASSERT_EQUAL_DOUBLE(50.0, MATRIX_AT(mat1, 1, 1));
+    TEST_ASSERT_TRUE(1e300 == MATRIX_AT(mat1, 1, 2));
+    destroy_matrix(mat1);
+
+    mat1 = read_text("1.5\n2.5\n3.5", ' ');
+    TEST_ASSERT_NOT_NULL(mat1);
+    TEST_ASSERT_EQUAL_INT(3, mat1->rows);
+    TEST_ASSERT_EQUAL_INT(1, mat1->cols);
+    TEST_ASSERT_EQUAL_DOUBLE(3.5, MATRIX_AT(mat1, 2, 0));
+    destroy_matrix(mat1);
+}
+
+
+void test_matrix_read_wide_rows(void) {
+    char content[4096] = "";
+
+    for (int i = 0; i < 300; i++) {
+        strcat(content, "0.125,");
+    }
+    strcat(content, "\n");
+    mat1 = read_text(content, ',');
+
+    TEST_ASSERT_NOT_NULL(mat1);
+    TEST_ASSERT_EQUAL_INT(1, mat1->rows);
+    TEST_ASSERT_EQUAL_INT(300, mat1->cols);
+    TEST_ASSERT_EQUAL_DOUBLE(0.125, MATRIX_AT(mat1, 0, 299));
+    destroy_matrix(mat1);
+}
+
+
+void test_matrix_read_should_fail(void) {
+    TEST_ASSERT_NULL(read_text("1 2 3\n4 5\n", ' '));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    TEST_ASSERT_NULL(read_text("1;x;3\n", ';'));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    TEST_ASSERT_NULL(read_text("\n\n", ';'));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    TEST_ASSERT_NULL(read_from_file("does_not_exist.txt", ';'));
+    TEST_ASSERT_EQUAL(MATRIX_OPENING_ERROR, error);
+}
+
+
 void test_matrix_get_size(void) {
     mat1 = create_unit_matrix(3, 3);
     int val1, val2;
@@ -228,6 +653,8 @@ void test_matrix_set_value(void) {
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_matrix_should_be_initialized);
+    RUN_TEST(test_matrix_storage_should_be_contiguous);
+    RUN_TEST(test_matrix_error_is_per_thread);
     RUN_TEST(test_matrix_should_be_unit);
     RUN_TEST(test_matrix_should_be_zero);
     RUN_TEST(test_matrix_add);
@@ -235,7 +662,20 @@ int main(void) {
     RUN_TEST(test_matrix_multiply_by_scalar);
     RUN_TEST(test_matrix_multiply_by_matrix);
     RUN_TEST(test_matrix_should_transposed);
+    RUN_TEST(test_matrix_add_into);
+    RUN_TEST(test_matrix_inplace_operations);
+    RUN_TEST(test_matrix_into_should_fail_on_mismatch);
+    RUN_TEST(test_matrix_multiply_by_matrix_into);
+    RUN_TEST(test_matrix_rectangular_transpose);
+    RUN_TEST(test_matrix_transpose_inplace);
+    RUN_TEST(test_matrix_transpose_view);
+    RUN_TEST(test_matrix_mixed_layout_operations);
+    RUN_TEST(test_matrix_block_views);
+    RUN_TEST(test_matrix_strided_views);
     RUN_TEST(test_matrix_file_operations);
+    RUN_TEST(test_matrix_read_formats);
+    RUN_TEST(test_matrix_read_wide_rows);
+    RUN_TEST(test_matrix_read_should_fail);
     RUN_TEST(test_matrix_get_size);
     RUN_TEST(test_matrix_get_value);
     RUN_TEST(test_matrix_set_value);
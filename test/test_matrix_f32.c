@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "matrix.h"
+#include "matrix_f32.h"
+#include "gemm.h"
+#include "simd.h"
+#include "binary.h"
+#include "math.h"
+#include "test_helpers.h"
+
+matrix *mat1, *mat2, *mat3;
+matrix_f32 *fmat1, *fmat2, *fmat3;
+
+static const char* temp_filename = "temp_test_matrix_f32";
+
+
+static double max_difference_f32(matrix_f32* a, matrix* b) {
+    double diff = 0.0;
+
+    for (int i = 0; i < a->rows; i++) {
+        for (int j = 0; j < a->cols; j++) {
+            double d = fabs(MATRIX_AT(a, i, j) - MATRIX_AT(b, i, j));
+            diff = d > diff ? d : diff;
+        }
+    }
+    return diff;
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = random_matrix(37, 29);
+    mat2 = random_matrix(37, 29);
+    fmat1 = matrix_to_f32(mat1);
+    fmat2 = matrix_to_f32(mat2);
+    mat3 = NULL;
+    fmat3 = NULL;
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_isa(matrix_detect_isa());
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+    destroy_matrix_f32(fmat1);
+    destroy_matrix_f32(fmat2);
+    destroy_matrix_f32(fmat3);
+    remove(temp_filename);
+}
+
+
+void test_matrix_f32_conversion(void) {
+    TEST_ASSERT_EQUAL_INT(37, fmat1->rows);
+    TEST_ASSERT_EQUAL_INT(29, fmat1->cols);
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        destroy_matrix_f32(fmat3);
+        destroy_matrix(mat3);
+
+        fmat3 = matrix_to_f32(mat1);
+        mat3 = matrix_f32_to_f64(fmat3);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+        for (int i = 0; i < mat1->rows; i++) {
+            for (int j = 0; j < mat1->cols; j++) {
+                TEST_ASSERT_TRUE((float)MATRIX_AT(mat1, i, j) == MATRIX_AT(fmat3, i, j));
+                TEST_ASSERT_TRUE((double)MATRIX_AT(fmat3, i, j) == MATRIX_AT(mat3, i, j));
+            }
+        }
+    }
+
+    TEST_ASSERT_NULL(matrix_to_f32(NULL));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+}
+
+
+void test_matrix_f32_elementwise(void) {
+    matrix *sum = add(mat1, mat2), *diff = substract(mat1, mat2), *scaled = multiply_by_scalar(mat1, 1.5);
+    matrix_f32 *fsum, *fdiff, *fscaled;
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        fsum = add_f32(fmat1, fmat2);
+        fdiff = substract_f32(fmat1, fmat2);
+        fscaled = multiply_by_scalar_f32(fmat1, 1.5f);
+
+        TEST_ASSERT_TRUE(max_difference_f32(fsum, sum) < 1e-6);
+        TEST_ASSERT_TRUE(max_difference_f32(fdiff, diff) < 1e-6);
+        TEST_ASSERT_TRUE(max_difference_f32(fscaled, scaled) < 1e-6);
+
+        destroy_matrix_f32(fsum);
+        destroy_matrix_f32(fdiff);
+        destroy_matrix_f32(fscaled);
+    }
+
+    fmat3 = create_zero_matrix_f32(29, 37);
+    add_into_f32(fmat3, fmat1, fmat2);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    add_inplace_f32(fmat1, fmat2);
+    TEST_ASSERT_TRUE(max_difference_f32(fmat1, sum) < 1e-6);
+    scale_inplace_f32(fmat2, 2.0f);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f * (float)MATRIX_AT(mat2, 3, 4), MATRIX_AT(fmat2, 3, 4));
+
+    destroy_matrix(sum);
+    destroy_matrix(diff);
+    destroy_matrix(scaled);
+}
+
+
+void test_matrix_f32_transpose(void) {
+    matrix_f32 *view = transpose_view_f32(fmat1), *sum;
+
+    fmat3 = transpose_f32(fmat1);
+    TEST_ASSERT_EQUAL_INT(29, fmat3->rows);
+    TEST_ASSERT_EQUAL_INT(37, fmat3->cols);
+    TEST_ASSERT_EQUAL_INT(29, view->rows);
+    TEST_ASSERT_EQUAL_INT(1, view->is_view);
+
+    for (int i = 0; i < fmat1->rows; i++) {
+        for (int j = 0; j < fmat1->cols; j++) {
+            TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat1, i, j), MATRIX_AT(fmat3, j, i));
+            TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat1, i, j), MATRIX_AT(view, j, i));
+        }
+    }
+
+    // Views in the other storage order go through row-major tiles
+    sum = add_f32(view, fmat3);
+    TEST_ASSERT_EQUAL_FLOAT(2 * MATRIX_AT(fmat1, 5, 7), MATRIX_AT(sum, 7, 5));
+
+    destroy_matrix_f32(sum);
+    destroy_matrix_f32(view);
+}
+
+
+void test_matrix_f32_views(void) {
+    matrix_f32 *slice = matrix_view_slice_f32(fmat1, 1, 2, 10, 8, 3, 2);
+    matrix_f32 *col = matrix_view_col_f32(fmat1, 4), *row = matrix_view_row_f32(fmat1, 6);
+    matrix_f32 *diag = matrix_view_diag_f32(fmat1), *col_t = transpose_view_f32(col);
+
+    TEST_ASSERT_NOT_NULL(slice);
+    TEST_ASSERT_EQUAL_INT(10, slice->rows);
+    TEST_ASSERT_EQUAL_INT(8, slice->cols);
+    TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat1, 1 + 3 * 9, 2 + 2 * 7), MATRIX_AT(slice, 9, 7));
+    TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat1, 36, 4), MATRIX_AT(col, 36, 0));
+    TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat1, 6, 28), MATRIX_AT(row, 0, 28));
+    TEST_ASSERT_EQUAL_INT(29, diag->rows);
+    TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat1, 20, 20), MATRIX_AT(diag, 20, 0));
+
+    // The transposition of a column view keeps the distance between its elements
+    TEST_ASSERT_EQUAL_INT(1, col_t->rows);
+    TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat1, 30, 4), MATRIX_AT(col_t, 0, 30));
+
+    fmat3 = materialize_f32(slice);
+    TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(slice, 4, 5), MATRIX_AT(fmat3, 4, 5));
+
+    TEST_ASSERT_NULL(matrix_view_block_f32(fmat1, 30, 0, 8, 1));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    destroy_matrix_f32(slice);
+    destroy_matrix_f32(col);
+    destroy_matrix_f32(row);
+    destroy_matrix_f32(diag);
+    destroy_matrix_f32(col_t);
+}
+
+
+void test_matrix_f32_transpose_inplace(void) {
+    matrix_f32 *square, *wide;
+
+    fmat3 = transpose_f32(fmat1);
+    transpose_inplace_f32(fmat1);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_EQUAL_INT(29, fmat1->rows);
+    TEST_ASSERT_EQUAL_INT(37, fmat1->cols);
+    TEST_ASSERT_EQUAL_INT(37, fmat1->row_stride);
+    TEST_ASSERT_TRUE(memcmp(fmat1->buffer, fmat3->buffer, 29 * 37 * sizeof(float)) == 0);
+
+    // Square views are transposed in their own storage, other views keep their shape
+    square = matrix_view_block_f32(fmat1, 3, 2, 20, 20);
+    wide = matrix_view_block_f32(fmat1, 0, 0, 2, 3);
+    transpose_inplace_f32(square);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < 20; i++) {
+        for (int j = 0; j < 20; j++) {
+            TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fmat3, 3 + j, 2 + i), MATRIX_AT(fmat1, 3 + i, 2 + j));
+        }
+    }
+    transpose_inplace_f32(wide);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix_f32(square);
+    destroy_matrix_f32(wide);
+}
+
+
+void test_matrix_f32_gemm_match_f64(void) {
+    matrix *a = random_matrix(67, 45), *b = random_matrix(45, 53), *expected = multiply_by_matrix(a, b);
+    matrix_f32 *fa = matrix_to_f32(a), *fb = matrix_to_f32(b), *fbt = transpose_f32(fb);
+    matrix_f32 *view = transpose_view_f32(fbt), *product;
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        product = multiply_by_matrix_f32(fa, fb);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+        TEST_ASSERT_TRUE(max_difference_f32(product, expected) < 1e-4);
+
+        // The same product with B transposed, once through op and once through a view
+        gemm_f32(1.0f, fa, MATRIX_NO_TRANS, fbt, MATRIX_TRANS, 0.0f, product);
+        TEST_ASSERT_TRUE(max_difference_f32(product, expected) < 1e-4);
+        multiply_by_matrix_into_f32(product, fa, view);
+        TEST_ASSERT_TRUE(max_difference_f32(product, expected) < 1e-4);
+
+        destroy_matrix_f32(product);
+    }
+
+    TEST_ASSERT_NULL(multiply_by_matrix_f32(fa, fa));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix(a);
+    destroy_matrix(b);
+    destroy_matrix(expected);
+    destroy_matrix_f32(fa);
+    destroy_matrix_f32(fb);
+    destroy_matrix_f32(fbt);
+    destroy_matrix_f32(view);
+}
+
+
+void test_matrix_f32_binary(void) {
+    save_to_binary_f32(fmat1, temp_filename);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    fmat3 = read_from_binary_f32(temp_filename);
+    TEST_ASSERT_NOT_NULL(fmat3);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(fmat1->buffer, fmat3->buffer, 37 * 29);
+    destroy_matrix_f32(fmat3);
+
+    fmat3 = mmap_matrix_f32(temp_filename, MATRIX_MAP_READ);
+    TEST_ASSERT_NOT_NULL(fmat3);
+    TEST_ASSERT_NOT_NULL(fmat3->mapping);
+    TEST_ASSERT_EQUAL_FLOAT_ARRAY(fmat1->buffer, fmat3->buffer, 37 * 29);
+
+    // A float32 file is not a double matrix and vice versa
+    TEST_ASSERT_NULL(read_from_binary(temp_filename));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    save_to_binary(mat1, temp_filename);
+    TEST_ASSERT_NULL(mmap_matrix_f32(temp_filename, MATRIX_MAP_READ));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+}
+
+
+void test_matrix_f32_text_file(void) {
+    save_to_file_f32(fmat1, temp_filename, ',');
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    fmat3 = read_from_file_f32(temp_filename, ',');
+    TEST_ASSERT_NOT_NULL(fmat3);
+    TEST_ASSERT_TRUE(max_difference_f32(fmat3, mat1) < 1e-6);
+}
+
+
+void test_matrix_f32_values(void) {
+    fmat3 = create_unit_matrix_f32(3, 4);
+
+    TEST_ASSERT_EQUAL_FLOAT(1.0f, get_value_f32(fmat3, 3, 3));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, get_value_f32(fmat3, 3, 4));
+    set_value_f32(fmat3, 3, 4, 2.5f);
+    TEST_ASSERT_EQUAL_FLOAT(2.5f, get_value_f32(fmat3, 3, 4));
+
+    get_value_f32(fmat3, 4, 1);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    TEST_ASSERT_NULL(initialize_matrix_f32(0, 3));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matrix_f32_conversion);
+    RUN_TEST(test_matrix_f32_elementwise);
+    RUN_TEST(test_matrix_f32_transpose);
+    RUN_TEST(test_matrix_f32_views);
+    RUN_TEST(test_matrix_f32_transpose_inplace);
+    RUN_TEST(test_matrix_f32_gemm_match_f64);
+    RUN_TEST(test_matrix_f32_binary);
+    RUN_TEST(test_matrix_f32_text_file);
+    RUN_TEST(test_matrix_f32_values);
+    return UNITY_END();
+}
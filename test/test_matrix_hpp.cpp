@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <cstdlib>
+#include "unity.h"
+#include "matrix.hpp"
+#include "gemm.h"
+#include "linalg.h"
+
+matrix *mat1, *mat2, *mat3;
+
+using mat::Matrix;
+using mat::Matrix2d;
+using mat::Matrix3d;
+using mat::Matrix4d;
+using mat::Vector3d;
+
+
+// Evaluated by the compiler, a failure stops the build
+constexpr Matrix2d rotation(0.0, -1.0, 1.0, 0.0);
+static_assert((rotation * rotation)(0, 0) == -1.0, "product");
+static_assert(rotation * rotation.transpose() == Matrix2d::identity(), "orthogonal");
+static_assert((rotation + Matrix2d::filled(2.0))(1, 0) == 3.0, "sum");
+static_assert(Matrix3d::identity().trace() == 3.0, "trace");
+static_assert(sizeof(Matrix4d) == 16 * sizeof(double), "elements are stored in the object");
+
+
+template <int R, int C>
+static Matrix<double, R, C> random_fixed() {
+    Matrix<double, R, C> m;
+
+    for (int i = 0; i < R; i++) {
+        for (int j = 0; j < C; j++) {
+            m(i, j) = (double)rand() / RAND_MAX - 0.5;
+        }
+    }
+    return m;
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+}
+
+
+void test_fixed_operations(void) {
+    Matrix<double, 2, 3> a(1, 2, 3, 4, 5, 6);
+    Matrix<double, 3, 2> t = a.transpose();
+    Matrix2d product = a * t;
+    Vector3d v(1.0, 2.0, 2.0);
+
+    TEST_ASSERT_EQUAL_DOUBLE(14.0, product(0, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(32.0, product(0, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(77.0, product(1, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(6.0, t(2, 1));
+
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, v.norm());
+    TEST_ASSERT_EQUAL_DOUBLE(9.0, v.dot(v));
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, (2.0 * v)[2]);
+    TEST_ASSERT_EQUAL_DOUBLE(-1.0, (-v / 2.0)[1]);
+    TEST_ASSERT_TRUE((a - a) == (Matrix<double, 2, 3>()));
+    TEST_ASSERT_TRUE(a != a * 2.0);
+
+    Matrix4d m = random_fixed<4, 4>(), square = m;
+    square *= m;
+    TEST_ASSERT_TRUE(square == m * m);
+    TEST_ASSERT_TRUE(m * Matrix4d::identity() == m);
+}
+
+
+void test_fixed_matches_c_library(void) {
+    // Products of fixed matrices agree with gemm on their views
+    Matrix<double, 5, 7> a = random_fixed<5, 7>();
+    Matrix<double, 7, 3> b = random_fixed<7, 3>();
+    Matrix<double, 5, 3> c = a * b, d;
+    matrix va = a.view(), vb = b.view(), vd = d.view();
+
+    gemm(1.0, &va, MATRIX_NO_TRANS, &vb, MATRIX_NO_TRANS, 0.0, &vd);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 3; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-14, c(i, j), d(i, j));
+        }
+    }
+
+    // Dynamic work of the C library returns to a fixed matrix
+    Matrix3d s = random_fixed<3, 3>() + 3.0 * Matrix3d::identity(), inv;
+    matrix vs = s.view();
+    mat1 = inverse(&vs);
+    TEST_ASSERT_TRUE(inv.assign(mat1));
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    Matrix3d unit = s * inv;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1e-13, i == j ? 1.0 : 0.0, unit(i, j));
+        }
+    }
+
+    // Views of C matrices are copied through their strides
+    mat2 = transpose_view(mat1);
+    TEST_ASSERT_TRUE(inv.assign(mat2));
+    TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(mat1, 0, 2), inv(2, 0));
+
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+}
+
+
+void test_fixed_float(void) {
+    Matrix<float, 2, 2> a(1.0f, 2.0f, 3.0f, 4.0f);
+    matrix_f32 va = a.view();
+    matrix_f32* product = multiply_by_matrix_f32(&va, &va);
+
+    TEST_ASSERT_EQUAL_FLOAT((a * a)(1, 1), MATRIX_AT(product, 1, 1));
+    TEST_ASSERT_EQUAL_FLOAT(22.0f, (a * a)(1, 1));
+    destroy_matrix_f32(product);
+}
+
+
+void test_fixed_should_fail(void) {
+    Matrix3d m = Matrix3d::filled(1.0);
+
+    mat1 = create_zero_matrix(3, 4);
+    TEST_ASSERT_FALSE(m.assign(mat1));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, m(2, 2));
+    TEST_ASSERT_FALSE(m.assign((matrix*)NULL));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    destroy_matrix(mat1);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fixed_operations);
+    RUN_TEST(test_fixed_matches_c_library);
+    RUN_TEST(test_fixed_float);
+    RUN_TEST(test_fixed_should_fail);
+    return UNITY_END();
+}
@@ -0,0 +1,268 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <complex.h>
+#include "unity.h"
+#include "matrix.h"
+#include "matrix_types.h"
+#include "binary.h"
+#include "simd.h"
+
+matrix *mat1, *mat2, *mat3;
+
+static const char* temp_filename = "temp_test_matrix_types";
+
+
+static matrix_i32* random_matrix_i32(int rows, int cols) {
+    matrix_i32* mat = initialize_matrix_i32(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            MATRIX_AT(mat, i, j) = rand() % 201 - 100;
+        }
+    }
+    return mat;
+}
+
+
+static matrix_c64* random_matrix_c64(int rows, int cols) {
+    matrix_c64* mat = initialize_matrix_c64(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            MATRIX_AT(mat, i, j) = CMPLX(rand() % 17 - 8, rand() % 17 - 8);
+        }
+    }
+    return mat;
+}
+
+
+static void write_text(const char* text) {
+    FILE* f = fopen(temp_filename, "w");
+    fputs(text, f);
+    fclose(f);
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_isa(matrix_detect_isa());
+    remove(temp_filename);
+}
+
+
+void test_matrix_i32_elementwise(void) {
+    matrix_i32 *a = random_matrix_i32(37, 29), *b = random_matrix_i32(37, 29);
+    matrix_i32 *sum = add_i32(a, b), *diff = substract_i32(a, b), *scaled = multiply_by_scalar_i32(a, -3);
+    matrix_i32 *at = transpose_i32(a), *view = transpose_view_i32(b), *mixed = add_i32(at, view);
+
+    for (int i = 0; i < 37; i++) {
+        for (int j = 0; j < 29; j++) {
+            TEST_ASSERT_EQUAL_INT32(MATRIX_AT(a, i, j) + MATRIX_AT(b, i, j), MATRIX_AT(sum, i, j));
+            TEST_ASSERT_EQUAL_INT32(MATRIX_AT(a, i, j) - MATRIX_AT(b, i, j), MATRIX_AT(diff, i, j));
+            TEST_ASSERT_EQUAL_INT32(-3 * MATRIX_AT(a, i, j), MATRIX_AT(scaled, i, j));
+            TEST_ASSERT_EQUAL_INT32(MATRIX_AT(a, i, j) + MATRIX_AT(b, i, j), MATRIX_AT(mixed, j, i));
+        }
+    }
+
+    add_into_i32(at, a, b);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix_i32(a);
+    destroy_matrix_i32(b);
+    destroy_matrix_i32(sum);
+    destroy_matrix_i32(diff);
+    destroy_matrix_i32(scaled);
+    destroy_matrix_i32(at);
+    destroy_matrix_i32(view);
+    destroy_matrix_i32(mixed);
+}
+
+
+void test_matrix_i32_multiply(void) {
+    // Larger than one block of B in both directions, B also read through a view
+    matrix_i32 *a = random_matrix_i32(70, 300), *b = random_matrix_i32(300, 530);
+    matrix_i32 *bt = transpose_i32(b), *view = transpose_view_i32(bt), *c = create_zero_matrix_i32(70, 530);
+    matrix_i32 *d = create_zero_matrix_i32(530, 70), *dt = transpose_view_i32(d);
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        multiply_by_matrix_into_i32(c, a, b);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+        multiply_by_matrix_into_i32(dt, a, view);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+        for (int i = 0; i < 70; i++) {
+            for (int j = 0; j < 530; j++) {
+                int32_t expected = 0;
+                for (int p = 0; p < 300; p++) {
+                    expected += MATRIX_AT(a, i, p) * MATRIX_AT(b, p, j);
+                }
+                TEST_ASSERT_EQUAL_INT32(expected, MATRIX_AT(c, i, j));
+                TEST_ASSERT_EQUAL_INT32(expected, MATRIX_AT(d, j, i));
+            }
+        }
+    }
+
+    TEST_ASSERT_NULL(multiply_by_matrix_i32(a, a));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_matrix_i32(a);
+    destroy_matrix_i32(b);
+    destroy_matrix_i32(bt);
+    destroy_matrix_i32(view);
+    destroy_matrix_i32(c);
+    destroy_matrix_i32(dt);
+    destroy_matrix_i32(d);
+}
+
+
+void test_matrix_i64_beyond_i32(void) {
+    matrix_i64 *a = create_unit_matrix_i64(3, 3), *b;
+
+    scale_inplace_i64(a, 3000000000LL);
+    b = multiply_by_matrix_i64(a, a);
+
+    TEST_ASSERT_EQUAL_INT64(9000000000000000000LL, get_value_i64(b, 2, 2));
+    TEST_ASSERT_EQUAL_INT64(0, get_value_i64(b, 1, 2));
+
+    destroy_matrix_i64(a);
+    destroy_matrix_i64(b);
+}
+
+
+void test_matrix_c64_operations(void) {
+    matrix_c64 *a = random_matrix_c64(23, 41), *b = random_matrix_c64(41, 19), *c = multiply_by_matrix_c64(a, b);
+    matrix_c64* scaled = multiply_by_scalar_c64(a, CMPLX(0.0, 1.0));
+
+    for (int i = 0; i < 23; i++) {
+        for (int j = 0; j < 19; j++) {
+            matrix_complex expected = 0;
+            for (int p = 0; p < 41; p++) {
+                expected += MATRIX_AT(a, i, p) * MATRIX_AT(b, p, j);
+            }
+            TEST_ASSERT_EQUAL_DOUBLE(creal(expected), creal(MATRIX_AT(c, i, j)));
+            TEST_ASSERT_EQUAL_DOUBLE(cimag(expected), cimag(MATRIX_AT(c, i, j)));
+        }
+    }
+
+    // Multiplying by i rotates every element
+    TEST_ASSERT_EQUAL_DOUBLE(-cimag(MATRIX_AT(a, 4, 5)), creal(MATRIX_AT(scaled, 4, 5)));
+    TEST_ASSERT_EQUAL_DOUBLE(creal(MATRIX_AT(a, 4, 5)), cimag(MATRIX_AT(scaled, 4, 5)));
+
+    destroy_matrix_c64(a);
+    destroy_matrix_c64(b);
+    destroy_matrix_c64(c);
+    destroy_matrix_c64(scaled);
+}
+
+
+void test_matrix_types_text_files(void) {
+    matrix_i32* a;
+    matrix_c64* z;
+
+    write_text("\n1, -2, 3\r\n4,5,6,\n\nignored\n");
+    a = read_from_file_i32(temp_filename, ',');
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL_INT(2, a->rows);
+    TEST_ASSERT_EQUAL_INT(3, a->cols);
+    TEST_ASSERT_EQUAL_INT32(-2, get_value_i32(a, 1, 2));
+    TEST_ASSERT_EQUAL_INT32(6, get_value_i32(a, 2, 3));
+
+    save_to_file_i32(a, temp_filename, ';');
+    destroy_matrix_i32(a);
+    a = read_from_file_i32(temp_filename, ';');
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL_INT32(4, get_value_i32(a, 2, 1));
+    destroy_matrix_i32(a);
+
+    write_text("1.5 2\n3 4\n");
+    TEST_ASSERT_NULL(read_from_file_i32(temp_filename, ' '));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    write_text("1 99999999999\n");
+    TEST_ASSERT_NULL(read_from_file_i32(temp_filename, ' '));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    write_text("1.5-2i 3i\n-4 0.5+0.25i\n");
+    z = read_from_file_c64(temp_filename, ' ');
+    TEST_ASSERT_NOT_NULL(z);
+    TEST_ASSERT_EQUAL_DOUBLE(1.5, creal(get_value_c64(z, 1, 1)));
+    TEST_ASSERT_EQUAL_DOUBLE(-2.0, cimag(get_value_c64(z, 1, 1)));
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, cimag(get_value_c64(z, 1, 2)));
+    TEST_ASSERT_EQUAL_DOUBLE(-4.0, creal(get_value_c64(z, 2, 1)));
+
+    save_to_file_c64(z, temp_filename, ',');
+    destroy_matrix_c64(z);
+    z = read_from_file_c64(temp_filename, ',');
+    TEST_ASSERT_NOT_NULL(z);
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, cimag(get_value_c64(z, 2, 2)));
+    destroy_matrix_c64(z);
+}
+
+
+void test_matrix_types_binary(void) {
+    matrix_c64 *z = random_matrix_c64(9, 13), *z2;
+    matrix_i64* n;
+
+    save_to_binary_c64(z, temp_filename);
+    z2 = read_from_binary_c64(temp_filename);
+    TEST_ASSERT_NOT_NULL(z2);
+    TEST_ASSERT_EQUAL_MEMORY(z->buffer, z2->buffer, 9 * 13 * sizeof(matrix_complex));
+    destroy_matrix_c64(z2);
+
+    z2 = mmap_matrix_c64(temp_filename, MATRIX_MAP_READ);
+    TEST_ASSERT_NOT_NULL(z2);
+    TEST_ASSERT_EQUAL_MEMORY(z->buffer, z2->buffer, 9 * 13 * sizeof(matrix_complex));
+    destroy_matrix_c64(z2);
+
+    // The element type is part of the format
+    TEST_ASSERT_NULL(read_from_binary_i64(temp_filename));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    n = create_unit_matrix_i64(4, 2);
+    save_to_binary_i64(n, temp_filename);
+    destroy_matrix_i64(n);
+    n = mmap_matrix_i64(temp_filename, MATRIX_MAP_READ);
+    TEST_ASSERT_NOT_NULL(n);
+    TEST_ASSERT_EQUAL_INT64(1, get_value_i64(n, 2, 2));
+    destroy_matrix_i64(n);
+
+    destroy_matrix_c64(z);
+}
+
+
+void test_matrix_types_generic(void) {
+    matrix_i32 *a = create_unit_matrix_i32(2, 2), *a2;
+    matrix* d = create_unit_matrix(2, 2);
+    matrix* d2;
+
+    a2 = matrix_add(a, a);
+    d2 = matrix_multiply_by_scalar(d, 2.5);
+    matrix_set_value(a2, 1, 2, 7);
+
+    TEST_ASSERT_EQUAL_INT32(2, matrix_get_value(a2, 2, 2));
+    TEST_ASSERT_EQUAL_INT32(7, matrix_get_value(a2, 1, 2));
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, matrix_get_value(d2, 1, 1));
+
+    matrix_destroy(a);
+    matrix_destroy(a2);
+    matrix_destroy(d);
+    matrix_destroy(d2);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matrix_i32_elementwise);
+    RUN_TEST(test_matrix_i32_multiply);
+    RUN_TEST(test_matrix_i64_beyond_i32);
+    RUN_TEST(test_matrix_c64_operations);
+    RUN_TEST(test_matrix_types_text_files);
+    RUN_TEST(test_matrix_types_binary);
+    RUN_TEST(test_matrix_types_generic);
+    return UNITY_END();
+}
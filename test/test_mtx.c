@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unity.h"
+#include "matrix.h"
+#include "sparse.h"
+#include "mtx.h"
+#include "thread_pool.h"
+
+matrix *mat1, *mat2, *mat3;
+
+static const char* temp_filename = "temp_test_matrix.mtx";
+
+
+static matrix* random_sparse_dense(int rows, int cols, double density) {
+    // Dense matrix with about density of its elements nonzero
+    matrix* mat = create_zero_matrix(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if ((double)rand() / RAND_MAX < density) {
+                MATRIX_AT(mat, i, j) = (double)rand() / RAND_MAX - 0.5;
+            }
+        }
+    }
+    return mat;
+}
+
+
+static int equal_matrices(matrix* a, matrix* b) {
+    if (a->rows != b->rows || a->cols != b->cols) {
+        return 0;
+    }
+    for (int i = 0; i < a->rows; i++) {
+        if (memcmp(&MATRIX_AT(a, i, 0), &MATRIX_AT(b, i, 0), a->cols * sizeof(double)) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+static int equal_sparse(sparse_matrix* a, sparse_matrix* b) {
+    size_t outer = a->format == SPARSE_CSR ? a->rows : a->cols;
+
+    return a->rows == b->rows && a->cols == b->cols && a->format == b->format && a->nnz == b->nnz &&
+           memcmp(a->ptr, b->ptr, (outer + 1) * sizeof(size_t)) == 0 &&
+           memcmp(a->idx, b->idx, a->nnz * sizeof(int)) == 0 &&
+           memcmp(a->values, b->values, a->nnz * sizeof(double)) == 0;
+}
+
+
+static void write_file(const char* text) {
+    FILE* f = fopen(temp_filename, "wb");
+    fputs(text, f);
+    fclose(f);
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = random_sparse_dense(37, 23, 0.2);
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_num_threads(0);
+    destroy_matrix(mat1);
+    remove(temp_filename);
+}
+
+
+void test_mtx_array_roundtrip(void) {
+    sparse_matrix *csr, *expected = dense_to_sparse(mat1, SPARSE_CSR);
+
+    save_to_mtx(mat1, temp_filename);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    mat2 = read_from_mtx(temp_filename);
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_TRUE(equal_matrices(mat1, mat2));
+
+    csr = read_sparse_from_mtx(temp_filename, SPARSE_CSR);
+    TEST_ASSERT_NOT_NULL(csr);
+    TEST_ASSERT_TRUE(equal_sparse(expected, csr));
+
+    destroy_matrix(mat2);
+    destroy_sparse_matrix(csr);
+    destroy_sparse_matrix(expected);
+}
+
+
+void test_mtx_coordinate_roundtrip(void) {
+    sparse_matrix *csr = dense_to_sparse(mat1, SPARSE_CSR), *csc = sparse_convert(csr, SPARSE_CSC), *read;
+
+    // Entries sorted by rows become the storage of a CSR result, a CSC result sorts them
+    save_sparse_to_mtx(csr, temp_filename);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    read = read_sparse_from_mtx(temp_filename, SPARSE_CSR);
+    TEST_ASSERT_NOT_NULL(read);
+    TEST_ASSERT_TRUE(equal_sparse(csr, read));
+    destroy_sparse_matrix(read);
+
+    read = read_sparse_from_mtx(temp_filename, SPARSE_CSC);
+    TEST_ASSERT_NOT_NULL(read);
+    TEST_ASSERT_TRUE(equal_sparse(csc, read));
+    destroy_sparse_matrix(read);
+
+    save_sparse_to_mtx(csc, temp_filename);
+    mat2 = read_from_mtx(temp_filename);
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_TRUE(equal_matrices(mat1, mat2));
+
+    destroy_matrix(mat2);
+    destroy_sparse_matrix(csr);
+    destroy_sparse_matrix(csc);
+}
+
+
+void test_mtx_symmetry_and_fields(void) {
+    sparse_matrix* read;
+
+    // Case-insensitive banner, comments, blank lines, CRLF and no final line break
+    write_file("%%MatrixMarket MATRIX Coordinate Real Symmetric\r\n"
+               "% lower triangle\r\n"
+               "\r\n"
+               "3 3 4\r\n"
+               "1 1 2.5\r\n"
+               "3 1 -1e-3\r\n"
+               "2 2 4\r\n"
+               "  3 2\t7");
+    mat2 = read_from_mtx(temp_filename);
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, MATRIX_AT(mat2, 0, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(-1e-3, MATRIX_AT(mat2, 2, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(-1e-3, MATRIX_AT(mat2, 0, 2));
+    TEST_ASSERT_EQUAL_DOUBLE(7.0, MATRIX_AT(mat2, 1, 2));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, MATRIX_AT(mat2, 0, 1));
+
+    read = read_sparse_from_mtx(temp_filename, SPARSE_CSR);
+    TEST_ASSERT_NOT_NULL(read);
+    TEST_ASSERT_EQUAL_UINT64(6, read->nnz);
+    mat3 = sparse_to_dense(read);
+    TEST_ASSERT_TRUE(equal_matrices(mat2, mat3));
+    destroy_sparse_matrix(read);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+
+    // Skew-symmetric array files store the strict lower triangle column by column
+    write_file("%%MatrixMarket matrix array integer skew-symmetric\n3 3\n1\n2\n3\n");
+    mat2 = read_from_mtx(temp_filename);
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, MATRIX_AT(mat2, 1, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(-1.0, MATRIX_AT(mat2, 0, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(2.0, MATRIX_AT(mat2, 2, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(-3.0, MATRIX_AT(mat2, 1, 2));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, MATRIX_AT(mat2, 2, 2));
+    destroy_matrix(mat2);
+
+    // Pattern entries are ones
+    write_file("%%MatrixMarket matrix coordinate pattern general\n2 4 2\n2 4\n1 3\n");
+    read = read_sparse_from_mtx(temp_filename, SPARSE_CSR);
+    TEST_ASSERT_NOT_NULL(read);
+    TEST_ASSERT_EQUAL_UINT64(2, read->nnz);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, sparse_get_value(read, 1, 3));
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, sparse_get_value(read, 2, 4));
+    destroy_sparse_matrix(read);
+}
+
+
+void test_mtx_parallel_chunks(void) {
+    // Several chunks, each split across threads
+    matrix* big = random_sparse_dense(1000, 1200, 0.3);
+    sparse_matrix *expected = dense_to_sparse(big, SPARSE_CSR), *read;
+    int threads[] = { 1, 3 };
+
+    save_sparse_to_mtx(expected, temp_filename);
+    for (int t = 0; t < 2; t++) {
+        matrix_set_num_threads(threads[t]);
+
+        read = read_sparse_from_mtx(temp_filename, SPARSE_CSR);
+        TEST_ASSERT_NOT_NULL(read);
+        TEST_ASSERT_TRUE(equal_sparse(expected, read));
+        destroy_sparse_matrix(read);
+
+        mat2 = read_from_mtx(temp_filename);
+        TEST_ASSERT_NOT_NULL(mat2);
+        TEST_ASSERT_TRUE(equal_matrices(big, mat2));
+        destroy_matrix(mat2);
+    }
+
+    save_to_mtx(big, temp_filename);
+    mat2 = read_from_mtx(temp_filename);
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_TRUE(equal_matrices(big, mat2));
+    destroy_matrix(mat2);
+
+    destroy_matrix(big);
+    destroy_sparse_matrix(expected);
+}
+
+
+void test_mtx_repeated_entries(void) {
+    // Both readers sum repeated coordinate entries, also of a symmetric mirror
+    sparse_matrix* read;
+
+    write_file("%%MatrixMarket matrix coordinate real symmetric\n3 3 5\n1 1 1\n2 1 4\n1 1 2\n3 3 5\n2 1 0.5\n");
+    mat2 = read_from_mtx(temp_filename);
+    TEST_ASSERT_NOT_NULL(mat2);
+    TEST_ASSERT_EQUAL_DOUBLE(3.0, MATRIX_AT(mat2, 0, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(4.5, MATRIX_AT(mat2, 1, 0));
+    TEST_ASSERT_EQUAL_DOUBLE(4.5, MATRIX_AT(mat2, 0, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, MATRIX_AT(mat2, 2, 2));
+
+    read = read_sparse_from_mtx(temp_filename, SPARSE_CSC);
+    TEST_ASSERT_NOT_NULL(read);
+    mat3 = sparse_to_dense(read);
+    TEST_ASSERT_TRUE(equal_matrices(mat2, mat3));
+
+    destroy_sparse_matrix(read);
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+}
+
+
+void test_mtx_should_fail(void) {
+    const char* invalid[] = {
+        "%%MatrixMarket matrix coordinate complex general\n1 1 1\n1 1 1 0\n",
+        "%%MatrixMarket matrix coordinate real general\n2 2 2\n1 1 1\n",
+        "%%MatrixMarket matrix coordinate real general\n2 2 1\n1 1 1\n2 2 1\n",
+        "%%MatrixMarket matrix coordinate real general\n2 2 1\n3 1 1\n",
+        "%%MatrixMarket matrix coordinate real general\n2 2 1\n1 1 x\n",
+        "%%MatrixMarket matrix array real symmetric\n2 3\n1\n2\n3\n",
+        "%%MatrixMarket matrix array pattern general\n1 1\n",
+        "1 1 1\n1 1 1\n",
+    };
+
+    for (size_t k = 0; k < ARRAY_LEN(invalid); k++) {
+        write_file(invalid[k]);
+        TEST_ASSERT_NULL(read_from_mtx(temp_filename));
+        TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+        TEST_ASSERT_NULL(read_sparse_from_mtx(temp_filename, SPARSE_CSR));
+        TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    }
+
+    TEST_ASSERT_NULL(read_from_mtx("does_not_exist.mtx"));
+    TEST_ASSERT_EQUAL(MATRIX_OPENING_ERROR, error);
+    save_to_mtx(NULL, temp_filename);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mtx_array_roundtrip);
+    RUN_TEST(test_mtx_coordinate_roundtrip);
+    RUN_TEST(test_mtx_symmetry_and_fields);
+    RUN_TEST(test_mtx_parallel_chunks);
+    RUN_TEST(test_mtx_repeated_entries);
+    RUN_TEST(test_mtx_should_fail);
+    return UNITY_END();
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "matrix.h"
+#include "matrix_f32.h"
+#include "gemm.h"
+#include "simd.h"
+#include "math.h"
+#include "test_helpers.h"
+
+matrix *mat1, *mat2, *mat3;
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = random_matrix(37, 29);
+    mat2 = random_matrix(37, 29);
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_isa(matrix_detect_isa());
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+}
+
+
+void test_simd_isa_names(void) {
+    TEST_ASSERT_EQUAL_STRING("scalar", matrix_isa_str(MATRIX_ISA_SCALAR));
+    TEST_ASSERT_EQUAL_STRING("avx512", matrix_isa_str(MATRIX_ISA_AVX512));
+    TEST_ASSERT_NULL(matrix_isa_str(MATRIX_ISA_COUNT));
+}
+
+
+void test_simd_force_isa(void) {
+    matrix_set_isa(MATRIX_ISA_SCALAR);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_EQUAL(MATRIX_ISA_SCALAR, matrix_get_isa());
+
+    matrix_set_isa(MATRIX_ISA_COUNT);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    TEST_ASSERT_EQUAL(MATRIX_ISA_SCALAR, matrix_get_isa());
+}
+
+
+void test_simd_elementwise_match_scalar(void) {
+    matrix *sum, *diff, *scaled;
+
+    matrix_set_isa(MATRIX_ISA_SCALAR);
+    sum = add(mat1, mat2);
+    diff = substract(mat1, mat2);
+    scaled = multiply_by_scalar(mat1, 1.5);
+
+    for (int isa = MATRIX_ISA_SSE2; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+
+        mat3 = add(mat1, mat2);
+        TEST_ASSERT_EQUAL_DOUBLE(0.0, max_difference(sum, mat3));
+        destroy_matrix(mat3);
+
+        mat3 = substract(mat1, mat2);
+        TEST_ASSERT_EQUAL_DOUBLE(0.0, max_difference(diff, mat3));
+        destroy_matrix(mat3);
+
+        mat3 = multiply_by_scalar(mat1, 1.5);
+        TEST_ASSERT_EQUAL_DOUBLE(0.0, max_difference(scaled, mat3));
+        destroy_matrix(mat3);
+    }
+
+    destroy_matrix(sum);
+    destroy_matrix(diff);
+    destroy_matrix(scaled);
+}
+
+
+void test_simd_gemm_match_scalar(void) {
+    matrix *a = random_matrix(83, 121), *b = random_matrix(121, 59);
+    matrix* expected;
+
+    matrix_set_isa(MATRIX_ISA_SCALAR);
+    expected = multiply_by_matrix(a, b);
+
+    for (int isa = MATRIX_ISA_SSE2; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        mat3 = multiply_by_matrix(a, b);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.0, max_difference(expected, mat3));
+        destroy_matrix(mat3);
+    }
+
+    destroy_matrix(a);
+    destroy_matrix(b);
+    destroy_matrix(expected);
+}
+
+
+void test_simd_transpose_match_reference(void) {
+    int sizes[][2] = { { 1, 1 }, { 7, 3 }, { 64, 64 }, { 131, 67 }, { 40, 257 } };
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+
+        for (size_t s = 0; s < ARRAY_LEN(sizes); s++) {
+            matrix* a = random_matrix(sizes[s][0], sizes[s][1]);
+
+            mat3 = transpose(a);
+            TEST_ASSERT_NOT_NULL(mat3);
+            for (int i = 0; i < a->rows; i++) {
+                for (int j = 0; j < a->cols; j++) {
+                    TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(a, i, j), MATRIX_AT(mat3, j, i));
+                }
+            }
+            destroy_matrix(mat3);
+            destroy_matrix(a);
+        }
+    }
+}
+
+
+void test_simd_transpose_f32_match_reference(void) {
+    int sizes[][2] = { { 1, 1 }, { 7, 3 }, { 64, 64 }, { 131, 67 }, { 40, 257 } };
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+
+        for (size_t s = 0; s < ARRAY_LEN(sizes); s++) {
+            matrix* a = random_matrix(sizes[s][0], sizes[s][1]);
+            matrix_f32 *fa = matrix_to_f32(a), *ft = transpose_f32(fa);
+
+            TEST_ASSERT_NOT_NULL(ft);
+            for (int i = 0; i < fa->rows; i++) {
+                for (int j = 0; j < fa->cols; j++) {
+                    TEST_ASSERT_EQUAL_FLOAT(MATRIX_AT(fa, i, j), MATRIX_AT(ft, j, i));
+                }
+            }
+            destroy_matrix_f32(ft);
+            destroy_matrix_f32(fa);
+            destroy_matrix(a);
+        }
+    }
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_simd_isa_names);
+    RUN_TEST(test_simd_force_isa);
+    RUN_TEST(test_simd_elementwise_match_scalar);
+    RUN_TEST(test_simd_gemm_match_scalar);
+    RUN_TEST(test_simd_transpose_match_reference);
+    RUN_TEST(test_simd_transpose_f32_match_reference);
+    return UNITY_END();
+}
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "unity.h"
+#include "matrix.h"
+#include "sparse.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "math.h"
+#include "test_helpers.h"
+
+matrix *mat1, *mat2, *mat3;
+
+
+static matrix* random_sparse_dense(int rows, int cols, double density) {
+    // Dense matrix with about density of its elements nonzero
+    matrix* mat = create_zero_matrix(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if ((double)rand() / RAND_MAX < density) {
+                MATRIX_AT(mat, i, j) = (double)rand() / RAND_MAX - 0.5;
+            }
+        }
+    }
+    return mat;
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = random_sparse_dense(203, 157, 0.05);
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_isa(matrix_detect_isa());
+    matrix_set_num_threads(0);
+    destroy_matrix(mat1);
+}
+
+
+void test_sparse_from_triplets(void) {
+    int rows[] = { 2, 0, 1, 0, 2, 0 };
+    int cols[] = { 1, 3, 0, 0, 1, 3 };
+    double values[] = { 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+    sparse_matrix* csr = sparse_from_triplets(3, 4, 6, rows, cols, values, SPARSE_CSR);
+    sparse_matrix* csc = sparse_from_triplets(3, 4, 6, rows, cols, values, SPARSE_CSC);
+
+    // Repeated positions (2, 1) and (0, 3) are summed
+    TEST_ASSERT_EQUAL_UINT64(4, csr->nnz);
+    TEST_ASSERT_EQUAL_UINT64(4, csc->nnz);
+    TEST_ASSERT_EQUAL_INT(0, csr->idx[0]);
+    TEST_ASSERT_EQUAL_INT(3, csr->idx[1]);
+    TEST_ASSERT_EQUAL_UINT64(2, csr->ptr[1]);
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, sparse_get_value(csr, 1, 1));
+    TEST_ASSERT_EQUAL_DOUBLE(8.0, sparse_get_value(csr, 1, 4));
+    TEST_ASSERT_EQUAL_DOUBLE(6.0, sparse_get_value(csc, 3, 2));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, sparse_get_value(csc, 3, 3));
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+
+    sparse_get_value(csr, 4, 1);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    rows[0] = 3;
+    TEST_ASSERT_NULL(sparse_from_triplets(3, 4, 6, rows, cols, values, SPARSE_CSR));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    destroy_sparse_matrix(csr);
+    destroy_sparse_matrix(csc);
+}
+
+
+void test_sparse_dense_conversions(void) {
+    sparse_matrix* csr = dense_to_sparse(mat1, SPARSE_CSR);
+    sparse_matrix* csc = sparse_convert(csr, SPARSE_CSC);
+    sparse_matrix* back = sparse_convert(csc, SPARSE_CSR);
+    matrix *from_csr = sparse_to_dense(csr), *from_csc = sparse_to_dense(csc);
+
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, max_difference(mat1, from_csr));
+    TEST_ASSERT_EQUAL_DOUBLE(0.0, max_difference(mat1, from_csc));
+    TEST_ASSERT_EQUAL_UINT64(csr->nnz, back->nnz);
+    TEST_ASSERT_EQUAL_MEMORY(csr->ptr, back->ptr, 204 * sizeof(size_t));
+    TEST_ASSERT_EQUAL_INT_ARRAY(csr->idx, back->idx, csr->nnz);
+    TEST_ASSERT_EQUAL_DOUBLE_ARRAY(csr->values, back->values, csr->nnz);
+
+    // Indices of every column are sorted
+    for (int j = 0; j < csc->cols; j++) {
+        for (size_t k = csc->ptr[j] + 1; k < csc->ptr[j + 1]; k++) {
+            TEST_ASSERT_TRUE(csc->idx[k - 1] < csc->idx[k]);
+        }
+    }
+
+    destroy_sparse_matrix(csr);
+    destroy_sparse_matrix(csc);
+    destroy_sparse_matrix(back);
+    destroy_matrix(from_csr);
+    destroy_matrix(from_csc);
+}
+
+
+void test_sparse_multiply_vector(void) {
+    // Enough stored elements to split the product across threads
+    matrix *a = random_sparse_dense(700, 400, 0.3), *x = random_matrix(400, 1), *y0 = random_matrix(700, 1), *expected, *product;
+    sparse_matrix* formats[] = { dense_to_sparse(a, SPARSE_CSR), dense_to_sparse(a, SPARSE_CSC) };
+    int threads[] = { 1, 3 };
+    double y[700];
+
+    product = multiply_by_matrix(a, x);
+    expected = multiply_by_scalar(product, 2.0);
+    scale_inplace(y0, -0.5);
+    add_inplace(expected, y0);
+    scale_inplace(y0, -2.0);
+
+    for (int isa = MATRIX_ISA_SCALAR; isa <= (int)matrix_detect_isa(); isa++) {
+        matrix_set_isa((matrix_isa)isa);
+        for (int f = 0; f < 2; f++) {
+            for (int t = 0; t < 2; t++) {
+                matrix_set_num_threads(threads[t]);
+                for (int i = 0; i < 700; i++) {
+                    y[i] = y0->buffer[i];
+                }
+                sparse_multiply_vector(2.0, formats[f], x->buffer, -0.5, y);
+                TEST_ASSERT_EQUAL(MATRIX_OK, error);
+                for (int i = 0; i < 700; i++) {
+                    TEST_ASSERT_DOUBLE_WITHIN(1e-12, expected->buffer[i], y[i]);
+                }
+            }
+        }
+    }
+
+    sparse_multiply_vector(1.0, formats[0], NULL, 0.0, y);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    destroy_sparse_matrix(formats[0]);
+    destroy_sparse_matrix(formats[1]);
+    destroy_matrix(a);
+    destroy_matrix(x);
+    destroy_matrix(y0);
+    destroy_matrix(expected);
+    destroy_matrix(product);
+}
+
+
+void test_sparse_multiply_dense(void) {
+    matrix *b = random_matrix(157, 1100), *expected = multiply_by_matrix(mat1, b);
+    matrix *bt = transpose(b), *b_view = transpose_view(bt), *ct = create_zero_matrix(1100, 203), *c_view = transpose_view(ct);
+    sparse_matrix* formats[] = { dense_to_sparse(mat1, SPARSE_CSR), dense_to_sparse(mat1, SPARSE_CSC) };
+    int threads[] = { 1, 4 };
+
+    for (int f = 0; f < 2; f++) {
+        for (int t = 0; t < 2; t++) {
+            matrix_set_num_threads(threads[t]);
+
+            mat3 = sparse_multiply_by_matrix(formats[f], b);
+            TEST_ASSERT_NOT_NULL(mat3);
+            TEST_ASSERT_TRUE(max_difference(mat3, expected) < 1e-12);
+
+            // Accumulate a second product through views of B and C
+            sparse_multiply_dense(1.0, formats[f], b, 0.0, c_view);
+            sparse_multiply_dense(-1.0, formats[f], b_view, 2.0, c_view);
+            TEST_ASSERT_EQUAL(MATRIX_OK, error);
+            TEST_ASSERT_TRUE(max_difference(c_view, expected) < 1e-12);
+
+            destroy_matrix(mat3);
+        }
+    }
+
+    sparse_multiply_dense(1.0, formats[0], bt, 0.0, c_view);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+
+    destroy_sparse_matrix(formats[0]);
+    destroy_sparse_matrix(formats[1]);
+    destroy_matrix(b);
+    destroy_matrix(bt);
+    destroy_matrix(b_view);
+    destroy_matrix(ct);
+    destroy_matrix(c_view);
+    destroy_matrix(expected);
+}
+
+
+void test_sparse_empty_rows(void) {
+    // A matrix without stored elements and one with a single dense row
+    matrix* x = random_matrix(157, 1);
+    sparse_matrix* empty = create_sparse_matrix(203, 157, 0, SPARSE_CSR);
+    sparse_matrix* row;
+    double y[203];
+
+    sparse_multiply_vector(1.0, empty, x->buffer, 0.0, y);
+    for (int i = 0; i < 203; i++) {
+        TEST_ASSERT_EQUAL_DOUBLE(0.0, y[i]);
+    }
+
+    mat2 = create_zero_matrix(203, 157);
+    for (int j = 0; j < 157; j++) {
+        MATRIX_AT(mat2, 7, j) = 1.0;
+    }
+    row = dense_to_sparse(mat2, SPARSE_CSR);
+    matrix_set_num_threads(4);
+    sparse_multiply_vector(1.0, row, x->buffer, 0.0, y);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, 0.0, y[0]);
+
+    double sum = 0.0;
+    for (int j = 0; j < 157; j++) {
+        sum += x->buffer[j];
+    }
+    TEST_ASSERT_DOUBLE_WITHIN(1e-12, sum, y[7]);
+
+    destroy_sparse_matrix(empty);
+    destroy_sparse_matrix(row);
+    destroy_matrix(mat2);
+    destroy_matrix(x);
+}
+
+void test_sparse_multiply_sparse(void) {
+    // Enough multiply-adds to split both phases across threads
+    matrix *a = random_sparse_dense(300, 250, 0.1), *b = random_sparse_dense(250, 280, 0.1), *expected = multiply_by_matrix(a, b);
+    sparse_matrix* formats[] = { dense_to_sparse(a, SPARSE_CSR), dense_to_sparse(a, SPARSE_CSC) };
+    sparse_matrix* b_csc = dense_to_sparse(b, SPARSE_CSC);
+    int threads[] = { 1, 3 };
+
+    for (int f = 0; f < 2; f++) {
+        for (int t = 0; t < 2; t++) {
+            matrix_set_num_threads(threads[t]);
+            sparse_matrix* c = sparse_multiply_sparse(formats[f], b_csc);
+            TEST_ASSERT_NOT_NULL(c);
+            TEST_ASSERT_EQUAL(MATRIX_OK, error);
+            TEST_ASSERT_EQUAL(SPARSE_CSR, c->format);
+
+            // Indices of every row are sorted and unique
+            for (int i = 0; i < c->rows; i++) {
+                for (size_t k = c->ptr[i] + 1; k < c->ptr[i + 1]; k++) {
+                    TEST_ASSERT_TRUE(c->idx[k - 1] < c->idx[k]);
+                }
+            }
+
+            mat3 = sparse_to_dense(c);
+            TEST_ASSERT_TRUE(max_difference(mat3, expected) < 1e-12);
+            destroy_matrix(mat3);
+            destroy_sparse_matrix(c);
+        }
+    }
+
+    TEST_ASSERT_NULL(sparse_multiply_sparse(b_csc, formats[0]));
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    TEST_ASSERT_NULL(sparse_multiply_sparse(NULL, b_csc));
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+
+    destroy_sparse_matrix(formats[0]);
+    destroy_sparse_matrix(formats[1]);
+    destroy_sparse_matrix(b_csc);
+    destroy_matrix(a);
+    destroy_matrix(b);
+    destroy_matrix(expected);
+}
+
+
+void test_sparse_multiply_sparse_hashed(void) {
+    // B is too wide for dense accumulators, the reference sums all products as triplets
+    enum { FILLED = 40, COLS = 300000, PER_ROW = 30 };
+    int b_rows[FILLED * PER_ROW], b_cols[FILLED * PER_ROW];
+    double b_values[FILLED * PER_ROW];
+    sparse_matrix *a = dense_to_sparse(mat1, SPARSE_CSR), *b, *c, *expected;
+    sparse_matrix* empty = create_sparse_matrix(203, 157, 0, SPARSE_CSR);
+    size_t n = 0;
+
+    for (int k = 0; k < FILLED * PER_ROW; k++) {
+        b_rows[k] = k / PER_ROW;
+        b_cols[k] = rand() % 64 * (COLS / 64) + k % 3;
+        b_values[k] = (double)rand() / RAND_MAX - 0.5;
+    }
+    b = sparse_from_triplets(157, COLS, FILLED * PER_ROW, b_rows, b_cols, b_values, SPARSE_CSR);
+
+    int* rows = malloc((a->nnz * PER_ROW + 1) * sizeof(int));
+    int* cols = malloc((a->nnz * PER_ROW + 1) * sizeof(int));
+    double* values = malloc((a->nnz * PER_ROW + 1) * sizeof(double));
+    for (int i = 0; i < a->rows; i++) {
+        for (size_t k = a->ptr[i]; k < a->ptr[i + 1]; k++) {
+            for (size_t l = b->ptr[a->idx[k]]; l < b->ptr[a->idx[k] + 1]; l++) {
+                rows[n] = i;
+                cols[n] = b->idx[l];
+                values[n++] = a->values[k] * b->values[l];
+            }
+        }
+    }
+    expected = sparse_from_triplets(203, COLS, n, rows, cols, values, SPARSE_CSR);
+
+    c = sparse_multiply_sparse(a, b);
+    TEST_ASSERT_NOT_NULL(c);
+    TEST_ASSERT_EQUAL_UINT64(expected->nnz, c->nnz);
+    TEST_ASSERT_EQUAL_MEMORY(expected->ptr, c->ptr, 204 * sizeof(size_t));
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected->idx, c->idx, c->nnz);
+    for (size_t k = 0; k < c->nnz; k++) {
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, expected->values[k], c->values[k]);
+    }
+    destroy_sparse_matrix(c);
+
+    // A product without stored elements
+    c = sparse_multiply_sparse(empty, b);
+    TEST_ASSERT_NOT_NULL(c);
+    TEST_ASSERT_EQUAL_UINT64(0, c->nnz);
+    TEST_ASSERT_EQUAL_UINT64(0, c->ptr[203]);
+    destroy_sparse_matrix(c);
+
+    free(rows);
+    free(cols);
+    free(values);
+    destroy_sparse_matrix(a);
+    destroy_sparse_matrix(b);
+    destroy_sparse_matrix(empty);
+    destroy_sparse_matrix(expected);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sparse_from_triplets);
+    RUN_TEST(test_sparse_dense_conversions);
+    RUN_TEST(test_sparse_multiply_vector);
+    RUN_TEST(test_sparse_multiply_dense);
+    RUN_TEST(test_sparse_empty_rows);
+    RUN_TEST(test_sparse_multiply_sparse);
+    RUN_TEST(test_sparse_multiply_sparse_hashed);
+    return UNITY_END();
+}
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "unity.h"
+#include "matrix.h"
+#include "gemm.h"
+#include "linalg.h"
+#include "eigen.h"
+#include "svd.h"
+#include "thread_pool.h"
+#include "test_helpers.h"
+
+matrix *mat1, *mat2, *mat3;
+
+
+static matrix* random_orthonormal(int rows, int cols) {
+    // Q of the QR factorization of a random matrix
+    matrix *a = random_matrix(rows, cols), *q;
+    double* tau = malloc(cols * sizeof(double));
+
+    qr_factor(a, tau);
+    q = qr_form_q(a, tau, 0);
+    destroy_matrix(a);
+    free(tau);
+    return q;
+}
+
+
+static matrix* with_singular_values(int rows, int cols, const double* s) {
+    // U0 * diag(s) * V0^T for random orthonormal U0 and V0
+    int k = rows < cols ? rows : cols;
+    matrix *u = random_orthonormal(rows, k), *v = random_orthonormal(cols, k), *mat = initialize_matrix(rows, cols);
+
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < k; j++) {
+            MATRIX_AT(u, i, j) *= s[j];
+        }
+    }
+    gemm(1.0, u, MATRIX_NO_TRANS, v, MATRIX_TRANS, 0.0, mat);
+
+    destroy_matrix(u);
+    destroy_matrix(v);
+    return mat;
+}
+
+
+static void check_orthonormal(matrix* q, double tolerance) {
+    matrix* qtq = initialize_matrix(q->cols, q->cols);
+
+    gemm(1.0, q, MATRIX_TRANS, q, MATRIX_NO_TRANS, 0.0, qtq);
+    for (int i = 0; i < q->cols; i++) {
+        for (int j = 0; j < q->cols; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(tolerance, i == j ? 1.0 : 0.0, MATRIX_AT(qtq, i, j));
+        }
+    }
+    destroy_matrix(qtq);
+}
+
+
+static void check_svd(matrix* a, double tolerance) {
+    // A = U * diag(s) * V^T with orthonormal U and V and descending s
+    int k = a->rows < a->cols ? a->rows : a->cols;
+    matrix *u = initialize_matrix(a->rows, k), *v = initialize_matrix(a->cols, k), *product = initialize_matrix(a->rows, a->cols);
+    double *s = malloc(k * sizeof(double)), *only = malloc(k * sizeof(double));
+
+    svd(a, s, u, v);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    check_orthonormal(u, tolerance);
+    check_orthonormal(v, tolerance);
+
+    for (int j = 0; j < k; j++) {
+        if (j > 0) {
+            TEST_ASSERT_TRUE(s[j - 1] >= s[j]);
+        }
+        for (int i = 0; i < a->rows; i++) {
+            MATRIX_AT(u, i, j) *= s[j];
+        }
+    }
+    gemm(1.0, u, MATRIX_NO_TRANS, v, MATRIX_TRANS, 0.0, product);
+    for (int i = 0; i < a->rows; i++) {
+        for (int j = 0; j < a->cols; j++) {
+            TEST_ASSERT_DOUBLE_WITHIN(tolerance, MATRIX_AT(a, i, j), MATRIX_AT(product, i, j));
+        }
+    }
+
+    svd(a, only, NULL, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int j = 0; j < k; j++) {
+        TEST_ASSERT_DOUBLE_WITHIN(tolerance, s[j], only[j]);
+    }
+
+    destroy_matrix(u);
+    destroy_matrix(v);
+    destroy_matrix(product);
+    free(s);
+    free(only);
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    mat1 = random_matrix(300, 120);
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_num_threads(0);
+    destroy_matrix(mat1);
+}
+
+
+void test_svd_shapes(void) {
+    matrix *wide = random_matrix(70, 150), *square = random_matrix(101, 101), *view = transpose_view(mat1);
+
+    check_svd(mat1, 1e-12);
+    matrix_set_num_threads(3);
+    check_svd(wide, 1e-12);
+    check_svd(square, 1e-12);
+    check_svd(view, 1e-12);
+
+    destroy_matrix(wide);
+    destroy_matrix(square);
+    destroy_matrix(view);
+}
+
+
+void test_svd_values(void) {
+    // Squares of the singular values are the eigenvalues of A^T * A
+    double s[120], eigenvalues[120];
+
+    mat2 = initialize_matrix(120, 120);
+    gemm(1.0, mat1, MATRIX_TRANS, mat1, MATRIX_NO_TRANS, 0.0, mat2);
+    eigen_symmetric(mat2, eigenvalues, NULL);
+    svd(mat1, s, NULL, NULL);
+    for (int i = 0; i < 120; i++) {
+        TEST_ASSERT_DOUBLE_WITHIN(1e-11, eigenvalues[119 - i], s[i] * s[i]);
+    }
+    destroy_matrix(mat2);
+
+    // A zero column gives a zero singular value
+    for (int i = 0; i < 300; i++) {
+        MATRIX_AT(mat1, i, 17) = 0.0;
+    }
+    svd(mat1, s, NULL, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_DOUBLE_WITHIN(1e-13, 0.0, s[119]);
+    TEST_ASSERT_TRUE(s[118] > 1e-3);
+}
+
+
+void test_svd_randomized(void) {
+    // Quickly decaying spectrum, the top singular triplets are accurate
+    double expected[200], s[8];
+
+    for (int i = 0; i < 200; i++) {
+        expected[i] = exp(-i / 4.0);
+    }
+    mat2 = with_singular_values(500, 200, expected);
+    mat3 = initialize_matrix(500, 8);
+    matrix *v = initialize_matrix(200, 8), *exact_u = initialize_matrix(500, 200), *exact_v = initialize_matrix(200, 200);
+    double exact[200];
+
+    svd(mat2, exact, exact_u, exact_v);
+    for (int t = 1; t <= 3; t += 2) {
+        matrix_set_num_threads(t);
+        svd_randomized(mat2, 8, 10, 2, s, mat3, v);
+        TEST_ASSERT_EQUAL(MATRIX_OK, error);
+        check_orthonormal(mat3, 1e-12);
+        check_orthonormal(v, 1e-12);
+
+        for (int j = 0; j < 8; j++) {
+            double dot_u = 0.0, dot_v = 0.0;
+            TEST_ASSERT_DOUBLE_WITHIN(1e-10, expected[j], s[j]);
+            for (int i = 0; i < 500; i++) {
+                dot_u += MATRIX_AT(mat3, i, j) * MATRIX_AT(exact_u, i, j);
+            }
+            for (int i = 0; i < 200; i++) {
+                dot_v += MATRIX_AT(v, i, j) * MATRIX_AT(exact_v, i, j);
+            }
+            // Singular vectors are unique up to their sign
+            TEST_ASSERT_DOUBLE_WITHIN(1e-8, 1.0, fabs(dot_u));
+            TEST_ASSERT_DOUBLE_WITHIN(1e-8, 1.0, fabs(dot_v));
+            TEST_ASSERT_TRUE(dot_u * dot_v > 0.0);
+        }
+    }
+
+    // A matrix of the exact rank is recovered without oversampling or power iterations
+    for (int i = 5; i < 200; i++) {
+        expected[i] = 0.0;
+    }
+    destroy_matrix(mat2);
+    mat2 = with_singular_values(500, 200, expected);
+    svd_randomized(mat2, 5, 0, 0, s, NULL, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    for (int j = 0; j < 5; j++) {
+        TEST_ASSERT_DOUBLE_WITHIN(1e-12, expected[j], s[j]);
+    }
+
+    destroy_matrix(mat2);
+    destroy_matrix(mat3);
+    destroy_matrix(v);
+    destroy_matrix(exact_u);
+    destroy_matrix(exact_v);
+}
+
+
+void test_svd_should_fail(void) {
+    double s[120];
+
+    svd(NULL, s, NULL, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    mat2 = initialize_matrix(300, 119);
+    svd(mat1, s, mat2, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    svd_randomized(mat1, 121, 5, 1, s, NULL, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    svd_randomized(mat1, 0, 5, 1, s, NULL, NULL);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    svd_randomized(mat1, 10, 5, 1, s, NULL, mat2);
+    TEST_ASSERT_EQUAL(MATRIX_TYPE_ERROR, error);
+    destroy_matrix(mat2);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_svd_shapes);
+    RUN_TEST(test_svd_values);
+    RUN_TEST(test_svd_randomized);
+    RUN_TEST(test_svd_should_fail);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "unity.h"
+#include "matrix.h"
+#include "gemm.h"
+#include "thread_pool.h"
+#include "math.h"
+#include "test_helpers.h"
+
+#define TASKS 1000
+
+matrix *mat1, *mat2, *mat3;
+static atomic_int counts[TASKS];
+
+
+static void count_task(void* ctx, int task, int worker) {
+    int max_workers = *(int*)ctx;
+
+    if (worker >= 0 && worker < max_workers) {
+        atomic_fetch_add(&counts[task], 1);
+    }
+}
+
+
+static void nested_task(void* ctx, int task, int worker) {
+    (void)worker;
+    thread_pool_run(2, 4, count_task, ctx);
+    atomic_fetch_add(&counts[task], 1);
+}
+
+
+void setUp(void) {
+    // This function is called before each test
+    for (int i = 0; i < TASKS; i++) {
+        atomic_store(&counts[i], 0);
+    }
+}
+
+
+void tearDown(void) {
+    // This function is called after each test
+    matrix_set_num_threads(0);
+}
+
+
+void test_thread_pool_runs_every_task_once(void) {
+    int max_workers = 3;
+
+    matrix_set_num_threads(4);
+    thread_pool_run(TASKS, max_workers, count_task, &max_workers);
+
+    for (int i = 0; i < TASKS; i++) {
+        TEST_ASSERT_EQUAL_INT(1, atomic_load(&counts[i]));
+    }
+}
+
+
+void test_thread_pool_nested_run(void) {
+    int max_workers = 4;
+
+    matrix_set_num_threads(4);
+    thread_pool_run(8, max_workers, nested_task, &max_workers);
+
+    // Tasks 0 and 1 are also counted by every nested call
+    TEST_ASSERT_EQUAL_INT(9, atomic_load(&counts[0]));
+    TEST_ASSERT_EQUAL_INT(9, atomic_load(&counts[1]));
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&counts[7]));
+}
+
+
+void test_thread_pool_num_threads(void) {
+    matrix_set_num_threads(3);
+    TEST_ASSERT_EQUAL(MATRIX_OK, error);
+    TEST_ASSERT_EQUAL_INT(3, matrix_get_num_threads());
+
+    matrix_set_num_threads(-1);
+    TEST_ASSERT_EQUAL(MATRIX_INVARGS, error);
+    TEST_ASSERT_EQUAL_INT(3, matrix_get_num_threads());
+}
+
+
+void test_parallel_gemm_matches_serial(void) {
+    matrix* expected;
+    int threads[] = { 2, 3, 8 };
+
+    mat1 = random_matrix(211, 157);
+    mat2 = random_matrix(157, 305);
+
+    matrix_set_num_threads(1);
+    expected = multiply_by_matrix(mat1, mat2);
+
+    for (size_t t = 0; t < ARRAY_LEN(threads); t++) {
+        matrix_set_num_threads(threads[t]);
+        mat3 = multiply_by_matrix(mat1, mat2);
+
+        TEST_ASSERT_NOT_NULL(mat3);
+        for (int i = 0; i < mat3->rows; i++) {
+            for (int j = 0; j < mat3->cols; j++) {
+                TEST_ASSERT_EQUAL_DOUBLE(MATRIX_AT(expected, i, j), MATRIX_AT(mat3, i, j));
+            }
+        }
+        destroy_matrix(mat3);
+    }
+
+    destroy_matrix(expected);
+    destroy_matrix(mat1);
+    destroy_matrix(mat2);
+}
+
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_thread_pool_runs_every_task_once);
+    RUN_TEST(test_thread_pool_nested_run);
+    RUN_TEST(test_thread_pool_num_threads);
+    RUN_TEST(test_parallel_gemm_matches_serial);
+    return UNITY_END();
+}